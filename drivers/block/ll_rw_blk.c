@@ -579,6 +579,51 @@ inline void drive_stat_acct (kdev_t dev, int rw,
 		printk(KERN_ERR "drive_stat_acct: cmd not R/W?\n");
 }
 
+/*
+ * Request size histogram for /proc/request_sizes, reads and writes,
+ * in power-of-two buckets of sectors. A request moves to its new bucket
+ * every time a merge makes it grow, so the counts are of requests the
+ * way the drivers get them. Protected by io_request_lock.
+ */
+#define RQ_SIZE_BUCKETS	12	/* 1, 2-3, 4-7, ... 2048+ sectors */
+
+static unsigned long rq_size_hist[2][RQ_SIZE_BUCKETS];
+
+static inline int rq_size_bucket(unsigned long nr_sectors)
+{
+	int i = 0;
+
+	while (nr_sectors > 1 && i < RQ_SIZE_BUCKETS - 1) {
+		nr_sectors >>= 1;
+		i++;
+	}
+	return i;
+}
+
+static inline void rq_size_acct(int rw, unsigned long from, unsigned long to)
+{
+	if (from)
+		rq_size_hist[rw][rq_size_bucket(from)]--;
+	if (to)
+		rq_size_hist[rw][rq_size_bucket(to)]++;
+}
+
+int get_request_sizes(char *page)
+{
+	int i, len;
+
+	len = sprintf(page, "sectors         reads      writes\n");
+	for (i = 0; i < RQ_SIZE_BUCKETS; i++) {
+		if (i == RQ_SIZE_BUCKETS - 1)
+			len += sprintf(page + len, "%5d+     ", 1 << i);
+		else
+			len += sprintf(page + len, "%5d-%-5d", 1 << i, (2 << i) - 1);
+		len += sprintf(page + len, " %11lu %11lu\n",
+			       rq_size_hist[READ][i], rq_size_hist[WRITE][i]);
+	}
+	return len;
+}
+
 /*
  * add-request adds a request to the linked list.
  * It disables interrupts (acquires the request spinlock) so that it can muck
@@ -595,6 +640,7 @@ static inline void add_request(request_queue_t * q, struct request * req,
 	int major;
 
 	drive_stat_acct(req->rq_dev, req->cmd, req->nr_sectors, 1);
+	rq_size_acct(req->cmd, 0, req->nr_sectors);
 
 	/*
 	 * let selected elevator insert the request
@@ -661,6 +707,9 @@ static void attempt_merge(request_queue_t * q,
 	if(!(q->merge_requests_fn)(q, req, next, max_segments))
 		return;
 
+	rq_size_acct(next->cmd, next->nr_sectors, 0);
+	rq_size_acct(req->cmd, req->nr_sectors,
+		     req->nr_sectors + next->hard_nr_sectors);
 	req->bhtail->b_reqnext = next->bh;
 	req->bhtail = next->bhtail;
 	req->nr_sectors = req->hard_nr_sectors += next->hard_nr_sectors;
@@ -769,6 +818,7 @@ again:
 		case ELEVATOR_BACK_MERGE:
 			if (!q->back_merge_fn(q, req, bh, max_segments))
 				break;
+			rq_size_acct(req->cmd, req->nr_sectors, req->nr_sectors + count);
 			req->bhtail->b_reqnext = bh;
 			req->bhtail = bh;
 			req->nr_sectors = req->hard_nr_sectors += count;
@@ -780,6 +830,7 @@ again:
 		case ELEVATOR_FRONT_MERGE:
 			if (!q->front_merge_fn(q, req, bh, max_segments))
 				break;
+			rq_size_acct(req->cmd, req->nr_sectors, req->nr_sectors + count);
 			bh->b_reqnext = req->bh;
 			req->bh = bh;
 			req->buffer = bh->b_data;
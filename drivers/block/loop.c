@@ -209,8 +209,9 @@ static int lo_send(struct loop_device *lo, char *data, int len, loff_t pos,
 
 write_fail:
 	printk(KERN_ERR "loop: transfer error block %ld\n", index);
+	/* commit nothing, but let the filesystem end what it began */
+	aops->commit_write(file, page, offset, offset);
 	ClearPageUptodate(page);
-	kunmap(page);
 unlock:
 	UnlockPage(page);
 	page_cache_release(page);
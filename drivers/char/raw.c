@@ -10,6 +10,7 @@
 
 #include <linux/fs.h>
 #include <linux/iobuf.h>
+#include <linux/aio.h>
 #include <linux/major.h>
 #include <linux/blkdev.h>
 #include <linux/raw.h>
@@ -31,6 +32,7 @@ ssize_t	raw_write(struct file *, const char *, size_t, loff_t *);
 int	raw_open(struct inode *, struct file *);
 int	raw_release(struct inode *, struct file *);
 int	raw_ctl_ioctl(struct inode *, struct file *, unsigned int, unsigned long);
+int	raw_aio_map(struct file *, int, loff_t, size_t, struct kio_map *);
 
 
 static struct file_operations raw_fops = {
@@ -38,6 +40,7 @@ static struct file_operations raw_fops = {
 	write:		raw_write,
 	open:		raw_open,
 	release:	raw_release,
+	aio_map:	raw_aio_map,
 };
 
 static struct file_operations raw_ctl_fops = {
@@ -342,3 +345,47 @@ ssize_t	rw_raw_dev(int rw, struct file *filp, char *buf,
 	
 	return err;
 }
+
+/*
+ * Map an asynchronous request to sectors of the bound device.
+ */
+int raw_aio_map(struct file *filp, int rw, loff_t pos, size_t count,
+		struct kio_map *map)
+{
+	int		minor;
+	int		i;
+	kdev_t		dev;
+	unsigned long	blocknr, blocks, limit;
+	int		sector_size, sector_bits, sector_mask;
+
+	minor = MINOR(filp->f_dentry->d_inode->i_rdev);
+	dev = to_kdev_t(raw_device_bindings[minor]->bd_dev);
+	sector_size = raw_device_sector_size[minor];
+	sector_bits = raw_device_sector_bits[minor];
+	sector_mask = sector_size- 1;
+
+	if (blk_size[MAJOR(dev)])
+		limit = (((loff_t) blk_size[MAJOR(dev)][MINOR(dev)]) << BLOCK_SIZE_BITS) >> sector_bits;
+	else
+		limit = INT_MAX;
+
+	if ((pos & sector_mask) || (count & sector_mask))
+		return -EINVAL;
+	blocks = count >> sector_bits;
+	if (blocks > KIO_MAX_SECTORS)
+		return -EINVAL;
+
+	blocknr = pos >> sector_bits;
+	if ((pos >> sector_bits) > limit)
+		blocks = 0;
+	else if (blocks > limit - blocknr)
+		blocks = limit - blocknr;
+
+	map->dev = dev;
+	map->blocksize = sector_size;
+	map->nr_blocks = blocks;
+	map->valid = blocks << sector_bits;
+	for (i = 0; i < blocks; i++)
+		map->blocks[i] = blocknr++;
+	return 0;
+}
@@ -186,7 +186,7 @@ static void go_sync(struct super_block *sb, int remount_flag)
 	       kdevname(sb->s_dev));
 
 	if (remount_flag) {				    /* Remount R/O */
-		int ret, flags;
+		int ret, flags, cpu;
 		struct list_head *p;
 
 		if (sb->s_flags & MS_RDONLY) {
@@ -194,14 +194,16 @@ static void go_sync(struct super_block *sb, int remount_flag)
 			return;
 		}
 
-		file_list_lock();
-		for (p = sb->s_files.next; p != &sb->s_files; p = p->next) {
-			struct file *file = list_entry(p, struct file, f_list);
-			if (file->f_dentry && file_count(file)
-				&& S_ISREG(file->f_dentry->d_inode->i_mode))
-				file->f_mode &= ~2;
+		for (cpu = 0; cpu < NR_CPUS; cpu++) {
+			sb_file_list_lock(cpu);
+			for (p = sb->s_files[cpu].next; p != &sb->s_files[cpu]; p = p->next) {
+				struct file *file = list_entry(p, struct file, f_list);
+				if (file->f_dentry && file_count(file)
+					&& S_ISREG(file->f_dentry->d_inode->i_mode))
+					file->f_mode &= ~2;
+			}
+			sb_file_list_unlock(cpu);
 		}
-		file_list_unlock();
 		DQUOT_OFF(sb);
 		fsync_dev(sb->s_dev);
 		flags = MS_RDONLY;
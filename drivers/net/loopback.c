@@ -80,6 +80,12 @@ static int loopback_xmit(struct sk_buff *skb, struct net_device *dev)
 	else
 		skb_orphan(skb);
 
+	/* We take paged buffers, but the receive side wants them linear */
+	if (skb_is_nonlinear(skb) && skb_linearize(skb, GFP_ATOMIC) != 0) {
+		kfree_skb(skb);
+		return 0;
+	}
+
 	skb->protocol=eth_type_trans(skb,dev);
 	skb->dev=dev;
 #ifndef LOOPBACK_MUST_CHECKSUM
@@ -114,6 +120,11 @@ int __init loopback_init(struct net_device *dev)
 	dev->type		= ARPHRD_LOOPBACK;	/* 0x0001		*/
 	dev->rebuild_header	= eth_rebuild_header;
 	dev->flags		= IFF_LOOPBACK;
+	/* Gathering here is one copy, and the checksum is never looked at */
+	dev->features		= NETIF_F_SG;
+#ifndef LOOPBACK_MUST_CHECKSUM
+	dev->features		|= NETIF_F_NO_CSUM;
+#endif
 	dev->priv = kmalloc(sizeof(struct net_device_stats), GFP_KERNEL);
 	if (dev->priv == NULL)
 			return -ENOMEM;
@@ -0,0 +1,536 @@
+/*
+ *  linux/fs/aio.c
+ *
+ *  Asynchronous block I/O.
+ *
+ *  Requests are mapped to device blocks by the file's aio_map method,
+ *  the user buffer is pinned in a kiobuf and the buffer_heads are sent
+ *  to the driver without waiting for them. Completion is noticed from
+ *  the kiobuf end_io callback, which moves the request over to the
+ *  context's done list; io_getevents() reaps it from there.
+ *
+ *  Contexts belong to the mm, so threads share them and they go away
+ *  with the address space.
+ */
+
+#include <linux/sched.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/slab.h>
+#include <linux/iobuf.h>
+#include <linux/aio.h>
+#include <linux/init.h>
+
+#include <asm/uaccess.h>
+
+static kmem_cache_t *kiocb_cachep;
+
+/* Requests of all the contexts in the system, and their limit */
+int aio_nr;
+int aio_max_nr = 0x10000;
+static spinlock_t aio_nr_lock = SPIN_LOCK_UNLOCKED;
+
+static inline void get_ioctx(struct kioctx *ctx)
+{
+	atomic_inc(&ctx->users);
+}
+
+static inline void put_ioctx(struct kioctx *ctx)
+{
+	if (atomic_dec_and_test(&ctx->users)) {
+		spin_lock(&aio_nr_lock);
+		aio_nr -= ctx->max_reqs;
+		spin_unlock(&aio_nr_lock);
+		kfree(ctx);
+	}
+}
+
+static struct kioctx *lookup_ioctx(aio_context_t id)
+{
+	struct mm_struct *mm = current->mm;
+	struct kioctx *ctx;
+
+	read_lock(&mm->ioctx_list_lock);
+	for (ctx = mm->ioctx_list; ctx; ctx = ctx->next) {
+		if (ctx->id == id) {
+			get_ioctx(ctx);
+			break;
+		}
+	}
+	read_unlock(&mm->ioctx_list_lock);
+	return ctx;
+}
+
+/* Let truncate at the blocks of a request, see generic_file_aio_map() */
+static inline void aio_unpin_blocks(struct kio_map *map)
+{
+	struct inode *inode = map->inode;
+
+	if (inode && atomic_dec_and_test(&inode->i_dio_count))
+		wake_up(&inode->i_wait);
+}
+
+/*
+ * kiobuf end_io callback: all the I/O of the request is done.
+ * Called from interrupt context. Once the request is on the done
+ * list it may be reaped and freed, and once ctx->lock is dropped
+ * the context may go too: touch neither after that.
+ */
+static void aio_kiobuf_done(struct kiobuf *iobuf)
+{
+	struct kiocb *req = (struct kiocb *) iobuf;
+	struct kioctx *ctx = req->ctx;
+	unsigned long flags;
+
+	aio_unpin_blocks(&req->map);
+
+	spin_lock_irqsave(&ctx->lock, flags);
+	list_del(&req->list);
+	list_add_tail(&req->list, &ctx->done_reqs);
+	wake_up(&ctx->wait);
+	spin_unlock_irqrestore(&ctx->lock, flags);
+}
+
+/*
+ * Turn a completed request into its io_event and free it.
+ * The request must already be off the context's lists.
+ */
+static void aio_finish(struct kiocb *req, struct io_event *ev)
+{
+	struct kiobuf *iobuf = &req->iobuf;
+	struct kioctx *ctx = req->ctx;
+
+	brw_kiovec_collect(req->nr_bh, req->bh, req->map.blocksize);
+
+	ev->data = req->data;
+	ev->obj = (unsigned long) req->user_iocb;
+	ev->res = iobuf->errno ? iobuf->errno : req->map.valid;
+	ev->res2 = 0;
+
+	unmap_kiobuf(iobuf);
+	if (iobuf->array_len > KIO_STATIC_PAGES)
+		kfree(iobuf->maplist);
+	fput(req->filp);
+	kmem_cache_free(kiocb_cachep, req);
+
+	spin_lock_irq(&ctx->lock);
+	ctx->nr_reqs--;
+	spin_unlock_irq(&ctx->lock);
+}
+
+static struct kiocb *aio_get_done(struct kioctx *ctx)
+{
+	struct kiocb *req = NULL;
+
+	spin_lock_irq(&ctx->lock);
+	if (!list_empty(&ctx->done_reqs)) {
+		req = list_entry(ctx->done_reqs.next, struct kiocb, list);
+		list_del(&req->list);
+	}
+	spin_unlock_irq(&ctx->lock);
+	return req;
+}
+
+/*
+ * Kill a context: no new requests, wait for the ones in flight
+ * (block I/O can't be called back once it is with the driver)
+ * and throw away the completions nobody reaped.
+ */
+static void aio_kill_ctx(struct kioctx *ctx)
+{
+	DECLARE_WAITQUEUE(wait, current);
+	struct kiocb *req;
+	struct io_event ev;
+
+	spin_lock_irq(&ctx->lock);
+	ctx->dead = 1;
+	spin_unlock_irq(&ctx->lock);
+
+	/* Under ctx->lock, so that aio_kiobuf_done() is out of the context */
+	add_wait_queue(&ctx->wait, &wait);
+	for (;;) {
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		spin_lock_irq(&ctx->lock);
+		if (list_empty(&ctx->active_reqs)) {
+			spin_unlock_irq(&ctx->lock);
+			break;
+		}
+		spin_unlock_irq(&ctx->lock);
+		run_task_queue(&tq_disk);
+		schedule();
+	}
+	current->state = TASK_RUNNING;
+	remove_wait_queue(&ctx->wait, &wait);
+
+	while ((req = aio_get_done(ctx)) != NULL)
+		aio_finish(req, &ev);
+}
+
+void exit_aio(struct mm_struct *mm)
+{
+	struct kioctx *ctx;
+
+	for (;;) {
+		write_lock(&mm->ioctx_list_lock);
+		ctx = mm->ioctx_list;
+		if (ctx)
+			mm->ioctx_list = ctx->next;
+		write_unlock(&mm->ioctx_list_lock);
+		if (!ctx)
+			break;
+		aio_kill_ctx(ctx);
+		put_ioctx(ctx);
+	}
+}
+
+/*
+ * Context ids are handed to user space instead of kernel addresses.
+ * Never 0, and unique within @mm.  Under mm->ioctx_list_lock.
+ */
+static aio_context_t aio_new_id(struct mm_struct *mm)
+{
+	static aio_context_t next_id;
+	struct kioctx *ctx;
+	aio_context_t id;
+
+again:
+	spin_lock(&aio_nr_lock);
+	id = ++next_id;
+	spin_unlock(&aio_nr_lock);
+	if (!id)
+		goto again;
+	for (ctx = mm->ioctx_list; ctx; ctx = ctx->next)
+		if (ctx->id == id)
+			goto again;
+	return id;
+}
+
+asmlinkage long sys_io_destroy(aio_context_t id);
+
+/*
+ * Each context is charged its nr_reqs against fs.aio-max-nr, so that
+ * the memory pinned by requests in flight stays bounded.
+ */
+asmlinkage long sys_io_setup(unsigned nr_reqs, aio_context_t *ctxp)
+{
+	struct mm_struct *mm = current->mm;
+	struct kioctx *ctx;
+	aio_context_t id;
+
+	if (!nr_reqs || nr_reqs > AIO_MAX_REQS)
+		return -EINVAL;
+
+	spin_lock(&aio_nr_lock);
+	if (aio_nr + (int) nr_reqs > aio_max_nr) {
+		spin_unlock(&aio_nr_lock);
+		return -EAGAIN;
+	}
+	aio_nr += nr_reqs;
+	spin_unlock(&aio_nr_lock);
+
+	ctx = kmalloc(sizeof(*ctx), GFP_KERNEL);
+	if (!ctx) {
+		spin_lock(&aio_nr_lock);
+		aio_nr -= nr_reqs;
+		spin_unlock(&aio_nr_lock);
+		return -ENOMEM;
+	}
+	atomic_set(&ctx->users, 1);
+	ctx->dead = 0;
+	spin_lock_init(&ctx->lock);
+	init_waitqueue_head(&ctx->wait);
+	INIT_LIST_HEAD(&ctx->active_reqs);
+	INIT_LIST_HEAD(&ctx->done_reqs);
+	ctx->nr_reqs = 0;
+	ctx->max_reqs = nr_reqs;
+
+	write_lock(&mm->ioctx_list_lock);
+	id = ctx->id = aio_new_id(mm);
+	ctx->next = mm->ioctx_list;
+	mm->ioctx_list = ctx;
+	write_unlock(&mm->ioctx_list_lock);
+
+	if (put_user(id, ctxp)) {
+		sys_io_destroy(id);
+		return -EFAULT;
+	}
+	return 0;
+}
+
+asmlinkage long sys_io_destroy(aio_context_t id)
+{
+	struct mm_struct *mm = current->mm;
+	struct kioctx *ctx, **p;
+
+	write_lock(&mm->ioctx_list_lock);
+	for (p = &mm->ioctx_list; (ctx = *p) != NULL; p = &ctx->next) {
+		if (ctx->id == id) {
+			*p = ctx->next;
+			break;
+		}
+	}
+	write_unlock(&mm->ioctx_list_lock);
+	if (!ctx)
+		return -EINVAL;
+
+	aio_kill_ctx(ctx);
+	put_ioctx(ctx);
+	return 0;
+}
+
+static int io_submit_one(struct kioctx *ctx, struct iocb *user_iocb)
+{
+	struct iocb iocb;
+	struct kiocb *req;
+	struct kiobuf *iobuf;
+	struct file *filp;
+	int rw, err;
+
+	if (copy_from_user(&iocb, user_iocb, sizeof(iocb)))
+		return -EFAULT;
+
+	switch (iocb.aio_lio_opcode) {
+		case IOCB_CMD_PREAD:
+			rw = READ;
+			break;
+		case IOCB_CMD_PWRITE:
+			rw = WRITE;
+			break;
+		default:
+			return -EINVAL;
+	}
+	/* No wrapping buffers or offsets */
+	if ((size_t) iocb.aio_nbytes != iocb.aio_nbytes ||
+	    (unsigned long) iocb.aio_buf != iocb.aio_buf ||
+	    iocb.aio_offset < 0)
+		return -EINVAL;
+
+	filp = fget(iocb.aio_fildes);
+	if (!filp)
+		return -EBADF;
+	err = -EBADF;
+	if (!(filp->f_mode & (rw == READ ? FMODE_READ : FMODE_WRITE)))
+		goto out_fput;
+	err = -EINVAL;
+	if (!filp->f_op || !filp->f_op->aio_map)
+		goto out_fput;
+
+	err = -ENOMEM;
+	req = kmem_cache_alloc(kiocb_cachep, SLAB_KERNEL);
+	if (!req)
+		goto out_fput;
+	iobuf = &req->iobuf;
+	kiobuf_init(iobuf);
+	iobuf->end_io = aio_kiobuf_done;
+	req->ctx = ctx;
+	req->filp = filp;
+	req->user_iocb = user_iocb;
+	req->data = iocb.aio_data;
+	req->nr_bh = 0;
+	req->map.inode = NULL;
+
+	err = filp->f_op->aio_map(filp, rw, iocb.aio_offset, iocb.aio_nbytes, &req->map);
+	if (err)
+		goto out_free;
+
+	err = map_user_kiobuf(rw, iobuf, (unsigned long) iocb.aio_buf,
+			      req->map.nr_blocks * req->map.blocksize);
+	if (err)
+		goto out_free;
+
+	spin_lock_irq(&ctx->lock);
+	err = -EINVAL;
+	if (ctx->dead)
+		goto out_unlock;
+	err = -EAGAIN;
+	if (ctx->nr_reqs >= ctx->max_reqs)
+		goto out_unlock;
+	ctx->nr_reqs++;
+	list_add_tail(&req->list, &ctx->active_reqs);
+	spin_unlock_irq(&ctx->lock);
+
+	err = brw_kiovec_async(rw, iobuf, req->map.dev, req->map.blocks,
+			       req->map.nr_blocks, req->map.blocksize, req->bh);
+	if (err < 0) {
+		spin_lock_irq(&ctx->lock);
+		list_del(&req->list);
+		ctx->nr_reqs--;
+		spin_unlock_irq(&ctx->lock);
+		goto out_unmap;
+	}
+	/* Only now may it complete, and be reaped by someone else */
+	req->nr_bh = err;
+	end_kio_request(iobuf, 1);
+	return 0;
+
+out_unlock:
+	spin_unlock_irq(&ctx->lock);
+out_unmap:
+	unmap_kiobuf(iobuf);
+out_free:
+	aio_unpin_blocks(&req->map);
+	if (iobuf->array_len > KIO_STATIC_PAGES)
+		kfree(iobuf->maplist);
+	kmem_cache_free(kiocb_cachep, req);
+out_fput:
+	fput(filp);
+	return err;
+}
+
+/*
+ * Queue up to nr requests. Returns the number queued, or the error
+ * of the first one if none could be.
+ */
+asmlinkage long sys_io_submit(aio_context_t id, long nr, struct iocb **iocbpp)
+{
+	struct kioctx *ctx;
+	long i, err = 0;
+
+	if (nr < 0)
+		return -EINVAL;
+
+	ctx = lookup_ioctx(id);
+	if (!ctx)
+		return -EINVAL;
+
+	for (i = 0; i < nr; i++) {
+		struct iocb *user_iocb;
+
+		err = -EFAULT;
+		if (get_user(user_iocb, iocbpp + i))
+			break;
+		err = io_submit_one(ctx, user_iocb);
+		if (err)
+			break;
+	}
+	/* Get the driver going on what we queued */
+	run_task_queue(&tq_disk);
+
+	put_ioctx(ctx);
+	return i ? i : err;
+}
+
+/*
+ * Reap between min_nr and nr completions, waiting up to timeout
+ * (forever if NULL) for the first min_nr. Passing min_nr == 0 just
+ * polls.
+ */
+asmlinkage long sys_io_getevents(aio_context_t id, long min_nr, long nr,
+				 struct io_event *events, struct timespec *timeout)
+{
+	DECLARE_WAITQUEUE(wait, current);
+	long timeout_jiffies = MAX_SCHEDULE_TIMEOUT;
+	struct kioctx *ctx;
+	struct kiocb *req;
+	struct io_event ev;
+	long i, err = 0;
+
+	if (min_nr < 0 || nr < min_nr)
+		return -EINVAL;
+	if (timeout) {
+		struct timespec ts;
+
+		if (copy_from_user(&ts, timeout, sizeof(ts)))
+			return -EFAULT;
+		if (ts.tv_sec < 0 || ts.tv_nsec < 0 || ts.tv_nsec >= 1000000000L)
+			return -EINVAL;
+		timeout_jiffies = timespec_to_jiffies(&ts);
+	}
+
+	ctx = lookup_ioctx(id);
+	if (!ctx)
+		return -EINVAL;
+
+	for (i = 0; i < nr; ) {
+		req = aio_get_done(ctx);
+		if (req) {
+			aio_finish(req, &ev);
+			if (copy_to_user(events + i, &ev, sizeof(ev))) {
+				err = -EFAULT;
+				break;
+			}
+			i++;
+			continue;
+		}
+
+		if (i >= min_nr || !timeout_jiffies)
+			break;
+		err = -EINTR;
+		if (signal_pending(current))
+			break;
+		err = 0;
+
+		add_wait_queue(&ctx->wait, &wait);
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (list_empty(&ctx->done_reqs)) {
+			run_task_queue(&tq_disk);
+			timeout_jiffies = schedule_timeout(timeout_jiffies);
+		}
+		current->state = TASK_RUNNING;
+		remove_wait_queue(&ctx->wait, &wait);
+	}
+
+	put_ioctx(ctx);
+	return i ? i : err;
+}
+
+/*
+ * Once block I/O has been handed to the driver there is no pulling
+ * it back, so only requests that have completed but haven't been
+ * reaped can be cancelled. Their completion is returned in *result.
+ * Requests still in flight get -EAGAIN.
+ */
+asmlinkage long sys_io_cancel(aio_context_t id, struct iocb *user_iocb,
+			      struct io_event *result)
+{
+	struct kioctx *ctx;
+	struct kiocb *req = NULL;
+	struct list_head *tmp;
+	struct io_event ev;
+	long err;
+
+	ctx = lookup_ioctx(id);
+	if (!ctx)
+		return -EINVAL;
+
+	spin_lock_irq(&ctx->lock);
+	list_for_each(tmp, &ctx->done_reqs) {
+		struct kiocb *p = list_entry(tmp, struct kiocb, list);
+		if (p->user_iocb == user_iocb) {
+			list_del(&p->list);
+			req = p;
+			break;
+		}
+	}
+	err = -EINVAL;
+	if (!req) {
+		list_for_each(tmp, &ctx->active_reqs) {
+			if (list_entry(tmp, struct kiocb, list)->user_iocb == user_iocb) {
+				err = -EAGAIN;
+				break;
+			}
+		}
+	}
+	spin_unlock_irq(&ctx->lock);
+
+	if (req) {
+		aio_finish(req, &ev);
+		err = 0;
+		if (copy_to_user(result, &ev, sizeof(ev)))
+			err = -EFAULT;
+	}
+
+	put_ioctx(ctx);
+	return err;
+}
+
+static int __init aio_setup(void)
+{
+	kiocb_cachep = kmem_cache_create("kiocb", sizeof(struct kiocb),
+					 0, SLAB_HWCACHE_ALIGN, NULL, NULL);
+	if (!kiocb_cachep)
+		panic("Cannot create kiocb SLAB cache");
+	return 0;
+}
+
+module_init(aio_setup)
@@ -45,6 +45,7 @@
 #include <linux/quotaops.h>
 #include <linux/iobuf.h>
 #include <linux/highmem.h>
+#include <linux/rcupdate.h>
 
 #include <asm/uaccess.h>
 #include <asm/io.h>
@@ -66,23 +67,175 @@ static char buffersize_index[65] =
 					     number of unused buffer heads */
 
 /* Anti-deadlock ordering:
- *	lru_list_lock > hash_table_lock > free_list_lock > unused_list_lock
+ *	lru set lock > hash chain lock > free_list_lock > unused_list_lock
+ *	lru set lock > hash chain lock > inode_buffers_lock
+ *
+ * Only try_to_free_buffers() and bh_hash_grow() hold more than one lru
+ * set or hash chain lock at a time, and they take them in array order.
  */
 
 #define BH_ENTRY(list) list_entry((list), struct buffer_head, b_inode_buffers)
 
 /*
  * Hash table gook..
+ *
+ * Every chain has a lock of its own.  kupdate replaces the table with
+ * one twice the size when the chains get long (bh_hash_grow()), so a
+ * lookup locks its chain and then checks that the table it hashed
+ * into is still the current one.
+ */
+struct bh_hash_bucket {
+	struct buffer_head *chain;
+	spinlock_t lock;
+};
+
+struct bh_hash_table {
+	unsigned int mask;
+	unsigned int shift;
+	int order;
+	struct bh_hash_bucket *buckets;
+};
+
+static struct bh_hash_table bh_hash_boot;
+static struct bh_hash_table *bh_hash = &bh_hash_boot;
+static int bh_hash_resizes;
+
+/* Chain lock counters, per CPU so that counting does not bounce */
+struct bh_hash_stat {
+	unsigned long acquired;
+	unsigned long contended;
+} ____cacheline_aligned;
+static struct bh_hash_stat bh_hash_stat[NR_CPUS];
+
+/*
+ * The lru lists are split by device: a device hashes to one of
+ * BH_LRU_SETS sets of lists, each under its own lock, so syncing or
+ * invalidating one disk walks only that disk's buffers and bdflush
+ * does not hold up unrelated devices.  A buffer's b_dev must not
+ * change while it is on an lru list.
+ *
+ * Each set is also a writeback context: it has a flush thread of its
+ * own, so a slow disk only stalls the writeback of its own buffers,
+ * and writers are throttled on their device's dirty data.
+ */
+#define BH_LRU_SETS	16
+
+struct bh_lru_set {
+	spinlock_t lock;
+	struct buffer_head *list[NR_LIST];
+	int nr[NR_LIST];
+	unsigned long size[NR_LIST];
+
+	/* lock statistics, only touched with the lock held */
+	unsigned long acquired;
+	unsigned long contended;
+	cycles_t locked_at;
+	cycles_t hold_total;
+	cycles_t hold_max;
+
+	/* writeback context */
+	struct task_struct *flush_tsk;
+	wait_queue_head_t flush_done;	/* end of a flush round */
+	int flush_old;			/* kupdate wants aged buffers out */
+
+	/* writeback statistics, only touched by flush_tsk */
+	unsigned long wb_buffers;
+	unsigned long wb_kbytes;
+	unsigned long wb_busy;		/* jiffies spent in flush rounds */
+	unsigned long wb_latency;	/* dirty-to-write jiffies, summed */
+	unsigned long wb_latency_max;
+	atomic_t wb_throttled;		/* writers that waited on us */
+} ____cacheline_aligned;
+
+static struct bh_lru_set lru_sets[BH_LRU_SETS];
+
+#define lru_set_index(dev) \
+	((HASHDEV(dev) ^ (HASHDEV(dev) >> 4) ^ (HASHDEV(dev) >> 8)) & (BH_LRU_SETS-1))
+#define lru_set(dev)	(&lru_sets[lru_set_index(dev)])
+
+/* Protects the inode->i_dirty_buffers lists */
+static spinlock_t inode_buffers_lock = SPIN_LOCK_UNLOCKED;
+
+static inline void lru_set_lock(struct bh_lru_set *set)
+{
+	if (!spin_trylock(&set->lock)) {
+		spin_lock(&set->lock);
+		set->contended++;
+	}
+	set->acquired++;
+	set->locked_at = get_cycles();
+}
+
+static inline void lru_set_unlock(struct bh_lru_set *set)
+{
+	cycles_t held = get_cycles() - set->locked_at;
+
+	set->hold_total += held;
+	if (held > set->hold_max)
+		set->hold_max = held;
+	spin_unlock(&set->lock);
+}
+
+/* Sums over all the lru sets, taken without the locks */
+static unsigned long lru_total_size(int blist)
+{
+	unsigned long size = 0;
+	int i;
+
+	for (i = 0; i < BH_LRU_SETS; i++)
+		size += lru_sets[i].size[blist];
+	return size;
+}
+
+static int lru_total_buffers(void)
+{
+	int i, nlist, nr = 0;
+
+	for (i = 0; i < BH_LRU_SETS; i++)
+		for (nlist = 0; nlist < NR_LIST; nlist++)
+			nr += lru_sets[i].nr[nlist];
+	return nr;
+}
+
+/* After several hours of tedious analysis, the following hash
+ * function won.  Do not mess with it... -DaveM
  */
-static unsigned int bh_hash_mask;
-static unsigned int bh_hash_shift;
-static struct buffer_head **hash_table;
-static rwlock_t hash_table_lock = RW_LOCK_UNLOCKED;
+#define _hashfn(shift,dev,block)	\
+	((((dev)<<((shift) - 6)) ^ ((dev)<<((shift) - 9))) ^ \
+	 (((block)<<((shift) - 6)) ^ ((block) >> 13) ^ \
+	  ((block) << ((shift) - 12))))
+#define hash_bucket(table,dev,block) \
+	(&(table)->buckets[_hashfn((table)->shift, HASHDEV(dev), block) & (table)->mask])
+
+static inline void bh_chain_lock(struct bh_hash_bucket *b)
+{
+	struct bh_hash_stat *stat = &bh_hash_stat[smp_processor_id()];
+
+	stat->acquired++;
+	if (!spin_trylock(&b->lock)) {
+		stat->contended++;
+		spin_lock(&b->lock);
+	}
+}
+
+/* Lock the chain that (dev, block) hashes to in the current table. */
+static struct bh_hash_bucket *bh_hash_lock(kdev_t dev, int block)
+{
+	struct bh_hash_table *table;
+	struct bh_hash_bucket *b;
 
-static struct buffer_head *lru_list[NR_LIST];
-static spinlock_t lru_list_lock = SPIN_LOCK_UNLOCKED;
-static int nr_buffers_type[NR_LIST];
-static unsigned long size_buffers_type[NR_LIST];
+	for (;;) {
+		table = bh_hash;
+		smp_rmb();
+		b = hash_bucket(table, dev, block);
+		bh_chain_lock(b);
+		if (table == bh_hash)
+			return b;
+		spin_unlock(&b->lock);
+	}
+}
+
+#define bh_hash_unlock(b)	spin_unlock(&(b)->lock)
 
 static struct buffer_head * unused_list;
 static int nr_unused_buffer_heads;
@@ -97,6 +250,7 @@ static struct bh_free_head free_list[NR_SIZES];
 
 static int grow_buffers(int size);
 static void __refile_buffer(struct buffer_head *);
+static void wait_on_flusher(struct bh_lru_set *);
 
 /* This is used by some architectures to estimate available memory. */
 atomic_t buffermem_pages = ATOMIC_INIT(0);
@@ -172,103 +326,122 @@ void __wait_on_buffer(struct buffer_head * bh)
  * We will ultimately want to put these in a separate list, but for
  * now we search all of the lists for dirty buffers.
  */
-static int sync_buffers(kdev_t dev, int wait)
+static int sync_lru_set(struct bh_lru_set *set, kdev_t dev, int wait,
+			int pass, int *retry)
 {
-	int i, retry, pass = 0, err = 0;
+	int i, err = 0;
 	struct buffer_head * bh, *next;
 
-	/* One pass for no-wait, three for wait:
-	 * 0) write out all dirty, unlocked buffers;
-	 * 1) write out all dirty buffers, waiting if locked;
-	 * 2) wait for completion by waiting for all buffers to unlock.
-	 */
-	do {
-		retry = 0;
-
-		/* We search all lists as a failsafe mechanism, not because we expect
-		 * there to be dirty buffers on any of the other lists.
-		 */
 repeat:
-		spin_lock(&lru_list_lock);
-		bh = lru_list[BUF_DIRTY];
-		if (!bh)
-			goto repeat2;
-
-		for (i = nr_buffers_type[BUF_DIRTY]*2 ; i-- > 0 ; bh = next) {
-			next = bh->b_next_free;
+	lru_set_lock(set);
+	bh = set->list[BUF_DIRTY];
+	if (!bh)
+		goto repeat2;
 
-			if (!lru_list[BUF_DIRTY])
-				break;
-			if (dev && bh->b_dev != dev)
-				continue;
-			if (buffer_locked(bh)) {
-				/* Buffer is locked; skip it unless wait is
-				 * requested AND pass > 0.
-				 */
-				if (!wait || !pass) {
-					retry = 1;
-					continue;
-				}
-				atomic_inc(&bh->b_count);
-				spin_unlock(&lru_list_lock);
-				wait_on_buffer (bh);
-				atomic_dec(&bh->b_count);
-				goto repeat;
-			}
+	for (i = set->nr[BUF_DIRTY]*2 ; i-- > 0 ; bh = next) {
+		next = bh->b_next_free;
 
-			/* If an unlocked buffer is not uptodate, there has
-			 * been an IO error. Skip it.
+		if (!set->list[BUF_DIRTY])
+			break;
+		if (dev && bh->b_dev != dev)
+			continue;
+		if (buffer_locked(bh)) {
+			/* Buffer is locked; skip it unless wait is
+			 * requested AND pass > 0.
 			 */
-			if (wait && buffer_req(bh) && !buffer_locked(bh) &&
-			    !buffer_dirty(bh) && !buffer_uptodate(bh)) {
-				err = -EIO;
+			if (!wait || !pass) {
+				*retry = 1;
 				continue;
 			}
-
-			/* Don't write clean buffers.  Don't write ANY buffers
-			 * on the third pass.
-			 */
-			if (!buffer_dirty(bh) || pass >= 2)
-				continue;
-
 			atomic_inc(&bh->b_count);
-			spin_unlock(&lru_list_lock);
-			ll_rw_block(WRITE, 1, &bh);
+			lru_set_unlock(set);
+			wait_on_buffer (bh);
 			atomic_dec(&bh->b_count);
-			retry = 1;
 			goto repeat;
 		}
 
-    repeat2:
-		bh = lru_list[BUF_LOCKED];
-		if (!bh) {
-			spin_unlock(&lru_list_lock);
-			break;
+		/* If an unlocked buffer is not uptodate, there has
+		 * been an IO error. Skip it.
+		 */
+		if (wait && buffer_req(bh) && !buffer_locked(bh) &&
+		    !buffer_dirty(bh) && !buffer_uptodate(bh)) {
+			err = -EIO;
+			continue;
 		}
-		for (i = nr_buffers_type[BUF_LOCKED]*2 ; i-- > 0 ; bh = next) {
-			next = bh->b_next_free;
 
-			if (!lru_list[BUF_LOCKED])
-				break;
-			if (dev && bh->b_dev != dev)
+		/* Don't write clean buffers.  Don't write ANY buffers
+		 * on the third pass.
+		 */
+		if (!buffer_dirty(bh) || pass >= 2)
+			continue;
+
+		atomic_inc(&bh->b_count);
+		lru_set_unlock(set);
+		ll_rw_block(WRITE, 1, &bh);
+		atomic_dec(&bh->b_count);
+		*retry = 1;
+		goto repeat;
+	}
+
+    repeat2:
+	bh = set->list[BUF_LOCKED];
+	if (!bh) {
+		lru_set_unlock(set);
+		return err;
+	}
+	for (i = set->nr[BUF_LOCKED]*2 ; i-- > 0 ; bh = next) {
+		next = bh->b_next_free;
+
+		if (!set->list[BUF_LOCKED])
+			break;
+		if (dev && bh->b_dev != dev)
+			continue;
+		if (buffer_locked(bh)) {
+			/* Buffer is locked; skip it unless wait is
+			 * requested AND pass > 0.
+			 */
+			if (!wait || !pass) {
+				*retry = 1;
 				continue;
-			if (buffer_locked(bh)) {
-				/* Buffer is locked; skip it unless wait is
-				 * requested AND pass > 0.
-				 */
-				if (!wait || !pass) {
-					retry = 1;
-					continue;
-				}
-				atomic_inc(&bh->b_count);
-				spin_unlock(&lru_list_lock);
-				wait_on_buffer (bh);
-				spin_lock(&lru_list_lock);
-				atomic_dec(&bh->b_count);
-				goto repeat2;
 			}
+			atomic_inc(&bh->b_count);
+			lru_set_unlock(set);
+			wait_on_buffer (bh);
+			lru_set_lock(set);
+			atomic_dec(&bh->b_count);
+			goto repeat2;
+		}
+	}
+	lru_set_unlock(set);
+	return err;
+}
+
+static int sync_buffers(kdev_t dev, int wait)
+{
+	int i, first, last, retry, pass = 0, err = 0;
+
+	/* A single device only has buffers on its own lru set */
+	first = 0;
+	last = BH_LRU_SETS - 1;
+	if (dev)
+		first = last = lru_set_index(dev);
+
+	/* One pass for no-wait, three for wait:
+	 * 0) write out all dirty, unlocked buffers;
+	 * 1) write out all dirty buffers, waiting if locked;
+	 * 2) wait for completion by waiting for all buffers to unlock.
+	 */
+	do {
+		retry = 0;
+
+		/* We search all lists as a failsafe mechanism, not because we expect
+		 * there to be dirty buffers on any of the other lists.
+		 */
+		for (i = first; i <= last; i++) {
+			int ret = sync_lru_set(&lru_sets[i], dev, wait, pass, &retry);
+			if (ret)
+				err = ret;
 		}
-		spin_unlock(&lru_list_lock);
 
 		/* If we are waiting for the sync to succeed, and if any dirty
 		 * blocks were written, then repeat; on the second pass, only
@@ -355,7 +528,7 @@ asmlinkage long sys_fsync(unsigned int fd)
 	struct file * file;
 	struct dentry * dentry;
 	struct inode * inode;
-	int err;
+	int ret, err;
 
 	err = -EBADF;
 	file = fget(fd);
@@ -371,10 +544,15 @@ asmlinkage long sys_fsync(unsigned int fd)
 
 	/* We need to protect against concurrent writers.. */
 	down(&inode->i_sem);
-	filemap_fdatasync(inode->i_mapping);
+	ret = filemap_fdatasync(inode->i_mapping);
 	err = file->f_op->fsync(file, dentry, 0);
-	filemap_fdatawait(inode->i_mapping);
+	if (err && !ret)
+		ret = err;
+	err = filemap_fdatawait(inode->i_mapping);
+	if (err && !ret)
+		ret = err;
 	up(&inode->i_sem);
+	err = ret;
 
 out_putf:
 	fput(file);
@@ -387,7 +565,7 @@ asmlinkage long sys_fdatasync(unsigned int fd)
 	struct file * file;
 	struct dentry * dentry;
 	struct inode * inode;
-	int err;
+	int ret, err;
 
 	err = -EBADF;
 	file = fget(fd);
@@ -402,10 +580,15 @@ asmlinkage long sys_fdatasync(unsigned int fd)
 		goto out_putf;
 
 	down(&inode->i_sem);
-	filemap_fdatasync(inode->i_mapping);
+	ret = filemap_fdatasync(inode->i_mapping);
 	err = file->f_op->fsync(file, dentry, 1);
-	filemap_fdatawait(inode->i_mapping);
+	if (err && !ret)
+		ret = err;
+	err = filemap_fdatawait(inode->i_mapping);
+	if (err && !ret)
+		ret = err;
 	up(&inode->i_sem);
+	err = ret;
 
 out_putf:
 	fput(file);
@@ -413,15 +596,6 @@ out:
 	return err;
 }
 
-/* After several hours of tedious analysis, the following hash
- * function won.  Do not mess with it... -DaveM
- */
-#define _hashfn(dev,block)	\
-	((((dev)<<(bh_hash_shift - 6)) ^ ((dev)<<(bh_hash_shift - 9))) ^ \
-	 (((block)<<(bh_hash_shift - 6)) ^ ((block) >> 13) ^ \
-	  ((block) << (bh_hash_shift - 12))))
-#define hash(dev,block) hash_table[(_hashfn(HASHDEV(dev),block) & bh_hash_mask)]
-
 static __inline__ void __hash_link(struct buffer_head *bh, struct buffer_head **head)
 {
 	if ((bh->b_next = *head) != NULL)
@@ -440,9 +614,11 @@ static __inline__ void __hash_unlink(struct buffer_head *bh)
 	}
 }
 
+/* The lru functions must be called with the buffer's lru set locked */
 static void __insert_into_lru_list(struct buffer_head * bh, int blist)
 {
-	struct buffer_head **bhp = &lru_list[blist];
+	struct bh_lru_set *set = lru_set(bh->b_dev);
+	struct buffer_head **bhp = &set->list[blist];
 
 	if(!*bhp) {
 		*bhp = bh;
@@ -452,22 +628,24 @@ static void __insert_into_lru_list(struct buffer_head * bh, int blist)
 	bh->b_prev_free = (*bhp)->b_prev_free;
 	(*bhp)->b_prev_free->b_next_free = bh;
 	(*bhp)->b_prev_free = bh;
-	nr_buffers_type[blist]++;
-	size_buffers_type[blist] += bh->b_size;
+	set->nr[blist]++;
+	set->size[blist] += bh->b_size;
 }
 
 static void __remove_from_lru_list(struct buffer_head * bh, int blist)
 {
+	struct bh_lru_set *set = lru_set(bh->b_dev);
+
 	if (bh->b_prev_free || bh->b_next_free) {
 		bh->b_prev_free->b_next_free = bh->b_next_free;
 		bh->b_next_free->b_prev_free = bh->b_prev_free;
-		if (lru_list[blist] == bh)
-			lru_list[blist] = bh->b_next_free;
-		if (lru_list[blist] == bh)
-			lru_list[blist] = NULL;
+		if (set->list[blist] == bh)
+			set->list[blist] = bh->b_next_free;
+		if (set->list[blist] == bh)
+			set->list[blist] = NULL;
 		bh->b_next_free = bh->b_prev_free = NULL;
-		nr_buffers_type[blist]--;
-		size_buffers_type[blist] -= bh->b_size;
+		set->nr[blist]--;
+		set->size[blist] -= bh->b_size;
 	}
 }
 
@@ -484,19 +662,16 @@ static void __remove_from_free_list(struct buffer_head * bh, int index)
 	bh->b_next_free = bh->b_prev_free = NULL;
 }
 
-/* must be called with both the hash_table_lock and the lru_list_lock
-   held */
+/* must be called with the buffer's lru set and hash chain locked */
 static void __remove_from_queues(struct buffer_head *bh)
 {
 	__hash_unlink(bh);
 	__remove_from_lru_list(bh, bh->b_list);
 }
 
-static void __insert_into_queues(struct buffer_head *bh)
+static void __insert_into_queues(struct buffer_head *bh, struct bh_hash_bucket *b)
 {
-	struct buffer_head **head = &hash(bh->b_dev, bh->b_blocknr);
-
-	__hash_link(bh, head);
+	__hash_link(bh, &b->chain);
 	__insert_into_lru_list(bh, bh->b_list);
 }
 
@@ -530,9 +705,10 @@ static void put_last_free(struct buffer_head * bh)
  * will force it bad). This shouldn't really happen currently, but
  * the code is ready.
  */
-static inline struct buffer_head * __get_hash_table(kdev_t dev, int block, int size)
+static inline struct buffer_head * __get_hash_table(struct bh_hash_bucket *b,
+						    kdev_t dev, int block, int size)
 {
-	struct buffer_head *bh = hash(dev, block);
+	struct buffer_head *bh = b->chain;
 
 	for (; bh; bh = bh->b_next)
 		if (bh->b_blocknr == block	&&
@@ -547,11 +723,12 @@ static inline struct buffer_head * __get_hash_table(kdev_t dev, int block, int s
 
 struct buffer_head * get_hash_table(kdev_t dev, int block, int size)
 {
+	struct bh_hash_bucket *b;
 	struct buffer_head *bh;
 
-	read_lock(&hash_table_lock);
-	bh = __get_hash_table(dev, block, size);
-	read_unlock(&hash_table_lock);
+	b = bh_hash_lock(dev, block);
+	bh = __get_hash_table(b, dev, block, size);
+	bh_hash_unlock(b);
 
 	return bh;
 }
@@ -577,35 +754,45 @@ unsigned int get_hardblocksize(kdev_t dev)
 
 void buffer_insert_inode_queue(struct buffer_head *bh, struct inode *inode)
 {
-	spin_lock(&lru_list_lock);
+	struct bh_lru_set *set = lru_set(bh->b_dev);
+
+	lru_set_lock(set);
+	spin_lock(&inode_buffers_lock);
 	if (bh->b_inode)
 		list_del(&bh->b_inode_buffers);
 	bh->b_inode = inode;
 	list_add(&bh->b_inode_buffers, &inode->i_dirty_buffers);
-	spin_unlock(&lru_list_lock);
+	spin_unlock(&inode_buffers_lock);
+	lru_set_unlock(set);
 }
 
-/* The caller must have the lru_list lock before calling the 
-   remove_inode_queue functions.  */
+/* The caller must hold inode_buffers_lock. */
 static void __remove_inode_queue(struct buffer_head *bh)
 {
 	bh->b_inode = NULL;
 	list_del(&bh->b_inode_buffers);
 }
 
+/* The caller must hold the buffer's lru set lock, which keeps
+   buffer_insert_inode_queue() out, so b_inode can only be cleared
+   under us.  */
 static inline void remove_inode_queue(struct buffer_head *bh)
 {
-	if (bh->b_inode)
-		__remove_inode_queue(bh);
+	if (bh->b_inode) {
+		spin_lock(&inode_buffers_lock);
+		if (bh->b_inode)
+			__remove_inode_queue(bh);
+		spin_unlock(&inode_buffers_lock);
+	}
 }
 
 int inode_has_buffers(struct inode *inode)
 {
 	int ret;
 	
-	spin_lock(&lru_list_lock);
+	spin_lock(&inode_buffers_lock);
 	ret = !list_empty(&inode->i_dirty_buffers);
-	spin_unlock(&lru_list_lock);
+	spin_unlock(&inode_buffers_lock);
 	
 	return ret;
 }
@@ -635,15 +822,17 @@ void __invalidate_buffers(kdev_t dev, int destroy_dirty_buffers)
 {
 	int i, nlist, slept;
 	struct buffer_head * bh, * bh_next;
+	struct bh_lru_set *set = lru_set(dev);
+	struct bh_hash_bucket *b;
 
  retry:
 	slept = 0;
-	spin_lock(&lru_list_lock);
+	lru_set_lock(set);
 	for(nlist = 0; nlist < NR_LIST; nlist++) {
-		bh = lru_list[nlist];
+		bh = set->list[nlist];
 		if (!bh)
 			continue;
-		for (i = nr_buffers_type[nlist]; i > 0 ; bh = bh_next, i--) {
+		for (i = set->nr[nlist]; i > 0 ; bh = bh_next, i--) {
 			bh_next = bh->b_next_free;
 
 			/* Another device? */
@@ -654,14 +843,14 @@ void __invalidate_buffers(kdev_t dev, int destroy_dirty_buffers)
 				continue;
 			if (buffer_locked(bh)) {
 				atomic_inc(&bh->b_count);
-				spin_unlock(&lru_list_lock);
+				lru_set_unlock(set);
 				wait_on_buffer(bh);
 				slept = 1;
-				spin_lock(&lru_list_lock);
+				lru_set_lock(set);
 				atomic_dec(&bh->b_count);
 			}
 
-			write_lock(&hash_table_lock);
+			b = bh_hash_lock(bh->b_dev, bh->b_blocknr);
 			if (!atomic_read(&bh->b_count) &&
 			    (destroy_dirty_buffers || !buffer_dirty(bh))) {
 				remove_inode_queue(bh);
@@ -670,13 +859,13 @@ void __invalidate_buffers(kdev_t dev, int destroy_dirty_buffers)
 			}
 			/* else complain loudly? */
 
-			write_unlock(&hash_table_lock);
+			bh_hash_unlock(b);
 			if (slept)
 				goto out;
 		}
 	}
 out:
-	spin_unlock(&lru_list_lock);
+	lru_set_unlock(set);
 	if (slept)
 		goto retry;
 }
@@ -686,6 +875,8 @@ void set_blocksize(kdev_t dev, int size)
 	extern int *blksize_size[];
 	int i, nlist, slept;
 	struct buffer_head * bh, * bh_next;
+	struct bh_lru_set *set = lru_set(dev);
+	struct bh_hash_bucket *b;
 
 	if (!blksize_size[MAJOR(dev)])
 		return;
@@ -705,25 +896,25 @@ void set_blocksize(kdev_t dev, int size)
 
  retry:
 	slept = 0;
-	spin_lock(&lru_list_lock);
+	lru_set_lock(set);
 	for(nlist = 0; nlist < NR_LIST; nlist++) {
-		bh = lru_list[nlist];
+		bh = set->list[nlist];
 		if (!bh)
 			continue;
-		for (i = nr_buffers_type[nlist]; i > 0 ; bh = bh_next, i--) {
+		for (i = set->nr[nlist]; i > 0 ; bh = bh_next, i--) {
 			bh_next = bh->b_next_free;
 			if (bh->b_dev != dev || bh->b_size == size)
 				continue;
 			if (buffer_locked(bh)) {
 				atomic_inc(&bh->b_count);
-				spin_unlock(&lru_list_lock);
+				lru_set_unlock(set);
 				wait_on_buffer(bh);
 				slept = 1;
-				spin_lock(&lru_list_lock);
+				lru_set_lock(set);
 				atomic_dec(&bh->b_count);
 			}
 
-			write_lock(&hash_table_lock);
+			b = bh_hash_lock(bh->b_dev, bh->b_blocknr);
 			if (!atomic_read(&bh->b_count)) {
 				if (buffer_dirty(bh))
 					printk(KERN_WARNING
@@ -742,13 +933,13 @@ void set_blocksize(kdev_t dev, int size)
 				       atomic_read(&bh->b_count), bdevname(bh->b_dev),
 				       bh->b_blocknr, __builtin_return_address(0));
 			}
-			write_unlock(&hash_table_lock);
+			bh_hash_unlock(b);
 			if (slept)
 				goto out;
 		}
 	}
  out:
-	spin_unlock(&lru_list_lock);
+	lru_set_unlock(set);
 	if (slept)
 		goto retry;
 }
@@ -859,7 +1050,7 @@ int fsync_inode_buffers(struct inode *inode)
 	
 	INIT_LIST_HEAD(&tmp.i_dirty_buffers);
 	
-	spin_lock(&lru_list_lock);
+	spin_lock(&inode_buffers_lock);
 
 	while (!list_empty(&inode->i_dirty_buffers)) {
 		bh = BH_ENTRY(inode->i_dirty_buffers.next);
@@ -871,27 +1062,27 @@ int fsync_inode_buffers(struct inode *inode)
 			list_add(&bh->b_inode_buffers, &tmp.i_dirty_buffers);
 			if (buffer_dirty(bh)) {
 				atomic_inc(&bh->b_count);
-				spin_unlock(&lru_list_lock);
+				spin_unlock(&inode_buffers_lock);
 				ll_rw_block(WRITE, 1, &bh);
 				brelse(bh);
-				spin_lock(&lru_list_lock);
+				spin_lock(&inode_buffers_lock);
 			}
 		}
 	}
 
 	while (!list_empty(&tmp.i_dirty_buffers)) {
 		bh = BH_ENTRY(tmp.i_dirty_buffers.prev);
-		remove_inode_queue(bh);
+		__remove_inode_queue(bh);
 		atomic_inc(&bh->b_count);
-		spin_unlock(&lru_list_lock);
+		spin_unlock(&inode_buffers_lock);
 		wait_on_buffer(bh);
 		if (!buffer_uptodate(bh))
 			err = -EIO;
 		brelse(bh);
-		spin_lock(&lru_list_lock);
+		spin_lock(&inode_buffers_lock);
 	}
 	
-	spin_unlock(&lru_list_lock);
+	spin_unlock(&inode_buffers_lock);
 	err2 = osync_inode_buffers(inode);
 
 	if (err)
@@ -918,7 +1109,7 @@ int osync_inode_buffers(struct inode *inode)
 	struct list_head *list;
 	int err = 0;
 
-	spin_lock(&lru_list_lock);
+	spin_lock(&inode_buffers_lock);
 	
  repeat:
 	
@@ -927,17 +1118,17 @@ int osync_inode_buffers(struct inode *inode)
 	     list = bh->b_inode_buffers.prev) {
 		if (buffer_locked(bh)) {
 			atomic_inc(&bh->b_count);
-			spin_unlock(&lru_list_lock);
+			spin_unlock(&inode_buffers_lock);
 			wait_on_buffer(bh);
 			if (!buffer_uptodate(bh))
 				err = -EIO;
 			brelse(bh);
-			spin_lock(&lru_list_lock);
+			spin_lock(&inode_buffers_lock);
 			goto repeat;
 		}
 	}
 
-	spin_unlock(&lru_list_lock);
+	spin_unlock(&inode_buffers_lock);
 	return err;
 }
 
@@ -951,14 +1142,14 @@ void invalidate_inode_buffers(struct inode *inode)
 {
 	struct list_head *list, *next;
 	
-	spin_lock(&lru_list_lock);
+	spin_lock(&inode_buffers_lock);
 	list = inode->i_dirty_buffers.next; 
 	while (list != &inode->i_dirty_buffers) {
 		next = list->next;
-		remove_inode_queue(BH_ENTRY(list));
+		__remove_inode_queue(BH_ENTRY(list));
 		list = next;
 	}
-	spin_unlock(&lru_list_lock);
+	spin_unlock(&inode_buffers_lock);
 }
 
 
@@ -975,12 +1166,21 @@ void invalidate_inode_buffers(struct inode *inode)
 struct buffer_head * getblk(kdev_t dev, int block, int size)
 {
 	struct buffer_head * bh;
+	struct bh_lru_set *set = lru_set(dev);
+	struct bh_hash_bucket *b;
 	int isize;
 
 repeat:
-	spin_lock(&lru_list_lock);
-	write_lock(&hash_table_lock);
-	bh = __get_hash_table(dev, block, size);
+	/* A hit only needs the hash chain */
+	bh = get_hash_table(dev, block, size);
+	if (bh) {
+		touch_buffer(bh);
+		return bh;
+	}
+
+	lru_set_lock(set);
+	b = bh_hash_lock(dev, block);
+	bh = __get_hash_table(b, dev, block, size);
 	if (bh)
 		goto out;
 
@@ -1005,10 +1205,10 @@ repeat:
 		bh->b_state = 1 << BH_Mapped;
 
 		/* Insert the buffer into the regular lists */
-		__insert_into_queues(bh);
+		__insert_into_queues(bh, b);
 	out:
-		write_unlock(&hash_table_lock);
-		spin_unlock(&lru_list_lock);
+		bh_hash_unlock(b);
+		lru_set_unlock(set);
 		touch_buffer(bh);
 		return bh;
 	}
@@ -1017,21 +1217,34 @@ repeat:
 	 * If we block while refilling the free list, somebody may
 	 * create the buffer first ... search the hashes again.
 	 */
-	write_unlock(&hash_table_lock);
-	spin_unlock(&lru_list_lock);
+	bh_hash_unlock(b);
+	lru_set_unlock(set);
 	refill_freelist(size);
 	goto repeat;
 }
 
 /* -1 -> no need to flush
     0 -> async flush
-    1 -> sync flush (wait for I/O completation) */
-int balance_dirty_state(kdev_t dev)
-{
-	unsigned long dirty, tot, hard_dirty_limit, soft_dirty_limit;
-	int shortage;
+    1 -> sync flush (wait for I/O completation)
 
-	dirty = size_buffers_type[BUF_DIRTY] >> PAGE_SHIFT;
+   For a single lru set only its own dirty buffers can make writers
+   wait, unless dirty memory as a whole is over the limit and the set
+   holds at least an even share of it.  A NULL set asks about the
+   whole cache. */
+static int lru_set_dirty_state(struct bh_lru_set *set)
+{
+	unsigned long dirty, set_dirty, size, tot, hard_dirty_limit, soft_dirty_limit;
+	int i, shortage, nr_dirty_sets = 0;
+
+	dirty = 0;
+	for (i = 0; i < BH_LRU_SETS; i++) {
+		size = lru_sets[i].size[BUF_DIRTY];
+		if (size) {
+			dirty += size;
+			nr_dirty_sets++;
+		}
+	}
+	dirty >>= PAGE_SHIFT;
 	tot = nr_free_buffer_pages();
 
 	dirty *= 100;
@@ -1039,7 +1252,14 @@ int balance_dirty_state(kdev_t dev)
 	hard_dirty_limit = tot * bdf_prm.b_un.nfract_sync;
 
 	/* First, check for the "real" dirty limit. */
-	if (dirty > soft_dirty_limit) {
+	if (set) {
+		set_dirty = (set->size[BUF_DIRTY] >> PAGE_SHIFT) * 100;
+		if (set_dirty > hard_dirty_limit ||
+		    (dirty > hard_dirty_limit && set_dirty * nr_dirty_sets >= dirty))
+			return 1;
+		if (set_dirty > soft_dirty_limit || dirty > soft_dirty_limit)
+			return 0;
+	} else if (dirty > soft_dirty_limit) {
 		if (dirty > hard_dirty_limit)
 			return 1;
 		return 0;
@@ -1058,12 +1278,17 @@ int balance_dirty_state(kdev_t dev)
 	return -1;
 }
 
+int balance_dirty_state(kdev_t dev)
+{
+	return lru_set_dirty_state(dev == NODEV ? NULL : lru_set(dev));
+}
+
 /*
  * if a new dirty buffer is created we need to balance bdflush.
  *
- * in the future we might want to make bdflush aware of different
- * pressures on different devices - thus the (currently unused)
- * 'dev' parameter.
+ * bdflush kicks the flush threads of every device with dirty
+ * buffers; a writer that has to wait only waits for the flush
+ * thread of the device it dirtied.
  */
 void balance_dirty(kdev_t dev)
 {
@@ -1071,7 +1296,13 @@ void balance_dirty(kdev_t dev)
 
 	if (state < 0)
 		return;
-	wakeup_bdflush(state);
+	if (dev == NODEV) {
+		wakeup_bdflush(state);
+		return;
+	}
+	wakeup_bdflush(0);
+	if (state > 0)
+		wait_on_flusher(lru_set(dev));
 }
 
 static __inline__ void __mark_dirty(struct buffer_head *bh)
@@ -1118,9 +1349,11 @@ static void __refile_buffer(struct buffer_head *bh)
 
 void refile_buffer(struct buffer_head *bh)
 {
-	spin_lock(&lru_list_lock);
+	struct bh_lru_set *set = lru_set(bh->b_dev);
+
+	lru_set_lock(set);
 	__refile_buffer(bh);
-	spin_unlock(&lru_list_lock);
+	lru_set_unlock(set);
 }
 
 /*
@@ -1143,22 +1376,25 @@ void __brelse(struct buffer_head * buf)
  */
 void __bforget(struct buffer_head * buf)
 {
+	struct bh_lru_set *set = lru_set(buf->b_dev);
+	struct bh_hash_bucket *b;
+
 	/* grab the lru lock here to block bdflush. */
-	spin_lock(&lru_list_lock);
-	write_lock(&hash_table_lock);
+	lru_set_lock(set);
+	b = bh_hash_lock(buf->b_dev, buf->b_blocknr);
 	if (!atomic_dec_and_test(&buf->b_count) || buffer_locked(buf))
 		goto in_use;
 	__hash_unlink(buf);
 	remove_inode_queue(buf);
-	write_unlock(&hash_table_lock);
+	bh_hash_unlock(b);
 	__remove_from_lru_list(buf, buf->b_list);
-	spin_unlock(&lru_list_lock);
+	lru_set_unlock(set);
 	put_last_free(buf);
 	return;
 
  in_use:
-	write_unlock(&hash_table_lock);
-	spin_unlock(&lru_list_lock);
+	bh_hash_unlock(b);
+	lru_set_unlock(set);
 }
 
 /*
@@ -1185,7 +1421,7 @@ struct buffer_head * bread(kdev_t dev, int block, int size)
  */
 static __inline__ void __put_unused_buffer_head(struct buffer_head * bh)
 {
-	if (bh->b_inode)
+	if (bh->b_inode || bh->b_journal_head)
 		BUG();
 	if (nr_unused_buffer_heads >= MAX_UNUSED_BUFFERS) {
 		kmem_cache_free(bh_cachep, bh);
@@ -1354,6 +1590,16 @@ no_grow:
 	goto try_again;
 }
 
+/*
+ * A delayed buffer got its block, or its data went away: give the
+ * reservation back to the filesystem.
+ */
+static inline void delay_release(struct inode *inode, struct buffer_head *bh)
+{
+	if (test_and_clear_bit(BH_Delay, &bh->b_state))
+		atomic_dec(&inode->i_sb->s_delayed_blocks);
+}
+
 static void unmap_buffer(struct buffer_head * bh)
 {
 	if (buffer_mapped(bh)) {
@@ -1392,8 +1638,13 @@ int block_flushpage(struct page *page, unsigned long offset)
 		/*
 		 * is this block fully flushed?
 		 */
-		if (offset <= curr_off)
+		if (offset <= curr_off) {
+			if (buffer_delay(bh)) {
+				delay_release(page->mapping->host, bh);
+				clear_bit(BH_Uptodate, &bh->b_state);
+			}
 			unmap_buffer(bh);
+		}
 		curr_off = next_off;
 		bh = next;
 	} while (bh != head);
@@ -1481,49 +1732,263 @@ static void unmap_underlying_metadata(struct buffer_head * bh)
  */
 
 /*
- * block_write_full_page() is SMP-safe - currently it's still
- * being called with the kernel lock held, but the code is ready.
+ * Delayed allocation. Pages written through delay_prepare_write()
+ * carry BH_Delay buffers: the filesystem has reserved space for them,
+ * but they have no block yet. They are only dirty as pages, and get
+ * their blocks when writepage runs. Since filemap_fdatasync() and
+ * page_launder() do not visit pages in file order, writepage allocates
+ * the whole run of delayed pages around the one it was asked for, in
+ * ascending order, so that the file ends up contiguous on disk even if
+ * several files were appended to at once. Pages we cannot lock right
+ * away end the run; they keep their reservations until their own
+ * writepage.
  */
-static int __block_write_full_page(struct inode *inode, struct page *page, get_block_t *get_block)
+#define DELAY_CLUSTER	32	/* pages allocated together */
+
+static int page_has_delayed(struct page *page)
 {
-	int err, i;
-	unsigned long block;
-	struct buffer_head *bh, *head;
+	struct buffer_head *bh, *head = page->buffers;
 
-	if (!PageLocked(page))
-		BUG();
+	if (!head)
+		return 0;
+	bh = head;
+	do {
+		if (buffer_delay(bh))
+			return 1;
+		bh = bh->b_this_page;
+	} while (bh != head);
+	return 0;
+}
 
-	if (!page->buffers)
-		create_empty_buffers(page, inode->i_dev, inode->i_sb->s_blocksize);
-	head = page->buffers;
+/*
+ * A locked reference to a dirty cached page (one with delayed buffers
+ * if 'delayed' is set), or NULL. Used to grow runs of pages around a
+ * page we already hold locked, so it must not block.
+ */
+static struct page *run_grab_page(struct address_space *mapping, unsigned long index, int delayed)
+{
+	struct page *page;
 
-	block = page->index << (PAGE_CACHE_SHIFT - inode->i_sb->s_blocksize_bits);
+	page = __find_get_page(mapping, index, page_hash(mapping, index));
+	if (!page)
+		return NULL;
+	if (TryLockPage(page))
+		goto out;
+	if (page->mapping == mapping && PageDirty(page) &&
+	    (!delayed || page_has_delayed(page)))
+		return page;
+	UnlockPage(page);
+out:
+	page_cache_release(page);
+	return NULL;
+}
+
+/* Runs are grown backwards first: put them back into file order */
+static inline void run_reverse(struct page **run, int nr)
+{
+	struct page *p;
+	int i;
 
+	for (i = 0; i < nr/2; i++) {
+		p = run[i];
+		run[i] = run[nr-1-i];
+		run[nr-1-i] = p;
+	}
+}
+
+/*
+ * A dirty page need not be valid as a whole: a copy from user space
+ * that faulted commits nothing, and leaves the buffers it was to fill
+ * as they were. Delayed buffers in that state are holes nobody wrote
+ * to, and become zeroes before they get a block.
+ */
+static void delay_fill_holes(struct page *page)
+{
+	struct buffer_head *bh, *head = page->buffers;
+
+	if (!head || Page_Uptodate(page))
+		return;
 	bh = head;
-	i = 0;
+	do {
+		if (buffer_delay(bh) && !buffer_uptodate(bh)) {
+			memset(kmap(page) + bh_offset(bh), 0, bh->b_size);
+			flush_dcache_page(page);
+			kunmap(page);
+			set_bit(BH_Uptodate, &bh->b_state);
+		}
+		bh = bh->b_this_page;
+	} while (bh != head);
+}
 
-	/* Stage 1: make sure we have all the buffers mapped! */
+/* Does the page hold buffers that were never read in? */
+static int page_has_unread(struct page *page)
+{
+	struct buffer_head *bh, *head = page->buffers;
+
+	if (!head || Page_Uptodate(page))
+		return 0;
+	bh = head;
 	do {
-		/*
-		 * If the buffer isn't up-to-date, we can't be sure
-		 * that the buffer has been initialized with the proper
-		 * block number information etc..
-		 *
-		 * Leave it to the low-level FS to make all those
-		 * decisions (block #0 may actually be a valid block)
-		 */
-		if (!buffer_mapped(bh)) {
+		if (!buffer_uptodate(bh))
+			return 1;
+		bh = bh->b_this_page;
+	} while (bh != head);
+	return 0;
+}
+
+/* Give the delayed buffers of a locked page their blocks */
+static int delay_allocate_page(struct inode *inode, struct page *page, get_block_t *get_block)
+{
+	struct buffer_head *bh, *head = page->buffers;
+	unsigned long block;
+	int err;
+
+	delay_fill_holes(page);
+	block = page->index << (PAGE_CACHE_SHIFT - inode->i_sb->s_blocksize_bits);
+	bh = head;
+	do {
+		if (buffer_delay(bh)) {
 			err = get_block(inode, block, bh, 1);
 			if (err)
-				goto out;
+				return err;
+			delay_release(inode, bh);
 			if (buffer_new(bh))
 				unmap_underlying_metadata(bh);
 		}
-		bh = bh->b_this_page;
+		block++;
+		bh = bh->b_this_page;
+	} while (bh != head);
+	return 0;
+}
+
+static void delay_allocate_cluster(struct inode *inode, struct page *page, get_block_t *get_block)
+{
+	struct address_space *mapping = page->mapping;
+	struct page *run[DELAY_CLUSTER], *p;
+	unsigned long index;
+	int nr = 0, i;
+
+	for (index = page->index; index > 0 && nr < DELAY_CLUSTER/2; index--) {
+		p = run_grab_page(mapping, index - 1, 1);
+		if (!p)
+			break;
+		run[nr++] = p;
+	}
+	run_reverse(run, nr);
+	run[nr++] = page;
+	for (index = page->index + 1; nr < DELAY_CLUSTER; index++) {
+		p = run_grab_page(mapping, index, 1);
+		if (!p)
+			break;
+		run[nr++] = p;
+	}
+
+	/* The neighbours stay dirty: their own writepage does the I/O */
+	for (i = 0; i < nr; i++)
+		if (delay_allocate_page(inode, run[i], get_block))
+			break;
+
+	for (i = 0; i < nr; i++) {
+		if (run[i] == page)
+			continue;
+		UnlockPage(run[i]);
+		page_cache_release(run[i]);
+	}
+}
+
+/*
+ * Write out a page that has buffers which were never read in. Those
+ * must not reach the disk, and end_buffer_io_async() would take the
+ * page for uptodate once the others are written. So the valid buffers
+ * get their blocks and go to the dirty buffer lists instead, as after
+ * a partial write, and the page is unlocked right away.
+ */
+static int write_partial_page(struct inode *inode, struct page *page, get_block_t *get_block)
+{
+	struct buffer_head *bh, *head = page->buffers;
+	unsigned long block;
+	int err = 0;
+
+	block = page->index << (PAGE_CACHE_SHIFT - inode->i_sb->s_blocksize_bits);
+	bh = head;
+	do {
+		if (!buffer_uptodate(bh))
+			goto next;
+		if (!buffer_mapped(bh)) {
+			err = get_block(inode, block, bh, 1);
+			if (err) {
+				SetPageError(page);
+				break;
+			}
+			delay_release(inode, bh);
+			if (buffer_new(bh))
+				unmap_underlying_metadata(bh);
+		}
+		if (!atomic_set_buffer_dirty(bh)) {
+			__mark_dirty(bh);
+			buffer_insert_inode_queue(bh, inode);
+		}
+next:
+		block++;
+		bh = bh->b_this_page;
+	} while (bh != head);
+	UnlockPage(page);
+	return err;
+}
+
+/*
+ * block_write_full_page() is SMP-safe - currently it's still
+ * being called with the kernel lock held, but the code is ready.
+ */
+static int __block_write_full_page(struct inode *inode, struct page *page, get_block_t *get_block)
+{
+	int err, i;
+	unsigned long block;
+	struct buffer_head *bh, *head;
+
+	if (!PageLocked(page))
+		BUG();
+
+	if (!page->buffers)
+		create_empty_buffers(page, inode->i_dev, inode->i_sb->s_blocksize);
+	head = page->buffers;
+
+	if (page_has_delayed(page)) {
+		delay_fill_holes(page);
+		delay_allocate_cluster(inode, page, get_block);
+	}
+	if (page_has_unread(page))
+		return write_partial_page(inode, page, get_block);
+
+	block = page->index << (PAGE_CACHE_SHIFT - inode->i_sb->s_blocksize_bits);
+
+	bh = head;
+	i = 0;
+
+	/* Stage 1: make sure we have all the buffers mapped! */
+	do {
+		/*
+		 * If the buffer isn't up-to-date, we can't be sure
+		 * that the buffer has been initialized with the proper
+		 * block number information etc..
+		 *
+		 * Leave it to the low-level FS to make all those
+		 * decisions (block #0 may actually be a valid block)
+		 */
+		if (!buffer_mapped(bh)) {
+			err = get_block(inode, block, bh, 1);
+			if (err)
+				goto out;
+			delay_release(inode, bh);
+			if (buffer_new(bh))
+				unmap_underlying_metadata(bh);
+		}
+		bh = bh->b_this_page;
 		block++;
 	} while (bh != head);
 
 	/* Stage 2: lock the buffers, mark them clean */
+	ClearPageError(page);
 	do {
 		lock_buffer(bh);
 		bh->b_end_io = end_buffer_io_async;
@@ -1545,10 +2010,180 @@ static int __block_write_full_page(struct inode *inode, struct page *page, get_b
 
 out:
 	ClearPageUptodate(page);
+	SetPageError(page);
 	UnlockPage(page);
 	return err;
 }
 
+/*
+ * writepages for block filesystems: write the dirty pages of a mapping
+ * out in runs of up to WRITEPAGES_RUN contiguous pages. All buffers of
+ * a run are mapped first, in file order, and then submitted back to
+ * back, so that the elevator can build requests as large as the device
+ * takes instead of having to find the pieces of a run in between other
+ * I/O. As with filemap_fdatasync(), the pages end up on the locked list,
+ * and the first error is returned; failed pages are marked PG_error.
+ */
+#define WRITEPAGES_RUN	64	/* pages */
+
+static int write_page_run(struct inode *inode, struct page **run, int nr, get_block_t *get_block)
+{
+	struct buffer_head *bh, *head;
+	unsigned long block;
+	int i, j, err, ret = 0;
+
+	/* Stage 1: map all the buffers of the run */
+	for (i = 0; i < nr; i++) {
+		struct page *page = run[i];
+
+		if (!page->buffers)
+			create_empty_buffers(page, inode->i_dev, inode->i_sb->s_blocksize);
+		block = page->index << (PAGE_CACHE_SHIFT - inode->i_sb->s_blocksize_bits);
+		bh = head = page->buffers;
+		do {
+			if (!buffer_mapped(bh)) {
+				err = get_block(inode, block, bh, 1);
+				if (err)
+					goto cut;
+				delay_release(inode, bh);
+				if (buffer_new(bh))
+					unmap_underlying_metadata(bh);
+			}
+			bh = bh->b_this_page;
+			block++;
+		} while (bh != head);
+	}
+	goto submit;
+
+cut:
+	/* Leave this page and the rest to writepage, it reports the error */
+	for (j = i; j < nr; j++) {
+		err = __block_write_full_page(inode, run[j], get_block);
+		if (err && !ret)
+			ret = err;
+	}
+	nr = i;
+
+submit:
+	/* Stage 2: lock the buffers, mark them clean */
+	for (i = 0; i < nr; i++) {
+		ClearPageError(run[i]);
+		bh = head = run[i]->buffers;
+		do {
+			lock_buffer(bh);
+			bh->b_end_io = end_buffer_io_async;
+			atomic_inc(&bh->b_count);
+			set_bit(BH_Uptodate, &bh->b_state);
+			clear_bit(BH_Dirty, &bh->b_state);
+			bh = bh->b_this_page;
+		} while (bh != head);
+	}
+
+	/* Stage 3: submit the IO - end_buffer_io_async will unlock */
+	for (i = 0; i < nr; i++) {
+		bh = head = run[i]->buffers;
+		do {
+			submit_bh(WRITE, bh);
+			bh = bh->b_this_page;
+		} while (bh != head);
+		SetPageUptodate(run[i]);
+	}
+	return ret;
+}
+
+int block_writepages(struct address_space *mapping, get_block_t *get_block)
+{
+	struct inode *inode = mapping->host;
+	struct page *run[WRITEPAGES_RUN], *page, *p;
+	unsigned long index, end_index;
+	int nr, i, j, err, ret = 0;
+
+	spin_lock(&pagecache_lock);
+	while (!list_empty(&mapping->dirty_pages)) {
+		page = list_entry(mapping->dirty_pages.next, struct page, list);
+
+		list_del(&page->list);
+		list_add(&page->list, &mapping->locked_pages);
+
+		if (!PageDirty(page))
+			continue;
+
+		page_cache_get(page);
+		spin_unlock(&pagecache_lock);
+
+		lock_page(page);
+		if (!PageDirty(page)) {
+			UnlockPage(page);
+			goto next;
+		}
+
+		/*
+		 * The page holding EOF, and anything past it, go alone
+		 * through ->writepage(), which may not want get_block
+		 * at all for them.
+		 */
+		end_index = inode->i_size >> PAGE_CACHE_SHIFT;
+		if (page->index >= end_index) {
+			ClearPageDirty(page);
+			err = mapping->a_ops->writepage(page);
+			if (err && !ret)
+				ret = err;
+			goto next;
+		}
+
+		nr = 0;
+		for (index = page->index; index > 0 && nr < WRITEPAGES_RUN/2; index--) {
+			p = run_grab_page(mapping, index - 1, 0);
+			if (!p)
+				break;
+			run[nr++] = p;
+		}
+		run_reverse(run, nr);
+		run[nr++] = page;
+		for (index = page->index + 1; index < end_index && nr < WRITEPAGES_RUN; index++) {
+			p = run_grab_page(mapping, index, 0);
+			if (!p)
+				break;
+			run[nr++] = p;
+		}
+
+		spin_lock(&pagecache_lock);
+		for (i = 0; i < nr; i++) {
+			list_del(&run[i]->list);
+			list_add(&run[i]->list, &mapping->locked_pages);
+		}
+		spin_unlock(&pagecache_lock);
+
+		/* Pages that are not wholly valid go alone, and leave the run */
+		for (i = j = 0; i < nr; i++) {
+			p = run[i];
+			ClearPageDirty(p);
+			if (!page_has_unread(p)) {
+				run[j++] = p;
+				continue;
+			}
+			err = __block_write_full_page(inode, p, get_block);
+			if (err && !ret)
+				ret = err;
+			if (p != page)
+				page_cache_release(p);
+		}
+		nr = j;
+		err = write_page_run(inode, run, nr, get_block);
+		if (err && !ret)
+			ret = err;
+
+		for (i = 0; i < nr; i++)
+			if (run[i] != page)
+				page_cache_release(run[i]);
+next:
+		page_cache_release(page);
+		spin_lock(&pagecache_lock);
+	}
+	spin_unlock(&pagecache_lock);
+	return ret;
+}
+
 static int __block_prepare_write(struct inode *inode, struct page *page,
 		unsigned from, unsigned to, get_block_t *get_block)
 {
@@ -1576,13 +2211,19 @@ static int __block_prepare_write(struct inode *inode, struct page *page,
 			continue;
 		if (block_start >= to)
 			break;
+		/* from here on BH_New means allocated by this write */
+		clear_bit(BH_New, &bh->b_state);
 		if (!buffer_mapped(bh)) {
+			/* a delayed buffer already holds its data */
+			int delayed = buffer_delay(bh);
+
 			err = get_block(inode, block, bh, 1);
 			if (err)
 				goto out;
+			delay_release(inode, bh);
 			if (buffer_new(bh)) {
 				unmap_underlying_metadata(bh);
-				if (Page_Uptodate(page)) {
+				if (Page_Uptodate(page) || delayed) {
 					set_bit(BH_Uptodate, &bh->b_state);
 					continue;
 				}
@@ -1623,7 +2264,7 @@ static int __block_commit_write(struct inode *inode, struct page *page,
 		unsigned from, unsigned to)
 {
 	unsigned block_start, block_end;
-	int partial = 0, need_balance_dirty = 0;
+	int partial = 0, need_balance_dirty = 0, delayed = 0;
 	unsigned blocksize;
 	struct buffer_head *bh, *head;
 
@@ -1633,12 +2274,19 @@ static int __block_commit_write(struct inode *inode, struct page *page,
 	    bh != head || !block_start;
 	    block_start=block_end, bh = bh->b_this_page) {
 		block_end = block_start + blocksize;
-		if (block_end <= from || block_start >= to) {
+		/* an empty range (a failed copy) commits nothing */
+		if (block_end <= from || block_start >= to || from == to) {
 			if (!buffer_uptodate(bh))
 				partial = 1;
+			/* delay_prepare_write() fills in the whole page */
+			if (buffer_delay(bh))
+				delayed = 1;
 		} else {
 			set_bit(BH_Uptodate, &bh->b_state);
-			if (!atomic_set_buffer_dirty(bh)) {
+			if (buffer_delay(bh))
+				/* no block yet, writepage will write it */
+				delayed = 1;
+			else if (!atomic_set_buffer_dirty(bh)) {
 				__mark_dirty(bh);
 				buffer_insert_inode_queue(bh, inode);
 				need_balance_dirty = 1;
@@ -1646,6 +2294,8 @@ static int __block_commit_write(struct inode *inode, struct page *page,
 		}
 	}
 
+	if (delayed)
+		set_page_dirty(page);
 	if (need_balance_dirty)
 		balance_dirty(bh->b_dev);
 	/*
@@ -1659,6 +2309,56 @@ static int __block_commit_write(struct inode *inode, struct page *page,
 	return 0;
 }
 
+/*
+ * copy_from_user() faulted in the middle of a write into a page and
+ * zero-filled the rest; the write was committed only up to @from,
+ * normally a block boundary. What is in from..to now is not file data, unless
+ * the block was a hole: forget that the page and the clean blocks
+ * under it are uptodate, so that they are read again. Blocks this
+ * write allocated, and delayed ones, get the zeroes they read as.
+ * A dirty page without buffers (ramfs) is the only copy of its data
+ * and is left as it is. The page is kmapped by prepare_write.
+ */
+void block_write_fault(struct page *page, unsigned from, unsigned to)
+{
+	struct inode *inode = page->mapping->host;
+	struct buffer_head *bh, *head = page->buffers;
+	unsigned block_start, block_end, start, end;
+	int need_balance_dirty = 0;
+	char *kaddr = page_address(page);
+
+	if (!head) {
+		if (!PageDirty(page))
+			ClearPageUptodate(page);
+		return;
+	}
+	ClearPageUptodate(page);
+	for(bh = head, block_start = 0; bh != head || !block_start;
+	    block_start=block_end, bh = bh->b_this_page) {
+		block_end = block_start + bh->b_size;
+		if (block_end <= from || block_start >= to)
+			continue;
+		if (!buffer_delay(bh) && !(buffer_mapped(bh) && buffer_new(bh))) {
+			if (!buffer_dirty(bh))
+				clear_bit(BH_Uptodate, &bh->b_state);
+			continue;
+		}
+		/* drop what was copied into it before the fault */
+		start = block_start > from ? block_start : from;
+		end = block_end < to ? block_end : to;
+		memset(kaddr + start, 0, end - start);
+		flush_dcache_page(page);
+		set_bit(BH_Uptodate, &bh->b_state);
+		if (!buffer_delay(bh) && !atomic_set_buffer_dirty(bh)) {
+			__mark_dirty(bh);
+			buffer_insert_inode_queue(bh, inode);
+			need_balance_dirty = 1;
+		}
+	}
+	if (need_balance_dirty)
+		balance_dirty(head->b_dev);
+}
+
 /*
  * Generic "read page" function for block devices that have the normal
  * get_block functionality. This is most of the block device filesystems.
@@ -1836,6 +2536,108 @@ int block_prepare_write(struct page *page, unsigned from, unsigned to,
 	return err;
 }
 
+/*
+ * prepare_write for delayed allocation: blocks that are already on disk
+ * are handled as in block_prepare_write(), holes are only reserved with
+ * the filesystem's reserve_blocks() and left for writepage to allocate.
+ * The page is dirtied as a whole and writepage writes every buffer of
+ * it, so the whole page is made valid here, not just from..to: blocks
+ * outside the range are read in, holes outside it are zeroed and
+ * reserved too. The reservation is made at once, so that a failure
+ * leaves nothing to undo.
+ */
+int delay_prepare_write(struct page *page, unsigned from, unsigned to,
+			get_block_t *get_block, reserve_blocks_t *reserve_blocks)
+{
+	struct inode *inode = page->mapping->host;
+	unsigned block_start, block_end;
+	unsigned long block, first;
+	int err = 0, nr = 0;
+	unsigned blocksize, bbits;
+	struct buffer_head *bh, *head, *wait[MAX_BUF_PER_PAGE], **wait_bh=wait;
+	char *kaddr = kmap(page);
+
+	blocksize = inode->i_sb->s_blocksize;
+	if (!page->buffers)
+		create_empty_buffers(page, inode->i_dev, blocksize);
+	head = page->buffers;
+
+	bbits = inode->i_sb->s_blocksize_bits;
+	first = page->index << (PAGE_CACHE_SHIFT - bbits);
+
+	/* Pass 1: look up what is on disk already, count the holes */
+	for(bh = head, block = first, block_start = 0;
+	    bh != head || !block_start;
+	    block++, block_start=block_end, bh = bh->b_this_page) {
+		block_end = block_start+blocksize;
+		if (buffer_mapped(bh) || buffer_delay(bh))
+			continue;
+		err = get_block(inode, block, bh, 0);
+		if (err)
+			goto out;
+		if (!buffer_mapped(bh))
+			nr++;
+	}
+	if (nr) {
+		err = reserve_blocks(inode, nr);
+		if (err)
+			goto out;
+	}
+
+	/* Pass 2: as __block_prepare_write(), with holes becoming delayed */
+	for(bh = head, block_start = 0; bh != head || !block_start;
+	    block_start=block_end, bh = bh->b_this_page) {
+		block_end = block_start+blocksize;
+		/* nothing is allocated here */
+		clear_bit(BH_New, &bh->b_state);
+		if (buffer_delay(bh))
+			continue;
+		if (!buffer_mapped(bh)) {
+			set_bit(BH_Delay, &bh->b_state);
+			if (Page_Uptodate(page) || buffer_uptodate(bh)) {
+				set_bit(BH_Uptodate, &bh->b_state);
+				continue;
+			}
+			if (block_end <= from || block_start >= to) {
+				memset(kaddr+block_start, 0, blocksize);
+				set_bit(BH_Uptodate, &bh->b_state);
+				flush_dcache_page(page);
+				continue;
+			}
+			if (block_end > to)
+				memset(kaddr+to, 0, block_end-to);
+			if (block_start < from)
+				memset(kaddr+block_start, 0, from-block_start);
+			if (block_end > to || block_start < from)
+				flush_dcache_page(page);
+			continue;
+		}
+		if (Page_Uptodate(page)) {
+			set_bit(BH_Uptodate, &bh->b_state);
+			continue; 
+		}
+		if (!buffer_uptodate(bh) &&
+		     (block_start < from || block_end > to)) {
+			ll_rw_block(READ, 1, &bh);
+			*wait_bh++=bh;
+		}
+	}
+	/*
+	 * If we issued read requests - let them complete.
+	 */
+	while(wait_bh > wait) {
+		wait_on_buffer(*--wait_bh);
+		err = -EIO;
+		if (!buffer_uptodate(*wait_bh))
+			goto out;
+	}
+	return 0;
+out:
+	ClearPageUptodate(page);
+	kunmap(page);
+	return err;
+}
+
 int generic_commit_write(struct file *file, struct page *page,
 		unsigned from, unsigned to)
 {
@@ -1888,6 +2690,13 @@ int block_truncate_page(struct address_space *mapping, loff_t from, get_block_t
 	}
 
 	err = 0;
+	if (buffer_delay(bh)) {
+		/* Not on disk yet: zero the tail in the page, it is dirty already */
+		memset(kmap(page) + offset, 0, length);
+		flush_dcache_page(page);
+		kunmap(page);
+		goto unlock;
+	}
 	if (!buffer_mapped(bh)) {
 		/* Hole? Nothing to do */
 		if (buffer_uptodate(bh))
@@ -1945,6 +2754,8 @@ int block_write_full_page(struct page *page, get_block_t *get_block)
 	}
 
 	/* Sigh... will have to work, then... */
+	if (page_has_delayed(page))
+		delay_allocate_cluster(inode, page, get_block);
 	err = __block_prepare_write(inode, page, 0, offset, get_block);
 	if (!err) {
 		memset(page_address(page) + offset, 0, PAGE_CACHE_SIZE - offset);
@@ -1969,6 +2780,52 @@ int generic_block_bmap(struct address_space *mapping, long block, get_block_t *g
 	return tmp.b_blocknr;
 }
 
+/*
+ * Map the blocks behind an O_DIRECT transfer with get_block() and do
+ * the I/O straight to/from the pages of the kiobuf. Holes read back
+ * as zeroes; writes allocate the blocks they need.
+ */
+int generic_direct_IO(int rw, struct inode *inode, struct kiobuf *iobuf,
+		      unsigned long blocknr, int blocksize, get_block_t *get_block)
+{
+	int i, nr_blocks, err;
+	unsigned long b[KIO_MAX_SECTORS];
+
+	nr_blocks = iobuf->length / blocksize;
+	if (nr_blocks > KIO_MAX_SECTORS)
+		return -EINVAL;
+
+	for (i = 0; i < nr_blocks; i++, blocknr++) {
+		struct buffer_head bh;
+
+		bh.b_state = 0;
+		bh.b_dev = inode->i_dev;
+		bh.b_size = blocksize;
+
+		err = get_block(inode, blocknr, &bh, rw == WRITE);
+		if (err)
+			return err;
+
+		if (rw == READ) {
+			if (buffer_new(&bh))
+				BUG();
+			if (!buffer_mapped(&bh)) {
+				/* A hole: brw_kiovec() will zero it for us */
+				b[i] = -1UL;
+				continue;
+			}
+		} else {
+			if (buffer_new(&bh))
+				unmap_underlying_metadata(&bh);
+			if (!buffer_mapped(&bh))
+				BUG();
+		}
+		b[i] = bh.b_blocknr;
+	}
+
+	return brw_kiovec(rw, 1, &iobuf, inode->i_dev, b, blocksize);
+}
+
 /*
  * IO completion routine for a buffer_head being used for kiobuf IO: we
  * can't dispatch the kiobuf callback until io_count reaches 0.  
@@ -2033,7 +2890,8 @@ static int wait_kio(int rw, int nr, struct buffer_head *bh[], int size)
  * maybe wait on page->wait.
  *
  * It is up to the caller to make sure that there are enough blocks
- * passed in to completely map the iobufs to disk.
+ * passed in to completely map the iobufs to disk. A block number of
+ * -1UL stands for a hole, which is zero-filled on reads.
  */
 
 int brw_kiovec(int rw, int nr, struct kiobuf *iovec[], 
@@ -2086,6 +2944,16 @@ int brw_kiovec(int rw, int nr, struct kiobuf *iovec[],
 			
 			while (length > 0) {
 				blocknr = b[bufind++];
+				if (blocknr == -1UL) {
+					if (rw != READ)
+						BUG();
+					memset(kmap(map) + offset, 0, size);
+					flush_dcache_page(map);
+					kunmap(map);
+					transferred += size;
+					goto skip_block;
+				}
+
 				tmp = get_unused_buffer_head(0);
 				if (!tmp) {
 					err = -ENOMEM;
@@ -2108,8 +2976,6 @@ int brw_kiovec(int rw, int nr, struct kiobuf *iovec[],
 				}
 
 				bh[bhind++] = tmp;
-				length -= size;
-				offset += size;
 
 				atomic_inc(&iobuf->io_count);
 
@@ -2125,7 +2991,11 @@ int brw_kiovec(int rw, int nr, struct kiobuf *iovec[],
 						goto finished;
 					bhind = 0;
 				}
-				
+
+			skip_block:
+				length -= size;
+				offset += size;
+
 				if (offset >= PAGE_SIZE) {
 					offset = 0;
 					break;
@@ -2159,6 +3029,99 @@ int brw_kiovec(int rw, int nr, struct kiobuf *iovec[],
 	goto finished;
 }
 
+/*
+ * Asynchronous brw_kiovec() for a single kiobuf, used by the aio code.
+ * All the buffer_heads are allocated before anything is submitted, so
+ * either the whole kiobuf goes to the driver or nothing does. Holes
+ * (-1UL) are zero-filled right away.
+ *
+ * iobuf->end_io runs (possibly from interrupt context) once all of the
+ * I/O is done. The buffer_heads are handed back in @bh and have to be
+ * released with brw_kiovec_collect() after that. Returns the number of
+ * buffer_heads in @bh, or a negative error if nothing was submitted.
+ *
+ * On success the I/O is held back from completing: the caller records
+ * what it needs and then lets it go with end_kio_request(iobuf, 1),
+ * after which end_io may already have run.
+ */
+int brw_kiovec_async(int rw, struct kiobuf *iobuf, kdev_t dev,
+		     unsigned long b[], int nr_blocks, int size,
+		     struct buffer_head *bh[])
+{
+	int i, nr, offset, pageind;
+	struct buffer_head *tmp;
+	struct page *map;
+
+	if ((iobuf->offset & (size-1)) || (iobuf->length & (size-1)) ||
+	    iobuf->length != nr_blocks * size)
+		return -EINVAL;
+
+	for (i = nr = 0; i < nr_blocks; i++) {
+		if (b[i] == -1UL) {
+			if (rw != READ)
+				return -EINVAL;
+			continue;
+		}
+		tmp = get_unused_buffer_head(0);
+		if (!tmp) {
+			brw_kiovec_collect(nr, bh, size);
+			return -ENOMEM;
+		}
+		tmp->b_state = 0;
+		bh[nr++] = tmp;
+	}
+
+	/* Hold io_count up until the caller drops it */
+	iobuf->errno = 0;
+	atomic_set(&iobuf->io_count, nr + 1);
+
+	offset = iobuf->offset;
+	pageind = 0;
+	for (i = nr = 0; i < nr_blocks; i++) {
+		map = iobuf->maplist[pageind];
+
+		if (b[i] == -1UL) {
+			memset(kmap(map) + offset, 0, size);
+			flush_dcache_page(map);
+			kunmap(map);
+		} else {
+			tmp = bh[nr++];
+			tmp->b_dev = B_FREE;
+			tmp->b_size = size;
+			set_bh_page(tmp, map, offset);
+			tmp->b_this_page = tmp;
+
+			init_buffer(tmp, end_buffer_io_kiobuf, iobuf);
+			tmp->b_dev = dev;
+			tmp->b_blocknr = b[i];
+			tmp->b_state = (1 << BH_Mapped) | (1 << BH_Lock) | (1 << BH_Req);
+
+			if (rw == WRITE) {
+				set_bit(BH_Uptodate, &tmp->b_state);
+				clear_bit(BH_Dirty, &tmp->b_state);
+			}
+			submit_bh(rw, tmp);
+		}
+
+		offset += size;
+		if (offset >= PAGE_SIZE) {
+			offset = 0;
+			pageind++;
+		}
+	}
+	return nr;
+}
+
+/*
+ * Release the buffer_heads of a brw_kiovec_async() request, waiting
+ * for any that are still in flight. Returns the amount of I/O done
+ * before the first failed block.
+ */
+int brw_kiovec_collect(int nr, struct buffer_head *bh[], int size)
+{
+	return wait_kio(READ, nr, bh, size);
+}
+
 /*
  * Start I/O on a page.
  * This function expects the page to be locked and may return
@@ -2329,10 +3292,106 @@ static void sync_page_buffers(struct buffer_head *bh, int wait)
 	} while (tmp != bh);
 }
 
+/*
+ * The lru sets and hash chains a page's buffers live on.  They are
+ * locked in array order, which keeps try_to_free_buffers() from
+ * deadlocking against itself or against bh_hash_grow().
+ */
+struct page_buffer_locks {
+	struct bh_hash_table *table;
+	unsigned long sets;
+	int nr_chains;
+	struct bh_hash_bucket *chain[MAX_BUF_PER_PAGE];
+};
+
+static void add_page_chain(struct page_buffer_locks *locks, struct bh_hash_bucket *b)
+{
+	int i, j;
+
+	for (i = 0; i < locks->nr_chains; i++) {
+		if (locks->chain[i] == b)
+			return;
+		if (locks->chain[i] > b)
+			break;
+	}
+	for (j = locks->nr_chains++; j > i; j--)
+		locks->chain[j] = locks->chain[j-1];
+	locks->chain[i] = b;
+}
+
+static void unlock_page_buffers(struct page_buffer_locks *locks)
+{
+	int i;
+
+	for (i = locks->nr_chains; i-- > 0; )
+		bh_hash_unlock(locks->chain[i]);
+	for (i = BH_LRU_SETS; i-- > 0; )
+		if (locks->sets & (1UL << i))
+			lru_set_unlock(&lru_sets[i]);
+}
+
+static void lock_page_buffers(struct buffer_head *head, struct page_buffer_locks *locks)
+{
+	struct buffer_head *bh;
+	int i;
+
+again:
+	locks->table = bh_hash;
+	smp_rmb();
+	locks->sets = 0;
+	locks->nr_chains = 0;
+	bh = head;
+	do {
+		if (bh->b_dev != B_FREE)
+			locks->sets |= 1UL << lru_set_index(bh->b_dev);
+		if (bh->b_pprev)
+			add_page_chain(locks, hash_bucket(locks->table, bh->b_dev, bh->b_blocknr));
+		bh = bh->b_this_page;
+	} while (bh != head);
+
+	for (i = 0; i < BH_LRU_SETS; i++)
+		if (locks->sets & (1UL << i))
+			lru_set_lock(&lru_sets[i]);
+	for (i = 0; i < locks->nr_chains; i++)
+		bh_chain_lock(locks->chain[i]);
+	if (locks->table != bh_hash) {
+		unlock_page_buffers(locks);
+		goto again;
+	}
+}
+
+/*
+ * A buffer may have been picked up by getblk() between looking at it
+ * and taking the locks.  Once none of them is busy they can no longer
+ * move, so check that we hold everything they are queued on.
+ */
+static int page_buffers_locked(struct buffer_head *head, struct page_buffer_locks *locks)
+{
+	struct buffer_head *bh = head;
+	struct bh_hash_bucket *b;
+	int i;
+
+	do {
+		if (bh->b_dev != B_FREE &&
+		    !(locks->sets & (1UL << lru_set_index(bh->b_dev))))
+			return 0;
+		if (bh->b_pprev) {
+			b = hash_bucket(locks->table, bh->b_dev, bh->b_blocknr);
+			for (i = 0; i < locks->nr_chains; i++)
+				if (locks->chain[i] == b)
+					break;
+			if (i == locks->nr_chains)
+				return 0;
+		}
+		bh = bh->b_this_page;
+	} while (bh != head);
+	return 1;
+}
+
 /*
  * Can the buffer be thrown out?
  */
-#define BUFFER_BUSY_BITS	((1<<BH_Dirty) | (1<<BH_Lock) | (1<<BH_Protected))
+#define BUFFER_BUSY_BITS	((1<<BH_Dirty) | (1<<BH_Lock) | (1<<BH_Protected) | (1<<BH_Delay))
 #define buffer_busy(bh)		(atomic_read(&(bh)->b_count) | ((bh)->b_state & BUFFER_BUSY_BITS))
 
 /*
@@ -2349,12 +3408,12 @@ static void sync_page_buffers(struct buffer_head *bh, int wait)
 int try_to_free_buffers(struct page * page, int wait)
 {
 	struct buffer_head * tmp, * bh = page->buffers;
+	struct page_buffer_locks locks;
 	int index = BUFSIZE_INDEX(bh->b_size);
 	int loop = 0;
 
 cleaned_buffers_try_again:
-	spin_lock(&lru_list_lock);
-	write_lock(&hash_table_lock);
+	lock_page_buffers(bh, &locks);
 	spin_lock(&free_list[index].lock);
 	tmp = bh;
 	do {
@@ -2365,6 +3424,12 @@ cleaned_buffers_try_again:
 			goto busy_buffer_page;
 	} while (tmp != bh);
 
+	if (!page_buffers_locked(bh, &locks)) {
+		spin_unlock(&free_list[index].lock);
+		unlock_page_buffers(&locks);
+		goto cleaned_buffers_try_again;
+	}
+
 	spin_lock(&unused_list_lock);
 	tmp = bh;
 	do {
@@ -2390,15 +3455,13 @@ cleaned_buffers_try_again:
 	page->buffers = NULL;
 	page_cache_release(page);
 	spin_unlock(&free_list[index].lock);
-	write_unlock(&hash_table_lock);
-	spin_unlock(&lru_list_lock);
+	unlock_page_buffers(&locks);
 	return 1;
 
 busy_buffer_page:
 	/* Uhhuh, start writeback so that we don't end up with all dirty pages */
 	spin_unlock(&free_list[index].lock);
-	write_unlock(&hash_table_lock);
-	spin_unlock(&lru_list_lock);
+	unlock_page_buffers(&locks);
 	if (wait) {
 		sync_page_buffers(bh, wait);
 		/* We waited synchronously, so we can free the buffers. */
@@ -2416,9 +3479,11 @@ void show_buffers(void)
 {
 #ifdef CONFIG_SMP
 	struct buffer_head * bh;
+	struct bh_lru_set *set;
 	int found = 0, locked = 0, dirty = 0, used = 0, lastused = 0;
 	int protected = 0;
-	int nlist;
+	int nlist, i;
+	unsigned long size;
 	static char *buf_types[NR_LIST] = { "CLEAN", "LOCKED", "DIRTY", "PROTECTED", };
 #endif
 
@@ -2426,40 +3491,169 @@ void show_buffers(void)
 			atomic_read(&buffermem_pages) << (PAGE_SHIFT-10));
 
 #ifdef CONFIG_SMP /* trylock does nothing on UP and so we could deadlock */
-	if (!spin_trylock(&lru_list_lock))
-		return;
 	for(nlist = 0; nlist < NR_LIST; nlist++) {
 		found = locked = dirty = used = lastused = protected = 0;
-		bh = lru_list[nlist];
-		if(!bh) continue;
+		size = 0;
+		for (i = 0; i < BH_LRU_SETS; i++) {
+			int start = found;
 
-		do {
-			found++;
-			if (buffer_locked(bh))
-				locked++;
-			if (buffer_protected(bh))
-				protected++;
-			if (buffer_dirty(bh))
-				dirty++;
-			if (atomic_read(&bh->b_count))
-				used++, lastused = found;
-			bh = bh->b_next_free;
-		} while (bh != lru_list[nlist]);
-		{
-			int tmp = nr_buffers_type[nlist];
-			if (found != tmp)
-				printk("%9s: BUG -> found %d, reported %d\n",
-				       buf_types[nlist], found, tmp);
+			set = &lru_sets[i];
+			if (!spin_trylock(&set->lock))
+				continue;
+			bh = set->list[nlist];
+			if (!bh) {
+				spin_unlock(&set->lock);
+				continue;
+			}
+
+			do {
+				found++;
+				if (buffer_locked(bh))
+					locked++;
+				if (buffer_protected(bh))
+					protected++;
+				if (buffer_dirty(bh))
+					dirty++;
+				if (atomic_read(&bh->b_count))
+					used++, lastused = found;
+				bh = bh->b_next_free;
+			} while (bh != set->list[nlist]);
+			{
+				int tmp = set->nr[nlist];
+				if (found - start != tmp)
+					printk("%9s: BUG -> found %d, reported %d\n",
+					       buf_types[nlist], found - start, tmp);
+			}
+			size += set->size[nlist];
+			spin_unlock(&set->lock);
 		}
+		if (!found)
+			continue;
 		printk("%9s: %d buffers, %lu kbyte, %d used (last=%d), "
 		       "%d locked, %d protected, %d dirty\n",
-		       buf_types[nlist], found, size_buffers_type[nlist]>>10,
+		       buf_types[nlist], found, size>>10,
 		       used, lastused, locked, protected, dirty);
 	}
-	spin_unlock(&lru_list_lock);
 #endif
 }
 
+/*
+ * /proc/buffer_locks: how hard the hash chains and lru sets are hit.
+ * Hold times are in get_cycles() units.
+ */
+int get_buffer_lock_stats(char *page)
+{
+	struct bh_hash_table *table = bh_hash;
+	unsigned long acquired = 0, contended = 0;
+	int i, len;
+
+	for (i = 0; i < smp_num_cpus; i++) {
+		acquired += bh_hash_stat[cpu_logical_map(i)].acquired;
+		contended += bh_hash_stat[cpu_logical_map(i)].contended;
+	}
+	len = sprintf(page, "hash: %u chains (order %d), %d resizes, "
+		      "%lu acquired, %lu contended\n",
+		      table->mask + 1, table->order, bh_hash_resizes,
+		      acquired, contended);
+
+	len += sprintf(page + len, "set  buffers   acquired  contended"
+		       "         hold_cycles       max_hold\n");
+	for (i = 0; i < BH_LRU_SETS; i++) {
+		struct bh_lru_set *set = &lru_sets[i];
+		int nlist, nr = 0;
+
+		for (nlist = 0; nlist < NR_LIST; nlist++)
+			nr += set->nr[nlist];
+		len += sprintf(page + len, "%3d %8d %10lu %10lu %19Lu %14Lu\n",
+			       i, nr, set->acquired, set->contended,
+			       (unsigned long long) set->hold_total,
+			       (unsigned long long) set->hold_max);
+	}
+	return len;
+}
+
+/*
+ * /proc/writeback: what each lru set's flush thread has been doing.
+ * Times are in jiffies; latency is from dirtying to write-out.
+ */
+int get_writeback_stats(char *page)
+{
+	int i, len;
+
+	len = sprintf(page, "HZ %d\n", HZ);
+	len += sprintf(page + len, "set   pid  dirty_kb    written  written_kb"
+		       "       busy  latency_sum  latency_max  throttled\n");
+	for (i = 0; i < BH_LRU_SETS; i++) {
+		struct bh_lru_set *set = &lru_sets[i];
+
+		len += sprintf(page + len, "%3d %5d %9lu %10lu %11lu %10lu %12lu %12lu %10d\n",
+			       i, set->flush_tsk ? set->flush_tsk->pid : 0,
+			       set->size[BUF_DIRTY] >> 10,
+			       set->wb_buffers, set->wb_kbytes, set->wb_busy,
+			       set->wb_latency, set->wb_latency_max,
+			       atomic_read(&set->wb_throttled));
+	}
+	return len;
+}
+
+/*
+ * Called from kupdate.  Once there are more than two buffers per hash
+ * chain on average, move everything over to a table twice the size.
+ * If the memory is not there we simply try again next time.
+ */
+static void bh_hash_grow(void)
+{
+	struct bh_hash_table *old = bh_hash, *new;
+	struct bh_hash_bucket *buckets;
+	struct buffer_head *bh;
+	unsigned int nr_hash, i;
+	int order = old->order + 1;
+
+	if (lru_total_buffers() <= 2 * (old->mask + 1) || order >= MAX_ORDER)
+		return;
+
+	new = kmalloc(sizeof(*new), GFP_KERNEL);
+	if (!new)
+		return;
+	buckets = (struct bh_hash_bucket *) __get_free_pages(GFP_KERNEL, order);
+	if (!buckets) {
+		kfree(new);
+		return;
+	}
+
+	nr_hash = (PAGE_SIZE << order) / sizeof(struct bh_hash_bucket);
+	new->mask = nr_hash - 1;
+	new->shift = 0;
+	while ((nr_hash >>= 1) != 0)
+		new->shift++;
+	new->order = order;
+	new->buckets = buckets;
+	for (i = 0; i <= new->mask; i++) {
+		buckets[i].chain = NULL;
+		buckets[i].lock = SPIN_LOCK_UNLOCKED;
+	}
+
+	for (i = 0; i <= old->mask; i++)
+		spin_lock(&old->buckets[i].lock);
+	for (i = 0; i <= old->mask; i++) {
+		while ((bh = old->buckets[i].chain) != NULL) {
+			__hash_unlink(bh);
+			__hash_link(bh, &hash_bucket(new, bh->b_dev, bh->b_blocknr)->chain);
+		}
+	}
+	wmb();
+	bh_hash = new;
+	for (i = 0; i <= old->mask; i++)
+		spin_unlock(&old->buckets[i].lock);
+	bh_hash_resizes++;
+
+	/* Wait for lookups still spinning on the old chains to retry */
+	synchronize_kernel();
+	free_pages((unsigned long) old->buckets, old->order);
+	if (old != &bh_hash_boot)
+		kfree(old);
+}
+
 /* ===================== Init ======================= */
 
 /*
@@ -2471,13 +3665,14 @@ void __init buffer_init(unsigned long mempages)
 {
 	int order, i;
 	unsigned int nr_hash;
+	struct bh_hash_table *table = &bh_hash_boot;
 
 	/* The buffer cache hash table is less important these days,
-	 * trim it a bit.
+	 * trim it a bit; it grows later if the chains get long.
 	 */
 	mempages >>= 14;
 
-	mempages *= sizeof(struct buffer_head *);
+	mempages *= sizeof(struct bh_hash_bucket);
 
 	for (order = 0; (1 << order) < mempages; order++)
 		;
@@ -2488,26 +3683,29 @@ void __init buffer_init(unsigned long mempages)
 	do {
 		unsigned long tmp;
 
-		nr_hash = (PAGE_SIZE << order) / sizeof(struct buffer_head *);
-		bh_hash_mask = (nr_hash - 1);
+		nr_hash = (PAGE_SIZE << order) / sizeof(struct bh_hash_bucket);
+		table->mask = (nr_hash - 1);
 
 		tmp = nr_hash;
-		bh_hash_shift = 0;
+		table->shift = 0;
 		while((tmp >>= 1UL) != 0UL)
-			bh_hash_shift++;
+			table->shift++;
 
-		hash_table = (struct buffer_head **)
+		table->buckets = (struct bh_hash_bucket *)
 		    __get_free_pages(GFP_ATOMIC, order);
-	} while (hash_table == NULL && --order > 0);
+	} while (table->buckets == NULL && --order > 0);
+	table->order = order;
 	printk("Buffer-cache hash table entries: %d (order: %d, %ld bytes)\n",
 	       nr_hash, order, (PAGE_SIZE << order));
 
-	if (!hash_table)
+	if (!table->buckets)
 		panic("Failed to allocate buffer hash table\n");
 
 	/* Setup hash chains. */
-	for(i = 0; i < nr_hash; i++)
-		hash_table[i] = NULL;
+	for(i = 0; i < nr_hash; i++) {
+		table->buckets[i].chain = NULL;
+		table->buckets[i].lock = SPIN_LOCK_UNLOCKED;
+	}
 
 	/* Setup free lists. */
 	for(i = 0; i < NR_SIZES; i++) {
@@ -2515,9 +3713,12 @@ void __init buffer_init(unsigned long mempages)
 		free_list[i].lock = SPIN_LOCK_UNLOCKED;
 	}
 
-	/* Setup lru lists. */
-	for(i = 0; i < NR_LIST; i++)
-		lru_list[i] = NULL;
+	/* Setup lru sets. */
+	for(i = 0; i < BH_LRU_SETS; i++) {
+		lru_sets[i].lock = SPIN_LOCK_UNLOCKED;
+		init_waitqueue_head(&lru_sets[i].flush_done);
+		atomic_set(&lru_sets[i].wb_throttled, 0);
+	}
 
 }
 
@@ -2531,9 +3732,61 @@ void __init buffer_init(unsigned long mempages)
 static DECLARE_WAIT_QUEUE_HEAD(bdflush_done);
 struct task_struct *bdflush_tsk = 0;
 
+/* The flush threads must never wait on each other. */
+static int current_is_flusher(void)
+{
+	int i;
+
+	if (current == bdflush_tsk)
+		return 1;
+	for (i = 0; i < BH_LRU_SETS; i++)
+		if (current == lru_sets[i].flush_tsk)
+			return 1;
+	return 0;
+}
+
+/* Wait for the end of the set's next flush round. */
+static void wait_on_flusher(struct bh_lru_set *set)
+{
+	DECLARE_WAITQUEUE(wait, current);
+
+	if (!set->flush_tsk || current_is_flusher())
+		return;
+
+	/* Same dance as wakeup_bdflush(): the flush thread may wake us
+	   before we get to sleep. */
+	atomic_inc(&set->wb_throttled);
+	__set_current_state(TASK_UNINTERRUPTIBLE);
+	add_wait_queue(&set->flush_done, &wait);
+
+	wake_up_process(set->flush_tsk);
+	schedule();
+
+	remove_wait_queue(&set->flush_done, &wait);
+	__set_current_state(TASK_RUNNING);
+}
+
+/* Start the flush threads of all sets with dirty buffers. */
+static struct bh_lru_set *kick_flushers(void)
+{
+	struct bh_lru_set *set, *busiest = NULL;
+	int i;
+
+	for (i = 0; i < BH_LRU_SETS; i++) {
+		set = &lru_sets[i];
+		if (!set->size[BUF_DIRTY] || !set->flush_tsk)
+			continue;
+		wake_up_process(set->flush_tsk);
+		if (!busiest || set->size[BUF_DIRTY] > busiest->size[BUF_DIRTY])
+			busiest = set;
+	}
+	return busiest;
+}
+
 void wakeup_bdflush(int block)
 {
 	DECLARE_WAITQUEUE(wait, current);
+	struct bh_lru_set *busiest;
 
 	if (current == bdflush_tsk)
 		return;
@@ -2543,6 +3796,15 @@ void wakeup_bdflush(int block)
 		return;
 	}
 
+	/* Dirty buffers are written by the per-device threads: wait
+	   for the one with the most work, not for every disk. */
+	busiest = kick_flushers();
+	if (busiest && !current_is_flusher()) {
+		wake_up_process(bdflush_tsk);
+		wait_on_flusher(busiest);
+		return;
+	}
+
 	/* bdflush can wakeup us before we have a chance to
 	   go to sleep so we must be smart in handling
 	   this wakeup event from bdflush to avoid deadlocking in SMP
@@ -2558,22 +3820,23 @@ void wakeup_bdflush(int block)
 }
 
 /* This is the _only_ function that deals with flushing async writes
-   to disk.
+   to disk, and it is only called from the set's own flush thread.
    NOTENOTENOTENOTE: we _only_ need to browse the DIRTY lru list
    as all dirty buffers lives _only_ in the DIRTY lru list.
    As we never browse the LOCKED and CLEAN lru lists they are infact
    completly useless. */
-static int flush_dirty_buffers(int check_flushtime)
+static int flush_lru_set(struct bh_lru_set *set, int check_flushtime)
 {
 	struct buffer_head * bh, *next;
+	unsigned long start = jiffies, age;
 	int flushed = 0, i;
 
  restart:
-	spin_lock(&lru_list_lock);
-	bh = lru_list[BUF_DIRTY];
+	lru_set_lock(set);
+	bh = set->list[BUF_DIRTY];
 	if (!bh)
 		goto out_unlock;
-	for (i = nr_buffers_type[BUF_DIRTY]; i-- > 0; bh = next) {
+	for (i = set->nr[BUF_DIRTY]; i-- > 0; bh = next) {
 		next = bh->b_next_free;
 
 		if (!buffer_dirty(bh)) {
@@ -2597,7 +3860,15 @@ static int flush_dirty_buffers(int check_flushtime)
 
 		/* OK, now we are committed to write it out. */
 		atomic_inc(&bh->b_count);
-		spin_unlock(&lru_list_lock);
+		lru_set_unlock(set);
+
+		age = jiffies - (bh->b_flushtime - bdf_prm.b_un.age_buffer);
+		set->wb_latency += age;
+		if (age > set->wb_latency_max)
+			set->wb_latency_max = age;
+		set->wb_buffers++;
+		set->wb_kbytes += bh->b_size >> 10;
+
 		ll_rw_block(WRITE, 1, &bh);
 		atomic_dec(&bh->b_count);
 
@@ -2606,8 +3877,9 @@ static int flush_dirty_buffers(int check_flushtime)
 		goto restart;
 	}
  out_unlock:
-	spin_unlock(&lru_list_lock);
+	lru_set_unlock(set);
 
+	set->wb_busy += jiffies - start;
 	return flushed;
 }
 
@@ -2617,18 +3889,29 @@ static int flush_dirty_buffers(int check_flushtime)
  * otherwise there would be no way of ensuring that these quantities ever 
  * get written back.  Ideally, we would have a timestamp on the inodes
  * and superblocks so that we could write back only the old ones as well
+ *
+ * The buffers themselves are written by each device's flush thread,
+ * so that one busy disk does not hold up the rest.
  */
 
 static int sync_old_buffers(void)
 {
+	int i;
+
 	lock_kernel();
 	sync_supers(0);
 	sync_inodes(0);
 	unlock_kernel();
 
-	flush_dirty_buffers(1);
-	/* must really sync all the active I/O request to disk here */
-	run_task_queue(&tq_disk);
+	for (i = 0; i < BH_LRU_SETS; i++) {
+		struct bh_lru_set *set = &lru_sets[i];
+
+		if (!set->size[BUF_DIRTY] || !set->flush_tsk)
+			continue;
+		set->flush_old = 1;
+		wake_up_process(set->flush_tsk);
+	}
+	bh_hash_grow();
 	return 0;
 }
 
@@ -2723,9 +4006,11 @@ int bdflush(void *sem)
 	for (;;) {
 		CHECK_EMERGENCY_SYNC
 
-		flushed = flush_dirty_buffers(0);
+		/* The dirty buffers are the flush threads' business */
+		kick_flushers();
+		flushed = 0;
 		if (free_shortage())
-			flushed += page_launder(GFP_BUFFER, 0);
+			flushed = page_launder(GFP_BUFFER, 0);
 
 		/* If wakeup_bdflush will wakeup us
 		   after our bdflush_done wakeup, then
@@ -2752,6 +4037,60 @@ int bdflush(void *sem)
 	}
 }
 
+/*
+ * One of these runs for every lru set.  It writes back the set's dirty
+ * buffers, ndirty at a time while the set is over its dirty limits,
+ * and the aged ones when kupdate asks for them.
+ */
+struct flusher_start {
+	struct semaphore *sem;
+	struct bh_lru_set *set;
+};
+
+int bdflush_set(void *arg)
+{
+	struct flusher_start *start = arg;
+	struct bh_lru_set *set = start->set;
+	struct task_struct *tsk = current;
+	int flushed;
+
+	tsk->session = 1;
+	tsk->pgrp = 1;
+	sprintf(tsk->comm, "bdflush/%d", (int) (set - lru_sets));
+	set->flush_tsk = tsk;
+
+	/* avoid getting signals */
+	spin_lock_irq(&tsk->sigmask_lock);
+	flush_signals(tsk);
+	sigfillset(&tsk->blocked);
+	recalc_sigpending(tsk);
+	spin_unlock_irq(&tsk->sigmask_lock);
+
+	up(start->sem);
+
+	for (;;) {
+		if (set->flush_old) {
+			set->flush_old = 0;
+			flush_lru_set(set, 1);
+			/* must really sync all the active I/O request to disk here */
+			run_task_queue(&tq_disk);
+			flushed = 0;
+		} else
+			flushed = flush_lru_set(set, 0);
+
+		/* See bdflush() for why we wake the waiters only
+		   after setting our state. */
+		__set_current_state(TASK_INTERRUPTIBLE);
+		wake_up_all(&set->flush_done);
+		if (!set->flush_old &&
+		    (!flushed || lru_set_dirty_state(set) < 0)) {
+			run_task_queue(&tq_disk);
+			schedule();
+		}
+		__set_current_state(TASK_RUNNING);
+	}
+}
+
 /*
  * This is the kernel update daemon. It was used to live in userspace
  * but since it's need to run safely we want it unkillable by mistake.
@@ -2810,10 +4149,20 @@ int kupdate(void *sem)
 static int __init bdflush_init(void)
 {
 	DECLARE_MUTEX_LOCKED(sem);
+	struct flusher_start start;
+	int i;
+
 	kernel_thread(bdflush, &sem, CLONE_FS | CLONE_FILES | CLONE_SIGNAL);
 	down(&sem);
 	kernel_thread(kupdate, &sem, CLONE_FS | CLONE_FILES | CLONE_SIGNAL);
 	down(&sem);
+
+	start.sem = &sem;
+	for (i = 0; i < BH_LRU_SETS; i++) {
+		start.set = &lru_sets[i];
+		kernel_thread(bdflush_set, &start, CLONE_FS | CLONE_FILES | CLONE_SIGNAL);
+		down(&sem);
+	}
 	return 0;
 }
 
@@ -44,7 +44,14 @@ struct cramfs_super {
  */
 #define CRAMFS_SUPPORTED_FLAGS (0xff)
 
+/*
+ * Largest compressed block we handle.  zlib output for a page is at
+ * most a few bytes longer than the page.
+ */
+#define CRAMFS_MAXCOMPR		(2*PAGE_CACHE_SIZE)
+
 /* Uncompression interfaces to the underlying zlib */
+void *cramfs_uncompress_buffer(void);
 int cramfs_uncompress_block(void *dst, int dstlen, void *src, int srclen);
 int cramfs_uncompress_init(void);
 int cramfs_uncompress_exit(void);
@@ -17,6 +17,7 @@
 #include <linux/init.h>
 #include <linux/string.h>
 #include <linux/locks.h>
+#include <linux/slab.h>
 
 #include <asm/uaccess.h>
 
@@ -75,9 +76,7 @@ static struct inode *get_cramfs_inode(struct super_block *sb, struct cramfs_inod
  * worry about end-of-buffer issues even when decompressing a full
  * page cache.
  */
-#define READ_BUFFERS (2)
-/* NEXT_BUFFER(): Loop over [0..(READ_BUFFERS-1)]. */
-#define NEXT_BUFFER(_ix) ((_ix) ^ 1)
+#define READ_BUFFERS (8)
 
 /*
  * BLKS_PER_BUF_SHIFT should be at least 2 to allow for "compressed"
@@ -91,16 +90,22 @@ static struct inode *get_cramfs_inode(struct super_block *sb, struct cramfs_inod
 static unsigned char read_buffers[READ_BUFFERS][BUFFER_SIZE];
 static unsigned buffer_blocknr[READ_BUFFERS];
 static struct super_block * buffer_dev[READ_BUFFERS];
-static int next_buffer;
+static unsigned long buffer_used[READ_BUFFERS];	/* for LRU replacement */
+static unsigned long buffer_clock;
+
+/* Protects the buffers, and the data cramfs_read() returns */
+static DECLARE_MUTEX(read_mutex);
 
 /*
  * Returns a pointer to a buffer containing at least LEN bytes of
  * filesystem starting at byte offset OFFSET into the filesystem.
+ * Called with read_mutex held.
  */
 static void *cramfs_read(struct super_block *sb, unsigned int offset, unsigned int len)
 {
 	struct buffer_head * bh_array[BLKS_PER_BUF];
-	unsigned i, blocknr, buffer;
+	struct buffer_head * read_array[BLKS_PER_BUF];
+	unsigned i, blocknr, buffer, nr;
 	char *data;
 
 	if (!len)
@@ -120,27 +125,38 @@ static void *cramfs_read(struct super_block *sb, unsigned int offset, unsigned i
 		blk_offset += offset;
 		if (blk_offset + len > BUFFER_SIZE)
 			continue;
+		buffer_used[i] = ++buffer_clock;
 		return read_buffers[i] + blk_offset;
 	}
 
-	/* Ok, read in BLKS_PER_BUF pages completely first. */
-	for (i = 0; i < BLKS_PER_BUF; i++)
-		bh_array[i] = bread(sb->s_dev, blocknr + i, PAGE_CACHE_SIZE);
-
-	/* Ok, copy them to the staging area without sleeping. */
-	buffer = next_buffer;
-	next_buffer = NEXT_BUFFER(buffer);
+	/* Ok, read in BLKS_PER_BUF pages completely first, in one go. */
+	nr = 0;
+	for (i = 0; i < BLKS_PER_BUF; i++) {
+		bh_array[i] = getblk(sb->s_dev, blocknr + i, PAGE_CACHE_SIZE);
+		if (!buffer_uptodate(bh_array[i]))
+			read_array[nr++] = bh_array[i];
+	}
+	if (nr)
+		ll_rw_block(READ, nr, read_array);
+
+	/* Replace the least recently used buffer. */
+	buffer = 0;
+	for (i = 1; i < READ_BUFFERS; i++)
+		if (buffer_used[i] < buffer_used[buffer])
+			buffer = i;
+	buffer_used[buffer] = ++buffer_clock;
 	buffer_blocknr[buffer] = blocknr;
 	buffer_dev[buffer] = sb;
 
 	data = read_buffers[buffer];
 	for (i = 0; i < BLKS_PER_BUF; i++) {
 		struct buffer_head * bh = bh_array[i];
-		if (bh) {
+		wait_on_buffer(bh);
+		if (buffer_uptodate(bh))
 			memcpy(data, bh->b_data, PAGE_CACHE_SIZE);
-			bforget(bh);
-		} else
+		else
 			memset(data, 0, PAGE_CACHE_SIZE);
+		bforget(bh);
 		data += PAGE_CACHE_SIZE;
 	}
 	return read_buffers[buffer] + offset;
@@ -158,12 +174,14 @@ static struct super_block * cramfs_read_super(struct super_block *sb, void *data
 	sb->s_blocksize = PAGE_CACHE_SIZE;
 	sb->s_blocksize_bits = PAGE_CACHE_SHIFT;
 
+	down(&read_mutex);
 	/* Invalidate the read buffers on mount: think disk change.. */
 	for (i = 0; i < READ_BUFFERS; i++)
 		buffer_blocknr[i] = -1;
 
 	/* Read the first block and get the superblock from it */
 	memcpy(&super, cramfs_read(sb, 0, sizeof(super)), sizeof(super));
+	up(&read_mutex);
 
 	/* Do sanity checks on the superblock */
 	if (super.magic != CRAMFS_MAGIC) {
@@ -219,6 +237,7 @@ static int cramfs_readdir(struct file *filp, void *dirent, filldir_t filldir)
 {
 	struct inode *inode = filp->f_dentry->d_inode;
 	struct super_block *sb = inode->i_sb;
+	char *buf;
 	unsigned int offset;
 	int copied;
 
@@ -230,13 +249,21 @@ static int cramfs_readdir(struct file *filp, void *dirent, filldir_t filldir)
 	if (offset & 3)
 		return -EINVAL;
 
+	/* filldir() may fault in a page of this filesystem: copy the name */
+	buf = kmalloc(256, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
 	copied = 0;
 	while (offset < inode->i_size) {
 		struct cramfs_inode *de;
 		unsigned long nextoffset;
 		char *name;
+		ino_t ino;
+		mode_t mode;
 		int namelen, error;
 
+		down(&read_mutex);
 		de = cramfs_read(sb, OFFSET(inode) + offset, sizeof(*de)+256);
 		name = (char *)(de+1);
 
@@ -246,15 +273,21 @@ static int cramfs_readdir(struct file *filp, void *dirent, filldir_t filldir)
 		 * with zeroes.
 		 */
 		namelen = de->namelen << 2;
+		memcpy(buf, name, namelen);
+		ino = CRAMINO(de);
+		mode = de->mode;
+		up(&read_mutex);
 		nextoffset = offset + sizeof(*de) + namelen;
 		for (;;) {
-			if (!namelen)
+			if (!namelen) {
+				kfree(buf);
 				return -EIO;
-			if (name[namelen-1])
+			}
+			if (buf[namelen-1])
 				break;
 			namelen--;
 		}
-		error = filldir(dirent, name, namelen, offset, CRAMINO(de), de->mode >> 12);
+		error = filldir(dirent, buf, namelen, offset, ino, mode >> 12);
 		if (error)
 			break;
 
@@ -262,6 +295,7 @@ static int cramfs_readdir(struct file *filp, void *dirent, filldir_t filldir)
 		filp->f_pos = offset;
 		copied++;
 	}
+	kfree(buf);
 	return 0;
 }
 
@@ -271,7 +305,9 @@ static int cramfs_readdir(struct file *filp, void *dirent, filldir_t filldir)
 static struct dentry * cramfs_lookup(struct inode *dir, struct dentry *dentry)
 {
 	unsigned int offset = 0;
+	struct inode *inode = NULL;
 
+	down(&read_mutex);
 	while (offset < dir->i_size) {
 		struct cramfs_inode *de;
 		char *name;
@@ -287,8 +323,10 @@ static struct dentry * cramfs_lookup(struct inode *dir, struct dentry *dentry)
 			continue;
 
 		for (;;) {
-			if (!namelen)
+			if (!namelen) {
+				up(&read_mutex);
 				return ERR_PTR(-EIO);
+			}
 			if (name[namelen-1])
 				break;
 			namelen--;
@@ -297,17 +335,24 @@ static struct dentry * cramfs_lookup(struct inode *dir, struct dentry *dentry)
 			continue;
 		if (memcmp(dentry->d_name.name, name, namelen))
 			continue;
-		d_add(dentry, get_cramfs_inode(dir->i_sb, de));
-		return NULL;
+		inode = get_cramfs_inode(dir->i_sb, de);
+		break;
 	}
-	d_add(dentry, NULL);
+	up(&read_mutex);
+	d_add(dentry, inode);
 	return NULL;
 }
 
+/*
+ * Only finding and copying the compressed block is done under
+ * read_mutex.  It is then uncompressed with this CPU's stream, in
+ * parallel with readers on other CPUs.
+ */
 static int cramfs_readpage(struct file *file, struct page * page)
 {
 	struct inode *inode = page->mapping->host;
 	u32 maxblock, bytes_filled;
+	char *kaddr = kmap(page);
 
 	maxblock = (inode->i_size + PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT;
 	bytes_filled = 0;
@@ -315,22 +360,34 @@ static int cramfs_readpage(struct file *file, struct page * page)
 		struct super_block *sb = inode->i_sb;
 		u32 blkptr_offset = OFFSET(inode) + page->index*4;
 		u32 start_offset, compr_len;
+		void *src;
 
+		down(&read_mutex);
 		start_offset = OFFSET(inode) + maxblock*4;
 		if (page->index)
 			start_offset = *(u32 *) cramfs_read(sb, blkptr_offset-4, 4);
 		compr_len = (*(u32 *) cramfs_read(sb, blkptr_offset, 4)
 			     - start_offset);
 		if (compr_len == 0)
-			; /* hole */
-		else
-			bytes_filled = cramfs_uncompress_block(page_address(page),
+			up(&read_mutex); /* hole */
+		else if (compr_len > CRAMFS_MAXCOMPR) {
+			up(&read_mutex);
+			printk(KERN_ERR "cramfs: bad compressed block length %u\n",
+			       compr_len);
+		} else {
+			src = cramfs_read(sb, start_offset, compr_len);
+			/* No sleeping from here on: the buffer is this CPU's */
+			memcpy(cramfs_uncompress_buffer(), src, compr_len);
+			up(&read_mutex);
+			bytes_filled = cramfs_uncompress_block(kaddr,
 				 PAGE_CACHE_SIZE,
-				 cramfs_read(sb, start_offset, compr_len),
+				 cramfs_uncompress_buffer(),
 				 compr_len);
+		}
 	}
-	memset(page_address(page) + bytes_filled, 0, PAGE_CACHE_SIZE - bytes_filled);
+	memset(kaddr + bytes_filled, 0, PAGE_CACHE_SIZE - bytes_filled);
 	flush_dcache_page(page);
+	kunmap(page);
 	SetPageUptodate(page);
 	UnlockPage(page);
 	return 0;
@@ -364,8 +421,14 @@ static DECLARE_FSTYPE_DEV(cramfs_fs_type, "cramfs", cramfs_read_super);
 
 static int __init init_cramfs_fs(void)
 {
-	cramfs_uncompress_init();
-	return register_filesystem(&cramfs_fs_type);
+	int err = cramfs_uncompress_init();
+
+	if (err)
+		return err;
+	err = register_filesystem(&cramfs_fs_type);
+	if (err)
+		cramfs_uncompress_exit();
+	return err;
 }
 
 static void __exit exit_cramfs_fs(void)
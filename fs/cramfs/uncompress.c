@@ -4,46 +4,64 @@
  * (C) Copyright 1999 Linus Torvalds
  *
  * cramfs interfaces to the uncompression library. There's really just
- * three entrypoints:
+ * four entrypoints:
  *
  *  - cramfs_uncompress_init() - called to initialize the thing.
  *  - cramfs_uncompress_exit() - tell me when you're done
+ *  - cramfs_uncompress_buffer() - where to put a compressed block.
  *  - cramfs_uncompress_block() - uncompress a block.
  *
- * NOTE NOTE NOTE! The uncompression is entirely single-threaded. We
- * only have one stream, and we'll initialize it only once even if it
- * then is used by multiple filesystems.
+ * Every CPU has a stream and an input buffer of its own, shared by all
+ * filesystems.  Inflating never sleeps, so from the moment a reader
+ * asks for the buffer until the block is uncompressed, nobody else can
+ * use them: readers on different CPUs decompress in parallel.
  */
 
 #include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/vmalloc.h>
+#include <linux/pagemap.h>
+#include <linux/errno.h>
+#include <linux/string.h>
 
-#include "inflate/zlib.h"
+#include <linux/zlib.h>
+#include "cramfs.h"
 
-static z_stream stream;
+static struct cramfs_stream {
+	z_stream stream;
+	void *buffer;		/* CRAMFS_MAXCOMPR bytes */
+} streams[NR_CPUS];
 static int initialized;
 
+/* This CPU's buffer for a compressed block: valid until we sleep */
+void *cramfs_uncompress_buffer(void)
+{
+	return streams[smp_processor_id()].buffer;
+}
+
 /* Returns length of decompressed data. */
 int cramfs_uncompress_block(void *dst, int dstlen, void *src, int srclen)
 {
+	z_stream *stream = &streams[smp_processor_id()].stream;
 	int err;
 
-	stream.next_in = src;
-	stream.avail_in = srclen;
+	stream->next_in = src;
+	stream->avail_in = srclen;
 
-	stream.next_out = dst;
-	stream.avail_out = dstlen;
+	stream->next_out = dst;
+	stream->avail_out = dstlen;
 
-	err = cramfs_inflateReset(&stream);
+	err = zlib_inflateReset(stream);
 	if (err != Z_OK) {
-		printk("cramfs_inflateReset error %d\n", err);
-		cramfs_inflateEnd(&stream);
-		cramfs_inflateInit(&stream);
+		printk("zlib_inflateReset error %d\n", err);
+		zlib_inflateEnd(stream);
+		zlib_inflateInit(stream);
 	}
 
-	err = cramfs_inflate(&stream, Z_FINISH);
+	err = zlib_inflate(stream, Z_FINISH);
 	if (err != Z_STREAM_END)
 		goto err;
-	return stream.total_out;
+	return stream->total_out;
 
 err:
 	printk("Error %d while decompressing!\n", err);
@@ -51,19 +69,48 @@ err:
 	return 0;
 }
 
+static void cramfs_free_streams(void)
+{
+	int cpu;
+
+	for (cpu = 0; cpu < smp_num_cpus; cpu++) {
+		if (streams[cpu].stream.state)
+			zlib_inflateEnd(&streams[cpu].stream);
+		vfree(streams[cpu].stream.workspace);
+		vfree(streams[cpu].buffer);
+		memset(&streams[cpu], 0, sizeof(streams[cpu]));
+	}
+}
+
 int cramfs_uncompress_init(void)
 {
-	if (!initialized++) {
-		stream.next_in = NULL;
-		stream.avail_in = 0;
-		cramfs_inflateInit(&stream);
+	z_stream *stream;
+	int cpu;
+
+	if (initialized++)
+		return 0;
+	for (cpu = 0; cpu < smp_num_cpus; cpu++) {
+		stream = &streams[cpu].stream;
+		stream->workspace = vmalloc(zlib_inflate_workspacesize());
+		streams[cpu].buffer = vmalloc(CRAMFS_MAXCOMPR);
+		if (!stream->workspace || !streams[cpu].buffer)
+			goto fail;
+		stream->next_in = NULL;
+		stream->avail_in = 0;
+		if (zlib_inflateInit(stream) != Z_OK)
+			goto fail;
 	}
 	return 0;
+
+fail:
+	cramfs_free_streams();
+	initialized = 0;
+	return -ENOMEM;
 }
 
 int cramfs_uncompress_exit(void)
 {
 	if (!--initialized)
-		cramfs_inflateEnd(&stream);
+		cramfs_free_streams();
 	return 0;
 }
@@ -30,6 +30,7 @@
 /* #define DCACHE_DEBUG 1 */
 
 spinlock_t dcache_lock = SPIN_LOCK_UNLOCKED;
+unsigned int d_hash_seq;
 
 /* Right now the dcache depends on the kernel lock */
 #define check_lock()	if (!kernel_locked()) BUG()
@@ -50,45 +51,66 @@ static kmem_cache_t *dentry_cache;
 static unsigned int d_hash_mask;
 static unsigned int d_hash_shift;
 static struct list_head *dentry_hashtable;
+
+/*
+ * Unused dentries, most recently used first. Negative ones are kept
+ * apart so that the misses they remember survive a burst of positive
+ * dentries going through the cache; see prune_dcache().
+ */
 static LIST_HEAD(dentry_unused);
+static LIST_HEAD(dentry_unused_negative);
 
-struct {
-	int nr_dentry;
-	int nr_unused;
-	int age_limit;		/* age in seconds */
-	int want_pages;		/* pages requested by system */
-	int dummy[2];
-} dentry_stat = {0, 0, 45, 0,};
+struct dentry_stat_t dentry_stat = {0, 0, 45, 0,};
 
-/* no dcache_lock, please */
-static inline void d_free(struct dentry *dentry)
+static inline struct list_head * d_unused_list(struct dentry * dentry)
 {
-	if (dentry->d_op && dentry->d_op->d_release)
-		dentry->d_op->d_release(dentry);
+	return dentry->d_inode ? &dentry_unused : &dentry_unused_negative;
+}
+
+static void d_callback(void *arg)
+{
+	struct dentry *dentry = arg;
+
 	if (dname_external(dentry)) 
 		kfree(dentry->d_name.name);
 	kmem_cache_free(dentry_cache, dentry); 
+}
+
+/*
+ * A lockless d_lookup() may still be walking past the dentry, so the
+ * memory is only given back once that can no longer be the case.
+ * no dcache_lock, please
+ */
+static inline void d_free(struct dentry *dentry)
+{
+	if (dentry->d_op && dentry->d_op->d_release)
+		dentry->d_op->d_release(dentry);
 	dentry_stat.nr_dentry--;
+	call_rcu(&dentry->d_rcu, d_callback, dentry);
 }
 
 /*
  * Release the dentry's inode, using the fileystem
  * d_iput() operation if defined.
- * Called with dcache_lock held, drops it.
+ * Called with dcache_lock and dentry->d_lock held, drops them.
  */
 static inline void dentry_iput(struct dentry * dentry)
 {
 	struct inode *inode = dentry->d_inode;
 	if (inode) {
 		dentry->d_inode = NULL;
+		dentry->d_flags &= ~DCACHE_COMPLETE;
 		list_del_init(&dentry->d_alias);
+		spin_unlock(&dentry->d_lock);
 		spin_unlock(&dcache_lock);
 		if (dentry->d_op && dentry->d_op->d_iput)
 			dentry->d_op->d_iput(dentry, inode);
 		else
 			iput(inode);
-	} else
+	} else {
+		spin_unlock(&dentry->d_lock);
 		spin_unlock(&dcache_lock);
+	}
 }
 
 /* 
@@ -129,9 +151,14 @@ repeat:
 	if (!atomic_dec_and_lock(&dentry->d_count, &dcache_lock))
 		return;
 
-	/* dput on a free dentry? */
-	if (!list_empty(&dentry->d_lru))
-		BUG();
+	/* Picked up again by a lockless d_lookup() meanwhile? */
+	spin_lock(&dentry->d_lock);
+	if (atomic_read(&dentry->d_count)) {
+		spin_unlock(&dentry->d_lock);
+		spin_unlock(&dcache_lock);
+		return;
+	}
+
 	/*
 	 * AV: ->d_delete() is _NOT_ allowed to block now.
 	 */
@@ -142,22 +169,34 @@ repeat:
 	/* Unreachable? Get rid of it */
 	if (list_empty(&dentry->d_hash))
 		goto kill_it;
-	list_add(&dentry->d_lru, &dentry_unused);
-	dentry_stat.nr_unused++;
+	/*
+	 * d_lookup() takes references without taking dentries off the
+	 * unused list, so it may still be on it.
+	 */
+	if (!list_empty(&dentry->d_lru))
+		list_del(&dentry->d_lru);
+	else
+		dentry_stat.nr_unused++;
+	list_add(&dentry->d_lru, d_unused_list(dentry));
 	/*
 	 * Update the timestamp
 	 */
 	dentry->d_reftime = jiffies;
+	spin_unlock(&dentry->d_lock);
 	spin_unlock(&dcache_lock);
 	return;
 
 unhash_it:
-	list_del_init(&dentry->d_hash);
+	__d_unhash(dentry);
 
 kill_it: {
 		struct dentry *parent;
+		if (!list_empty(&dentry->d_lru)) {
+			list_del(&dentry->d_lru);
+			dentry_stat.nr_unused--;
+		}
 		list_del(&dentry->d_child);
-		/* drops the lock, at that point nobody can reach this dentry */
+		/* drops the locks, at that point nobody can reach this dentry */
 		dentry_iput(dentry);
 		parent = dentry->d_parent;
 		d_free(dentry);
@@ -217,7 +256,7 @@ int d_invalidate(struct dentry * dentry)
 		}
 	}
 
-	list_del_init(&dentry->d_hash);
+	__d_drop(dentry);
 	spin_unlock(&dcache_lock);
 	return 0;
 }
@@ -299,13 +338,14 @@ restart:
  * Throw away a dentry - free the inode, dput the parent.
  * This requires that the LRU list has already been
  * removed.
- * Called with dcache_lock, drops it and then regains.
+ * Called with dcache_lock and dentry->d_lock, drops them
+ * and then regains dcache_lock.
  */
 static inline void prune_one_dentry(struct dentry * dentry)
 {
 	struct dentry * parent;
 
-	list_del_init(&dentry->d_hash);
+	__d_unhash(dentry);
 	list_del(&dentry->d_child);
 	dentry_iput(dentry);
 	parent = dentry->d_parent;
@@ -328,6 +368,28 @@ static inline void prune_one_dentry(struct dentry * dentry)
  * all the dentries are in use.
  */
  
+/*
+ * Negative dentries are only taken before positive ones once they
+ * have gone unused for age_limit seconds, or when nothing else is left.
+ */
+static inline struct list_head * prune_victim(void)
+{
+	struct list_head *tmp = dentry_unused_negative.prev;
+
+	if (tmp != &dentry_unused_negative) {
+		struct dentry *dentry = list_entry(tmp, struct dentry, d_lru);
+
+		if (list_empty(&dentry_unused))
+			return tmp;
+		if (time_after(jiffies, dentry->d_reftime + dentry_stat.age_limit * HZ))
+			return tmp;
+	}
+	tmp = dentry_unused.prev;
+	if (tmp == &dentry_unused)
+		return NULL;
+	return tmp;
+}
+
 void prune_dcache(int count)
 {
 	spin_lock(&dcache_lock);
@@ -335,17 +397,22 @@ void prune_dcache(int count)
 		struct dentry *dentry;
 		struct list_head *tmp;
 
-		tmp = dentry_unused.prev;
-
-		if (tmp == &dentry_unused)
+		tmp = prune_victim();
+		if (!tmp)
 			break;
 		dentry_stat.nr_unused--;
 		list_del_init(tmp);
 		dentry = list_entry(tmp, struct dentry, d_lru);
 
-		/* Unused dentry with a count? */
-		if (atomic_read(&dentry->d_count))
-			BUG();
+		/*
+		 * In use again after a lockless d_lookup()? Leave it
+		 * off the list; dput() puts it back when it is unused.
+		 */
+		spin_lock(&dentry->d_lock);
+		if (atomic_read(&dentry->d_count)) {
+			spin_unlock(&dentry->d_lock);
+			continue;
+		}
 
 		prune_one_dentry(dentry);
 		if (!--count)
@@ -367,16 +434,8 @@ void prune_dcache(int count)
  * the end, it's really just a single traversal.
  */
 
-/**
- * shrink_dcache_sb - shrink dcache for a superblock
- * @sb: superblock
- *
- * Shrink the dcache for the specified super block. This
- * is used to free the dcache before unmounting a file
- * system
- */
-
-void shrink_dcache_sb(struct super_block * sb)
+/* Called with dcache_lock held */
+static void shrink_unused_list(struct super_block * sb, struct list_head * list)
 {
 	struct list_head *tmp, *next;
 	struct dentry *dentry;
@@ -385,24 +444,23 @@ void shrink_dcache_sb(struct super_block * sb)
 	 * Pass one ... move the dentries for the specified
 	 * superblock to the most recent end of the unused list.
 	 */
-	spin_lock(&dcache_lock);
-	next = dentry_unused.next;
-	while (next != &dentry_unused) {
+	next = list->next;
+	while (next != list) {
 		tmp = next;
 		next = tmp->next;
 		dentry = list_entry(tmp, struct dentry, d_lru);
 		if (dentry->d_sb != sb)
 			continue;
 		list_del(tmp);
-		list_add(tmp, &dentry_unused);
+		list_add(tmp, list);
 	}
 
 	/*
 	 * Pass two ... free the dentries for this superblock.
 	 */
 repeat:
-	next = dentry_unused.next;
-	while (next != &dentry_unused) {
+	next = list->next;
+	while (next != list) {
 		tmp = next;
 		next = tmp->next;
 		dentry = list_entry(tmp, struct dentry, d_lru);
@@ -410,12 +468,34 @@ repeat:
 			continue;
 		if (atomic_read(&dentry->d_count))
 			continue;
+		spin_lock(&dentry->d_lock);
+		if (atomic_read(&dentry->d_count)) {
+			spin_unlock(&dentry->d_lock);
+			continue;
+		}
 		dentry_stat.nr_unused--;
 		list_del(tmp);
 		INIT_LIST_HEAD(tmp);
 		prune_one_dentry(dentry);
 		goto repeat;
 	}
+}
+
+/**
+ * shrink_dcache_sb - shrink dcache for a superblock
+ * @sb: superblock
+ *
+ * Shrink the dcache for the specified super block. This
+ * is used to free the dcache before unmounting a file
+ * system
+ */
+
+void shrink_dcache_sb(struct super_block * sb)
+{
+	spin_lock(&dcache_lock);
+	/* Negative ones first: freeing them only releases positive parents */
+	shrink_unused_list(sb, &dentry_unused_negative);
+	shrink_unused_list(sb, &dentry_unused);
 	spin_unlock(&dcache_lock);
 }
 
@@ -494,7 +574,7 @@ resume:
 		next = tmp->next;
 		if (!atomic_read(&dentry->d_count)) {
 			list_del(&dentry->d_lru);
-			list_add(&dentry->d_lru, dentry_unused.prev);
+			list_add(&dentry->d_lru, d_unused_list(dentry)->prev);
 			found++;
 		}
 		/*
@@ -611,6 +691,7 @@ struct dentry * d_alloc(struct dentry * parent, const struct qstr *name)
 
 	atomic_set(&dentry->d_count, 1);
 	dentry->d_flags = 0;
+	spin_lock_init(&dentry->d_lock);
 	dentry->d_inode = NULL;
 	dentry->d_parent = NULL;
 	dentry->d_sb = NULL;
@@ -655,9 +736,14 @@ struct dentry * d_alloc(struct dentry * parent, const struct qstr *name)
 void d_instantiate(struct dentry *entry, struct inode * inode)
 {
 	spin_lock(&dcache_lock);
+	spin_lock(&entry->d_lock);
+	/* A name going into the directory without a hashed dentry */
+	if (inode && list_empty(&entry->d_hash))
+		entry->d_parent->d_flags &= ~DCACHE_COMPLETE;
 	if (inode)
 		list_add(&entry->d_alias, &inode->i_dentry);
 	entry->d_inode = inode;
+	spin_unlock(&entry->d_lock);
 	spin_unlock(&dcache_lock);
 }
 
@@ -703,6 +789,64 @@ static inline struct list_head * d_hash(struct dentry * parent, unsigned long ha
  * finished using it. %NULL is returned on failure.
  */
  
+/*
+ * The lockless walk. Each dentry that looks right is checked again
+ * under its d_lock, which d_move(), unhashing and the final dput()
+ * take as well, and the reference is taken there. Returns -EAGAIN if
+ * a hash chain changed under us, in which case a miss means nothing.
+ */
+static int __d_lookup(struct dentry * parent, struct qstr * name,
+		      unsigned int seq, struct dentry ** result)
+{
+	unsigned int len = name->len;
+	unsigned int hash = name->hash;
+	const unsigned char *str = name->name;
+	struct list_head *head = d_hash(parent,hash);
+	struct list_head *tmp;
+
+	tmp = head->next;
+	for (;;) {
+		struct dentry * dentry;
+
+		rmb();
+		if (d_hash_seq != seq)
+			return -EAGAIN;
+		if (tmp == head)
+			break;
+		dentry = list_entry(tmp, struct dentry, d_hash);
+		tmp = tmp->next;
+		if (dentry->d_name.hash != hash)
+			continue;
+		if (dentry->d_parent != parent)
+			continue;
+
+		spin_lock(&dentry->d_lock);
+		if (dentry->d_name.hash != hash)
+			goto next;
+		if (dentry->d_parent != parent)
+			goto next;
+		if (list_empty(&dentry->d_hash))
+			goto next;
+		if (parent->d_op && parent->d_op->d_compare) {
+			if (parent->d_op->d_compare(parent, &dentry->d_name, name))
+				goto next;
+		} else {
+			if (dentry->d_name.len != len)
+				goto next;
+			if (memcmp(dentry->d_name.name, str, len))
+				goto next;
+		}
+		atomic_inc(&dentry->d_count);
+		spin_unlock(&dentry->d_lock);
+		*result = dentry;
+		return 0;
+next:
+		spin_unlock(&dentry->d_lock);
+	}
+	*result = NULL;
+	return 0;
+}
+
 struct dentry * d_lookup(struct dentry * parent, struct qstr * name)
 {
 	unsigned int len = name->len;
@@ -710,7 +854,14 @@ struct dentry * d_lookup(struct dentry * parent, struct qstr * name)
 	const unsigned char *str = name->name;
 	struct list_head *head = d_hash(parent,hash);
 	struct list_head *tmp;
+	struct dentry *found;
+	unsigned int seq;
 
+	seq = d_hash_seq;
+	if (!(seq & 1) && !__d_lookup(parent, name, seq, &found))
+		return found;
+
+	/* Somebody is changing the hash chains: do it the slow way */
 	spin_lock(&dcache_lock);
 	tmp = head->next;
 	for (;;) {
@@ -822,10 +973,12 @@ void d_delete(struct dentry * dentry)
 	 * Are we the only user?
 	 */
 	spin_lock(&dcache_lock);
+	spin_lock(&dentry->d_lock);
 	if (atomic_read(&dentry->d_count) == 1) {
 		dentry_iput(dentry);
 		return;
 	}
+	spin_unlock(&dentry->d_lock);
 	spin_unlock(&dcache_lock);
 
 	/*
@@ -846,7 +999,11 @@ void d_rehash(struct dentry * entry)
 {
 	struct list_head *list = d_hash(entry->d_parent, entry->d_name.hash);
 	spin_lock(&dcache_lock);
+	spin_lock(&entry->d_lock);
+	d_hash_write_begin();
 	list_add(&entry->d_hash, list);
+	d_hash_write_end();
+	spin_unlock(&entry->d_lock);
 	spin_unlock(&dcache_lock);
 }
 
@@ -914,6 +1071,10 @@ void d_move(struct dentry * dentry, struct dentry * target)
 		printk(KERN_WARNING "VFS: moving negative dcache entry\n");
 
 	spin_lock(&dcache_lock);
+	spin_lock(&dentry->d_lock);
+	spin_lock(&target->d_lock);
+	d_hash_write_begin();
+
 	/* Move the dentry to the target hash queue */
 	list_del(&dentry->d_hash);
 	list_add(&dentry->d_hash, &target->d_hash);
@@ -934,6 +1095,10 @@ void d_move(struct dentry * dentry, struct dentry * target)
 	/* And add them back to the (new) parent lists */
 	list_add(&target->d_child, &target->d_parent->d_subdirs);
 	list_add(&dentry->d_child, &dentry->d_parent->d_subdirs);
+
+	d_hash_write_end();
+	spin_unlock(&target->d_lock);
+	spin_unlock(&dentry->d_lock);
 	spin_unlock(&dcache_lock);
 }
 
@@ -1267,6 +1432,7 @@ void __init vfs_caches_init(unsigned long mempages)
 			SLAB_HWCACHE_ALIGN, NULL, NULL);
 	if(!filp_cachep)
 		panic("Cannot create filp SLAB cache");
+	files_init();
 
 #if defined (CONFIG_QUOTA)
 	dquot_cachep = kmem_cache_create("dquot", 
@@ -668,26 +668,29 @@ static void add_dquot_ref(struct super_block *sb, short type)
 {
 	struct list_head *p;
 	struct inode *inode;
+	int cpu;
 
 	if (!sb->dq_op)
 		return;	/* nothing to do */
 
 restart:
-	file_list_lock();
-	for (p = sb->s_files.next; p != &sb->s_files; p = p->next) {
-		struct file *filp = list_entry(p, struct file, f_list);
-		if (!filp->f_dentry)
-			continue;
-		inode = filp->f_dentry->d_inode;
-		if (filp->f_mode & FMODE_WRITE && dqinit_needed(inode, type)) {
-			file_list_unlock();
-			sb->dq_op->initialize(inode, type);
-			inode->i_flags |= S_QUOTA;
-			/* As we may have blocked we had better restart... */
-			goto restart;
+	for (cpu = 0; cpu < NR_CPUS; cpu++) {
+		sb_file_list_lock(cpu);
+		for (p = sb->s_files[cpu].next; p != &sb->s_files[cpu]; p = p->next) {
+			struct file *filp = list_entry(p, struct file, f_list);
+			if (!filp->f_dentry)
+				continue;
+			inode = filp->f_dentry->d_inode;
+			if (filp->f_mode & FMODE_WRITE && dqinit_needed(inode, type)) {
+				sb_file_list_unlock(cpu);
+				sb->dq_op->initialize(inode, type);
+				inode->i_flags |= S_QUOTA;
+				/* As we may have blocked we had better restart... */
+				goto restart;
+			}
 		}
+		sb_file_list_unlock(cpu);
 	}
-	file_list_unlock();
 }
 
 /* Return 0 if dqput() won't block (note that 1 doesn't necessarily mean blocking) */
@@ -0,0 +1,654 @@
+/*
+ *  linux/fs/eventpoll.c
+ *
+ *  Persistent interest sets for poll events (epoll).
+ *
+ *  An epoll file holds (file, fd) items.  Each item sits on the wait
+ *  queues of its file with a callback entry, so a socket, pipe or tty
+ *  wakeup moves the item onto the ready list.  epoll_wait() then only
+ *  polls the files that have had something happen to them, rather than
+ *  queueing on and scanning every descriptor each time like select().
+ */
+
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/file.h>
+#include <linux/poll.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/eventpoll.h>
+
+#include <asm/uaccess.h>
+#include <asm/semaphore.h>
+
+#define EVENTPOLLFS_MAGIC	0x03111965
+
+/* Hash size bounds for the items of one epoll file, as a power of 2 */
+#define EP_MIN_HASH_BITS	4
+#define EP_MAX_HASH_BITS	12
+
+#define EP_MAX_EVENTS	(INT_MAX / sizeof(struct epoll_event))
+
+/* One of the wait queues the file of an item poll_wait()ed on */
+struct eppoll_entry {
+	struct list_head llink;		/* on epi->pwqlist */
+	struct epitem *base;
+	wait_queue_t wait;
+	wait_queue_head_t *whead;
+};
+
+struct epitem {
+	struct list_head llink;		/* on an ep->hash chain */
+	struct list_head rdllink;	/* on ep->rdllist while ready */
+	struct list_head fllink;	/* on file->f_ep_links */
+	struct list_head pwqlist;	/* eppoll_entry's */
+	struct eventpoll *ep;
+	struct file *file;
+	int fd;
+	int nwait;			/* -1 if queueing ran out of memory */
+	struct epoll_event event;
+};
+
+struct eventpoll {
+	struct semaphore sem;		/* item changes vs. event transfer */
+	spinlock_t lock;		/* rdllist, taken from wakeups */
+	wait_queue_head_t wq;		/* epoll_wait() sleepers */
+	wait_queue_head_t poll_wait;	/* poll() on the epoll file itself */
+	struct list_head rdllist;
+	unsigned int hashbits;
+	struct list_head *hash;
+};
+
+/* A poll table that queues an item's callback rather than the caller */
+struct ep_pqueue {
+	poll_table pt;
+	struct epitem *epi;
+};
+
+/*
+ * Serializes epoll_ctl() and the release of epoll files and of watched
+ * files, which are what change file->f_ep_links. Taken before ep->sem.
+ */
+static DECLARE_MUTEX(epsem);
+
+static kmem_cache_t *epi_cachep;
+static kmem_cache_t *pwq_cachep;
+
+static struct vfsmount *eventpoll_mnt;
+static struct file_operations eventpoll_fops;
+
+static inline struct list_head *ep_hash_list(struct eventpoll *ep, struct file *file, int fd)
+{
+	unsigned long hash = (unsigned long) file / L1_CACHE_BYTES + fd;
+
+	return ep->hash + (hash & ((1 << ep->hashbits) - 1));
+}
+
+static struct epitem *ep_find(struct eventpoll *ep, struct file *file, int fd)
+{
+	struct list_head *head, *tmp;
+
+	head = ep_hash_list(ep, file, fd);
+	for (tmp = head->next; tmp != head; tmp = tmp->next) {
+		struct epitem *epi = list_entry(tmp, struct epitem, llink);
+		if (epi->file == file && epi->fd == fd)
+			return epi;
+	}
+	return NULL;
+}
+
+static void ep_wake(struct eventpoll *ep)
+{
+	if (waitqueue_active(&ep->wq))
+		wake_up(&ep->wq);
+	if (waitqueue_active(&ep->poll_wait))
+		wake_up(&ep->poll_wait);
+}
+
+/* Put an item on the ready list, if it is not there already */
+static inline void ep_set_ready(struct eventpoll *ep, struct epitem *epi)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&ep->lock, flags);
+	if (list_empty(&epi->rdllink))
+		list_add_tail(&epi->rdllink, &ep->rdllist);
+	spin_unlock_irqrestore(&ep->lock, flags);
+}
+
+/*
+ * Runs from __wake_up() on one of the watched file's wait queues, with
+ * that queue locked and interrupts off.
+ */
+static void ep_poll_callback(wait_queue_t *wait)
+{
+	struct epitem *epi = list_entry(wait, struct eppoll_entry, wait)->base;
+	struct eventpoll *ep = epi->ep;
+
+	ep_set_ready(ep, epi);
+	ep_wake(ep);
+}
+
+static void ep_ptable_queue_proc(struct file *file, wait_queue_head_t *whead, poll_table *pt)
+{
+	struct epitem *epi = ((struct ep_pqueue *) pt)->epi;
+	struct eppoll_entry *pwq;
+
+	if (epi->nwait < 0)
+		return;
+	pwq = kmem_cache_alloc(pwq_cachep, SLAB_KERNEL);
+	if (!pwq) {
+		epi->nwait = -1;
+		return;
+	}
+	init_waitqueue_func_entry(&pwq->wait, ep_poll_callback);
+	pwq->whead = whead;
+	pwq->base = epi;
+	add_wait_queue(whead, &pwq->wait);
+	list_add_tail(&pwq->llink, &epi->pwqlist);
+	epi->nwait++;
+}
+
+/* Called with epsem and ep->sem held */
+static void ep_unregister(struct eventpoll *ep, struct epitem *epi)
+{
+	unsigned long flags;
+
+	/* Once off the wait queues no callback can be running for it */
+	while (!list_empty(&epi->pwqlist)) {
+		struct eppoll_entry *pwq;
+
+		pwq = list_entry(epi->pwqlist.next, struct eppoll_entry, llink);
+		list_del(&pwq->llink);
+		remove_wait_queue(pwq->whead, &pwq->wait);
+		kmem_cache_free(pwq_cachep, pwq);
+	}
+
+	spin_lock_irqsave(&ep->lock, flags);
+	if (!list_empty(&epi->rdllink))
+		list_del(&epi->rdllink);
+	spin_unlock_irqrestore(&ep->lock, flags);
+
+	list_del(&epi->llink);
+	list_del(&epi->fllink);
+	kmem_cache_free(epi_cachep, epi);
+}
+
+/* Called with epsem and ep->sem held */
+static int ep_insert(struct eventpoll *ep, struct epoll_event *event, struct file *file, int fd)
+{
+	struct epitem *epi;
+	struct ep_pqueue epq;
+	unsigned int revents;
+
+	epi = kmem_cache_alloc(epi_cachep, SLAB_KERNEL);
+	if (!epi)
+		return -ENOMEM;
+	INIT_LIST_HEAD(&epi->rdllink);
+	INIT_LIST_HEAD(&epi->pwqlist);
+	epi->ep = ep;
+	epi->file = file;
+	epi->fd = fd;
+	epi->nwait = 0;
+	epi->event = *event;
+
+	/* Hook into the file's wait queues, and see where it is at */
+	epq.epi = epi;
+	poll_initwait(&epq.pt);
+	epq.pt.qproc = ep_ptable_queue_proc;
+	revents = file->f_op->poll(file, &epq.pt);
+
+	list_add_tail(&epi->llink, ep_hash_list(ep, file, fd));
+	list_add_tail(&epi->fllink, &file->f_ep_links);
+	if (epi->nwait < 0) {
+		ep_unregister(ep, epi);
+		return -ENOMEM;
+	}
+
+	if (revents & event->events) {
+		ep_set_ready(ep, epi);
+		ep_wake(ep);
+	}
+	return 0;
+}
+
+/* Called with epsem and ep->sem held */
+static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_event *event)
+{
+	unsigned int revents;
+
+	epi->event = *event;
+	revents = epi->file->f_op->poll(epi->file, NULL);
+	if (revents & event->events) {
+		ep_set_ready(ep, epi);
+		ep_wake(ep);
+	}
+	return 0;
+}
+
+/*
+ * Poll the items on the ready list and copy out those that really are
+ * ready.  Level-triggered items that were go back on the list so that
+ * the next call looks at them again.  Called with ep->sem held.
+ */
+static int ep_send_events(struct eventpoll *ep, struct epoll_event *events, int maxevents)
+{
+	struct list_head txlist;
+	struct epitem *epi;
+	struct epoll_event ev;
+	unsigned long flags;
+	int eventcnt = 0;
+
+	INIT_LIST_HEAD(&txlist);
+	spin_lock_irqsave(&ep->lock, flags);
+	list_splice(&ep->rdllist, &txlist);
+	INIT_LIST_HEAD(&ep->rdllist);
+	spin_unlock_irqrestore(&ep->lock, flags);
+
+	while (!list_empty(&txlist) && eventcnt < maxevents) {
+		epi = list_entry(txlist.next, struct epitem, rdllink);
+
+		spin_lock_irqsave(&ep->lock, flags);
+		list_del_init(&epi->rdllink);
+		spin_unlock_irqrestore(&ep->lock, flags);
+
+		ev.events = epi->file->f_op->poll(epi->file, NULL) & epi->event.events;
+		if (!ev.events)
+			continue;
+		ev.data = epi->event.data;
+		if (__copy_to_user(&events[eventcnt], &ev, sizeof(ev))) {
+			spin_lock_irqsave(&ep->lock, flags);
+			if (list_empty(&epi->rdllink))
+				list_add(&epi->rdllink, &txlist);
+			spin_unlock_irqrestore(&ep->lock, flags);
+			if (!eventcnt)
+				eventcnt = -EFAULT;
+			break;
+		}
+		eventcnt++;
+
+		if (!(epi->event.events & EPOLLET))
+			ep_set_ready(ep, epi);
+	}
+
+	/* Whatever we did not get to stays ready for the next call */
+	if (!list_empty(&txlist)) {
+		spin_lock_irqsave(&ep->lock, flags);
+		list_splice(&txlist, &ep->rdllist);
+		spin_unlock_irqrestore(&ep->lock, flags);
+	}
+	return eventcnt;
+}
+
+static int ep_poll(struct eventpoll *ep, struct epoll_event *events, int maxevents, long timeout)
+{
+	int res;
+	DECLARE_WAITQUEUE(wait, current);
+
+retry:
+	res = 0;
+	add_wait_queue(&ep->wq, &wait);
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!list_empty(&ep->rdllist) || !timeout)
+			break;
+		if (signal_pending(current)) {
+			res = -EINTR;
+			break;
+		}
+		timeout = schedule_timeout(timeout);
+	}
+	remove_wait_queue(&ep->wq, &wait);
+	set_current_state(TASK_RUNNING);
+
+	if (!res && !list_empty(&ep->rdllist)) {
+		down(&ep->sem);
+		res = ep_send_events(ep, events, maxevents);
+		up(&ep->sem);
+
+		/* Woken up but nothing was ready after all */
+		if (!res && timeout)
+			goto retry;
+	}
+	return res;
+}
+
+static struct eventpoll *ep_alloc(int size)
+{
+	struct eventpoll *ep;
+	unsigned int bits, i;
+
+	for (bits = EP_MIN_HASH_BITS; bits < EP_MAX_HASH_BITS; bits++)
+		if ((1 << bits) >= size)
+			break;
+
+	ep = kmalloc(sizeof(struct eventpoll), GFP_KERNEL);
+	if (!ep)
+		return NULL;
+	ep->hash = kmalloc(sizeof(struct list_head) << bits, GFP_KERNEL);
+	if (!ep->hash) {
+		kfree(ep);
+		return NULL;
+	}
+	for (i = 0; i < (1 << bits); i++)
+		INIT_LIST_HEAD(ep->hash + i);
+	ep->hashbits = bits;
+
+	init_MUTEX(&ep->sem);
+	spin_lock_init(&ep->lock);
+	init_waitqueue_head(&ep->wq);
+	init_waitqueue_head(&ep->poll_wait);
+	INIT_LIST_HEAD(&ep->rdllist);
+	return ep;
+}
+
+static void ep_free(struct eventpoll *ep)
+{
+	unsigned int i;
+
+	/* Nobody else can get at ep any more, but watched files can still go */
+	down(&epsem);
+	for (i = 0; i < (1 << ep->hashbits); i++) {
+		struct list_head *head = ep->hash + i;
+
+		while (!list_empty(head))
+			ep_unregister(ep, list_entry(head->next, struct epitem, llink));
+	}
+	up(&epsem);
+
+	kfree(ep->hash);
+	kfree(ep);
+}
+
+/* A watched file is going away: drop it from every set it is in */
+void eventpoll_release(struct file *file)
+{
+	struct epitem *epi;
+	struct eventpoll *ep;
+
+	down(&epsem);
+	while (!list_empty(&file->f_ep_links)) {
+		epi = list_entry(file->f_ep_links.next, struct epitem, fllink);
+		ep = epi->ep;
+		down(&ep->sem);
+		ep_unregister(ep, epi);
+		up(&ep->sem);
+	}
+	up(&epsem);
+}
+
+static unsigned int ep_eventpoll_poll(struct file *file, poll_table *wait)
+{
+	struct eventpoll *ep = file->private_data;
+
+	poll_wait(file, &ep->poll_wait, wait);
+	if (!list_empty(&ep->rdllist))
+		return POLLIN | POLLRDNORM;
+	return 0;
+}
+
+static int ep_eventpoll_close(struct inode *inode, struct file *file)
+{
+	ep_free(file->private_data);
+	return 0;
+}
+
+static struct file_operations eventpoll_fops = {
+	poll:		ep_eventpoll_poll,
+	release:	ep_eventpoll_close,
+};
+
+static int eventpollfs_delete_dentry(struct dentry *dentry)
+{
+	return 1;
+}
+
+static struct dentry_operations eventpollfs_dentry_operations = {
+	d_delete:	eventpollfs_delete_dentry,
+};
+
+static struct inode *ep_get_inode(void)
+{
+	struct inode *inode = get_empty_inode();
+
+	if (!inode)
+		return NULL;
+	inode->i_sb = eventpoll_mnt->mnt_sb;
+	inode->i_fop = &eventpoll_fops;
+
+	/* Never goes on the dirty list, see get_pipe_inode() */
+	inode->i_state = I_DIRTY;
+	inode->i_mode = S_IRUSR | S_IWUSR;
+	inode->i_uid = current->fsuid;
+	inode->i_gid = current->fsgid;
+	inode->i_atime = inode->i_mtime = inode->i_ctime = CURRENT_TIME;
+	inode->i_blksize = PAGE_SIZE;
+	return inode;
+}
+
+asmlinkage long sys_epoll_create(int size)
+{
+	struct eventpoll *ep;
+	struct file *file;
+	struct inode *inode;
+	struct dentry *dentry;
+	struct qstr this;
+	char name[32];
+	int error, fd;
+
+	error = -EINVAL;
+	if (size <= 0)
+		goto out;
+
+	error = -ENOMEM;
+	ep = ep_alloc(size);
+	if (!ep)
+		goto out;
+
+	error = -ENFILE;
+	file = get_empty_filp();
+	if (!file)
+		goto free_ep;
+
+	error = -ENOMEM;
+	inode = ep_get_inode();
+	if (!inode)
+		goto close_file;
+
+	error = get_unused_fd();
+	if (error < 0)
+		goto close_file_inode;
+	fd = error;
+
+	error = -ENOMEM;
+	sprintf(name, "[%lu]", inode->i_ino);
+	this.name = name;
+	this.len = strlen(name);
+	this.hash = inode->i_ino;
+	dentry = d_alloc(eventpoll_mnt->mnt_sb->s_root, &this);
+	if (!dentry)
+		goto close_file_inode_fd;
+	dentry->d_op = &eventpollfs_dentry_operations;
+	d_add(dentry, inode);
+
+	file->f_vfsmnt = mntget(eventpoll_mnt);
+	file->f_dentry = dentry;
+	file->f_pos = 0;
+	file->f_flags = O_RDONLY;
+	file->f_op = &eventpoll_fops;
+	file->f_mode = FMODE_READ;
+	file->f_version = 0;
+	file->private_data = ep;
+
+	fd_install(fd, file);
+	return fd;
+
+close_file_inode_fd:
+	put_unused_fd(fd);
+close_file_inode:
+	iput(inode);
+close_file:
+	put_filp(file);
+free_ep:
+	kfree(ep->hash);
+	kfree(ep);
+out:
+	return error;
+}
+
+asmlinkage long sys_epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+	struct file *file, *tfile;
+	struct eventpoll *ep;
+	struct epitem *epi;
+	struct epoll_event epds;
+	int error;
+
+	if (op != EPOLL_CTL_DEL) {
+		error = -EFAULT;
+		if (copy_from_user(&epds, event, sizeof(struct epoll_event)))
+			goto out;
+		/* Errors and hangups are always reported */
+		epds.events |= POLLERR | POLLHUP;
+	}
+
+	error = -EBADF;
+	file = fget(epfd);
+	if (!file)
+		goto out;
+	tfile = fget(fd);
+	if (!tfile)
+		goto fput_file;
+
+	error = -EPERM;
+	if (!tfile->f_op || !tfile->f_op->poll)
+		goto fput_tfile;
+
+	/* No epoll sets inside epoll sets: the callbacks would nest */
+	error = -EINVAL;
+	if (file->f_op != &eventpoll_fops || tfile->f_op == &eventpoll_fops)
+		goto fput_tfile;
+	ep = file->private_data;
+
+	down(&epsem);
+	down(&ep->sem);
+	epi = ep_find(ep, tfile, fd);
+	switch (op) {
+	case EPOLL_CTL_ADD:
+		error = -EEXIST;
+		if (!epi)
+			error = ep_insert(ep, &epds, tfile, fd);
+		break;
+	case EPOLL_CTL_DEL:
+		error = -ENOENT;
+		if (epi) {
+			ep_unregister(ep, epi);
+			error = 0;
+		}
+		break;
+	case EPOLL_CTL_MOD:
+		error = -ENOENT;
+		if (epi)
+			error = ep_modify(ep, epi, &epds);
+		break;
+	default:
+		error = -EINVAL;
+	}
+	up(&ep->sem);
+	up(&epsem);
+
+	/* Only now: if fd was closed meanwhile this fput() releases it */
+fput_tfile:
+	fput(tfile);
+fput_file:
+	fput(file);
+out:
+	return error;
+}
+
+asmlinkage long sys_epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+	struct file *file;
+	long jtimeout;
+	int error;
+
+	error = -EINVAL;
+	if (maxevents <= 0 || maxevents > EP_MAX_EVENTS)
+		goto out;
+	error = verify_area(VERIFY_WRITE, events, maxevents * sizeof(struct epoll_event));
+	if (error)
+		goto out;
+
+	error = -EBADF;
+	file = fget(epfd);
+	if (!file)
+		goto out;
+	error = -EINVAL;
+	if (file->f_op != &eventpoll_fops)
+		goto fput_file;
+
+	/* Careful about overflow in the intermediate values */
+	if ((unsigned long) timeout < MAX_SCHEDULE_TIMEOUT / HZ)
+		jtimeout = (unsigned long)(timeout*HZ+999)/1000;
+	else /* Negative or overflow */
+		jtimeout = MAX_SCHEDULE_TIMEOUT;
+
+	error = ep_poll(file->private_data, events, maxevents, jtimeout);
+
+fput_file:
+	fput(file);
+out:
+	return error;
+}
+
+static struct super_block *eventpollfs_read_super(struct super_block *sb, void *data, int silent)
+{
+	struct inode *root = new_inode(sb);
+	if (!root)
+		return NULL;
+	root->i_mode = S_IFDIR | S_IRUSR | S_IWUSR;
+	root->i_uid = root->i_gid = 0;
+	root->i_atime = root->i_mtime = root->i_ctime = CURRENT_TIME;
+	sb->s_blocksize = 1024;
+	sb->s_blocksize_bits = 10;
+	sb->s_magic = EVENTPOLLFS_MAGIC;
+	sb->s_root = d_alloc(NULL, &(const struct qstr) { "eventpoll:", 10, 0 });
+	if (!sb->s_root) {
+		iput(root);
+		return NULL;
+	}
+	sb->s_root->d_sb = sb;
+	sb->s_root->d_parent = sb->s_root;
+	d_instantiate(sb->s_root, root);
+	return sb;
+}
+
+static DECLARE_FSTYPE(eventpoll_fs_type, "eventpollfs", eventpollfs_read_super,
+	FS_NOMOUNT|FS_SINGLE);
+
+static int __init eventpoll_init(void)
+{
+	int error;
+
+	epi_cachep = kmem_cache_create("eventpoll_epi", sizeof(struct epitem),
+				       0, SLAB_HWCACHE_ALIGN, NULL, NULL);
+	if (!epi_cachep)
+		panic("Cannot create eventpoll_epi SLAB cache");
+	pwq_cachep = kmem_cache_create("eventpoll_pwq", sizeof(struct eppoll_entry),
+				       0, SLAB_HWCACHE_ALIGN, NULL, NULL);
+	if (!pwq_cachep)
+		panic("Cannot create eventpoll_pwq SLAB cache");
+
+	error = register_filesystem(&eventpoll_fs_type);
+	if (!error) {
+		eventpoll_mnt = kern_mount(&eventpoll_fs_type);
+		error = PTR_ERR(eventpoll_mnt);
+		if (IS_ERR(eventpoll_mnt))
+			unregister_filesystem(&eventpoll_fs_type);
+		else
+			error = 0;
+	}
+	return error;
+}
+
+module_init(eventpoll_init)
@@ -70,61 +70,20 @@ struct ext2_group_desc * ext2_get_group_desc(struct super_block * sb,
 }
 
 /*
- * Read the bitmap for a given block_group, reading into the specified 
- * slot in the superblock's bitmap cache.
+ * Read the block bitmap for a given block group.
  *
- * Return >=0 on success or a -ve error code.
- */
-
-static int read_block_bitmap (struct super_block * sb,
-			       unsigned int block_group,
-			       unsigned long bitmap_nr)
-{
-	struct ext2_group_desc * gdp;
-	struct buffer_head * bh = NULL;
-	int retval = -EIO;
-	
-	gdp = ext2_get_group_desc (sb, block_group, NULL);
-	if (!gdp)
-		goto error_out;
-	retval = 0;
-	bh = bread (sb->s_dev, le32_to_cpu(gdp->bg_block_bitmap), sb->s_blocksize);
-	if (!bh) {
-		ext2_error (sb, "read_block_bitmap",
-			    "Cannot read block bitmap - "
-			    "block_group = %d, block_bitmap = %lu",
-			    block_group, (unsigned long) gdp->bg_block_bitmap);
-		retval = -EIO;
-	}
-	/*
-	 * On IO error, just leave a zero in the superblock's block pointer for
-	 * this group.  The IO will be retried next time.
-	 */
-error_out:
-	sb->u.ext2_sb.s_block_bitmap_number[bitmap_nr] = block_group;
-	sb->u.ext2_sb.s_block_bitmap[bitmap_nr] = bh;
-	return retval;
-}
-
-/*
- * load_block_bitmap loads the block bitmap for a blocks group
- *
- * It maintains a cache for the last bitmaps loaded.  This cache is managed
- * with a LRU algorithm.
+ * Bitmaps are ordinary buffer cache buffers: there is no limit on how
+ * many of them stay cached, and the VM reclaims the clean ones like any
+ * other metadata.  Allocation decisions that must not read a bitmap use
+ * the group descriptors and s_group_info instead.
  *
- * Notes:
- * 1/ There is one cache per mounted file system.
- * 2/ If the file system contains less than EXT2_MAX_GROUP_LOADED groups,
- *    this function reads the bitmap without maintaining a LRU cache.
- * 
- * Return the slot used to store the bitmap, or a -ve error code.
+ * Return the buffer, which the caller must brelse(), or NULL on error.
  */
-static int __load_block_bitmap (struct super_block * sb,
-			        unsigned int block_group)
+static struct buffer_head * load_block_bitmap (struct super_block * sb,
+					       unsigned int block_group)
 {
-	int i, j, retval = 0;
-	unsigned long block_bitmap_number;
-	struct buffer_head * block_bitmap;
+	struct ext2_group_desc * gdp;
+	struct buffer_head * bh;
 
 	if (block_group >= sb->u.ext2_sb.s_groups_count)
 		ext2_panic (sb, "load_block_bitmap",
@@ -132,130 +91,26 @@ static int __load_block_bitmap (struct super_block * sb,
 			    "block_group = %d, groups_count = %lu",
 			    block_group, sb->u.ext2_sb.s_groups_count);
 
-	if (sb->u.ext2_sb.s_groups_count <= EXT2_MAX_GROUP_LOADED) {
-		if (sb->u.ext2_sb.s_block_bitmap[block_group]) {
-			if (sb->u.ext2_sb.s_block_bitmap_number[block_group] ==
-			    block_group)
-				return block_group;
-			ext2_error (sb, "__load_block_bitmap",
-				    "block_group != block_bitmap_number");
-		}
-		retval = read_block_bitmap (sb, block_group, block_group);
-		if (retval < 0)
-			return retval;
-		return block_group;
-	}
-
-	for (i = 0; i < sb->u.ext2_sb.s_loaded_block_bitmaps &&
-		    sb->u.ext2_sb.s_block_bitmap_number[i] != block_group; i++)
-		;
-	if (i < sb->u.ext2_sb.s_loaded_block_bitmaps &&
-  	    sb->u.ext2_sb.s_block_bitmap_number[i] == block_group) {
-		block_bitmap_number = sb->u.ext2_sb.s_block_bitmap_number[i];
-		block_bitmap = sb->u.ext2_sb.s_block_bitmap[i];
-		for (j = i; j > 0; j--) {
-			sb->u.ext2_sb.s_block_bitmap_number[j] =
-				sb->u.ext2_sb.s_block_bitmap_number[j - 1];
-			sb->u.ext2_sb.s_block_bitmap[j] =
-				sb->u.ext2_sb.s_block_bitmap[j - 1];
-		}
-		sb->u.ext2_sb.s_block_bitmap_number[0] = block_bitmap_number;
-		sb->u.ext2_sb.s_block_bitmap[0] = block_bitmap;
-
-		/*
-		 * There's still one special case here --- if block_bitmap == 0
-		 * then our last attempt to read the bitmap failed and we have
-		 * just ended up caching that failure.  Try again to read it.
-		 */
-		if (!block_bitmap)
-			retval = read_block_bitmap (sb, block_group, 0);
-	} else {
-		if (sb->u.ext2_sb.s_loaded_block_bitmaps < EXT2_MAX_GROUP_LOADED)
-			sb->u.ext2_sb.s_loaded_block_bitmaps++;
-		else
-			brelse (sb->u.ext2_sb.s_block_bitmap[EXT2_MAX_GROUP_LOADED - 1]);
-		for (j = sb->u.ext2_sb.s_loaded_block_bitmaps - 1; j > 0;  j--) {
-			sb->u.ext2_sb.s_block_bitmap_number[j] =
-				sb->u.ext2_sb.s_block_bitmap_number[j - 1];
-			sb->u.ext2_sb.s_block_bitmap[j] =
-				sb->u.ext2_sb.s_block_bitmap[j - 1];
-		}
-		retval = read_block_bitmap (sb, block_group, 0);
-	}
-	return retval;
-}
-
-/*
- * Load the block bitmap for a given block group.  First of all do a couple
- * of fast lookups for common cases and then pass the request onto the guts
- * of the bitmap loader.
- *
- * Return the slot number of the group in the superblock bitmap cache's on
- * success, or a -ve error code.
- *
- * There is still one inconsistency here --- if the number of groups in this
- * filesystems is <= EXT2_MAX_GROUP_LOADED, then we have no way of 
- * differentiating between a group for which we have never performed a bitmap
- * IO request, and a group for which the last bitmap read request failed.
- */
-static inline int load_block_bitmap (struct super_block * sb,
-				     unsigned int block_group)
-{
-	int slot;
-	
-	/*
-	 * Do the lookup for the slot.  First of all, check if we're asking
-	 * for the same slot as last time, and did we succeed that last time?
-	 */
-	if (sb->u.ext2_sb.s_loaded_block_bitmaps > 0 &&
-	    sb->u.ext2_sb.s_block_bitmap_number[0] == block_group &&
-	    sb->u.ext2_sb.s_block_bitmap[0]) {
-		return 0;
-	}
-	/*
-	 * Or can we do a fast lookup based on a loaded group on a filesystem
-	 * small enough to be mapped directly into the superblock?
-	 */
-	else if (sb->u.ext2_sb.s_groups_count <= EXT2_MAX_GROUP_LOADED && 
-		 sb->u.ext2_sb.s_block_bitmap_number[block_group] == block_group &&
-		 sb->u.ext2_sb.s_block_bitmap[block_group]) {
-		slot = block_group;
-	}
-	/*
-	 * If not, then do a full lookup for this block group.
-	 */
-	else {
-		slot = __load_block_bitmap (sb, block_group);
-	}
-
-	/*
-	 * <0 means we just got an error
-	 */
-	if (slot < 0)
-		return slot;
-	
-	/*
-	 * If it's a valid slot, we may still have cached a previous IO error,
-	 * in which case the bh in the superblock cache will be zero.
-	 */
-	if (!sb->u.ext2_sb.s_block_bitmap[slot])
-		return -EIO;
-	
-	/*
-	 * Must have been read in OK to get this far.
-	 */
-	return slot;
+	gdp = ext2_get_group_desc (sb, block_group, NULL);
+	if (!gdp)
+		return NULL;
+	bh = bread (sb->s_dev, le32_to_cpu(gdp->bg_block_bitmap), sb->s_blocksize);
+	if (!bh)
+		ext2_error (sb, "read_block_bitmap",
+			    "Cannot read block bitmap - "
+			    "block_group = %d, block_bitmap = %lu",
+			    block_group, (unsigned long) gdp->bg_block_bitmap);
+	return bh;
 }
 
 void ext2_free_blocks (const struct inode * inode, unsigned long block,
 		       unsigned long count)
 {
-	struct buffer_head * bh;
+	struct buffer_head * bh = NULL;
 	struct buffer_head * bh2;
 	unsigned long block_group;
 	unsigned long bit;
 	unsigned long i;
-	int bitmap_nr;
 	unsigned long overflow;
 	struct super_block * sb;
 	struct ext2_group_desc * gdp;
@@ -292,11 +147,9 @@ do_more:
 		overflow = bit + count - EXT2_BLOCKS_PER_GROUP(sb);
 		count -= overflow;
 	}
-	bitmap_nr = load_block_bitmap (sb, block_group);
-	if (bitmap_nr < 0)
+	bh = load_block_bitmap (sb, block_group);
+	if (!bh)
 		goto error_return;
-	
-	bh = sb->u.ext2_sb.s_block_bitmap[bitmap_nr];
 	gdp = ext2_get_group_desc (sb, block_group, &bh2);
 	if (!gdp)
 		goto error_return;
@@ -312,6 +165,8 @@ do_more:
 			    "Block = %lu, count = %lu",
 			    block, count);
 
+	if (ext2_journal_undo_access(sb, bh) || ext2_journal_access(sb, bh2))
+		goto error_return;
 	for (i = 0; i < count; i++) {
 		if (!ext2_clear_bit (bit + i, bh->b_data))
 			ext2_error (sb, "ext2_free_blocks",
@@ -326,14 +181,18 @@ do_more:
 		}
 	}
 	
-	mark_buffer_dirty(bh2);
+	/* The freed blocks may join up into a longer run */
+	sb->u.ext2_sb.s_group_info[block_group].gi_max_run =
+		EXT2_BLOCKS_PER_GROUP(sb);
+
+	ext2_journal_dirty(sb, bh2);
 	mark_buffer_dirty(sb->u.ext2_sb.s_sbh);
 
-	mark_buffer_dirty(bh);
-	if (sb->s_flags & MS_SYNCHRONOUS) {
-		ll_rw_block (WRITE, 1, &bh);
-		wait_on_buffer (bh);
-	}
+	ext2_journal_dirty(sb, bh);
+	if (sb->s_flags & MS_SYNCHRONOUS)
+		ext2_journal_sync(sb, bh);
+	brelse (bh);
+	bh = NULL;
 	if (overflow) {
 		block += count;
 		count = overflow;
@@ -341,25 +200,80 @@ do_more:
 	}
 	sb->s_dirt = 1;
 error_return:
+	brelse (bh);
 	unlock_super (sb);
 	return;
 }
 
 /*
- * ext2_new_block uses a goal block to assist allocation.  If the goal is
- * free, or there is a free block within 32 blocks of the goal, that block
- * is allocated.  Otherwise a forward search is made for a free block; within 
- * each block group the search first looks for an entire free byte in the block
- * bitmap, and then for any free bit if that fails.
+ * Find the first run of @want free bits in map[start..size), or failing
+ * that the longest run there. Returns its start and sets *len, or
+ * returns -1 if there is no free bit at all.
  */
-int ext2_new_block (const struct inode * inode, unsigned long goal,
-    u32 * prealloc_count, u32 * prealloc_block, int * err)
+static int find_free_run (char * map, int start, int size, int want,
+			  int * len)
 {
-	struct buffer_head * bh;
+	int best = -1, best_len = 0;
+	int j = start, n;
+
+	while ((j = ext2_find_next_zero_bit ((unsigned long *) map,
+					     size, j)) < size) {
+		for (n = 1; n < want && j + n < size &&
+			    !ext2_test_bit (j + n, map); n++)
+			;
+		if (n > best_len) {
+			best = j;
+			best_len = n;
+			if (n == want)
+				break;
+		}
+		j += n + 1;
+	}
+	*len = best_len;
+	return best;
+}
+
+/*
+ * Space held back for nr delayed data blocks and the indirect blocks
+ * they may need once they are allocated.
+ */
+static inline unsigned long ext2_pledged_blocks (struct super_block * sb,
+						 unsigned long nr)
+{
+	if (!nr)
+		return 0;
+	return nr + nr / EXT2_ADDR_PER_BLOCK(sb) + 2;
+}
+
+/*
+ * ext2_new_blocks allocates up to *count contiguous blocks and returns
+ * the first one, setting *count to the number actually allocated.
+ *
+ * For a single block, the goal is used if it is free, or else a free
+ * block within 64 blocks of it.  Otherwise a forward search is made for
+ * a free block; within each block group the search first looks for an
+ * entire free byte in the block bitmap, and then for any free bit if
+ * that fails.  For a run, the search from the goal onwards takes the
+ * first free run long enough, or the longest one in the group, so that
+ * the caller gets contiguous space rather than the first hole in it.
+ *
+ * Blocks after the first are charged to quota as preallocated ones and
+ * are never taken from space promised to delayed allocation or from
+ * the reserved blocks.  Neither is the first one, unless 'delayed' says
+ * that it is itself being allocated for a delayed block: one which
+ * write() promised a place on disk, whether data or indirect.
+ */
+int ext2_new_blocks (const struct inode * inode, unsigned long goal,
+		     unsigned long * count, int delayed, int * err)
+{
+	struct buffer_head * bh = NULL;
 	struct buffer_head * bh2;
-	char * p, * r;
+	struct ext2_group_info * gi;
+	char * map, * p, * r;
 	int i, j, k, tmp;
-	int bitmap_nr;
+	int want = *count;
+	int len, priv, busy = 0;
+	long avail;
 	struct super_block * sb;
 	struct ext2_group_desc * gdp;
 	struct ext2_super_block * es;
@@ -369,20 +283,34 @@ int ext2_new_block (const struct inode * inode, unsigned long goal,
 	*err = -ENOSPC;
 	sb = inode->i_sb;
 	if (!sb) {
-		printk ("ext2_new_block: nonexistent device");
+		printk ("ext2_new_blocks: nonexistent device");
 		return 0;
 	}
 
 	lock_super (sb);
 	es = sb->u.ext2_sb.s_es;
+	priv = sb->u.ext2_sb.s_resuid == current->fsuid ||
+	       (sb->u.ext2_sb.s_resgid != 0 &&
+		in_group_p (sb->u.ext2_sb.s_resgid)) ||
+	       capable(CAP_SYS_RESOURCE);
 	if (le32_to_cpu(es->s_free_blocks_count) <= le32_to_cpu(es->s_r_blocks_count) &&
-	    ((sb->u.ext2_sb.s_resuid != current->fsuid) &&
-	     (sb->u.ext2_sb.s_resgid == 0 ||
-	      !in_group_p (sb->u.ext2_sb.s_resgid)) && 
-	     !capable(CAP_SYS_RESOURCE)))
+	    !priv && !delayed)
 		goto out;
 
-	ext2_debug ("goal=%lu.\n", goal);
+	avail = le32_to_cpu(es->s_free_blocks_count) -
+		ext2_pledged_blocks(sb, atomic_read(&sb->s_delayed_blocks));
+	if (!priv)
+		avail -= le32_to_cpu(es->s_r_blocks_count);
+	if (want > avail)
+		want = avail;
+	if (want < 1) {
+		if (!delayed)
+			goto out;
+		want = 1;
+	}
+
+	ext2_debug ("goal=%lu, count=%d.\n", goal, want);
+	gi = sb->u.ext2_sb.s_group_info;
 
 repeat:
 	/*
@@ -402,22 +330,32 @@ repeat:
 		if (j)
 			goal_attempts++;
 #endif
-		bitmap_nr = load_block_bitmap (sb, i);
-		if (bitmap_nr < 0)
+		bh = load_block_bitmap (sb, i);
+		if (!bh)
 			goto io_error;
-		
-		bh = sb->u.ext2_sb.s_block_bitmap[bitmap_nr];
+		map = ext2_journal_bitmap (sb, bh);
 
 		ext2_debug ("goal is at %d:%d.\n", i, j);
 
-		if (!ext2_test_bit(j, bh->b_data)) {
+		if (!ext2_test_bit(j, map)) {
 #ifdef EXT2FS_DEBUG
 			goal_hits++;
 			ext2_debug ("goal bit allocated.\n");
 #endif
 			goto got_block;
 		}
-		if (j) {
+		if (want > 1) {
+			/*
+			 * The goal was occupied; take the first run that is
+			 * long enough, or the longest, in the rest of the group.
+			 */
+			k = find_free_run (map, j, EXT2_BLOCKS_PER_GROUP(sb),
+					   want, &len);
+			if (k >= 0) {
+				j = k;
+				goto got_block;
+			}
+		} else if (j) {
 			/*
 			 * The goal was occupied; search forward for a free 
 			 * block within the next XX blocks.
@@ -427,7 +365,7 @@ repeat:
 			 * next 64-bit boundary is simple..
 			 */
 			int end_goal = (j + 63) & ~63;
-			j = ext2_find_next_zero_bit(bh->b_data, end_goal, j);
+			j = ext2_find_next_zero_bit(map, end_goal, j);
 			if (j < end_goal)
 				goto got_block;
 		}
@@ -443,15 +381,15 @@ repeat:
 		 * Search first in the remainder of the current group; then,
 		 * cyclicly search through the rest of the groups.
 		 */
-		p = ((char *) bh->b_data) + (j >> 3);
+		p = map + (j >> 3);
 		r = memscan(p, 0, (EXT2_BLOCKS_PER_GROUP(sb) - j + 7) >> 3);
-		k = (r - ((char *) bh->b_data)) << 3;
+		k = (r - map) << 3;
 		if (k < EXT2_BLOCKS_PER_GROUP(sb)) {
 			j = k;
 			goto search_back;
 		}
 
-		k = ext2_find_next_zero_bit ((unsigned long *) bh->b_data, 
+		k = ext2_find_next_zero_bit ((unsigned long *) map, 
 					EXT2_BLOCKS_PER_GROUP(sb),
 					j);
 		if (k < EXT2_BLOCKS_PER_GROUP(sb)) {
@@ -461,11 +399,34 @@ repeat:
 	}
 
 	ext2_debug ("Bit not found in block group %d.\n", i);
+	brelse (bh);
+	bh = NULL;
 
 	/*
 	 * Now search the rest of the groups.  We assume that 
 	 * i and gdp correctly point to the last group visited.
+	 *
+	 * A run goes to the first group that can hold all of it, going
+	 * by the free count and by the longest free run seen there, so
+	 * that full or fragmented groups are passed over without reading
+	 * their bitmaps.  Failing that, any group with a free block will do.
 	 */
+	if (want > 1) {
+		tmp = i;
+		for (k = 0; k < sb->u.ext2_sb.s_groups_count; k++) {
+			i++;
+			if (i >= sb->u.ext2_sb.s_groups_count)
+				i = 0;
+			gdp = ext2_get_group_desc (sb, i, &bh2);
+			if (!gdp)
+				goto io_error;
+			if (le16_to_cpu(gdp->bg_free_blocks_count) >= want &&
+			    gi[i].gi_max_run >= want)
+				goto found_group;
+		}
+		i = tmp;
+	}
+next_group:
 	for (k = 0; k < sb->u.ext2_sb.s_groups_count; k++) {
 		i++;
 		if (i >= sb->u.ext2_sb.s_groups_count)
@@ -480,20 +441,38 @@ repeat:
 	}
 	if (k >= sb->u.ext2_sb.s_groups_count)
 		goto out;
-	bitmap_nr = load_block_bitmap (sb, i);
-	if (bitmap_nr < 0)
+found_group:
+	bh = load_block_bitmap (sb, i);
+	if (!bh)
 		goto io_error;
-	
-	bh = sb->u.ext2_sb.s_block_bitmap[bitmap_nr];
-	r = memscan(bh->b_data, 0, EXT2_BLOCKS_PER_GROUP(sb) >> 3);
-	j = (r - bh->b_data) << 3;
-	if (j < EXT2_BLOCKS_PER_GROUP(sb))
-		goto search_back;
-	else
-		j = ext2_find_first_zero_bit ((unsigned long *) bh->b_data,
+	map = ext2_journal_bitmap (sb, bh);
+	if (want > 1) {
+		j = find_free_run (map, 0, EXT2_BLOCKS_PER_GROUP(sb),
+				   want, &len);
+		/* A short answer means we saw every free run in the group */
+		if (len < want && map == bh->b_data)
+			gi[i].gi_max_run = len;
+		if (j >= 0)
+			goto got_block;
+		j = EXT2_BLOCKS_PER_GROUP(sb);
+	} else {
+		r = memscan(map, 0, EXT2_BLOCKS_PER_GROUP(sb) >> 3);
+		j = (r - map) << 3;
+		if (j < EXT2_BLOCKS_PER_GROUP(sb))
+			goto search_back;
+		j = ext2_find_first_zero_bit ((unsigned long *) map,
 					 EXT2_BLOCKS_PER_GROUP(sb));
+	}
 	if (j >= EXT2_BLOCKS_PER_GROUP(sb)) {
-		ext2_error (sb, "ext2_new_block",
+		/* all its free blocks wait for their frees to commit */
+		if (map != bh->b_data) {
+			brelse (bh);
+			bh = NULL;
+			if (++busy < sb->u.ext2_sb.s_groups_count)
+				goto next_group;
+			goto out;
+		}
+		ext2_error (sb, "ext2_new_blocks",
 			    "Free blocks count corrupted for block group %d", i);
 		goto out;
 	}
@@ -504,7 +483,7 @@ search_back:
 	 * bitmap.  Now search backwards up to 7 bits to find the
 	 * start of this group of free blocks.
 	 */
-	for (k = 0; k < 7 && j > 0 && !ext2_test_bit (j - 1, bh->b_data); k++, j--);
+	for (k = 0; k < 7 && j > 0 && !ext2_test_bit (j - 1, map); k++, j--);
 	
 got_block:
 
@@ -524,73 +503,60 @@ got_block:
 	    tmp == le32_to_cpu(gdp->bg_inode_bitmap) ||
 	    in_range (tmp, le32_to_cpu(gdp->bg_inode_table),
 		      sb->u.ext2_sb.s_itb_per_group))
-		ext2_error (sb, "ext2_new_block",
+		ext2_error (sb, "ext2_new_blocks",
 			    "Allocating block in system zone - "
 			    "block = %u", tmp);
 
+	*err = ext2_journal_access(sb, bh);
+	if (!*err)
+		*err = ext2_journal_access(sb, bh2);
+	if (*err) {
+		DQUOT_FREE_BLOCK(sb, inode, 1);
+		goto out;
+	}
 	if (ext2_set_bit (j, bh->b_data)) {
-		ext2_warning (sb, "ext2_new_block",
+		ext2_warning (sb, "ext2_new_blocks",
 			      "bit already set for block %d", j);
 		DQUOT_FREE_BLOCK(sb, inode, 1);
+		brelse (bh);
+		bh = NULL;
 		goto repeat;
 	}
 
 	ext2_debug ("found bit %d\n", j);
 
 	/*
-	 * Do block preallocation now if required.
+	 * Extend the run as far as the caller wants and the bitmap allows.
 	 */
-#ifdef EXT2_PREALLOCATE
-	/* Writer: ->i_prealloc* */
-	if (prealloc_count && !*prealloc_count) {
-		int	prealloc_goal;
-		unsigned long next_block = tmp + 1;
-
-		prealloc_goal = es->s_prealloc_blocks ?
-			es->s_prealloc_blocks : EXT2_DEFAULT_PREALLOC_BLOCKS;
-
-		*prealloc_block = next_block;
-		/* Writer: end */
-		for (k = 1;
-		     k < prealloc_goal && (j + k) < EXT2_BLOCKS_PER_GROUP(sb);
-		     k++, next_block++) {
-			if (DQUOT_PREALLOC_BLOCK(sb, inode, 1))
-				break;
-			/* Writer: ->i_prealloc* */
-			if (*prealloc_block + *prealloc_count != next_block ||
-			    ext2_set_bit (j + k, bh->b_data)) {
-				/* Writer: end */
-				DQUOT_FREE_BLOCK(sb, inode, 1);
- 				break;
-			}
-			(*prealloc_count)++;
-			/* Writer: end */
-		}	
-		/*
-		 * As soon as we go for per-group spinlocks we'll need these
-		 * done inside the loop above.
-		 */
-		gdp->bg_free_blocks_count =
-			cpu_to_le16(le16_to_cpu(gdp->bg_free_blocks_count) -
-			       (k - 1));
-		es->s_free_blocks_count =
-			cpu_to_le32(le32_to_cpu(es->s_free_blocks_count) -
-			       (k - 1));
-		ext2_debug ("Preallocated a further %lu bits.\n",
-			       (k - 1));
+	for (k = 1; k < want && j + k < EXT2_BLOCKS_PER_GROUP(sb) &&
+		    tmp + k < le32_to_cpu(es->s_blocks_count); k++) {
+		if (ext2_test_bit (j + k, map))
+			break;
+		if (DQUOT_PREALLOC_BLOCK(sb, inode, 1))
+			break;
+		ext2_set_bit (j + k, bh->b_data);
 	}
-#endif
+	/*
+	 * As soon as we go for per-group spinlocks we'll need these
+	 * done inside the loop above.
+	 */
+	gdp->bg_free_blocks_count =
+		cpu_to_le16(le16_to_cpu(gdp->bg_free_blocks_count) - (k - 1));
+	es->s_free_blocks_count =
+		cpu_to_le32(le32_to_cpu(es->s_free_blocks_count) - (k - 1));
+	ext2_debug ("Allocated a further %d bits.\n", k - 1);
+	*count = k;
 
 	j = tmp;
 
-	mark_buffer_dirty(bh);
-	if (sb->s_flags & MS_SYNCHRONOUS) {
-		ll_rw_block (WRITE, 1, &bh);
-		wait_on_buffer (bh);
-	}
+	ext2_journal_dirty(sb, bh);
+	if (sb->s_flags & MS_SYNCHRONOUS)
+		ext2_journal_sync(sb, bh);
+	brelse (bh);
+	bh = NULL;
 
 	if (j >= le32_to_cpu(es->s_blocks_count)) {
-		ext2_error (sb, "ext2_new_block",
+		ext2_error (sb, "ext2_new_blocks",
 			    "block(%d) >= blocks count(%d) - "
 			    "block_group = %d, es == %p ",j,
 			le32_to_cpu(es->s_blocks_count), i, es);
@@ -601,7 +567,7 @@ got_block:
 		    "Goal hits %d of %d.\n", j, goal_hits, goal_attempts);
 
 	gdp->bg_free_blocks_count = cpu_to_le16(le16_to_cpu(gdp->bg_free_blocks_count) - 1);
-	mark_buffer_dirty(bh2);
+	ext2_journal_dirty(sb, bh2);
 	es->s_free_blocks_count = cpu_to_le32(le32_to_cpu(es->s_free_blocks_count) - 1);
 	mark_buffer_dirty(sb->u.ext2_sb.s_sbh);
 	sb->s_dirt = 1;
@@ -612,6 +578,7 @@ got_block:
 io_error:
 	*err = -EIO;
 out:
+	brelse (bh);
 	unlock_super (sb);
 	return 0;
 	
@@ -621,8 +588,8 @@ unsigned long ext2_count_free_blocks (struct super_block * sb)
 {
 #ifdef EXT2FS_DEBUG
 	struct ext2_super_block * es;
+	struct buffer_head * bh;
 	unsigned long desc_count, bitmap_count, x;
-	int bitmap_nr;
 	struct ext2_group_desc * gdp;
 	int i;
 	
@@ -636,12 +603,12 @@ unsigned long ext2_count_free_blocks (struct super_block * sb)
 		if (!gdp)
 			continue;
 		desc_count += le16_to_cpu(gdp->bg_free_blocks_count);
-		bitmap_nr = load_block_bitmap (sb, i);
-		if (bitmap_nr < 0)
+		bh = load_block_bitmap (sb, i);
+		if (!bh)
 			continue;
 		
-		x = ext2_count_free (sb->u.ext2_sb.s_block_bitmap[bitmap_nr],
-				     sb->s_blocksize);
+		x = ext2_count_free (bh, sb->s_blocksize);
+		brelse (bh);
 		printk ("group %d: stored = %d, counted = %lu\n",
 			i, le16_to_cpu(gdp->bg_free_blocks_count), x);
 		bitmap_count += x;
@@ -655,6 +622,34 @@ unsigned long ext2_count_free_blocks (struct super_block * sb)
 #endif
 }
 
+/*
+ * Delayed allocation: promise nr more data blocks to the caller, to
+ * be allocated when the pages are written out. Blocks promised
+ * earlier, and the indirect blocks they may need, count as used.
+ */
+int ext2_reserve_blocks (struct inode * inode, int nr)
+{
+	struct super_block * sb = inode->i_sb;
+	struct ext2_super_block * es;
+	unsigned long want;
+	int err = -ENOSPC;
+
+	lock_super (sb);
+	es = sb->u.ext2_sb.s_es;
+	want = ext2_pledged_blocks(sb, atomic_read(&sb->s_delayed_blocks) + nr);
+	if ((sb->u.ext2_sb.s_resuid != current->fsuid) &&
+	    (sb->u.ext2_sb.s_resgid == 0 ||
+	     !in_group_p (sb->u.ext2_sb.s_resgid)) &&
+	    !capable(CAP_SYS_RESOURCE))
+		want += le32_to_cpu(es->s_r_blocks_count);
+	if (le32_to_cpu(es->s_free_blocks_count) >= want) {
+		atomic_add(nr, &sb->s_delayed_blocks);
+		err = 0;
+	}
+	unlock_super (sb);
+	return err;
+}
+
 static inline int block_in_use (unsigned long block,
 				struct super_block * sb,
 				unsigned char * map)
@@ -723,7 +718,6 @@ void ext2_check_blocks_bitmap (struct super_block * sb)
 	struct ext2_super_block * es;
 	unsigned long desc_count, bitmap_count, x, j;
 	unsigned long desc_blocks;
-	int bitmap_nr;
 	struct ext2_group_desc * gdp;
 	int i;
 
@@ -736,12 +730,10 @@ void ext2_check_blocks_bitmap (struct super_block * sb)
 		if (!gdp)
 			continue;
 		desc_count += le16_to_cpu(gdp->bg_free_blocks_count);
-		bitmap_nr = load_block_bitmap (sb, i);
-		if (bitmap_nr < 0)
+		bh = load_block_bitmap (sb, i);
+		if (!bh)
 			continue;
 
-		bh = EXT2_SB(sb)->s_block_bitmap[bitmap_nr];
-
 		if (ext2_bg_has_super(sb, i) && !ext2_test_bit(0, bh->b_data))
 			ext2_error(sb, __FUNCTION__,
 				   "Superblock in group %d is marked free", i);
@@ -776,6 +768,7 @@ void ext2_check_blocks_bitmap (struct super_block * sb)
 				    "stored = %d, counted = %lu", i,
 				    le16_to_cpu(gdp->bg_free_blocks_count), x);
 		bitmap_count += x;
+		brelse (bh);
 	}
 	if (le32_to_cpu(es->s_free_blocks_count) != bitmap_count)
 		ext2_error (sb, "ext2_check_blocks_bitmap",
@@ -68,13 +68,14 @@ static loff_t ext2_file_lseek(
 }
 
 /*
- * Called when an inode is released. Note that this is different
- * from ext2_file_open: open gets called at every open, but release
- * gets called only when /all/ the files are closed.
+ * Called when the last reference to a struct file goes away. The
+ * preallocation window belongs to the inode, so keep it while other
+ * writers still have the file open.
  */
 static int ext2_release_file (struct inode * inode, struct file * filp)
 {
-	if (filp->f_mode & FMODE_WRITE)
+	if ((filp->f_mode & FMODE_WRITE) &&
+	    atomic_read(&inode->i_writecount) == 1)
 		ext2_discard_prealloc (inode);
 	return 0;
 }
@@ -106,6 +107,7 @@ struct file_operations ext2_file_operations = {
 	open:		ext2_open_file,
 	release:	ext2_release_file,
 	fsync:		ext2_sync_file,
+	aio_map:	generic_file_aio_map,
 };
 
 struct inode_operations ext2_file_inode_operations = {
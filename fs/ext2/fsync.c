@@ -43,6 +43,10 @@ int ext2_fsync_inode(struct inode *inode, int datasync)
 {
 	int err;
 	
+	/* the inode and its metadata are all in the running transaction */
+	if (inode->i_sb->u.ext2_sb.s_journal)
+		return ext2_force_commit(inode->i_sb);
+
 	err  = fsync_inode_buffers(inode);
 	if (!(inode->i_state & I_DIRTY))
 		return err;
@@ -28,8 +28,12 @@
 #include <linux/smp_lock.h>
 #include <linux/sched.h>
 #include <linux/highuid.h>
+#include <linux/journal.h>
 
 static int ext2_update_inode(struct inode * inode, int do_sync);
+static struct buffer_head * ext2_get_inode_block (struct inode *,
+						  struct ext2_inode **,
+						  const char *);
 
 /*
  * Called at each iput()
@@ -50,6 +54,8 @@ void ext2_delete_inode (struct inode * inode)
 	    inode->i_ino == EXT2_ACL_IDX_INO ||
 	    inode->i_ino == EXT2_ACL_DATA_INO)
 		goto no_delete;
+	if (ext2_journal_start(inode->i_sb, EXT2_TRUNCATE_TRANS_BLOCKS))
+		goto no_delete;
 	inode->u.ext2_i.i_dtime	= CURRENT_TIME;
 	mark_inode_dirty(inode);
 	ext2_update_inode(inode, IS_SYNC(inode));
@@ -57,6 +63,7 @@ void ext2_delete_inode (struct inode * inode)
 	if (inode->i_blocks)
 		ext2_truncate (inode);
 	ext2_free_inode (inode);
+	ext2_journal_stop(inode->i_sb);
 
 	unlock_kernel();
 	return;
@@ -82,12 +89,13 @@ void ext2_discard_prealloc (struct inode * inode)
 #endif
 }
 
-static int ext2_alloc_block (struct inode * inode, unsigned long goal, int *err)
+static int ext2_alloc_block (struct inode * inode, unsigned long goal, int delayed, int *err)
 {
 #ifdef EXT2FS_DEBUG
 	static unsigned long alloc_hits = 0, alloc_attempts = 0;
 #endif
 	unsigned long result;
+	unsigned long count = 1;
 
 
 #ifdef EXT2_PREALLOCATE
@@ -103,21 +111,44 @@ static int ext2_alloc_block (struct inode * inode, unsigned long goal, int *err)
 		ext2_debug ("preallocation hit (%lu/%lu).\n",
 			    ++alloc_hits, ++alloc_attempts);
 #endif
-	} else {
+	} else if (S_ISREG(inode->i_mode) && !inode->i_sb->u.ext2_sb.s_journal) {
+		/* no preallocation on journaled mounts: a crash would leak it */
+		struct ext2_super_block *es = inode->i_sb->u.ext2_sb.s_es;
+		unsigned long window = inode->u.ext2_i.i_prealloc_window;
+
+		/*
+		 * A file that used up its window and carries on where it
+		 * ended gets a bigger one; anything else starts over.
+		 */
+		if (!inode->u.ext2_i.i_prealloc_count &&
+		    goal == inode->u.ext2_i.i_prealloc_block && window) {
+			window *= 2;
+			if (window > EXT2_MAX_PREALLOC_BLOCKS)
+				window = EXT2_MAX_PREALLOC_BLOCKS;
+		} else
+			window = es->s_prealloc_blocks ?
+				es->s_prealloc_blocks :
+				EXT2_DEFAULT_PREALLOC_BLOCKS;
 		ext2_discard_prealloc (inode);
 #ifdef EXT2FS_DEBUG
 		ext2_debug ("preallocation miss (%lu/%lu).\n",
 			    alloc_hits, ++alloc_attempts);
 #endif
-		if (S_ISREG(inode->i_mode))
-			result = ext2_new_block (inode, goal, 
-				 &inode->u.ext2_i.i_prealloc_count,
-				 &inode->u.ext2_i.i_prealloc_block, err);
-		else
-			result = ext2_new_block (inode, goal, 0, 0, err);
+		count = window;
+		result = ext2_new_blocks (inode, goal, &count, delayed, err);
+		/* Writer: ->i_prealloc* */
+		inode->u.ext2_i.i_prealloc_window = window;
+		if (result) {
+			inode->u.ext2_i.i_prealloc_block = result + 1;
+			inode->u.ext2_i.i_prealloc_count = count - 1;
+		}
+		/* Writer: end */
+	} else {
+		ext2_discard_prealloc (inode);
+		result = ext2_new_blocks (inode, goal, &count, delayed, err);
 	}
 #else
-	result = ext2_new_block (inode, goal, 0, 0, err);
+	result = ext2_new_blocks (inode, goal, &count, delayed, err);
 #endif
 	return result;
 }
@@ -353,6 +384,7 @@ static inline int ext2_find_goal(struct inode *inode,
  *	@num: depth of the chain (number of blocks to allocate)
  *	@offsets: offsets (in the blocks) to store the pointers to next.
  *	@branch: place to store the chain in.
+ *	@delayed: the data block was promised to delayed allocation.
  *
  *	This function allocates @num blocks, zeroes out all but the last one,
  *	links them into chain and (if we are synchronous) writes them to disk.
@@ -376,19 +408,20 @@ static int ext2_alloc_branch(struct inode *inode,
 			     int num,
 			     unsigned long goal,
 			     int *offsets,
-			     Indirect *branch)
+			     Indirect *branch,
+			     int delayed)
 {
 	int blocksize = inode->i_sb->s_blocksize;
 	int n = 0;
 	int err;
 	int i;
-	int parent = ext2_alloc_block(inode, goal, &err);
+	int parent = ext2_alloc_block(inode, goal, delayed, &err);
 
 	branch[0].key = cpu_to_le32(parent);
 	if (parent) for (n = 1; n < num; n++) {
 		struct buffer_head *bh;
 		/* Allocate the next block */
-		int nr = ext2_alloc_block(inode, parent, &err);
+		int nr = ext2_alloc_block(inode, parent, delayed, &err);
 		if (!nr)
 			break;
 		branch[n].key = cpu_to_le32(nr);
@@ -399,16 +432,20 @@ static int ext2_alloc_branch(struct inode *inode,
 		bh = getblk(inode->i_dev, parent, blocksize);
 		if (!buffer_uptodate(bh))
 			wait_on_buffer(bh);
+		err = ext2_journal_access(inode->i_sb, bh);
+		if (err) {
+			brelse(bh);
+			ext2_free_blocks(inode, nr, 1);
+			break;
+		}
 		memset(bh->b_data, 0, blocksize);
 		branch[n].bh = bh;
 		branch[n].p = (u32*) bh->b_data + offsets[n];
 		*branch[n].p = branch[n].key;
 		mark_buffer_uptodate(bh, 1);
-		mark_buffer_dirty_inode(bh, inode);
-		if (IS_SYNC(inode) || inode->u.ext2_i.i_osync) {
-			ll_rw_block (WRITE, 1, &bh);
-			wait_on_buffer (bh);
-		}
+		ext2_journal_dirty_inode(bh, inode);
+		if (IS_SYNC(inode) || inode->u.ext2_i.i_osync)
+			ext2_journal_sync(inode->i_sb, bh);
 		parent = nr;
 	}
 	if (n == num)
@@ -416,7 +453,7 @@ static int ext2_alloc_branch(struct inode *inode,
 
 	/* Allocation failed, free what we already allocated */
 	for (i = 1; i < n; i++)
-		bforget(branch[i].bh);
+		ext2_journal_forget(inode->i_sb, branch[i].bh);
 	for (i = 0; i < n; i++)
 		ext2_free_blocks(inode, le32_to_cpu(branch[i].key), 1);
 	return err;
@@ -445,7 +482,14 @@ static inline int ext2_splice_branch(struct inode *inode,
 				     Indirect *where,
 				     int num)
 {
-	int i;
+	int i, err;
+
+	/* Journal access may sleep, so get it before the checks */
+	if (where->bh) {
+		err = ext2_journal_access(inode->i_sb, where->bh);
+		if (err)
+			goto out;
+	}
 
 	/* Verify that place we are splicing to is still there and vacant */
 
@@ -469,11 +513,9 @@ static inline int ext2_splice_branch(struct inode *inode,
 
 	/* had we spliced it onto indirect block? */
 	if (where->bh) {
-		mark_buffer_dirty_inode(where->bh, inode);
-		if (IS_SYNC(inode) || inode->u.ext2_i.i_osync) {
-			ll_rw_block (WRITE, 1, &where->bh);
-			wait_on_buffer(where->bh);
-		}
+		ext2_journal_dirty_inode(where->bh, inode);
+		if (IS_SYNC(inode) || inode->u.ext2_i.i_osync)
+			ext2_journal_sync(inode->i_sb, where->bh);
 	}
 
 	if (IS_SYNC(inode) || inode->u.ext2_i.i_osync)
@@ -483,11 +525,112 @@ static inline int ext2_splice_branch(struct inode *inode,
 	return 0;
 
 changed:
+	err = -EAGAIN;
+out:
 	for (i = 1; i < num; i++)
-		bforget(where[i].bh);
+		ext2_journal_forget(inode->i_sb, where[i].bh);
 	for (i = 0; i < num; i++)
 		ext2_free_blocks(inode, le32_to_cpu(where[i].key), 1);
-	return -EAGAIN;
+	return err;
+}
+
+/*
+ * Each inode keeps a few recently used mappings, each a run of logical
+ * blocks on physically contiguous disk blocks, so that sequential I/O
+ * on a big file walks the indirect blocks once per run rather than
+ * once per block. Only mapped blocks are cached; holes always take the
+ * slow path. ext2_truncate() empties the cache and bumps i_map_gen on
+ * entry and on exit, and a walk that overlapped it does not refill the
+ * cache with blocks that may have been freed under it.
+ */
+static spinlock_t ext2_map_lock = SPIN_LOCK_UNLOCKED;
+
+static struct {
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long indirect;		/* indirect blocks walked on misses */
+} ext2_map_stats;
+
+static int ext2_map_lookup(struct inode *inode, long block,
+			   unsigned long *blocknr)
+{
+	struct ext2_map_extent *ex = inode->u.ext2_i.i_map;
+	int found = 0;
+	int i;
+
+	spin_lock(&ext2_map_lock);
+	for (i = 0; i < EXT2_MAP_EXTENTS; i++, ex++) {
+		if ((unsigned long)(block - ex->lblock) < ex->len) {
+			*blocknr = ex->pblock + (block - ex->lblock);
+			found = 1;
+			break;
+		}
+	}
+	spin_unlock(&ext2_map_lock);
+	return found;
+}
+
+/*
+ * Cache the run around the block just found. @p points to its slot in
+ * the inode or in the last indirect block, @offset is the index of that
+ * slot and @nr the number of slots there.
+ */
+static void ext2_map_insert(struct inode *inode, unsigned gen, long block,
+			    u32 *p, int offset, int nr)
+{
+	struct ext2_inode_info *ei = &inode->u.ext2_i;
+	struct ext2_map_extent *ex;
+	u32 *start = p - offset, *end = start + nr;
+	u32 first = le32_to_cpu(*p);
+	u32 len = 1;
+	u32 *q;
+
+	for (q = p - 1; q >= start && *q && le32_to_cpu(*q) == first - 1; q--) {
+		first--;
+		block--;
+		len++;
+	}
+	for (q = p + 1; q < end && le32_to_cpu(*q) == first + len; q++)
+		len++;
+
+	spin_lock(&ext2_map_lock);
+	if (ei->i_map_gen == gen) {
+		ex = &ei->i_map[ei->i_map_next];
+		ei->i_map_next = (ei->i_map_next + 1) % EXT2_MAP_EXTENTS;
+		ex->lblock = block;
+		ex->pblock = first;
+		ex->len = len;
+	}
+	spin_unlock(&ext2_map_lock);
+}
+
+static void ext2_map_flush(struct inode *inode)
+{
+	struct ext2_inode_info *ei = &inode->u.ext2_i;
+
+	spin_lock(&ext2_map_lock);
+	ei->i_map_gen++;
+	memset(ei->i_map, 0, sizeof(ei->i_map));
+	spin_unlock(&ext2_map_lock);
+}
+
+int ext2_map_read_proc(char *page, char **start, off_t off,
+		       int count, int *eof, void *data)
+{
+	int len;
+
+	len = sprintf(page, "hits %lu\nmisses %lu\nindirect %lu\n",
+		      ext2_map_stats.hits, ext2_map_stats.misses,
+		      ext2_map_stats.indirect);
+	if (len <= off + count)
+		*eof = 1;
+	*start = page + off;
+	len -= off;
+	if (len > count)
+		len = count;
+	if (len < 0)
+		len = 0;
+	return len;
 }
 
 /*
@@ -503,13 +646,14 @@ changed:
  * reachable from inode.
  */
 
-static int ext2_get_block(struct inode *inode, long iblock, struct buffer_head *bh_result, int create)
+static int __ext2_get_block(struct inode *inode, long iblock, struct buffer_head *bh_result, int create)
 {
 	int err = -EIO;
 	int offsets[4];
 	Indirect chain[4];
 	Indirect *partial;
-	unsigned long goal;
+	unsigned long goal, blocknr;
+	unsigned gen;
 	int left;
 	int depth = ext2_block_to_path(inode, iblock, offsets);
 
@@ -517,7 +661,18 @@ static int ext2_get_block(struct inode *inode, long iblock, struct buffer_head *
 		goto out;
 
 	lock_kernel();
+	if (ext2_map_lookup(inode, iblock, &blocknr)) {
+		ext2_map_stats.hits++;
+		bh_result->b_dev = inode->i_dev;
+		bh_result->b_blocknr = blocknr;
+		bh_result->b_state |= (1UL << BH_Mapped);
+		unlock_kernel();
+		return 0;
+	}
+	ext2_map_stats.misses++;
 reread:
+	gen = inode->u.ext2_i.i_map_gen;
+	ext2_map_stats.indirect += depth - 1;
 	partial = ext2_get_branch(inode, depth, offsets, chain, &err);
 
 	/* Simplest case - block found, no allocation needed */
@@ -526,6 +681,9 @@ got_it:
 		bh_result->b_dev = inode->i_dev;
 		bh_result->b_blocknr = le32_to_cpu(chain[depth-1].key);
 		bh_result->b_state |= (1UL << BH_Mapped);
+		ext2_map_insert(inode, gen, iblock, chain[depth-1].p,
+				offsets[depth-1], depth == 1 ? EXT2_NDIR_BLOCKS :
+				EXT2_ADDR_PER_BLOCK(inode->i_sb));
 		/* Clean up and exit */
 		partial = chain+depth-1; /* the whole chain */
 		goto cleanup;
@@ -556,24 +714,69 @@ out:
 
 	left = (chain + depth) - partial;
 	err = ext2_alloc_branch(inode, left, goal,
-					offsets+(partial-chain), partial);
+					offsets+(partial-chain), partial,
+					buffer_delay(bh_result));
 	if (err)
 		goto cleanup;
 
-	if (ext2_splice_branch(inode, iblock, chain, partial, left) < 0)
+	err = ext2_splice_branch(inode, iblock, chain, partial, left);
+	if (err == -EAGAIN)
 		goto changed;
+	if (err)
+		goto cleanup;
 
 	bh_result->b_state |= (1UL << BH_New);
 	goto got_it;
 
 changed:
+	/* these are live metadata, possibly in the journal: just let go */
 	while (partial > chain) {
-		bforget(partial->bh);
+		brelse(partial->bh);
 		partial--;
 	}
 	goto reread;
 }
 
+/* Allocation changes the block tree, so it runs under a handle */
+static int ext2_get_block(struct inode *inode, long iblock, struct buffer_head *bh_result, int create)
+{
+	struct super_block *sb = inode->i_sb;
+	int err;
+
+	if (!create || !sb->u.ext2_sb.s_journal)
+		return __ext2_get_block(inode, iblock, bh_result, create);
+	err = ext2_journal_start(sb, EXT2_ALLOC_TRANS_BLOCKS);
+	if (err)
+		return err;
+	err = __ext2_get_block(inode, iblock, bh_result, create);
+	ext2_journal_stop(sb);
+	return err;
+}
+
+/*
+ * The same, for page cache buffers: on a journaled mount a new block
+ * is dirtied and tied to the transaction which allocated it, so that
+ * the allocation does not commit before the data is on disk.
+ */
+static int ext2_get_block_data(struct inode *inode, long iblock, struct buffer_head *bh_result, int create)
+{
+	struct super_block *sb = inode->i_sb;
+	int err;
+
+	if (!create || !sb->u.ext2_sb.s_journal)
+		return __ext2_get_block(inode, iblock, bh_result, create);
+	err = ext2_journal_start(sb, EXT2_ALLOC_TRANS_BLOCKS);
+	if (err)
+		return err;
+	err = __ext2_get_block(inode, iblock, bh_result, create);
+	if (!err && buffer_new(bh_result)) {
+		mark_buffer_dirty(bh_result);
+		ext2_journal_data(inode, bh_result);
+	}
+	ext2_journal_stop(sb);
+	return err;
+}
+
 struct buffer_head * ext2_getblk(struct inode * inode, long block, int create, int * err)
 {
 	struct buffer_head dummy;
@@ -589,9 +792,15 @@ struct buffer_head * ext2_getblk(struct inode * inode, long block, int create, i
 		if (buffer_new(&dummy)) {
 			if (!buffer_uptodate(bh))
 				wait_on_buffer(bh);
+			error = ext2_journal_access(inode->i_sb, bh);
+			if (error) {
+				*err = error;
+				brelse(bh);
+				return NULL;
+			}
 			memset(bh->b_data, 0, inode->i_sb->s_blocksize);
 			mark_buffer_uptodate(bh, 1);
-			mark_buffer_dirty_inode(bh, inode);
+			ext2_journal_dirty_inode(bh, inode);
 		}
 		return bh;
 	}
@@ -650,29 +859,334 @@ struct buffer_head * ext2_bread (struct inode * inode, int block,
 	return NULL;
 }
 
+/*
+ * Inline files.  Small regular files keep their data in the inode:
+ * the first INLINE_IDATA bytes in i_data, the rest (with inodes of
+ * more than 128 bytes) after the good old inode on disk.  Bytes past
+ * i_size are kept zeroed.  The page cache works as usual; only page 0
+ * is ever filled from or copied back to the inode, always under its
+ * page lock.
+ */
+#define INLINE_IDATA	(EXT2_N_BLOCKS * sizeof(u32))
+
+static inline int ext2_has_inline_data(struct inode *inode)
+{
+	return inode->u.ext2_i.i_flags & EXT2_INLINE_DATA_FL;
+}
+
+static inline unsigned ext2_inline_size(struct inode *inode)
+{
+	unsigned max = EXT2_INLINE_DATA_SIZE(inode->i_sb);
+
+	/* a truncate upwards converts the file after raising i_size */
+	return inode->i_size < max ? inode->i_size : max;
+}
+
+/* Fill page @page of an inline file */
+static int ext2_read_inline(struct inode *inode, struct page *page)
+{
+	unsigned size = ext2_inline_size(inode);
+	struct ext2_inode *raw_inode;
+	struct buffer_head *bh;
+	char *kaddr = kmap(page);
+	int err = 0;
+
+	memset(kaddr, 0, PAGE_CACHE_SIZE);
+	if (!page->index) {
+		memcpy(kaddr, inode->u.ext2_i.i_data, INLINE_IDATA);
+		if (size > INLINE_IDATA) {
+			bh = ext2_get_inode_block(inode, &raw_inode,
+						  "ext2_read_inline");
+			if (bh) {
+				memcpy(kaddr + INLINE_IDATA,
+				       (char *) raw_inode + EXT2_GOOD_OLD_INODE_SIZE,
+				       size - INLINE_IDATA);
+				brelse(bh);
+			} else
+				err = -EIO;
+		}
+	}
+	flush_dcache_page(page);
+	kunmap(page);
+	if (!err)
+		SetPageUptodate(page);
+	return err;
+}
+
+/*
+ * Copy bytes from..to of an inline file back from its page 0 into the
+ * inode. Only the range written is copied: after a faulting write the
+ * rest of the page is not file data.
+ */
+static int ext2_write_inline(struct inode *inode, struct page *page,
+			     unsigned from, unsigned to)
+{
+	struct super_block *sb = inode->i_sb;
+	unsigned size = ext2_inline_size(inode);
+	struct ext2_inode *raw_inode;
+	struct buffer_head *bh;
+	char *kaddr;
+	int err;
+
+	/* both halves go into one transaction */
+	err = ext2_journal_start(sb, EXT2_INODE_TRANS_BLOCKS);
+	if (err)
+		return err;
+	kaddr = kmap(page);
+	if (from < INLINE_IDATA)
+		memcpy((char *) inode->u.ext2_i.i_data + from, kaddr + from,
+		       (to < INLINE_IDATA ? to : INLINE_IDATA) - from);
+	if (to > size)
+		to = size;
+	if (to > INLINE_IDATA) {
+		if (from < INLINE_IDATA)
+			from = INLINE_IDATA;
+		err = -EIO;
+		bh = ext2_get_inode_block(inode, &raw_inode, "ext2_write_inline");
+		if (bh) {
+			err = ext2_journal_access(sb, bh);
+			if (!err) {
+				memcpy((char *) raw_inode + EXT2_GOOD_OLD_INODE_SIZE +
+				       from - INLINE_IDATA, kaddr + from, to - from);
+				ext2_journal_dirty(sb, bh);
+			}
+			brelse(bh);
+		}
+	}
+	kunmap(page);
+	mark_inode_dirty(inode);
+	ext2_journal_stop(sb);
+	return err;
+}
+
+/* Zero the inline data from @from on */
+static int ext2_clear_inline(struct inode *inode, unsigned from)
+{
+	struct super_block *sb = inode->i_sb;
+	unsigned max = EXT2_INLINE_DATA_SIZE(sb);
+	struct ext2_inode *raw_inode;
+	struct buffer_head *bh;
+	int err;
+
+	if (from < INLINE_IDATA) {
+		memset((char *) inode->u.ext2_i.i_data + from, 0,
+		       INLINE_IDATA - from);
+		from = INLINE_IDATA;
+	}
+	if (from >= max)
+		return 0;
+	bh = ext2_get_inode_block(inode, &raw_inode, "ext2_clear_inline");
+	if (!bh)
+		return -EIO;
+	err = ext2_journal_access(sb, bh);
+	if (!err) {
+		memset((char *) raw_inode + EXT2_GOOD_OLD_INODE_SIZE +
+		       from - INLINE_IDATA, 0, max - from);
+		ext2_journal_dirty(sb, bh);
+	}
+	brelse(bh);
+	return err;
+}
+
+/*
+ * New regular files start out inline on filesystems with the feature.
+ * The slot in the inode table may still hold an old file's data.
+ */
+void ext2_init_inline(struct inode *inode)
+{
+	if (!EXT2_HAS_INCOMPAT_FEATURE(inode->i_sb,
+				       EXT2_FEATURE_INCOMPAT_INLINE_DATA))
+		return;
+	if (!ext2_clear_inline(inode, 0))
+		inode->u.ext2_i.i_flags |= EXT2_INLINE_DATA_FL;
+}
+
+/*
+ * The file is outgrowing its inode: write the data out to a block of
+ * its own, through page 0.  @locked is a page of the file which the
+ * caller holds locked already, or NULL.  Page 0 is taken inside
+ * another page only here, where i_sem keeps out anyone else who might
+ * lock two pages of the file.
+ */
+static int ext2_uninline(struct inode *inode, struct page *locked)
+{
+	struct super_block *sb = inode->i_sb;
+	struct page *page = locked;
+	u32 i_data[EXT2_N_BLOCKS];
+	unsigned size;
+	int err = 0;
+
+	if (!page || page->index) {
+		page = grab_cache_page(inode->i_mapping, 0);
+		if (!page)
+			return -ENOMEM;
+	}
+	if (!ext2_has_inline_data(inode))
+		goto out;
+	if (!Page_Uptodate(page)) {
+		err = ext2_read_inline(inode, page);
+		if (err)
+			goto out;
+	}
+	err = ext2_journal_start(sb, EXT2_WRITE_TRANS_BLOCKS);
+	if (err)
+		goto out;
+	size = ext2_inline_size(inode);
+	memcpy(i_data, inode->u.ext2_i.i_data, sizeof(i_data));
+	memset(inode->u.ext2_i.i_data, 0, sizeof(i_data));
+	inode->u.ext2_i.i_flags &= ~EXT2_INLINE_DATA_FL;
+	if (size) {
+		err = block_prepare_write(page, 0, size, ext2_get_block_data);
+		if (!err)
+			generic_commit_write(NULL, page, 0, size);
+	}
+	if (err) {
+		/* the one block needed was not allocated: nothing to undo */
+		memcpy(inode->u.ext2_i.i_data, i_data, sizeof(i_data));
+		inode->u.ext2_i.i_flags |= EXT2_INLINE_DATA_FL;
+	}
+	mark_inode_dirty(inode);
+	ext2_journal_stop(sb);
+out:
+	if (page != locked) {
+		UnlockPage(page);
+		page_cache_release(page);
+	}
+	return err;
+}
+
 static int ext2_writepage(struct page *page)
 {
-	return block_write_full_page(page,ext2_get_block);
+	struct inode *inode = page->mapping->host;
+	struct super_block *sb = inode->i_sb;
+	handle_t *handle = journal_current_handle();
+	int err = 0;
+
+	/* Called from reclaim inside another journal's handle? */
+	if (handle && sb->u.ext2_sb.s_journal &&
+	    handle->h_transaction->t_journal != sb->u.ext2_sb.s_journal) {
+		set_page_dirty(page);
+		UnlockPage(page);
+		return 0;
+	}
+	/* written through a mapping: put the data back into the inode */
+	if (ext2_has_inline_data(inode)) {
+		if (!page->index)
+			err = ext2_write_inline(inode, page, 0, PAGE_CACHE_SIZE);
+		UnlockPage(page);
+		return err;
+	}
+	return block_write_full_page(page,ext2_get_block_data);
+}
+static int ext2_writepages(struct address_space *mapping)
+{
+	return block_writepages(mapping,ext2_get_block_data);
 }
 static int ext2_readpage(struct file *file, struct page *page)
 {
+	struct inode *inode = page->mapping->host;
+	int err;
+
+	if (ext2_has_inline_data(inode)) {
+		err = ext2_read_inline(inode, page);
+		UnlockPage(page);
+		return err;
+	}
 	return block_read_full_page(page,ext2_get_block);
 }
+/*
+ * On a journaled mount the handle is held from here to commit_write,
+ * so that new blocks can not commit before the data is copied in.
+ */
 static int ext2_prepare_write(struct file *file, struct page *page, unsigned from, unsigned to)
 {
-	return block_prepare_write(page,from,to,ext2_get_block);
+	struct inode *inode = page->mapping->host;
+	struct super_block *sb = inode->i_sb;
+	int err;
+
+	if (ext2_has_inline_data(inode)) {
+		if (!page->index && to <= EXT2_INLINE_DATA_SIZE(sb)) {
+			if (!Page_Uptodate(page)) {
+				err = ext2_read_inline(inode, page);
+				if (err)
+					return err;
+			}
+			kmap(page);
+			return 0;
+		}
+		err = ext2_uninline(inode, page);
+		if (err)
+			return err;
+	}
+	if (test_opt(sb, DELALLOC))
+		return delay_prepare_write(page,from,to,ext2_get_block,
+					   ext2_reserve_blocks);
+	err = ext2_journal_start(sb, EXT2_WRITE_TRANS_BLOCKS);
+	if (err)
+		return err;
+	err = block_prepare_write(page,from,to,ext2_get_block_data);
+	if (err)
+		ext2_journal_stop(sb);
+	return err;
+}
+static int ext2_commit_write(struct file *file, struct page *page, unsigned from, unsigned to)
+{
+	struct inode *inode = page->mapping->host;
+	int err, err2;
+
+	if (ext2_has_inline_data(inode)) {
+		if (to > inode->i_size)
+			inode->i_size = to;
+		err = ext2_write_inline(inode, page, from, to);
+		kunmap(page);
+		return err;
+	}
+	err = generic_commit_write(file, page, from, to);
+	err2 = ext2_journal_stop(inode->i_sb);
+	return err ? err : err2;
 }
 static int ext2_bmap(struct address_space *mapping, long block)
 {
+	if (ext2_has_inline_data(mapping->host))
+		return 0;
+	/* delayed blocks have no number until they are written out */
+	if (test_opt(mapping->host->i_sb, DELALLOC)) {
+		filemap_fdatasync(mapping);
+		filemap_fdatawait(mapping);
+	}
 	return generic_block_bmap(mapping,block,ext2_get_block);
 }
+static int ext2_direct_IO(int rw, struct inode *inode, struct kiobuf *iobuf, unsigned long blocknr, int blocksize)
+{
+	int err;
+
+	/* O_DIRECT needs blocks to go to */
+	if (ext2_has_inline_data(inode)) {
+		/* writers come here with i_sem held, readers do not */
+		if (rw == READ)
+			down(&inode->i_sem);
+		err = ext2_uninline(inode, NULL);
+		if (rw == READ)
+			up(&inode->i_sem);
+		if (err)
+			return err;
+		err = filemap_fdatasync(inode->i_mapping);
+		if (filemap_fdatawait(inode->i_mapping) && !err)
+			err = -EIO;
+		if (err)
+			return err;
+	}
+	return generic_direct_IO(rw, inode, iobuf, blocknr, blocksize, ext2_get_block);
+}
 struct address_space_operations ext2_aops = {
 	readpage: ext2_readpage,
 	writepage: ext2_writepage,
+	writepages: ext2_writepages,
 	sync_page: block_sync_page,
 	prepare_write: ext2_prepare_write,
-	commit_write: generic_commit_write,
-	bmap: ext2_bmap
+	commit_write: ext2_commit_write,
+	bmap: ext2_bmap,
+	direct_IO: ext2_direct_IO
 };
 
 /*
@@ -756,6 +1270,8 @@ static Indirect *ext2_find_shared(struct inode *inode,
 	if (p == chain + k - 1 && p > chain) {
 		p->p--;
 	} else {
+		if (p > chain)
+			ext2_journal_access(inode->i_sb, p->bh);
 		*top = *p->p;
 		*p->p = 0;
 	}
@@ -773,14 +1289,17 @@ no_top:
 /**
  *	ext2_free_data - free a list of data blocks
  *	@inode:	inode we are dealing with
+ *	@bh:	indirect block holding the array, NULL for the inode itself
  *	@p:	array of block numbers
  *	@q:	points immediately past the end of array
  *
  *	We are freeing all blocks refered from that array (numbers are
  *	stored as little-endian 32-bit) and updating @inode->i_blocks
- *	appropriately.
+ *	appropriately.  On a journaled mount the caller has got write
+ *	access to @bh.
  */
-static inline void ext2_free_data(struct inode *inode, u32 *p, u32 *q)
+static inline void ext2_free_data(struct inode *inode, struct buffer_head *bh,
+				  u32 *p, u32 *q)
 {
 	int blocks = inode->i_sb->s_blocksize / 512;
 	unsigned long block_to_free = 0, count = 0;
@@ -799,8 +1318,10 @@ static inline void ext2_free_data(struct inode *inode, u32 *p, u32 *q)
 				/* Writer: ->i_blocks */
 				inode->i_blocks -= blocks * count;
 				/* Writer: end */
+				ext2_journal_free_data(inode, block_to_free, count);
 				ext2_free_blocks (inode, block_to_free, count);
 				mark_inode_dirty(inode);
+				ext2_journal_restart(inode, bh);
 			free_this:
 				block_to_free = nr;
 				count = 1;
@@ -811,6 +1332,7 @@ static inline void ext2_free_data(struct inode *inode, u32 *p, u32 *q)
 		/* Writer: ->i_blocks */
 		inode->i_blocks -= blocks * count;
 		/* Writer: end */
+		ext2_journal_free_data(inode, block_to_free, count);
 		ext2_free_blocks (inode, block_to_free, count);
 		mark_inode_dirty(inode);
 	}
@@ -819,15 +1341,20 @@ static inline void ext2_free_data(struct inode *inode, u32 *p, u32 *q)
 /**
  *	ext2_free_branches - free an array of branches
  *	@inode:	inode we are dealing with
+ *	@parent: indirect block holding the array, NULL for the inode itself
  *	@p:	array of block numbers
  *	@q:	pointer immediately past the end of array
  *	@depth:	depth of the branches to free
  *
  *	We are freeing all blocks refered from these branches (numbers are
  *	stored as little-endian 32-bit) and updating @inode->i_blocks
- *	appropriately.
+ *	appropriately.  On a journaled mount the caller has got write
+ *	access to @parent, and indirect blocks are emptied through the
+ *	journal too: a big truncate spans several transactions, and a
+ *	crash between them must not leave pointers to freed blocks.
  */
-static void ext2_free_branches(struct inode *inode, u32 *p, u32 *q, int depth)
+static void ext2_free_branches(struct inode *inode, struct buffer_head *parent,
+			       u32 *p, u32 *q, int depth)
 {
 	struct buffer_head * bh;
 	unsigned long nr;
@@ -850,19 +1377,21 @@ static void ext2_free_branches(struct inode *inode, u32 *p, u32 *q, int depth)
 					inode->i_ino, nr);
 				continue;
 			}
-			ext2_free_branches(inode,
+			ext2_journal_access(inode->i_sb, bh);
+			ext2_free_branches(inode, bh,
 					   (u32*)bh->b_data,
 					   (u32*)bh->b_data + addr_per_block,
 					   depth);
-			bforget(bh);
+			ext2_journal_forget(inode->i_sb, bh);
 			/* Writer: ->i_blocks */
 			inode->i_blocks -= inode->i_sb->s_blocksize / 512;
 			/* Writer: end */
 			ext2_free_blocks(inode, nr, 1);
 			mark_inode_dirty(inode);
+			ext2_journal_restart(inode, parent);
 		}
 	} else
-		ext2_free_data(inode, p, q);
+		ext2_free_data(inode, parent, p, q);
 }
 
 void ext2_truncate (struct inode * inode)
@@ -883,7 +1412,24 @@ void ext2_truncate (struct inode * inode)
 	if (IS_APPEND(inode) || IS_IMMUTABLE(inode))
 		return;
 
+	if (ext2_has_inline_data(inode)) {
+		/* page 0 must be locked before a handle is started */
+		if (inode->i_size > EXT2_INLINE_DATA_SIZE(inode->i_sb) &&
+		    ext2_uninline(inode, NULL))
+			return;
+		if (ext2_journal_start(inode->i_sb, EXT2_INODE_TRANS_BLOCKS))
+			return;
+		if (ext2_has_inline_data(inode))
+			ext2_clear_inline(inode, inode->i_size);
+		inode->i_mtime = inode->i_ctime = CURRENT_TIME;
+		mark_inode_dirty(inode);
+		ext2_journal_stop(inode->i_sb);
+		return;
+	}
+	if (ext2_journal_start(inode->i_sb, EXT2_TRUNCATE_TRANS_BLOCKS))
+		return;
 	ext2_discard_prealloc(inode);
+	ext2_map_flush(inode);
 
 	blocksize = inode->i_sb->s_blocksize;
 	iblock = (inode->i_size + blocksize-1)
@@ -893,10 +1439,10 @@ void ext2_truncate (struct inode * inode)
 
 	n = ext2_block_to_path(inode, iblock, offsets);
 	if (n == 0)
-		return;
+		goto out;
 
 	if (n == 1) {
-		ext2_free_data(inode, i_data+offsets[0],
+		ext2_free_data(inode, NULL, i_data+offsets[0],
 					i_data + EXT2_NDIR_BLOCKS);
 		goto do_indirects;
 	}
@@ -907,20 +1453,21 @@ void ext2_truncate (struct inode * inode)
 		if (partial == chain)
 			mark_inode_dirty(inode);
 		else
-			mark_buffer_dirty_inode(partial->bh, inode);
-		ext2_free_branches(inode, &nr, &nr+1, (chain+n-1) - partial);
+			ext2_journal_dirty_inode(partial->bh, inode);
+		/* the top is held by nothing now */
+		ext2_free_branches(inode, NULL, &nr, &nr+1,
+				   (chain+n-1) - partial);
 	}
 	/* Clear the ends of indirect blocks on the shared branch */
 	while (partial > chain) {
-		ext2_free_branches(inode,
+		ext2_journal_access(inode->i_sb, partial->bh);
+		ext2_free_branches(inode, partial->bh,
 				   partial->p + 1,
 				   (u32*)partial->bh->b_data + addr_per_block,
 				   (chain+n-1) - partial);
-		mark_buffer_dirty_inode(partial->bh, inode);
-		if (IS_SYNC(inode)) {
-			ll_rw_block (WRITE, 1, &partial->bh);
-			wait_on_buffer (partial->bh);
-		}
+		ext2_journal_dirty_inode(partial->bh, inode);
+		if (IS_SYNC(inode))
+			ext2_journal_sync(inode->i_sb, partial->bh);
 		brelse (partial->bh);
 		partial--;
 	}
@@ -932,21 +1479,21 @@ do_indirects:
 			if (nr) {
 				i_data[EXT2_IND_BLOCK] = 0;
 				mark_inode_dirty(inode);
-				ext2_free_branches(inode, &nr, &nr+1, 1);
+				ext2_free_branches(inode, NULL, &nr, &nr+1, 1);
 			}
 		case EXT2_IND_BLOCK:
 			nr = i_data[EXT2_DIND_BLOCK];
 			if (nr) {
 				i_data[EXT2_DIND_BLOCK] = 0;
 				mark_inode_dirty(inode);
-				ext2_free_branches(inode, &nr, &nr+1, 2);
+				ext2_free_branches(inode, NULL, &nr, &nr+1, 2);
 			}
 		case EXT2_DIND_BLOCK:
 			nr = i_data[EXT2_TIND_BLOCK];
 			if (nr) {
 				i_data[EXT2_TIND_BLOCK] = 0;
 				mark_inode_dirty(inode);
-				ext2_free_branches(inode, &nr, &nr+1, 3);
+				ext2_free_branches(inode, NULL, &nr, &nr+1, 3);
 			}
 		case EXT2_TIND_BLOCK:
 			;
@@ -956,12 +1503,19 @@ do_indirects:
 		ext2_sync_inode (inode);
 	else
 		mark_inode_dirty(inode);
+out:
+	ext2_map_flush(inode);
+	ext2_journal_stop(inode->i_sb);
 }
 
-void ext2_read_inode (struct inode * inode)
+/*
+ * Read in the inode table block holding @inode, and find the inode in it.
+ */
+static struct buffer_head * ext2_get_inode_block (struct inode * inode,
+						  struct ext2_inode ** raw_inode,
+						  const char * function)
 {
 	struct buffer_head * bh;
-	struct ext2_inode * raw_inode;
 	unsigned long block_group;
 	unsigned long group_desc;
 	unsigned long desc;
@@ -969,29 +1523,18 @@ void ext2_read_inode (struct inode * inode)
 	unsigned long offset;
 	struct ext2_group_desc * gdp;
 
-	if ((inode->i_ino != EXT2_ROOT_INO && inode->i_ino != EXT2_ACL_IDX_INO &&
-	     inode->i_ino != EXT2_ACL_DATA_INO &&
-	     inode->i_ino < EXT2_FIRST_INO(inode->i_sb)) ||
-	    inode->i_ino > le32_to_cpu(inode->i_sb->u.ext2_sb.s_es->s_inodes_count)) {
-		ext2_error (inode->i_sb, "ext2_read_inode",
-			    "bad inode number: %lu", inode->i_ino);
-		goto bad_inode;
-	}
 	block_group = (inode->i_ino - 1) / EXT2_INODES_PER_GROUP(inode->i_sb);
 	if (block_group >= inode->i_sb->u.ext2_sb.s_groups_count) {
-		ext2_error (inode->i_sb, "ext2_read_inode",
-			    "group >= groups count");
-		goto bad_inode;
+		ext2_error (inode->i_sb, function, "group >= groups count");
+		return NULL;
 	}
 	group_desc = block_group >> EXT2_DESC_PER_BLOCK_BITS(inode->i_sb);
 	desc = block_group & (EXT2_DESC_PER_BLOCK(inode->i_sb) - 1);
 	bh = inode->i_sb->u.ext2_sb.s_group_desc[group_desc];
 	if (!bh) {
-		ext2_error (inode->i_sb, "ext2_read_inode",
-			    "Descriptor not loaded");
-		goto bad_inode;
+		ext2_error (inode->i_sb, function, "Descriptor not loaded");
+		return NULL;
 	}
-
 	gdp = (struct ext2_group_desc *) bh->b_data;
 	/*
 	 * Figure out the offset within the block group inode table
@@ -1001,13 +1544,34 @@ void ext2_read_inode (struct inode * inode)
 	block = le32_to_cpu(gdp[desc].bg_inode_table) +
 		(offset >> EXT2_BLOCK_SIZE_BITS(inode->i_sb));
 	if (!(bh = bread (inode->i_dev, block, inode->i_sb->s_blocksize))) {
-		ext2_error (inode->i_sb, "ext2_read_inode",
+		ext2_error (inode->i_sb, function,
 			    "unable to read inode block - "
 			    "inode=%lu, block=%lu", inode->i_ino, block);
+		return NULL;
+	}
+	offset &= EXT2_BLOCK_SIZE(inode->i_sb) - 1;
+	*raw_inode = (struct ext2_inode *) (bh->b_data + offset);
+	return bh;
+}
+
+void ext2_read_inode (struct inode * inode)
+{
+	struct buffer_head * bh;
+	struct ext2_inode * raw_inode;
+	unsigned long block;
+
+	if ((inode->i_ino != EXT2_ROOT_INO && inode->i_ino != EXT2_ACL_IDX_INO &&
+	     inode->i_ino != EXT2_ACL_DATA_INO &&
+	     inode->i_ino != le32_to_cpu(EXT2_SB(inode->i_sb)->s_es->s_journal_inum) &&
+	     inode->i_ino < EXT2_FIRST_INO(inode->i_sb)) ||
+	    inode->i_ino > le32_to_cpu(inode->i_sb->u.ext2_sb.s_es->s_inodes_count)) {
+		ext2_error (inode->i_sb, "ext2_read_inode",
+			    "bad inode number: %lu", inode->i_ino);
 		goto bad_inode;
 	}
-	offset &= (EXT2_BLOCK_SIZE(inode->i_sb) - 1);
-	raw_inode = (struct ext2_inode *) (bh->b_data + offset);
+	bh = ext2_get_inode_block (inode, &raw_inode, "ext2_read_inode");
+	if (!bh)
+		goto bad_inode;
 
 	inode->i_mode = le16_to_cpu(raw_inode->i_mode);
 	inode->i_uid = (uid_t)le16_to_cpu(raw_inode->i_uid_low);
@@ -1047,7 +1611,8 @@ void ext2_read_inode (struct inode * inode)
 		inode->i_size |= ((__u64)le32_to_cpu(raw_inode->i_size_high)) << 32;
 	}
 	inode->i_generation = le32_to_cpu(raw_inode->i_generation);
-	inode->u.ext2_i.i_block_group = block_group;
+	inode->u.ext2_i.i_block_group = (inode->i_ino - 1) /
+					EXT2_INODES_PER_GROUP(inode->i_sb);
 
 	/*
 	 * NOTE! The in-memory inode i_data array is in little-endian order
@@ -1105,13 +1670,8 @@ static int ext2_update_inode(struct inode * inode, int do_sync)
 {
 	struct buffer_head * bh;
 	struct ext2_inode * raw_inode;
-	unsigned long block_group;
-	unsigned long group_desc;
-	unsigned long desc;
 	unsigned long block;
-	unsigned long offset;
 	int err = 0;
-	struct ext2_group_desc * gdp;
 
 	if ((inode->i_ino != EXT2_ROOT_INO &&
 	     inode->i_ino < EXT2_FIRST_INO(inode->i_sb)) ||
@@ -1120,36 +1680,14 @@ static int ext2_update_inode(struct inode * inode, int do_sync)
 			    "bad inode number: %lu", inode->i_ino);
 		return -EIO;
 	}
-	block_group = (inode->i_ino - 1) / EXT2_INODES_PER_GROUP(inode->i_sb);
-	if (block_group >= inode->i_sb->u.ext2_sb.s_groups_count) {
-		ext2_error (inode->i_sb, "ext2_write_inode",
-			    "group >= groups count");
-		return -EIO;
-	}
-	group_desc = block_group >> EXT2_DESC_PER_BLOCK_BITS(inode->i_sb);
-	desc = block_group & (EXT2_DESC_PER_BLOCK(inode->i_sb) - 1);
-	bh = inode->i_sb->u.ext2_sb.s_group_desc[group_desc];
-	if (!bh) {
-		ext2_error (inode->i_sb, "ext2_write_inode",
-			    "Descriptor not loaded");
-		return -EIO;
-	}
-	gdp = (struct ext2_group_desc *) bh->b_data;
-	/*
-	 * Figure out the offset within the block group inode table
-	 */
-	offset = ((inode->i_ino - 1) % EXT2_INODES_PER_GROUP(inode->i_sb)) *
-		EXT2_INODE_SIZE(inode->i_sb);
-	block = le32_to_cpu(gdp[desc].bg_inode_table) +
-		(offset >> EXT2_BLOCK_SIZE_BITS(inode->i_sb));
-	if (!(bh = bread (inode->i_dev, block, inode->i_sb->s_blocksize))) {
-		ext2_error (inode->i_sb, "ext2_write_inode",
-			    "unable to read inode block - "
-			    "inode=%lu, block=%lu", inode->i_ino, block);
+	bh = ext2_get_inode_block (inode, &raw_inode, "ext2_write_inode");
+	if (!bh)
 		return -EIO;
+	err = ext2_journal_access(inode->i_sb, bh);
+	if (err) {
+		brelse (bh);
+		return err;
 	}
-	offset &= EXT2_BLOCK_SIZE(inode->i_sb) - 1;
-	raw_inode = (struct ext2_inode *) (bh->b_data + offset);
 
 	raw_inode->i_mode = cpu_to_le16(inode->i_mode);
 	if(!(test_opt(inode->i_sb, NO_UID32))) {
@@ -1212,16 +1750,13 @@ static int ext2_update_inode(struct inode * inode, int do_sync)
 		raw_inode->i_block[0] = cpu_to_le32(kdev_t_to_nr(inode->i_rdev));
 	else for (block = 0; block < EXT2_N_BLOCKS; block++)
 		raw_inode->i_block[block] = inode->u.ext2_i.i_data[block];
-	mark_buffer_dirty(bh);
+	ext2_journal_dirty(inode->i_sb, bh);
 	if (do_sync) {
-		ll_rw_block (WRITE, 1, &bh);
-		wait_on_buffer (bh);
-		if (buffer_req(bh) && !buffer_uptodate(bh)) {
+		err = ext2_journal_sync(inode->i_sb, bh);
+		if (err)
 			printk ("IO error syncing ext2 inode ["
 				"%s:%08lx]\n",
 				bdevname(inode->i_dev), inode->i_ino);
-			err = -EIO;
-		}
 	}
 	brelse (bh);
 	return err;
@@ -1229,14 +1764,45 @@ static int ext2_update_inode(struct inode * inode, int do_sync)
 
 void ext2_write_inode (struct inode * inode, int wait)
 {
+	/* A journaled mount logged the inode when it was dirtied */
+	if (inode->i_sb->u.ext2_sb.s_journal) {
+		if (wait && !journal_current_handle())
+			ext2_force_commit(inode->i_sb);
+		return;
+	}
 	lock_kernel();
 	ext2_update_inode (inode, wait);
 	unlock_kernel();
 }
 
+/*
+ * On a journaled mount every change to an inode goes into the running
+ * transaction as mark_inode_dirty() reports it, so that it commits
+ * together with the rest of the update.
+ */
+void ext2_dirty_inode (struct inode * inode)
+{
+	struct super_block *sb = inode->i_sb;
+
+	if (!sb->u.ext2_sb.s_journal ||
+	    ext2_journal_start(sb, EXT2_INODE_TRANS_BLOCKS))
+		return;
+	lock_kernel();
+	ext2_update_inode (inode, 0);
+	unlock_kernel();
+	ext2_journal_stop(sb);
+}
+
 int ext2_sync_inode (struct inode *inode)
 {
-	return ext2_update_inode (inode, 1);
+	int err, err2;
+
+	err = ext2_journal_start(inode->i_sb, EXT2_INODE_TRANS_BLOCKS);
+	if (err)
+		return err;
+	err = ext2_update_inode (inode, 1);
+	err2 = ext2_journal_stop(inode->i_sb);
+	return err ? err : err2;
 }
 
 int ext2_notify_change(struct dentry *dentry, struct iattr *iattr)
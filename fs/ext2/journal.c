@@ -0,0 +1,296 @@
+/*
+ *  linux/fs/ext2/journal.c
+ *
+ *  Glue between ext2 and the metadata journal of fs/journal.c.
+ *
+ *  Every helper here also does the right thing on a filesystem mounted
+ *  without a journal, where it falls back to what ext2 always did, so
+ *  the rest of ext2 need not care which kind of mount it is on.  The
+ *  handle of the operation in progress is found through
+ *  current->journal_info; nested starts just count.  If the journal
+ *  aborts in the middle of an operation the handle may go away: the
+ *  rest of the operation then only changes memory.
+ */
+
+#include <linux/fs.h>
+#include <linux/ext2_fs.h>
+#include <linux/journal.h>
+#include <linux/locks.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+
+static inline journal_t *ext2_journal(struct super_block *sb)
+{
+	return sb->u.ext2_sb.s_journal;
+}
+
+/*
+ * Open a handle for an update touching at most @nblocks metadata blocks.
+ * Every successful start must be paired with ext2_journal_stop().
+ */
+int ext2_journal_start(struct super_block *sb, int nblocks)
+{
+	journal_t *journal = ext2_journal(sb);
+	handle_t *handle = journal_current_handle();
+
+	if (!journal)
+		return 0;
+	/* a handle on another filesystem's journal can not nest ours */
+	if (handle && handle->h_transaction->t_journal != journal)
+		return -EDEADLK;
+	if (sb->s_flags & MS_RDONLY)
+		return -EROFS;
+	handle = journal_start(journal, nblocks);
+	if (IS_ERR(handle))
+		return PTR_ERR(handle);
+	return 0;
+}
+
+/* Returns -EIO if a synchronous update could not be committed */
+int ext2_journal_stop(struct super_block *sb)
+{
+	handle_t *handle = journal_current_handle();
+
+	if (!ext2_journal(sb))
+		return 0;
+	if (!handle)
+		return -EROFS;
+	return journal_stop(handle);
+}
+
+/*
+ * Long operations (truncate) are split over several transactions when
+ * the handle runs low on credits.  Each step must leave the filesystem
+ * consistent; @bh is the block being modified, which is dirtied in the
+ * old transaction and opened again in the new one.
+ */
+void ext2_journal_restart(struct inode *inode, struct buffer_head *bh)
+{
+	struct super_block *sb = inode->i_sb;
+	journal_t *journal = ext2_journal(sb);
+	handle_t *handle = journal_current_handle();
+
+	if (!journal || !handle ||
+	    handle->h_buffer_credits > EXT2_ALLOC_TRANS_BLOCKS)
+		return;
+	if (bh)
+		journal_dirty_metadata(handle, bh);
+	mark_inode_dirty(inode);
+	if (journal_restart(handle, EXT2_TRUNCATE_TRANS_BLOCKS))
+		return;
+	if (bh)
+		journal_get_write_access(journal_current_handle(), bh);
+}
+
+/* Must be called before a metadata block is modified */
+int ext2_journal_access(struct super_block *sb, struct buffer_head *bh)
+{
+	handle_t *handle = journal_current_handle();
+
+	if (!ext2_journal(sb))
+		return 0;
+	if (!handle)
+		return -EROFS;
+	return journal_get_write_access(handle, bh);
+}
+
+/*
+ * Bits are about to be cleared in a block bitmap: remember which were
+ * set in the last committed copy, see ext2_journal_bitmap().
+ */
+int ext2_journal_undo_access(struct super_block *sb, struct buffer_head *bh)
+{
+	handle_t *handle = journal_current_handle();
+
+	if (!ext2_journal(sb))
+		return 0;
+	if (!handle)
+		return -EROFS;
+	return journal_get_undo_access(handle, bh);
+}
+
+/*
+ * The bitmap to look for free blocks in.  A block freed by a transaction
+ * which has not committed yet is in use again after a crash, so its bit
+ * is still set in the map returned.  Under lock_super(), which protects
+ * the scratch copy.
+ */
+char *ext2_journal_bitmap(struct super_block *sb, struct buffer_head *bh)
+{
+	journal_t *journal = ext2_journal(sb);
+	char *map = sb->u.ext2_sb.s_alloc_map;
+
+	if (journal && journal_merge_committed(journal, bh, map))
+		return map;
+	return bh->b_data;
+}
+
+/* These take the place of mark_buffer_dirty{,_inode}() for metadata */
+void ext2_journal_dirty(struct super_block *sb, struct buffer_head *bh)
+{
+	handle_t *handle = journal_current_handle();
+
+	if (!ext2_journal(sb))
+		mark_buffer_dirty(bh);
+	else if (handle)
+		journal_dirty_metadata(handle, bh);
+}
+
+void ext2_journal_dirty_inode(struct buffer_head *bh, struct inode *inode)
+{
+	handle_t *handle = journal_current_handle();
+
+	if (!ext2_journal(inode->i_sb))
+		mark_buffer_dirty_inode(bh, inode);
+	else if (handle)
+		journal_dirty_metadata(handle, bh);
+}
+
+/*
+ * A synchronous update: write the block now, or with a journal, have
+ * ext2_journal_stop() wait for the commit.
+ */
+int ext2_journal_sync(struct super_block *sb, struct buffer_head *bh)
+{
+	handle_t *handle = journal_current_handle();
+
+	if (ext2_journal(sb)) {
+		if (handle)
+			handle->h_sync = 1;
+		return 0;
+	}
+	ll_rw_block (WRITE, 1, &bh);
+	wait_on_buffer (bh);
+	if (buffer_req(bh) && !buffer_uptodate(bh))
+		return -EIO;
+	return 0;
+}
+
+/*
+ * A metadata block is being freed.  Like bforget(), this drops the
+ * caller's reference, and no copy of the block in the log may be
+ * replayed over its next user.
+ */
+void ext2_journal_forget(struct super_block *sb, struct buffer_head *bh)
+{
+	handle_t *handle = journal_current_handle();
+	unsigned long blocknr = bh->b_blocknr;
+
+	if (!ext2_journal(sb) || !handle) {
+		bforget(bh);
+		return;
+	}
+	journal_forget(handle, bh);
+	journal_revoke(handle, blocknr);
+}
+
+/*
+ * Directory blocks are metadata too.  Free them through the journal
+ * whether or not they are in the buffer cache.
+ */
+void ext2_journal_free_data(struct inode *inode, unsigned long block,
+			    unsigned long count)
+{
+	struct super_block *sb = inode->i_sb;
+	handle_t *handle = journal_current_handle();
+	struct buffer_head *bh;
+
+	if (!ext2_journal(sb) || !handle || !S_ISDIR(inode->i_mode))
+		return;
+	for ( ; count; count--, block++) {
+		bh = get_hash_table(inode->i_dev, block, sb->s_blocksize);
+		if (bh)
+			journal_forget(handle, bh);
+		journal_revoke(handle, block);
+	}
+}
+
+/*
+ * File data is not logged, but a newly allocated data block must reach
+ * the disk before the transaction which allocated it commits: after a
+ * crash, a file never points to a block holding stale data.
+ */
+void ext2_journal_data(struct inode *inode, struct buffer_head *bh)
+{
+	handle_t *handle = journal_current_handle();
+
+	if (ext2_journal(inode->i_sb) && handle)
+		journal_dirty_data(handle, bh);
+}
+
+/* Commit everything and wait for it; a no-op without a journal */
+int ext2_force_commit(struct super_block *sb)
+{
+	journal_t *journal = ext2_journal(sb);
+
+	if (!journal)
+		return 0;
+	return journal_force_commit(journal);
+}
+
+/* Called from ext2_write_super(), under lock_super(): must not wait */
+void ext2_start_commit(struct super_block *sb)
+{
+	journal_t *journal = ext2_journal(sb);
+
+	if (journal)
+		journal_start_commit(journal);
+}
+
+/*
+ * Find the journal inode named in the superblock and replay whatever
+ * committed transactions it still holds.
+ */
+int ext2_load_journal(struct super_block *sb)
+{
+	struct ext2_super_block *es = sb->u.ext2_sb.s_es;
+	struct inode *inode;
+	journal_t *journal;
+	int err = -EINVAL;
+
+	inode = iget(sb, le32_to_cpu(es->s_journal_inum));
+	if (!inode)
+		return -ENOMEM;
+	if (is_bad_inode(inode) || !inode->i_nlink ||
+	    !S_ISREG(inode->i_mode)) {
+		printk(KERN_ERR "EXT2-fs: no journal found in inode %u\n",
+		       le32_to_cpu(es->s_journal_inum));
+		goto out_iput;
+	}
+	journal = journal_init_inode(inode);
+	if (!journal)
+		goto out_iput;
+	err = journal_load(journal);
+	if (err) {
+		journal_destroy(journal);
+		goto out_iput;
+	}
+	sb->u.ext2_sb.s_alloc_map = kmalloc(sb->s_blocksize, GFP_KERNEL);
+	if (!sb->u.ext2_sb.s_alloc_map) {
+		journal_destroy(journal);
+		err = -ENOMEM;
+		goto out_iput;
+	}
+	sb->u.ext2_sb.s_journal = journal;
+	return 0;
+
+out_iput:
+	iput(inode);
+	return err;
+}
+
+/* Check the log in and write everything home.  Under lock_super(). */
+void ext2_destroy_journal(struct super_block *sb)
+{
+	journal_t *journal = ext2_journal(sb);
+	struct inode *inode;
+
+	if (!journal)
+		return;
+	inode = journal->j_inode;
+	journal_destroy(journal);
+	sb->u.ext2_sb.s_journal = NULL;
+	kfree(sb->u.ext2_sb.s_alloc_map);
+	sb->u.ext2_sb.s_alloc_map = NULL;
+	iput(inode);
+}
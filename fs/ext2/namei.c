@@ -21,6 +21,7 @@
 #include <linux/fs.h>
 #include <linux/ext2_fs.h>
 #include <linux/locks.h>
+#include <linux/malloc.h>
 #include <linux/quotaops.h>
 
 
@@ -49,6 +50,584 @@ static inline int ext2_match (int len, const char * const name,
 	return !memcmp(name, de->name, len);
 }
 
+/*
+ * Hashed directory index.
+ *
+ * Block 0 of an indexed directory holds "." and "..", with ".." taking
+ * up the rest of the block; the root of the index lives in that slack.
+ * A second level of index blocks, when needed, hold one empty entry
+ * covering the whole block. So an index block looks like a directory
+ * block with no names in it to a kernel that knows nothing about the
+ * index, and such a kernel clears EXT2_INDEX_FL as soon as it adds a
+ * name (see ext2_add_entry() below for this one). The leaves are
+ * ordinary directory blocks, each holding the names whose hashes fall
+ * into one range.
+ *
+ * A hash value taken up by more names than fit in a leaf continues in
+ * the next leaf; the index entry of that leaf then has the low bit of
+ * its hash set. Leaves are never merged: unlink leaves the index alone.
+ */
+#define DX_HASH_LEGACY	0
+#define ERR_BAD_DX_DIR	-75000	/* the index is corrupt: go linear */
+
+struct fake_dirent {
+	__u32 inode;
+	__u16 rec_len;
+	__u8 name_len;
+	__u8 file_type;
+};
+
+struct dx_countlimit {
+	__u16 limit;
+	__u16 count;
+};
+
+/* In the first entry of a block, 'hash' is taken by the dx_countlimit */
+struct dx_entry {
+	__u32 hash;
+	__u32 block;
+};
+
+struct dx_root {
+	struct fake_dirent dot;
+	char dot_name[4];
+	struct fake_dirent dotdot;
+	char dotdot_name[4];
+	struct dx_root_info {
+		__u32 reserved_zero;
+		__u8 hash_version;
+		__u8 info_length;	/* 8 */
+		__u8 indirect_levels;
+		__u8 unused_flags;
+	} info;
+	struct dx_entry entries[0];
+};
+
+struct dx_node {
+	struct fake_dirent fake;
+	struct dx_entry entries[0];
+};
+
+struct dx_frame {
+	struct buffer_head *bh;
+	struct dx_entry *entries;
+	struct dx_entry *at;
+};
+
+struct dx_map_entry {
+	__u32 hash;
+	__u32 offs;
+};
+
+static inline int is_dx(struct inode *dir)
+{
+	return EXT2_HAS_COMPAT_FEATURE(dir->i_sb, EXT2_FEATURE_COMPAT_DIR_INDEX) &&
+	       (dir->u.ext2_i.i_flags & EXT2_INDEX_FL);
+}
+
+static inline unsigned dx_get_block(struct dx_entry *entry)
+{
+	return le32_to_cpu(entry->block) & 0x00ffffff;
+}
+
+static inline void dx_set_block(struct dx_entry *entry, unsigned value)
+{
+	entry->block = cpu_to_le32(value);
+}
+
+static inline unsigned dx_get_hash(struct dx_entry *entry)
+{
+	return le32_to_cpu(entry->hash);
+}
+
+static inline void dx_set_hash(struct dx_entry *entry, unsigned value)
+{
+	entry->hash = cpu_to_le32(value);
+}
+
+static inline unsigned dx_get_count(struct dx_entry *entries)
+{
+	return le16_to_cpu(((struct dx_countlimit *) entries)->count);
+}
+
+static inline unsigned dx_get_limit(struct dx_entry *entries)
+{
+	return le16_to_cpu(((struct dx_countlimit *) entries)->limit);
+}
+
+static inline void dx_set_count(struct dx_entry *entries, unsigned value)
+{
+	((struct dx_countlimit *) entries)->count = cpu_to_le16(value);
+}
+
+static inline void dx_set_limit(struct dx_entry *entries, unsigned value)
+{
+	((struct dx_countlimit *) entries)->limit = cpu_to_le16(value);
+}
+
+static inline unsigned dx_root_limit(struct inode *dir, unsigned infosize)
+{
+	return (dir->i_sb->s_blocksize - EXT2_DIR_REC_LEN(1) -
+		EXT2_DIR_REC_LEN(2) - infosize) / sizeof(struct dx_entry);
+}
+
+static inline unsigned dx_node_limit(struct inode *dir)
+{
+	return (dir->i_sb->s_blocksize - EXT2_DIR_REC_LEN(0)) /
+		sizeof(struct dx_entry);
+}
+
+/* The low bit is left clear for the continuation flag */
+static u32 dx_hash(const char *name, int len)
+{
+	u32 hash, hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+
+	while (len--) {
+		hash = hash1 + (hash0 ^ (((signed char) *name++) * 7152373));
+		if (hash & 0x80000000)
+			hash -= 0x7fffffff;
+		hash1 = hash0;
+		hash0 = hash;
+	}
+	return hash0 << 1;
+}
+
+/* A directory block has been changed, under ext2_journal_access() */
+static void dirty_dir_block(struct inode *dir, struct buffer_head *bh)
+{
+	ext2_journal_dirty_inode(bh, dir);
+	if (IS_SYNC(dir))
+		ext2_journal_sync(dir->i_sb, bh);
+}
+
+/* Directory operations are one transaction each */
+static inline int ext2_dirop_stop(struct inode *dir, int err)
+{
+	int err2 = ext2_journal_stop(dir->i_sb);
+
+	return err ? err : err2;
+}
+
+static void dx_release(struct dx_frame *frames)
+{
+	struct dx_root *root = (struct dx_root *) frames[0].bh->b_data;
+
+	if (root->info.indirect_levels)
+		brelse(frames[1].bh);
+	brelse(frames[0].bh);
+}
+
+/*
+ * Walk the index down to the leaf for 'hash'. Fills in one frame per
+ * level and returns the last one, or NULL with *err set; ERR_BAD_DX_DIR
+ * if the index does not look right.
+ */
+static struct dx_frame *dx_probe(struct inode *dir, u32 hash,
+				 struct dx_frame *frames, int *err)
+{
+	struct dx_frame *frame = frames;
+	struct dx_entry *entries, *p, *q, *m;
+	struct buffer_head *bh;
+	struct dx_root *root;
+	unsigned count, indirect;
+
+	if (!(bh = ext2_bread (dir, 0, 0, err)))
+		return NULL;
+	root = (struct dx_root *) bh->b_data;
+	if (root->info.reserved_zero ||
+	    root->info.hash_version != DX_HASH_LEGACY ||
+	    root->info.info_length != sizeof(root->info) ||
+	    root->info.indirect_levels > 1) {
+		ext2_warning (dir->i_sb, "dx_probe",
+			      "bad index root in directory #%lu", dir->i_ino);
+		goto bad;
+	}
+	indirect = root->info.indirect_levels;
+	entries = root->entries;
+	if (dx_get_limit(entries) != dx_root_limit(dir, sizeof(root->info))) {
+		ext2_warning (dir->i_sb, "dx_probe",
+			      "bad index limit in directory #%lu", dir->i_ino);
+		goto bad;
+	}
+
+	while (1) {
+		count = dx_get_count(entries);
+		if (!count || count > dx_get_limit(entries)) {
+			ext2_warning (dir->i_sb, "dx_probe",
+				      "bad index count in directory #%lu",
+				      dir->i_ino);
+			goto bad;
+		}
+		p = entries + 1;
+		q = entries + count - 1;
+		while (p <= q) {
+			m = p + (q - p) / 2;
+			if (dx_get_hash(m) > hash)
+				q = m - 1;
+			else
+				p = m + 1;
+		}
+		frame->bh = bh;
+		frame->entries = entries;
+		frame->at = p - 1;
+		if (!indirect--)
+			return frame;
+
+		if (!(bh = ext2_bread (dir, dx_get_block(frame->at), 0, err)))
+			goto fail;
+		entries = ((struct dx_node *) bh->b_data)->entries;
+		frame++;
+		if (dx_get_limit(entries) != dx_node_limit(dir)) {
+			ext2_warning (dir->i_sb, "dx_probe",
+				      "bad index node in directory #%lu",
+				      dir->i_ino);
+			goto bad;
+		}
+	}
+
+bad:
+	brelse(bh);
+	*err = ERR_BAD_DX_DIR;
+fail:
+	while (frame-- != frames)
+		brelse(frame->bh);
+	return NULL;
+}
+
+/*
+ * The names hashing to 'hash' may go on in the next leaf: if so, move
+ * the frames on to it and return 1. 0 if not, < 0 on error.
+ */
+static int dx_next_leaf(struct inode *dir, u32 hash,
+			struct dx_frame *frame, struct dx_frame *frames)
+{
+	struct dx_frame *p = frame;
+	struct buffer_head *bh;
+	int err, levels = 0;
+	u32 bhash;
+
+	while (1) {
+		if (++p->at < p->entries + dx_get_count(p->entries))
+			break;
+		if (p == frames)
+			return 0;
+		levels++;
+		p--;
+	}
+	bhash = dx_get_hash(p->at);
+	if (!(bhash & 1) || (bhash & ~1) != hash)
+		return 0;
+
+	while (levels--) {
+		if (!(bh = ext2_bread (dir, dx_get_block(p->at), 0, &err)))
+			return err;
+		p++;
+		brelse(p->bh);
+		p->bh = bh;
+		p->at = p->entries = ((struct dx_node *) bh->b_data)->entries;
+	}
+	return 1;
+}
+
+/* Put a new index entry right after frame->at; the caller made room */
+static void dx_insert_block(struct dx_frame *frame, u32 hash, u32 block)
+{
+	struct dx_entry *entries = frame->entries;
+	struct dx_entry *new = frame->at + 1;
+	int count = dx_get_count(entries);
+
+	memmove(new + 1, new, (char *) (entries + count) - (char *) new);
+	dx_set_hash(new, hash);
+	dx_set_block(new, block);
+	dx_set_count(entries, count + 1);
+}
+
+static struct buffer_head *ext2_append(struct inode *dir,
+				       unsigned long *block, int *err)
+{
+	struct buffer_head *bh;
+
+	*block = dir->i_size >> EXT2_BLOCK_SIZE_BITS(dir->i_sb);
+	bh = ext2_bread (dir, *block, 1, err);
+	if (bh) {
+		dir->i_size += dir->i_sb->s_blocksize;
+		mark_inode_dirty(dir);
+	}
+	return bh;
+}
+
+/* Lay the names in map[] out one after the other, filling the block */
+static void dx_pack(char *to, char *from, struct dx_map_entry *map,
+		    int count, unsigned blocksize)
+{
+	struct ext2_dir_entry_2 *de = NULL, *src;
+	char *p = to;
+	unsigned len;
+
+	while (count--) {
+		src = (struct ext2_dir_entry_2 *) (from + map->offs);
+		len = EXT2_DIR_REC_LEN(src->name_len);
+		memcpy(p, src, len);
+		de = (struct ext2_dir_entry_2 *) p;
+		de->rec_len = cpu_to_le16(len);
+		p += len;
+		map++;
+	}
+	de->rec_len = cpu_to_le16(to + blocksize - (char *) de);
+}
+
+/*
+ * Split the full leaf *bh (block *block of the directory) in two by hash
+ * order, sorting out the deleted entries on the way, and put the new
+ * leaf into the index after frame->at. *bh and *block are left at the
+ * half 'hash' belongs in. The halves hold about the same number of
+ * bytes, not of names, so that long names do not all land on one side.
+ */
+static int dx_split_leaf(struct inode *dir, struct buffer_head **bh,
+			 unsigned long *block, struct dx_frame *frame, u32 hash)
+{
+	unsigned blocksize = dir->i_sb->s_blocksize;
+	struct dx_map_entry *map, tmp;
+	struct ext2_dir_entry_2 *de;
+	struct buffer_head *bh2;
+	unsigned long newblock;
+	int count = 0, split, gap, i, j, err;
+	unsigned size, used;
+	char *copy, *p;
+	u32 hash2;
+
+	copy = kmalloc(blocksize + sizeof(*map) * (blocksize / EXT2_DIR_REC_LEN(1)),
+		       GFP_KERNEL);
+	if (!copy)
+		return -ENOMEM;
+	map = (struct dx_map_entry *) (copy + blocksize);
+
+	memcpy(copy, (*bh)->b_data, blocksize);
+	err = -EIO;
+	for (p = (*bh)->b_data; p < (*bh)->b_data + blocksize;
+	     p += le16_to_cpu(de->rec_len)) {
+		de = (struct ext2_dir_entry_2 *) p;
+		if (!ext2_check_dir_entry ("dx_split_leaf", dir, de, *bh,
+					   p - (*bh)->b_data))
+			goto out;
+		if (!de->inode)
+			continue;
+		map[count].hash = dx_hash(de->name, de->name_len);
+		map[count].offs = p - (*bh)->b_data;
+		count++;
+	}
+	err = -ENOSPC;
+	if (count < 2)
+		goto out;
+
+	err = ext2_journal_access(dir->i_sb, *bh);
+	if (!err)
+		err = ext2_journal_access(dir->i_sb, frame->bh);
+	if (err)
+		goto out;
+	bh2 = ext2_append(dir, &newblock, &err);
+	if (!bh2)
+		goto out;
+	err = ext2_journal_access(dir->i_sb, bh2);
+	if (err) {
+		brelse(bh2);
+		goto out;
+	}
+
+	/* Shell sort on the hash; there are a few hundred at most */
+	for (gap = count / 2; gap > 0; gap /= 2)
+		for (i = gap; i < count; i++)
+			for (j = i - gap; j >= 0 && map[j].hash > map[j+gap].hash; j -= gap) {
+				tmp = map[j];
+				map[j] = map[j+gap];
+				map[j+gap] = tmp;
+			}
+
+#define MAP_REC_LEN(m) \
+	EXT2_DIR_REC_LEN(((struct ext2_dir_entry_2 *) (copy + (m).offs))->name_len)
+	for (i = 0, size = 0; i < count; i++)
+		size += MAP_REC_LEN(map[i]);
+	for (split = 0, used = 0; used < size / 2; split++)
+		used += MAP_REC_LEN(map[split]);
+	if (split == count)
+		split--;
+#undef MAP_REC_LEN
+	hash2 = map[split].hash;
+	dx_pack((*bh)->b_data, copy, map, split, blocksize);
+	dx_pack(bh2->b_data, copy, map + split, count - split, blocksize);
+	/* a hash value on both sides continues in the new leaf */
+	dx_insert_block(frame, hash2 | (map[split-1].hash == hash2), newblock);
+
+	dirty_dir_block(dir, *bh);
+	dirty_dir_block(dir, bh2);
+	dirty_dir_block(dir, frame->bh);
+	if (hash >= hash2) {
+		brelse(*bh);
+		*bh = bh2;
+		*block = newblock;
+	} else
+		brelse(bh2);
+	err = 0;
+out:
+	kfree(copy);
+	return err;
+}
+
+/*
+ * The index block of 'frame' is full: make room in it. At the root we
+ * add a level, below it we split the node.
+ */
+static int dx_grow_index(struct inode *dir, struct dx_frame *frames,
+			 struct dx_frame **framep)
+{
+	struct dx_frame *frame = *framep;
+	struct dx_entry *entries = frame->entries, *entries2;
+	struct dx_root *root = (struct dx_root *) frames[0].bh->b_data;
+	struct buffer_head *bh2;
+	unsigned long newblock;
+	unsigned count = dx_get_count(entries), count1;
+	int err;
+
+	if (frame != frames &&
+	    dx_get_count(frames[0].entries) == dx_get_limit(frames[0].entries)) {
+		ext2_warning (dir->i_sb, "dx_grow_index",
+			      "directory #%lu index full", dir->i_ino);
+		return -ENOSPC;
+	}
+
+	bh2 = ext2_append(dir, &newblock, &err);
+	if (!bh2)
+		return err;
+	err = ext2_journal_access(dir->i_sb, bh2);
+	if (!err)
+		err = ext2_journal_access(dir->i_sb, frame->bh);
+	if (!err && frame != frames)
+		err = ext2_journal_access(dir->i_sb, frames[0].bh);
+	if (err) {
+		brelse(bh2);
+		return err;
+	}
+	memset(bh2->b_data, 0, sizeof(struct fake_dirent));
+	((struct dx_node *) bh2->b_data)->fake.rec_len =
+		cpu_to_le16(dir->i_sb->s_blocksize);
+	entries2 = ((struct dx_node *) bh2->b_data)->entries;
+
+	if (frame == frames) {
+		/* Move everything down into the new node */
+		memcpy(entries2, entries, count * sizeof(struct dx_entry));
+		dx_set_limit(entries2, dx_node_limit(dir));
+		dx_set_count(entries, 1);
+		dx_set_block(entries, newblock);
+		root->info.indirect_levels = 1;
+		frames[1].bh = bh2;
+		frames[1].entries = entries2;
+		frames[1].at = entries2 + (frame->at - entries);
+		frame->at = entries;
+		dirty_dir_block(dir, frame->bh);
+		dirty_dir_block(dir, bh2);
+		*framep = frames + 1;
+		return 0;
+	}
+
+	/* Split the node, and carry on in the half holding frame->at */
+	count1 = count / 2;
+	memcpy(entries2, entries + count1, (count - count1) * sizeof(struct dx_entry));
+	dx_insert_block(frames, dx_get_hash(entries + count1), newblock);
+	dx_set_count(entries, count1);
+	dx_set_count(entries2, count - count1);
+	dx_set_limit(entries2, dx_node_limit(dir));
+	dirty_dir_block(dir, frames[0].bh);
+	dirty_dir_block(dir, frame->bh);
+	dirty_dir_block(dir, bh2);
+	if (frame->at - entries >= count1) {
+		frame->at = entries2 + (frame->at - entries - count1);
+		frame->entries = entries2;
+		brelse(frame->bh);
+		frame->bh = bh2;
+	} else
+		brelse(bh2);
+	return 0;
+}
+
+/*
+ * Look for a name in one directory block: 1 and *res_dir set if it is
+ * there, 0 if not, -1 if the block is corrupt.
+ */
+static inline int search_dirblock(struct buffer_head * bh, struct inode * dir,
+				  const char * const name, int namelen,
+				  unsigned long offset,
+				  struct ext2_dir_entry_2 ** res_dir)
+{
+	struct ext2_dir_entry_2 * de;
+	char * dlimit;
+	int de_len;
+
+	de = (struct ext2_dir_entry_2 *) bh->b_data;
+	dlimit = bh->b_data + dir->i_sb->s_blocksize;
+	while ((char *) de < dlimit) {
+		/* this code is executed quadratically often */
+		/* do minimal checking `by hand' */
+
+		if ((char *) de + namelen <= dlimit &&
+		    ext2_match (namelen, name, de)) {
+			/* found a match -
+			   just to be sure, do a full check */
+			if (!ext2_check_dir_entry("ext2_find_entry",
+						  dir, de, bh, offset))
+				return -1;
+			*res_dir = de;
+			return 1;
+		}
+		/* prevent looping on a bad block */
+		de_len = le16_to_cpu(de->rec_len);
+		if (de_len <= 0)
+			return -1;
+		offset += de_len;
+		de = (struct ext2_dir_entry_2 *) ((char *) de + de_len);
+	}
+	return 0;
+}
+
+static struct buffer_head * dx_find_entry(struct inode * dir,
+					  const char * const name, int namelen,
+					  struct ext2_dir_entry_2 ** res_dir,
+					  int * err)
+{
+	struct dx_frame frames[2], *frame;
+	struct buffer_head * bh;
+	unsigned long block;
+	u32 hash = dx_hash(name, namelen);
+	int retval;
+
+	if (!(frame = dx_probe(dir, hash, frames, err)))
+		return NULL;
+	do {
+		block = dx_get_block(frame->at);
+		if (!(bh = ext2_bread (dir, block, 0, err)))
+			goto out;
+		retval = search_dirblock(bh, dir, name, namelen,
+				block << EXT2_BLOCK_SIZE_BITS(dir->i_sb), res_dir);
+		if (retval > 0) {
+			dx_release(frames);
+			return bh;
+		}
+		brelse (bh);
+		if (retval < 0) {
+			*err = -EIO;
+			goto out;
+		}
+		retval = dx_next_leaf(dir, hash, frame, frames);
+		if (retval < 0) {
+			*err = retval;
+			goto out;
+		}
+	} while (retval);
+	*err = -ENOENT;
+out:
+	dx_release(frames);
+	return NULL;
+}
+
 /*
  *	ext2_find_entry()
  *
@@ -73,6 +652,15 @@ static struct buffer_head * ext2_find_entry (struct inode * dir,
 	if (namelen > EXT2_NAME_LEN)
 		return NULL;
 
+	if (is_dx(dir)) {
+		struct buffer_head * bh;
+
+		bh = dx_find_entry(dir, name, namelen, res_dir, &err);
+		/* a broken index is no reason not to find the name */
+		if (bh || err != ERR_BAD_DX_DIR)
+			return bh;
+	}
+
 	memset (bh_use, 0, sizeof (bh_use));
 	toread = 0;
 	for (block = 0; block < NAMEI_RA_SIZE; ++block) {
@@ -88,8 +676,6 @@ static struct buffer_head * ext2_find_entry (struct inode * dir,
 
 	for (block = 0, offset = 0; offset < dir->i_size; block++) {
 		struct buffer_head * bh;
-		struct ext2_dir_entry_2 * de;
-		char * dlimit;
 
 		if ((block % NAMEI_RA_BLOCKS) == 0 && toread) {
 			ll_rw_block (READ, toread, bh_read);
@@ -113,35 +699,17 @@ static struct buffer_head * ext2_find_entry (struct inode * dir,
 			break;
 		}
 
-		de = (struct ext2_dir_entry_2 *) bh->b_data;
-		dlimit = bh->b_data + sb->s_blocksize;
-		while ((char *) de < dlimit) {
-			/* this code is executed quadratically often */
-			/* do minimal checking `by hand' */
-			int de_len;
-
-			if ((char *) de + namelen <= dlimit &&
-			    ext2_match (namelen, name, de)) {
-				/* found a match -
-				   just to be sure, do a full check */
-				if (!ext2_check_dir_entry("ext2_find_entry",
-							  dir, de, bh, offset))
-					goto failure;
-				for (i = 0; i < NAMEI_RA_SIZE; ++i) {
-					if (bh_use[i] != bh)
-						brelse (bh_use[i]);
-				}
-				*res_dir = de;
-				return bh;
+		i = search_dirblock(bh, dir, name, namelen, offset, res_dir);
+		if (i > 0) {
+			for (i = 0; i < NAMEI_RA_SIZE; ++i) {
+				if (bh_use[i] != bh)
+					brelse (bh_use[i]);
 			}
-			/* prevent looping on a bad block */
-			de_len = le16_to_cpu(de->rec_len);
-			if (de_len <= 0)
-				goto failure;
-			offset += de_len;
-			de = (struct ext2_dir_entry_2 *)
-				((char *) de + de_len);
+			return bh;
 		}
+		if (i < 0)
+			goto failure;
+		offset += sb->s_blocksize;
 
 		brelse (bh);
 		if (((block + NAMEI_RA_SIZE) << EXT2_BLOCK_SIZE_BITS (sb)) >=
@@ -202,113 +770,250 @@ static inline void ext2_set_de_type(struct super_block *sb,
 }
 
 /*
- *	ext2_add_entry()
- *
- * adds a file entry to the specified directory.
+ * Put a new entry into directory block 'bh', which starts at 'offset'
+ * in the directory, if there is room for it. Returns -ENOSPC if there
+ * is not; otherwise bh has been released.
  */
-int ext2_add_entry (struct inode * dir, const char * name, int namelen,
-		    struct inode *inode)
+static int add_dirent_to_buf (struct inode * dir, const char * name, int namelen,
+			      struct inode * inode, struct buffer_head * bh,
+			      unsigned long offset)
 {
-	unsigned long offset;
-	unsigned short rec_len;
-	struct buffer_head * bh;
+	unsigned short rec_len = EXT2_DIR_REC_LEN(namelen);
 	struct ext2_dir_entry_2 * de, * de1;
-	struct super_block * sb;
-	int	retval;
-
-	sb = dir->i_sb;
+	char * top = bh->b_data + dir->i_sb->s_blocksize;
+	int err;
 
-	if (!namelen)
-		return -EINVAL;
-	bh = ext2_bread (dir, 0, 0, &retval);
-	if (!bh)
-		return retval;
-	rec_len = EXT2_DIR_REC_LEN(namelen);
-	offset = 0;
 	de = (struct ext2_dir_entry_2 *) bh->b_data;
 	while (1) {
-		if ((char *)de >= sb->s_blocksize + bh->b_data) {
-			brelse (bh);
-			bh = NULL;
-			bh = ext2_bread (dir, offset >> EXT2_BLOCK_SIZE_BITS(sb), 1, &retval);
-			if (!bh)
-				return retval;
-			if (dir->i_size <= offset) {
-				if (dir->i_size == 0) {
-					return -ENOENT;
-				}
-
-				ext2_debug ("creating next block\n");
-
-				de = (struct ext2_dir_entry_2 *) bh->b_data;
-				de->inode = 0;
-				de->rec_len = le16_to_cpu(sb->s_blocksize);
-				dir->i_size = offset + sb->s_blocksize;
-				dir->u.ext2_i.i_flags &= ~EXT2_BTREE_FL;
-				mark_inode_dirty(dir);
-			} else {
-
-				ext2_debug ("skipping to next block\n");
-
-				de = (struct ext2_dir_entry_2 *) bh->b_data;
-			}
-		}
+		if ((char *) de >= top)
+			return -ENOSPC;
 		if (!ext2_check_dir_entry ("ext2_add_entry", dir, de, bh,
 					   offset)) {
 			brelse (bh);
 			return -ENOENT;
 		}
 		if (ext2_match (namelen, name, de)) {
-				brelse (bh);
-				return -EEXIST;
+			brelse (bh);
+			return -EEXIST;
 		}
 		if ((le32_to_cpu(de->inode) == 0 && le16_to_cpu(de->rec_len) >= rec_len) ||
-		    (le16_to_cpu(de->rec_len) >= EXT2_DIR_REC_LEN(de->name_len) + rec_len)) {
-			offset += le16_to_cpu(de->rec_len);
-			if (le32_to_cpu(de->inode)) {
-				de1 = (struct ext2_dir_entry_2 *) ((char *) de +
-					EXT2_DIR_REC_LEN(de->name_len));
-				de1->rec_len = cpu_to_le16(le16_to_cpu(de->rec_len) -
-					EXT2_DIR_REC_LEN(de->name_len));
-				de->rec_len = cpu_to_le16(EXT2_DIR_REC_LEN(de->name_len));
-				de = de1;
-			}
-			de->file_type = EXT2_FT_UNKNOWN;
-			if (inode) {
-				de->inode = cpu_to_le32(inode->i_ino);
-				ext2_set_de_type(dir->i_sb, de, inode->i_mode);
-			} else
-				de->inode = 0;
-			de->name_len = namelen;
-			memcpy (de->name, name, namelen);
-			/*
-			 * XXX shouldn't update any times until successful
-			 * completion of syscall, but too many callers depend
-			 * on this.
-			 *
-			 * XXX similarly, too many callers depend on
-			 * ext2_new_inode() setting the times, but error
-			 * recovery deletes the inode, so the worst that can
-			 * happen is that the times are slightly out of date
-			 * and/or different from the directory change time.
-			 */
-			dir->i_mtime = dir->i_ctime = CURRENT_TIME;
-			dir->u.ext2_i.i_flags &= ~EXT2_BTREE_FL;
-			mark_inode_dirty(dir);
-			dir->i_version = ++event;
-			mark_buffer_dirty_inode(bh, dir);
-			if (IS_SYNC(dir)) {
-				ll_rw_block (WRITE, 1, &bh);
-				wait_on_buffer (bh);
-			}
-			brelse(bh);
-			return 0;
-		}
+		    (le16_to_cpu(de->rec_len) >= EXT2_DIR_REC_LEN(de->name_len) + rec_len))
+			break;
 		offset += le16_to_cpu(de->rec_len);
 		de = (struct ext2_dir_entry_2 *) ((char *) de + le16_to_cpu(de->rec_len));
 	}
+
+	err = ext2_journal_access(dir->i_sb, bh);
+	if (err) {
+		brelse (bh);
+		return err;
+	}
+	if (le32_to_cpu(de->inode)) {
+		de1 = (struct ext2_dir_entry_2 *) ((char *) de +
+			EXT2_DIR_REC_LEN(de->name_len));
+		de1->rec_len = cpu_to_le16(le16_to_cpu(de->rec_len) -
+			EXT2_DIR_REC_LEN(de->name_len));
+		de->rec_len = cpu_to_le16(EXT2_DIR_REC_LEN(de->name_len));
+		de = de1;
+	}
+	de->file_type = EXT2_FT_UNKNOWN;
+	if (inode) {
+		de->inode = cpu_to_le32(inode->i_ino);
+		ext2_set_de_type(dir->i_sb, de, inode->i_mode);
+	} else
+		de->inode = 0;
+	de->name_len = namelen;
+	memcpy (de->name, name, namelen);
+	/*
+	 * XXX shouldn't update any times until successful
+	 * completion of syscall, but too many callers depend
+	 * on this.
+	 *
+	 * XXX similarly, too many callers depend on
+	 * ext2_new_inode() setting the times, but error
+	 * recovery deletes the inode, so the worst that can
+	 * happen is that the times are slightly out of date
+	 * and/or different from the directory change time.
+	 */
+	dir->i_mtime = dir->i_ctime = CURRENT_TIME;
+	mark_inode_dirty(dir);
+	dir->i_version = ++event;
+	dirty_dir_block(dir, bh);
+	brelse(bh);
+	return 0;
+}
+
+static int dx_add_entry (struct inode * dir, const char * name, int namelen,
+			 struct inode * inode)
+{
+	struct dx_frame frames[2], *frame;
+	struct buffer_head * bh;
+	unsigned long block;
+	u32 hash = dx_hash(name, namelen);
+	int splits = 0, err;
+
+again:
+	if (!(frame = dx_probe(dir, hash, frames, &err)))
+		return err;
+	block = dx_get_block(frame->at);
+	if (!(bh = ext2_bread (dir, block, 0, &err)))
+		goto out;
+	err = add_dirent_to_buf(dir, name, namelen, inode, bh,
+				block << EXT2_BLOCK_SIZE_BITS(dir->i_sb));
+	if (err != -ENOSPC)
+		goto out;
+
+	/* The leaf is full: split it, making room in the index first */
+	if (dx_get_count(frame->entries) == dx_get_limit(frame->entries)) {
+		err = dx_grow_index(dir, frames, &frame);
+		if (err)
+			goto out_brelse;
+	}
+	err = dx_split_leaf(dir, &bh, &block, frame, hash);
+	if (err)
+		goto out_brelse;
+	err = add_dirent_to_buf(dir, name, namelen, inode, bh,
+				block << EXT2_BLOCK_SIZE_BITS(dir->i_sb));
+	/*
+	 * The half we landed in can still be short of room for a long
+	 * name when the crossing entry was long too: split it once more.
+	 * Two splits always leave room, and stay within the credits of
+	 * EXT2_DIROP_TRANS_BLOCKS.
+	 */
+	if (err == -ENOSPC && !splits++) {
+		brelse(bh);
+		dx_release(frames);
+		goto again;
+	}
+out_brelse:
 	brelse (bh);
-	return -ENOSPC;
+out:
+	dx_release(frames);
+	return err;
+}
+
+/*
+ * A directory of one block has filled up: move the names out into a
+ * leaf of their own, and put the root of an index into block 0.
+ */
+static int dx_make_indexed (struct inode * dir, struct buffer_head * bh)
+{
+	unsigned blocksize = dir->i_sb->s_blocksize;
+	struct dx_root * root = (struct dx_root *) bh->b_data;
+	struct ext2_dir_entry_2 * de;
+	struct buffer_head * bh2;
+	unsigned long block;
+	char * data;
+	unsigned len;
+	int err;
+
+	de = (struct ext2_dir_entry_2 *) &root->dotdot;
+	if (le16_to_cpu(root->dot.rec_len) != EXT2_DIR_REC_LEN(1) ||
+	    de->name_len != 2 || memcmp(de->name, "..", 2))
+		return -EIO;
+	data = (char *) de + le16_to_cpu(de->rec_len);
+	len = bh->b_data + blocksize - data;
+	if (!len)
+		return -ENOSPC;
+
+	err = ext2_journal_access(dir->i_sb, bh);
+	if (err)
+		return err;
+	bh2 = ext2_append(dir, &block, &err);
+	if (!bh2)
+		return err;
+	err = ext2_journal_access(dir->i_sb, bh2);
+	if (err) {
+		brelse (bh2);
+		return err;
+	}
+	memcpy(bh2->b_data, data, len);
+	/* the last name takes up what is left of the new block */
+	de = (struct ext2_dir_entry_2 *) bh2->b_data;
+	while ((char *) de + le16_to_cpu(de->rec_len) < bh2->b_data + len)
+		de = (struct ext2_dir_entry_2 *) ((char *) de + le16_to_cpu(de->rec_len));
+	de->rec_len = cpu_to_le16(bh2->b_data + blocksize - (char *) de);
+
+	root->dotdot.rec_len = cpu_to_le16(blocksize - EXT2_DIR_REC_LEN(1));
+	memset(&root->info, 0, sizeof(root->info));
+	root->info.info_length = sizeof(root->info);
+	root->info.hash_version = DX_HASH_LEGACY;
+	dx_set_block(root->entries, block);
+	dx_set_count(root->entries, 1);
+	dx_set_limit(root->entries, dx_root_limit(dir, sizeof(root->info)));
+
+	dir->u.ext2_i.i_flags |= EXT2_INDEX_FL;
+	mark_inode_dirty(dir);
+	dirty_dir_block(dir, bh2);
+	dirty_dir_block(dir, bh);
+	brelse (bh2);
+	return 0;
+}
+
+/*
+ *	ext2_add_entry()
+ *
+ * adds a file entry to the specified directory.
+ */
+int ext2_add_entry (struct inode * dir, const char * name, int namelen,
+		    struct inode *inode)
+{
+	struct super_block * sb = dir->i_sb;
+	struct buffer_head * bh;
+	struct ext2_dir_entry_2 * de;
+	unsigned long block, blocks;
+	int retval;
+
+	if (!namelen)
+		return -EINVAL;
+	if (!dir->i_size)
+		return -ENOENT;
+
+	if (is_dx(dir)) {
+		retval = dx_add_entry(dir, name, namelen, inode);
+		if (retval != ERR_BAD_DX_DIR)
+			return retval;
+	}
+	/* Not keeping the index up to date here: whatever there is goes */
+	if (dir->u.ext2_i.i_flags & EXT2_INDEX_FL) {
+		dir->u.ext2_i.i_flags &= ~EXT2_INDEX_FL;
+		mark_inode_dirty(dir);
+	}
+
+	blocks = dir->i_size >> EXT2_BLOCK_SIZE_BITS(sb);
+	for (block = 0; block < blocks; block++) {
+		/* fill in holes, except at the start */
+		bh = ext2_bread (dir, block, block > 0, &retval);
+		if (!bh)
+			return retval;
+		retval = add_dirent_to_buf(dir, name, namelen, inode, bh,
+					   block << EXT2_BLOCK_SIZE_BITS(sb));
+		if (retval != -ENOSPC)
+			return retval;
+		if (blocks == 1 &&
+		    EXT2_HAS_COMPAT_FEATURE(sb, EXT2_FEATURE_COMPAT_DIR_INDEX) &&
+		    !dx_make_indexed(dir, bh)) {
+			brelse (bh);
+			return dx_add_entry(dir, name, namelen, inode);
+		}
+		brelse (bh);
+	}
+
+	ext2_debug ("creating next block\n");
+
+	bh = ext2_append(dir, &block, &retval);
+	if (!bh)
+		return retval;
+	retval = ext2_journal_access(sb, bh);
+	if (retval) {
+		brelse (bh);
+		return retval;
+	}
+	de = (struct ext2_dir_entry_2 *) bh->b_data;
+	de->inode = 0;
+	de->rec_len = cpu_to_le16(sb->s_blocksize);
+	return add_dirent_to_buf(dir, name, namelen, inode, bh,
+				 block << EXT2_BLOCK_SIZE_BITS(sb));
 }
 
 /*
@@ -320,7 +1025,7 @@ static int ext2_delete_entry (struct inode * dir,
 			      struct buffer_head * bh)
 {
 	struct ext2_dir_entry_2 * de, * pde;
-	int i;
+	int i, err;
 
 	i = 0;
 	pde = NULL;
@@ -330,6 +1035,9 @@ static int ext2_delete_entry (struct inode * dir,
 					   de, bh, i))
 			return -EIO;
 		if (de == de_del)  {
+			err = ext2_journal_access(dir->i_sb, bh);
+			if (err)
+				return err;
 			if (pde)
 				pde->rec_len =
 					cpu_to_le16(le16_to_cpu(pde->rec_len) +
@@ -337,11 +1045,7 @@ static int ext2_delete_entry (struct inode * dir,
 			else
 				de->inode = 0;
 			dir->i_version = ++event;
-			mark_buffer_dirty_inode(bh, dir);
-			if (IS_SYNC(dir)) {
-				ll_rw_block (WRITE, 1, &bh);
-				wait_on_buffer (bh);
-			}
+			dirty_dir_block(dir, bh);
 			return 0;
 		}
 		i += le16_to_cpu(de->rec_len);
@@ -361,15 +1065,21 @@ static int ext2_delete_entry (struct inode * dir,
  */
 static int ext2_create (struct inode * dir, struct dentry * dentry, int mode)
 {
-	struct inode * inode = ext2_new_inode (dir, mode);
-	int err = PTR_ERR(inode);
-	if (IS_ERR(inode))
+	struct inode * inode;
+	int err = ext2_journal_start(dir->i_sb, EXT2_DIROP_TRANS_BLOCKS);
+
+	if (err)
 		return err;
+	inode = ext2_new_inode (dir, mode);
+	err = PTR_ERR(inode);
+	if (IS_ERR(inode))
+		goto out;
 
 	inode->i_op = &ext2_file_inode_operations;
 	inode->i_fop = &ext2_file_operations;
 	inode->i_mapping->a_ops = &ext2_aops;
 	inode->i_mode = mode;
+	ext2_init_inline(inode);
 	mark_inode_dirty(inode);
 	err = ext2_add_entry (dir, dentry->d_name.name, dentry->d_name.len, 
 			     inode);
@@ -377,19 +1087,24 @@ static int ext2_create (struct inode * dir, struct dentry * dentry, int mode)
 		inode->i_nlink--;
 		mark_inode_dirty(inode);
 		iput (inode);
-		return err;
+		goto out;
 	}
 	d_instantiate(dentry, inode);
-	return 0;
+out:
+	return ext2_dirop_stop(dir, err);
 }
 
 static int ext2_mknod (struct inode * dir, struct dentry *dentry, int mode, int rdev)
 {
-	struct inode * inode = ext2_new_inode (dir, mode);
-	int err = PTR_ERR(inode);
+	struct inode * inode;
+	int err = ext2_journal_start(dir->i_sb, EXT2_DIROP_TRANS_BLOCKS);
 
-	if (IS_ERR(inode))
+	if (err)
 		return err;
+	inode = ext2_new_inode (dir, mode);
+	err = PTR_ERR(inode);
+	if (IS_ERR(inode))
+		goto out;
 
 	inode->i_uid = current->fsuid;
 	init_special_inode(inode, mode, rdev);
@@ -399,13 +1114,14 @@ static int ext2_mknod (struct inode * dir, struct dentry *dentry, int mode, int
 		goto out_no_entry;
 	mark_inode_dirty(inode);
 	d_instantiate(dentry, inode);
-	return 0;
+	goto out;
 
 out_no_entry:
 	inode->i_nlink--;
 	mark_inode_dirty(inode);
 	iput(inode);
-	return err;
+out:
+	return ext2_dirop_stop(dir, err);
 }
 
 static int ext2_mkdir(struct inode * dir, struct dentry * dentry, int mode)
@@ -418,21 +1134,29 @@ static int ext2_mkdir(struct inode * dir, struct dentry * dentry, int mode)
 	if (dir->i_nlink >= EXT2_LINK_MAX)
 		return -EMLINK;
 
+	err = ext2_journal_start(dir->i_sb, EXT2_DIROP_TRANS_BLOCKS);
+	if (err)
+		return err;
 	inode = ext2_new_inode (dir, S_IFDIR);
 	err = PTR_ERR(inode);
 	if (IS_ERR(inode))
-		return err;
+		goto out;
 
 	inode->i_op = &ext2_dir_inode_operations;
 	inode->i_fop = &ext2_dir_operations;
 	inode->i_size = inode->i_sb->s_blocksize;
 	inode->i_blocks = 0;	
 	dir_block = ext2_bread (inode, 0, 1, &err);
-	if (!dir_block) {
+	if (dir_block) {
+		err = ext2_journal_access(dir->i_sb, dir_block);
+		if (err)
+			brelse (dir_block);
+	}
+	if (!dir_block || err) {
 		inode->i_nlink--; /* is this nlink == 0? */
 		mark_inode_dirty(inode);
 		iput (inode);
-		return err;
+		goto out;
 	}
 	de = (struct ext2_dir_entry_2 *) dir_block->b_data;
 	de->inode = cpu_to_le32(inode->i_ino);
@@ -447,7 +1171,7 @@ static int ext2_mkdir(struct inode * dir, struct dentry * dentry, int mode)
 	strcpy (de->name, "..");
 	ext2_set_de_type(dir->i_sb, de, S_IFDIR);
 	inode->i_nlink = 2;
-	mark_buffer_dirty_inode(dir_block, dir);
+	dirty_dir_block(dir, dir_block);
 	brelse (dir_block);
 	inode->i_mode = S_IFDIR | mode;
 	if (dir->i_mode & S_ISGID)
@@ -458,16 +1182,16 @@ static int ext2_mkdir(struct inode * dir, struct dentry * dentry, int mode)
 	if (err)
 		goto out_no_entry;
 	dir->i_nlink++;
-	dir->u.ext2_i.i_flags &= ~EXT2_BTREE_FL;
 	mark_inode_dirty(dir);
 	d_instantiate(dentry, inode);
-	return 0;
+	goto out;
 
 out_no_entry:
 	inode->i_nlink = 0;
 	mark_inode_dirty(inode);
 	iput (inode);
-	return err;
+out:
+	return ext2_dirop_stop(dir, err);
 }
 
 /*
@@ -539,6 +1263,9 @@ static int ext2_rmdir (struct inode * dir, struct dentry *dentry)
 	struct buffer_head * bh;
 	struct ext2_dir_entry_2 * de;
 
+	retval = ext2_journal_start(dir->i_sb, EXT2_DIROP_TRANS_BLOCKS);
+	if (retval)
+		return retval;
 	retval = -ENOENT;
 	bh = ext2_find_entry (dir, dentry->d_name.name, dentry->d_name.len, &de);
 	if (!bh)
@@ -568,12 +1295,11 @@ static int ext2_rmdir (struct inode * dir, struct dentry *dentry)
 	mark_inode_dirty(inode);
 	dir->i_nlink--;
 	inode->i_ctime = dir->i_ctime = dir->i_mtime = CURRENT_TIME;
-	dir->u.ext2_i.i_flags &= ~EXT2_BTREE_FL;
 	mark_inode_dirty(dir);
 
 end_rmdir:
 	brelse (bh);
-	return retval;
+	return ext2_dirop_stop(dir, retval);
 }
 
 static int ext2_unlink(struct inode * dir, struct dentry *dentry)
@@ -583,6 +1309,9 @@ static int ext2_unlink(struct inode * dir, struct dentry *dentry)
 	struct buffer_head * bh;
 	struct ext2_dir_entry_2 * de;
 
+	retval = ext2_journal_start(dir->i_sb, EXT2_DIROP_TRANS_BLOCKS);
+	if (retval)
+		return retval;
 	retval = -ENOENT;
 	bh = ext2_find_entry (dir, dentry->d_name.name, dentry->d_name.len, &de);
 	if (!bh)
@@ -605,7 +1334,6 @@ static int ext2_unlink(struct inode * dir, struct dentry *dentry)
 	if (retval)
 		goto end_unlink;
 	dir->i_ctime = dir->i_mtime = CURRENT_TIME;
-	dir->u.ext2_i.i_flags &= ~EXT2_BTREE_FL;
 	mark_inode_dirty(dir);
 	inode->i_nlink--;
 	mark_inode_dirty(inode);
@@ -614,7 +1342,7 @@ static int ext2_unlink(struct inode * dir, struct dentry *dentry)
 
 end_unlink:
 	brelse (bh);
-	return retval;
+	return ext2_dirop_stop(dir, retval);
 }
 
 static int ext2_symlink (struct inode * dir, struct dentry *dentry, const char * symname)
@@ -626,10 +1354,13 @@ static int ext2_symlink (struct inode * dir, struct dentry *dentry, const char *
 	if (l > dir->i_sb->s_blocksize)
 		return -ENAMETOOLONG;
 
+	err = ext2_journal_start(dir->i_sb, EXT2_DIROP_TRANS_BLOCKS);
+	if (err)
+		return err;
 	inode = ext2_new_inode (dir, S_IFLNK);
 	err = PTR_ERR(inode);
 	if (IS_ERR(inode))
-		return err;
+		goto out;
 
 	inode->i_mode = S_IFLNK | S_IRWXUGO;
 
@@ -651,13 +1382,14 @@ static int ext2_symlink (struct inode * dir, struct dentry *dentry, const char *
 	if (err)
 		goto out_no_entry;
 	d_instantiate(dentry, inode);
-	return 0;
+	goto out;
 
 out_no_entry:
 	inode->i_nlink--;
 	mark_inode_dirty(inode);
 	iput (inode);
-	return err;
+out:
+	return ext2_dirop_stop(dir, err);
 }
 
 static int ext2_link (struct dentry * old_dentry,
@@ -672,17 +1404,21 @@ static int ext2_link (struct dentry * old_dentry,
 	if (inode->i_nlink >= EXT2_LINK_MAX)
 		return -EMLINK;
 	
+	err = ext2_journal_start(dir->i_sb, EXT2_DIROP_TRANS_BLOCKS);
+	if (err)
+		return err;
 	err = ext2_add_entry (dir, dentry->d_name.name, dentry->d_name.len, 
 			     inode);
 	if (err)
-		return err;
+		goto out;
 
 	inode->i_nlink++;
 	inode->i_ctime = CURRENT_TIME;
 	mark_inode_dirty(inode);
 	atomic_inc(&inode->i_count);
 	d_instantiate(dentry, inode);
-	return 0;
+out:
+	return ext2_dirop_stop(dir, err);
 }
 
 #define PARENT_INO(buffer) \
@@ -701,6 +1437,9 @@ static int ext2_rename (struct inode * old_dir, struct dentry *old_dentry,
 	struct ext2_dir_entry_2 * old_de, * new_de;
 	int retval;
 
+	retval = ext2_journal_start(old_dir->i_sb, EXT2_RENAME_TRANS_BLOCKS);
+	if (retval)
+		return retval;
 	old_bh = new_bh = dir_bh = NULL;
 
 	old_bh = ext2_find_entry (old_dir, old_dentry->d_name.name, old_dentry->d_name.len, &old_de);
@@ -742,6 +1481,9 @@ static int ext2_rename (struct inode * old_dir, struct dentry *old_dentry,
 		if (!new_inode && new_dir!=old_dir &&
 				new_dir->i_nlink >= EXT2_LINK_MAX)
 			goto end_rename;
+		retval = ext2_journal_access(old_dir->i_sb, dir_bh);
+		if (retval)
+			goto end_rename;
 	}
 	if (!new_bh) {
 		retval = ext2_add_entry (new_dir, new_dentry->d_name.name,
@@ -750,16 +1492,15 @@ static int ext2_rename (struct inode * old_dir, struct dentry *old_dentry,
 		if (retval)
 			goto end_rename;
 	} else {
+		retval = ext2_journal_access(new_dir->i_sb, new_bh);
+		if (retval)
+			goto end_rename;
 		new_de->inode = le32_to_cpu(old_inode->i_ino);
 		if (EXT2_HAS_INCOMPAT_FEATURE(new_dir->i_sb,
 					      EXT2_FEATURE_INCOMPAT_FILETYPE))
 			new_de->file_type = old_de->file_type;
 		new_dir->i_version = ++event;
-		mark_buffer_dirty_inode(new_bh, new_dir);
-		if (IS_SYNC(new_dir)) {
-			ll_rw_block (WRITE, 1, &new_bh);
-			wait_on_buffer (new_bh);
-		}
+		dirty_dir_block(new_dir, new_bh);
 		brelse(new_bh);
 		new_bh = NULL;
 	}
@@ -782,11 +1523,10 @@ static int ext2_rename (struct inode * old_dir, struct dentry *old_dentry,
 		mark_inode_dirty(new_inode);
 	}
 	old_dir->i_ctime = old_dir->i_mtime = CURRENT_TIME;
-	old_dir->u.ext2_i.i_flags &= ~EXT2_BTREE_FL;
 	mark_inode_dirty(old_dir);
 	if (dir_bh) {
 		PARENT_INO(dir_bh->b_data) = le32_to_cpu(new_dir->i_ino);
-		mark_buffer_dirty_inode(dir_bh, old_inode);
+		ext2_journal_dirty_inode(dir_bh, old_inode);
 		old_dir->i_nlink--;
 		mark_inode_dirty(old_dir);
 		if (new_inode) {
@@ -794,7 +1534,6 @@ static int ext2_rename (struct inode * old_dir, struct dentry *old_dentry,
 			mark_inode_dirty(new_inode);
 		} else {
 			new_dir->i_nlink++;
-			new_dir->u.ext2_i.i_flags &= ~EXT2_BTREE_FL;
 			mark_inode_dirty(new_dir);
 		}
 	}
@@ -805,7 +1544,7 @@ end_rename:
 	brelse (dir_bh);
 	brelse (old_bh);
 	brelse (new_bh);
-	return retval;
+	return ext2_dirop_stop(old_dir, retval);
 }
 
 /*
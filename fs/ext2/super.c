@@ -21,9 +21,11 @@
 #include <linux/string.h>
 #include <linux/fs.h>
 #include <linux/ext2_fs.h>
+#include <linux/journal.h>
 #include <linux/slab.h>
 #include <linux/init.h>
 #include <linux/locks.h>
+#include <linux/proc_fs.h>
 #include <asm/uaccess.h>
 
 
@@ -125,6 +127,14 @@ void ext2_put_super (struct super_block * sb)
 	int db_count;
 	int i;
 
+	if (sb->u.ext2_sb.s_journal) {
+		int aborted = is_journal_aborted(sb->u.ext2_sb.s_journal);
+
+		ext2_destroy_journal(sb);
+		/* after an abort the log still holds what it did */
+		if (!aborted && !(sb->s_flags & MS_RDONLY))
+			EXT2_CLEAR_INCOMPAT_FEATURE(sb, EXT2_FEATURE_INCOMPAT_RECOVER);
+	}
 	if (!(sb->s_flags & MS_RDONLY)) {
 		sb->u.ext2_sb.s_es->s_state = le16_to_cpu(sb->u.ext2_sb.s_mount_state);
 		mark_buffer_dirty(sb->u.ext2_sb.s_sbh);
@@ -134,12 +144,7 @@ void ext2_put_super (struct super_block * sb)
 		if (sb->u.ext2_sb.s_group_desc[i])
 			brelse (sb->u.ext2_sb.s_group_desc[i]);
 	kfree(sb->u.ext2_sb.s_group_desc);
-	for (i = 0; i < EXT2_MAX_GROUP_LOADED; i++)
-		if (sb->u.ext2_sb.s_inode_bitmap[i])
-			brelse (sb->u.ext2_sb.s_inode_bitmap[i]);
-	for (i = 0; i < EXT2_MAX_GROUP_LOADED; i++)
-		if (sb->u.ext2_sb.s_block_bitmap[i])
-			brelse (sb->u.ext2_sb.s_block_bitmap[i]);
+	kfree(sb->u.ext2_sb.s_group_info);
 	brelse (sb->u.ext2_sb.s_sbh);
 
 	return;
@@ -148,6 +153,7 @@ void ext2_put_super (struct super_block * sb)
 static struct super_operations ext2_sops = {
 	read_inode:	ext2_read_inode,
 	write_inode:	ext2_write_inode,
+	dirty_inode:	ext2_dirty_inode,
 	put_inode:	ext2_put_inode,
 	delete_inode:	ext2_delete_inode,
 	put_super:	ext2_put_super,
@@ -178,6 +184,22 @@ static int parse_options (char * options, unsigned long * sb_block,
 		else if (!strcmp (this_char, "nouid32")) {
 			set_opt (*mount_options, NO_UID32);
 		}
+		else if (!strcmp (this_char, "delalloc"))
+			set_opt (*mount_options, DELALLOC);
+		else if (!strcmp (this_char, "nodelalloc"))
+			clear_opt (*mount_options, DELALLOC);
+		else if (!strcmp (this_char, "index"))
+			set_opt (*mount_options, INDEX);
+		else if (!strcmp (this_char, "inline"))
+			set_opt (*mount_options, INLINE);
+		else if (!strcmp (this_char, "oldalloc"))
+			set_opt (*mount_options, OLDALLOC);
+		else if (!strcmp (this_char, "orlov"))
+			clear_opt (*mount_options, OLDALLOC);
+		else if (!strcmp (this_char, "nojournal"))
+			set_opt (*mount_options, NOJOURNAL);
+		else if (!strcmp (this_char, "journal"))
+			clear_opt (*mount_options, NOJOURNAL);
 		else if (!strcmp (this_char, "check")) {
 			if (!value || !*value || !strcmp (value, "none"))
 				clear_opt (*mount_options, CHECK);
@@ -307,13 +329,36 @@ static int ext2_setup_super (struct super_block * sb,
 		(le32_to_cpu(es->s_lastcheck) + le32_to_cpu(es->s_checkinterval) <= CURRENT_TIME))
 		printk ("EXT2-fs warning: checktime reached, "
 			"running e2fsck is recommended\n");
-	es->s_state = cpu_to_le16(le16_to_cpu(es->s_state) & ~EXT2_VALID_FS);
+	/* with a journal, replaying the log is all a crash calls for */
+	if (sb->u.ext2_sb.s_journal)
+		EXT2_SET_INCOMPAT_FEATURE(sb, EXT2_FEATURE_INCOMPAT_RECOVER);
+	else
+		es->s_state = cpu_to_le16(le16_to_cpu(es->s_state) & ~EXT2_VALID_FS);
 	if (!(__s16) le16_to_cpu(es->s_max_mnt_count))
 		es->s_max_mnt_count = (__s16) cpu_to_le16(EXT2_DFL_MAX_MNT_COUNT);
 	es->s_mnt_count=cpu_to_le16(le16_to_cpu(es->s_mnt_count) + 1);
 	es->s_mtime = cpu_to_le32(CURRENT_TIME);
+	if (test_opt (sb, INDEX)) {
+		if (le32_to_cpu(es->s_rev_level) == EXT2_GOOD_OLD_REV)
+			printk ("EXT2-fs warning: revision 0 filesystem, "
+				"not turning on directory indexes\n");
+		else
+			EXT2_SET_COMPAT_FEATURE(sb, EXT2_FEATURE_COMPAT_DIR_INDEX);
+	}
+	if (test_opt (sb, INLINE)) {
+		if (le32_to_cpu(es->s_rev_level) == EXT2_GOOD_OLD_REV)
+			printk ("EXT2-fs warning: revision 0 filesystem, "
+				"not turning on inline data\n");
+		else
+			EXT2_SET_INCOMPAT_FEATURE(sb, EXT2_FEATURE_INCOMPAT_INLINE_DATA);
+	}
 	mark_buffer_dirty(sb->u.ext2_sb.s_sbh);
 	sb->s_dirt = 1;
+	if (sb->u.ext2_sb.s_journal) {
+		/* the recovery flag must be on disk before the first commit */
+		ll_rw_block (WRITE, 1, &sb->u.ext2_sb.s_sbh);
+		wait_on_buffer (sb->u.ext2_sb.s_sbh);
+	}
 	if (test_opt (sb, DEBUG))
 		printk ("[EXT II FS %s, %s, bs=%lu, fs=%lu, gc=%lu, "
 			"bpg=%lu, ipg=%lu, mo=%04lx]\n",
@@ -381,6 +426,42 @@ static int ext2_check_descriptors (struct super_block * sb)
 
 #define log2(n) ffz(~(n))
 
+/*
+ * Replay and open the journal, if the filesystem has one.  A log which
+ * needs recovery can not be ignored: it may hold the only good copy of
+ * some metadata.
+ */
+static int ext2_mount_journal (struct super_block * sb)
+{
+	struct ext2_super_block * es = sb->u.ext2_sb.s_es;
+	int recover = EXT2_HAS_INCOMPAT_FEATURE(sb, EXT2_FEATURE_INCOMPAT_RECOVER);
+	int err;
+
+	if (!EXT2_HAS_COMPAT_FEATURE(sb, EXT2_FEATURE_COMPAT_HAS_JOURNAL) ||
+	    test_opt (sb, NOJOURNAL)) {
+		if (recover) {
+			printk ("EXT2-fs: %s: journal needs recovery, "
+				"can not mount without it\n",
+				bdevname(sb->s_dev));
+			return -EINVAL;
+		}
+		return 0;
+	}
+	err = ext2_load_journal(sb);
+	if (err) {
+		printk ("EXT2-fs: %s: error %d loading the journal%s\n",
+			bdevname(sb->s_dev), err,
+			recover ? "" : ", mounting without it");
+		return recover ? err : 0;
+	}
+	/* blocks allocated at writeback would escape the data ordering */
+	clear_opt (sb->u.ext2_sb.s_mount_opt, DELALLOC);
+	/* the superblock is not logged: its free counts may be stale */
+	es->s_free_blocks_count = cpu_to_le32(ext2_count_free_blocks(sb));
+	es->s_free_inodes_count = cpu_to_le32(ext2_count_free_inodes(sb));
+	return 0;
+}
+
 struct super_block * ext2_read_super (struct super_block * sb, void * data,
 				      int silent)
 {
@@ -513,7 +594,11 @@ struct super_block * ext2_read_super (struct super_block * sb, void * data,
 	} else {
 		sb->u.ext2_sb.s_inode_size = le16_to_cpu(es->s_inode_size);
 		sb->u.ext2_sb.s_first_ino = le32_to_cpu(es->s_first_ino);
-		if (sb->u.ext2_sb.s_inode_size != EXT2_GOOD_OLD_INODE_SIZE) {
+		/* larger inodes leave room for inline data */
+		if (sb->u.ext2_sb.s_inode_size < EXT2_GOOD_OLD_INODE_SIZE ||
+		    sb->u.ext2_sb.s_inode_size > sb->s_blocksize ||
+		    (sb->u.ext2_sb.s_inode_size &
+		     (sb->u.ext2_sb.s_inode_size - 1))) {
 			printk ("EXT2-fs: unsupported inode size: %d\n",
 				sb->u.ext2_sb.s_inode_size);
 			goto failed_mount;
@@ -614,25 +699,46 @@ struct super_block * ext2_read_super (struct super_block * sb, void * data,
 		printk ("EXT2-fs: group descriptors corrupted !\n");
 		goto failed_mount;
 	}
-	for (i = 0; i < EXT2_MAX_GROUP_LOADED; i++) {
-		sb->u.ext2_sb.s_inode_bitmap_number[i] = 0;
-		sb->u.ext2_sb.s_inode_bitmap[i] = NULL;
-		sb->u.ext2_sb.s_block_bitmap_number[i] = 0;
-		sb->u.ext2_sb.s_block_bitmap[i] = NULL;
+	sb->u.ext2_sb.s_group_info = kmalloc (sb->u.ext2_sb.s_groups_count *
+					      sizeof (struct ext2_group_info),
+					      GFP_KERNEL);
+	if (sb->u.ext2_sb.s_group_info == NULL) {
+		for (j = 0; j < db_count; j++)
+			brelse (sb->u.ext2_sb.s_group_desc[j]);
+		kfree(sb->u.ext2_sb.s_group_desc);
+		printk ("EXT2-fs: not enough memory\n");
+		goto failed_mount;
+	}
+	/* Nothing is known about the free runs until a bitmap is scanned */
+	for (i = 0; i < sb->u.ext2_sb.s_groups_count; i++) {
+		sb->u.ext2_sb.s_group_info[i].gi_max_run =
+			EXT2_BLOCKS_PER_GROUP(sb);
+		sb->u.ext2_sb.s_group_info[i].gi_debt = 0;
 	}
-	sb->u.ext2_sb.s_loaded_inode_bitmaps = 0;
-	sb->u.ext2_sb.s_loaded_block_bitmaps = 0;
 	sb->u.ext2_sb.s_gdb_count = db_count;
 	/*
 	 * set up enough so that it can read an inode
 	 */
 	sb->s_op = &ext2_sops;
+	sb->u.ext2_sb.s_journal = NULL;
+	sb->u.ext2_sb.s_alloc_map = NULL;
+	if (ext2_mount_journal (sb)) {
+		for (j = 0; j < db_count; j++)
+			brelse (sb->u.ext2_sb.s_group_desc[j]);
+		kfree(sb->u.ext2_sb.s_group_desc);
+		kfree(sb->u.ext2_sb.s_group_info);
+		goto failed_mount;
+	}
+	/* only now that the log has been replayed */
+	sb->u.ext2_sb.s_dir_count = ext2_count_dirs (sb);
 	sb->s_root = d_alloc_root(iget(sb, EXT2_ROOT_INO));
 	if (!sb->s_root) {
+		ext2_destroy_journal(sb);
 		for (i = 0; i < db_count; i++)
 			if (sb->u.ext2_sb.s_group_desc[i])
 				brelse (sb->u.ext2_sb.s_group_desc[i]);
 		kfree(sb->u.ext2_sb.s_group_desc);
+		kfree(sb->u.ext2_sb.s_group_info);
 		brelse (bh);
 		printk ("EXT2-fs: get root inode failed\n");
 		return NULL;
@@ -669,7 +775,9 @@ void ext2_write_super (struct super_block * sb)
 
 		ext2_debug ("setting valid to 0\n");
 
-		if (le16_to_cpu(es->s_state) & EXT2_VALID_FS) {
+		if (sb->u.ext2_sb.s_journal)
+			ext2_start_commit(sb);
+		else if (le16_to_cpu(es->s_state) & EXT2_VALID_FS) {
 			es->s_state = cpu_to_le16(le16_to_cpu(es->s_state) & ~EXT2_VALID_FS);
 			es->s_mtime = cpu_to_le32(CURRENT_TIME);
 		}
@@ -697,10 +805,19 @@ int ext2_remount (struct super_block * sb, int * flags, char * data)
 	sb->u.ext2_sb.s_mount_opt = new_mount_opt;
 	sb->u.ext2_sb.s_resuid = resuid;
 	sb->u.ext2_sb.s_resgid = resgid;
+	if (sb->u.ext2_sb.s_journal)
+		clear_opt (sb->u.ext2_sb.s_mount_opt, DELALLOC);
 	es = sb->u.ext2_sb.s_es;
 	if ((*flags & MS_RDONLY) == (sb->s_flags & MS_RDONLY))
 		return 0;
-	if (*flags & MS_RDONLY) {
+	if (*flags & MS_RDONLY && sb->u.ext2_sb.s_journal) {
+		/* write everything home, leaving nothing to recover */
+		if (!journal_flush(sb->u.ext2_sb.s_journal))
+			EXT2_CLEAR_INCOMPAT_FEATURE(sb, EXT2_FEATURE_INCOMPAT_RECOVER);
+		es->s_mtime = cpu_to_le32(CURRENT_TIME);
+		ext2_commit_super (sb, es);
+	}
+	else if (*flags & MS_RDONLY) {
 		if (le16_to_cpu(es->s_state) & EXT2_VALID_FS ||
 		    !(sb->u.ext2_sb.s_mount_state & EXT2_VALID_FS))
 			return 0;
@@ -774,6 +891,11 @@ int ext2_statfs (struct super_block * sb, struct statfs * buf)
 	buf->f_bsize = sb->s_blocksize;
 	buf->f_blocks = le32_to_cpu(sb->u.ext2_sb.s_es->s_blocks_count) - overhead;
 	buf->f_bfree = ext2_count_free_blocks (sb);
+	/* blocks promised to delayed allocations are as good as used */
+	if (buf->f_bfree > atomic_read(&sb->s_delayed_blocks))
+		buf->f_bfree -= atomic_read(&sb->s_delayed_blocks);
+	else
+		buf->f_bfree = 0;
 	buf->f_bavail = buf->f_bfree - le32_to_cpu(sb->u.ext2_sb.s_es->s_r_blocks_count);
 	if (buf->f_bfree < le32_to_cpu(sb->u.ext2_sb.s_es->s_r_blocks_count))
 		buf->f_bavail = 0;
@@ -783,16 +905,26 @@ int ext2_statfs (struct super_block * sb, struct statfs * buf)
 	return 0;
 }
 
-static DECLARE_FSTYPE_DEV(ext2_fs_type, "ext2", ext2_read_super);
+static DECLARE_FSTYPE(ext2_fs_type, "ext2", ext2_read_super,
+	FS_REQUIRES_DEV|FS_COMPLETE_DIRS);
 
 static int __init init_ext2_fs(void)
 {
+#ifdef CONFIG_PROC_FS
+	if (proc_mkdir("fs/ext2", 0))
+		create_proc_read_entry("fs/ext2/map_cache", 0, 0,
+				       ext2_map_read_proc, NULL);
+#endif
         return register_filesystem(&ext2_fs_type);
 }
 
 static void __exit exit_ext2_fs(void)
 {
 	unregister_filesystem(&ext2_fs_type);
+#ifdef CONFIG_PROC_FS
+	remove_proc_entry("fs/ext2/map_cache", 0);
+	remove_proc_entry("fs/ext2", 0);
+#endif
 }
 
 EXPORT_NO_SYMBOLS;
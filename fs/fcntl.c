@@ -75,10 +75,8 @@ repeat:
 		start = files->next_fd;
 
 	newfd = start;
-	if (start < files->max_fdset) {
-		newfd = find_next_zero_bit(files->open_fds->fds_bits,
-			files->max_fdset, start);
-	}
+	if (start < files->max_fdset)
+		newfd = find_next_fd(files, start);
 	
 	error = -EMFILE;
 	if (newfd >= current->rlim[RLIMIT_NOFILE].rlim_cur)
@@ -107,7 +105,7 @@ out:
 static inline void allocate_fd(struct files_struct *files, 
 					struct file *file, int fd)
 {
-	FD_SET(fd, files->open_fds);
+	__set_open_fd(files, fd);
 	FD_CLR(fd, files->close_on_exec);
 	write_unlock(&files->file_lock);
 	fd_install(fd, file);
@@ -165,7 +163,7 @@ asmlinkage long sys_dup2(unsigned int oldfd, unsigned int newfd)
 		goto out_fput;
 
 	files->fd[newfd] = file;
-	FD_SET(newfd, files->open_fds);
+	__set_open_fd(files, newfd);
 	FD_CLR(newfd, files->close_on_exec);
 	write_unlock(&files->file_lock);
 
@@ -194,7 +192,7 @@ asmlinkage long sys_dup(unsigned int fildes)
 	return ret;
 }
 
-#define SETFL_MASK (O_APPEND | O_NONBLOCK | O_NDELAY | FASYNC)
+#define SETFL_MASK (O_APPEND | O_NONBLOCK | O_NDELAY | FASYNC | O_DIRECT)
 
 static int setfl(int fd, struct file * filp, unsigned long arg)
 {
@@ -208,6 +206,11 @@ static int setfl(int fd, struct file * filp, unsigned long arg)
 	if (!(arg & O_APPEND) && IS_APPEND(inode))
 		return -EPERM;
 
+	/* O_DIRECT on regular files needs support from the filesystem */
+	if ((arg & O_DIRECT) && S_ISREG(inode->i_mode) &&
+	    !inode->i_mapping->a_ops->direct_IO)
+		return -EINVAL;
+
 	/* Did FASYNC state change? */
 	if ((arg ^ filp->f_flags) & FASYNC) {
 		if (filp->f_op && filp->f_op->fasync) {
@@ -11,6 +11,8 @@
 #include <linux/sched.h>
 #include <linux/malloc.h>
 #include <linux/vmalloc.h>
+#include <linux/file.h>
+#include <linux/rcupdate.h>
 
 #include <asm/bitops.h>
 
@@ -51,6 +53,11 @@ void free_fd_array(struct file **array, int num)
 /*
  * Expand the fd array in the files_struct.  Called with the files
  * spinlock held for write.
+ *
+ * fget() reads files->max_fds and then files->fd without the lock, so
+ * the new array is filled in before it is installed, and max_fds is
+ * raised only after that. The old array is freed once every CPU has
+ * scheduled, as a lockless fget() may still be reading it.
  */
 
 int expand_fd_array(struct files_struct *files, int nr)
@@ -98,8 +105,8 @@ int expand_fd_array(struct files_struct *files, int nr)
 		struct file **old_fds;
 		int i;
 		
-		old_fds = xchg(&files->fd, new_fds);
-		i = xchg(&files->max_fds, nfds);
+		old_fds = files->fd;
+		i = files->max_fds;
 
 		/* Don't copy/clear the array if we are creating a new
 		   fd array for fork() */
@@ -108,8 +115,15 @@ int expand_fd_array(struct files_struct *files, int nr)
 			/* clear the remainder of the array */
 			memset(&new_fds[i], 0,
 			       (nfds-i) * sizeof(struct file *)); 
+		}
+		wmb();
+		files->fd = new_fds;
+		wmb();
+		files->max_fds = nfds;
 
+		if (i) {
 			write_unlock(&files->file_lock);
+			synchronize_kernel();
 			free_fd_array(old_fds, i);
 			write_lock(&files->file_lock);
 		}
@@ -157,6 +171,19 @@ void free_fdset(fd_set *array, int num)
 		vfree(array);
 }
 
+static unsigned long * alloc_full_fds_bits(int num)
+{
+	return (unsigned long *) kmalloc(FULL_FDS_LONGS(num) * sizeof(unsigned long),
+					 GFP_KERNEL);
+}
+
+static void free_full_fds_bits(unsigned long *array, int num)
+{
+	if (num <= __FD_SETSIZE) /* Don't free the embedded one */
+		return;
+	kfree(array);
+}
+
 /*
  * Expand the fdset in the files_struct.  Called with the files spinlock
  * held for write.
@@ -164,6 +191,7 @@ void free_fdset(fd_set *array, int num)
 int expand_fdset(struct files_struct *files, int nr)
 {
 	fd_set *new_openset = 0, *new_execset = 0;
+	unsigned long *new_fullset = 0;
 	int error, nfds = 0;
 
 	error = -EMFILE;
@@ -187,8 +215,9 @@ int expand_fdset(struct files_struct *files, int nr)
 	error = -ENOMEM;
 	new_openset = alloc_fdset(nfds);
 	new_execset = alloc_fdset(nfds);
+	new_fullset = alloc_full_fds_bits(nfds);
 	write_lock(&files->file_lock);
-	if (!new_openset || !new_execset)
+	if (!new_openset || !new_execset || !new_fullset)
 		goto out;
 
 	error = 0;
@@ -197,6 +226,7 @@ int expand_fdset(struct files_struct *files, int nr)
 	if (nfds > files->max_fdset) {
 		int i = files->max_fdset / (sizeof(unsigned long) * 8);
 		int count = (nfds - files->max_fdset) / 8;
+		int full = FULL_FDS_LONGS(files->max_fdset);
 		
 		/* 
 		 * Don't copy the entire array if the current fdset is
@@ -207,14 +237,20 @@ int expand_fdset(struct files_struct *files, int nr)
 			memcpy (new_execset, files->close_on_exec, files->max_fdset/8);
 			memset (&new_openset->fds_bits[i], 0, count);
 			memset (&new_execset->fds_bits[i], 0, count);
-		}
+			memcpy (new_fullset, files->full_fds_bits, full * sizeof(unsigned long));
+		} else
+			full = 0;
+		memset (&new_fullset[full], 0,
+			(FULL_FDS_LONGS(nfds) - full) * sizeof(unsigned long));
 		
 		nfds = xchg(&files->max_fdset, nfds);
 		new_openset = xchg(&files->open_fds, new_openset);
 		new_execset = xchg(&files->close_on_exec, new_execset);
+		new_fullset = xchg(&files->full_fds_bits, new_fullset);
 		write_unlock(&files->file_lock);
 		free_fdset (new_openset, nfds);
 		free_fdset (new_execset, nfds);
+		free_full_fds_bits (new_fullset, nfds);
 		write_lock(&files->file_lock);
 		return 0;
 	} 
@@ -226,7 +262,38 @@ out:
 		free_fdset(new_openset, nfds);
 	if (new_execset)
 		free_fdset(new_execset, nfds);
+	if (new_fullset)
+		kfree(new_fullset);
 	write_lock(&files->file_lock);
 	return error;
 }
 
+/*
+ * Find the lowest free descriptor at or above start, or max_fdset if
+ * there is none. full_fds_bits lets it skip longs of open_fds that
+ * are all in use without looking at them. Called with the files
+ * spinlock held for write.
+ */
+int find_next_fd(struct files_struct *files, int start)
+{
+	int maxfd = files->max_fdset;
+	int maxword = maxfd / __NFDBITS;
+
+	while (start < maxfd) {
+		int word, end, fd;
+
+		word = find_next_zero_bit(files->full_fds_bits, maxword,
+					  start / __NFDBITS);
+		if (word >= maxword)
+			break;
+		if (start < word * __NFDBITS)
+			start = word * __NFDBITS;
+		end = (word + 1) * __NFDBITS;
+		fd = find_next_zero_bit(files->open_fds->fds_bits, end, start);
+		if (fd < end)
+			return fd;
+		start = end;
+	}
+	return maxfd;
+}
+
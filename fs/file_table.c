@@ -11,17 +11,114 @@
 #include <linux/init.h>
 #include <linux/module.h>
 #include <linux/smp_lock.h>
+#include <linux/eventpoll.h>
 
 /* sysctl tunables... */
 struct files_stat_struct files_stat = {0, 0, NR_FILE};
 
-/* Here the new files go */
-static LIST_HEAD(anon_list);
-/* And here the free ones sit */
+/* The global pool of free ones; nr_free_files counts these */
 static LIST_HEAD(free_list);
 /* public *and* exported. Not pretty! */
 spinlock_t files_lock = SPIN_LOCK_UNLOCKED;
 
+struct files_cpu files_cpu[NR_CPUS];
+
+/*
+ * Each CPU keeps up to FILP_CACHE_MAX free file structures of its own
+ * and trades them with the global pool FILP_CACHE_BATCH at a time. The
+ * caches are only touched by their own CPU from process context, so
+ * they need no lock.
+ */
+#define FILP_CACHE_BATCH	16
+#define FILP_CACHE_MAX		(2*FILP_CACHE_BATCH)
+
+/* Leaves the reserved ones for root in the global pool */
+static int filp_cache_refill(struct files_cpu *fc)
+{
+	int n = 0;
+
+	file_list_lock();
+	while (n < FILP_CACHE_BATCH && files_stat.nr_free_files > NR_RESERVED_FILES) {
+		struct list_head *tmp = free_list.next;
+
+		list_del(tmp);
+		list_add(tmp, &fc->free);
+		files_stat.nr_free_files--;
+		n++;
+	}
+	file_list_unlock();
+	fc->nr_free += n;
+	return n;
+}
+
+static void filp_cache_drain(struct files_cpu *fc)
+{
+	int n;
+
+	file_list_lock();
+	for (n = 0; n < FILP_CACHE_BATCH; n++) {
+		struct list_head *tmp = fc->free.prev;
+
+		list_del(tmp);
+		list_add(tmp, &free_list);
+	}
+	files_stat.nr_free_files += n;
+	file_list_unlock();
+	fc->nr_free -= n;
+}
+
+/*
+ * f_list_cpu says which lock guards the list the file is on: a CPU's
+ * for the s_files[] lists, or -1 for files_lock (as for tty_files).
+ */
+static inline void file_list_lock_for(int cpu)
+{
+	if (cpu < 0)
+		spin_lock(&files_lock);
+	else
+		spin_lock(&files_cpu[cpu].lock);
+}
+
+static inline void file_list_unlock_for(int cpu)
+{
+	if (cpu < 0)
+		spin_unlock(&files_lock);
+	else
+		spin_unlock(&files_cpu[cpu].lock);
+}
+
+/* Takes it off whatever list it is on */
+static inline void file_list_del(struct file *file)
+{
+	int cpu = file->f_list_cpu;
+
+	if (list_empty(&file->f_list))
+		return;
+	file_list_lock_for(cpu);
+	list_del_init(&file->f_list);
+	file_list_unlock_for(cpu);
+}
+
+static void file_free_rcu(void *arg)
+{
+	struct file *file = arg;
+	struct files_cpu *fc = &files_cpu[smp_processor_id()];
+
+	list_add(&file->f_list, &fc->free);
+	if (++fc->nr_free > FILP_CACHE_MAX)
+		filp_cache_drain(fc);
+}
+
+/*
+ * A lockless fget() may still be looking at the file, so it is only
+ * reused once every CPU has scheduled.
+ */
+static void file_free(struct file *file)
+{
+	file_list_del(file);
+	call_rcu(&file->f_rcu, file_free_rcu, file);
+}
+
 /* Find an unused file structure and return a pointer to it.
  * Returns NULL, if there are no more free file structures or
  * we run out of memory.
@@ -31,29 +128,34 @@ spinlock_t files_lock = SPIN_LOCK_UNLOCKED;
 struct file * get_empty_filp(void)
 {
 	static int old_max = 0;
+	struct files_cpu *fc = &files_cpu[smp_processor_id()];
 	struct file * f;
 
-	file_list_lock();
-	if (files_stat.nr_free_files > NR_RESERVED_FILES) {
-	used_one:
-		f = list_entry(free_list.next, struct file, f_list);
+	if (fc->nr_free || filp_cache_refill(fc)) {
+		f = list_entry(fc->free.next, struct file, f_list);
 		list_del(&f->f_list);
-		files_stat.nr_free_files--;
+		fc->nr_free--;
 	new_one:
 		memset(f, 0, sizeof(*f));
 		atomic_set(&f->f_count,1);
+		INIT_LIST_HEAD(&f->f_list);
+		INIT_LIST_HEAD(&f->f_ep_links);
 		f->f_version = ++event;
 		f->f_uid = current->fsuid;
 		f->f_gid = current->fsgid;
-		list_add(&f->f_list, &anon_list);
-		file_list_unlock();
 		return f;
 	}
+	file_list_lock();
 	/*
 	 * Use a reserved one if we're the superuser
 	 */
-	if (files_stat.nr_free_files && !current->euid)
-		goto used_one;
+	if (files_stat.nr_free_files && !current->euid) {
+		f = list_entry(free_list.next, struct file, f_list);
+		list_del(&f->f_list);
+		files_stat.nr_free_files--;
+		file_list_unlock();
+		goto new_one;
+	}
 	/*
 	 * Allocate a new one if we're below the limit.
 	 */
@@ -63,6 +165,7 @@ struct file * get_empty_filp(void)
 		file_list_lock();
 		if (f) {
 			files_stat.nr_files++;
+			file_list_unlock();
 			goto new_one;
 		}
 		/* Big problems... */
@@ -86,6 +189,7 @@ int init_private_file(struct file *filp, struct dentry *dentry, int mode)
 	memset(filp, 0, sizeof(*filp));
 	filp->f_mode   = mode;
 	atomic_set(&filp->f_count, 1);
+	INIT_LIST_HEAD(&filp->f_ep_links);
 	filp->f_dentry = dentry;
 	filp->f_uid    = current->fsuid;
 	filp->f_gid    = current->fsgid;
@@ -103,6 +207,8 @@ void fput(struct file * file)
 	struct inode * inode = dentry->d_inode;
 
 	if (atomic_dec_and_test(&file->f_count)) {
+		if (!list_empty(&file->f_ep_links))
+			eventpoll_release(file);
 		locks_remove_flock(file);
 		if (file->f_op && file->f_op->release)
 			file->f_op->release(inode, file);
@@ -114,14 +220,49 @@ void fput(struct file * file)
 		dput(dentry);
 		if (mnt)
 			mntput(mnt);
-		file_list_lock();
-		list_del(&file->f_list);
-		list_add(&file->f_list, &free_list);
-		files_stat.nr_free_files++;
-		file_list_unlock();
+		file_free(file);
 	}
 }
 
+#ifdef __HAVE_ARCH_CMPXCHG
+/* Takes a reference, unless the last fput() has already happened */
+static inline int get_file_unless_zero(struct file *file)
+{
+	int count = atomic_read(&file->f_count);
+
+	while (count) {
+		int old = cmpxchg(&file->f_count.counter, count, count + 1);
+		if (old == count)
+			return 1;
+		count = old;
+	}
+	return 0;
+}
+
+/*
+ * No file_lock here: neither the fd array nor the file can be freed
+ * before we are done, as we do not schedule. The reference is good
+ * if the file was still alive and still installed at fd after we
+ * took it; close() clears the slot before its fput().
+ */
+struct file * fget(unsigned int fd)
+{
+	struct file * file;
+	struct files_struct *files = current->files;
+
+	for (;;) {
+		file = fcheck_files(files, fd);
+		if (!file)
+			break;
+		if (get_file_unless_zero(file)) {
+			if (fcheck_files(files, fd) == file)
+				break;
+			fput(file);
+		}
+	}
+	return file;
+}
+#else
 struct file * fget(unsigned int fd)
 {
 	struct file * file;
@@ -134,64 +275,91 @@ struct file * fget(unsigned int fd)
 	read_unlock(&files->file_lock);
 	return file;
 }
+#endif
 
 /* Here. put_filp() is SMP-safe now. */
 
 void put_filp(struct file *file)
 {
-	if(atomic_dec_and_test(&file->f_count)) {
-		file_list_lock();
-		list_del(&file->f_list);
-		list_add(&file->f_list, &free_list);
-		files_stat.nr_free_files++;
-		file_list_unlock();
-	}
+	if(atomic_dec_and_test(&file->f_count))
+		file_free(file);
+}
+
+/* Puts it on the list of @sb's open files for this CPU */
+void file_move_sb(struct file *file, struct super_block *sb)
+{
+	int cpu = smp_processor_id();
+
+	file_list_del(file);
+	file->f_list_cpu = cpu;
+	sb_file_list_lock(cpu);
+	list_add(&file->f_list, &sb->s_files[cpu]);
+	sb_file_list_unlock(cpu);
 }
 
+/* Puts it on a list of the caller's, which files_lock guards */
 void file_move(struct file *file, struct list_head *list)
 {
 	if (!list)
 		return;
+	file_list_del(file);
+	file->f_list_cpu = -1;
 	file_list_lock();
-	list_del(&file->f_list);
 	list_add(&file->f_list, list);
 	file_list_unlock();
 }
 
 void file_moveto(struct file *new, struct file *old)
 {
-	file_list_lock();
-	list_del(&new->f_list);
+	int cpu = old->f_list_cpu;
+
+	file_list_del(new);
+	new->f_list_cpu = cpu;
+	file_list_lock_for(cpu);
 	list_add(&new->f_list, &old->f_list);
-	file_list_unlock();
+	file_list_unlock_for(cpu);
 }
 
 int fs_may_remount_ro(struct super_block *sb)
 {
 	struct list_head *p;
+	int cpu;
 
 	/* Check that no files are currently opened for writing. */
-	file_list_lock();
-	for (p = sb->s_files.next; p != &sb->s_files; p = p->next) {
-		struct file *file = list_entry(p, struct file, f_list);
-		struct inode *inode;
+	for (cpu = 0; cpu < NR_CPUS; cpu++) {
+		sb_file_list_lock(cpu);
+		for (p = sb->s_files[cpu].next; p != &sb->s_files[cpu]; p = p->next) {
+			struct file *file = list_entry(p, struct file, f_list);
+			struct inode *inode;
 
-		if (!file->f_dentry)
-			continue;
+			if (!file->f_dentry)
+				continue;
 
-		inode = file->f_dentry->d_inode;
+			inode = file->f_dentry->d_inode;
 
-		/* File with pending delete? */
-		if (inode->i_nlink == 0)
-			goto too_bad;
+			/* File with pending delete? */
+			if (inode->i_nlink == 0)
+				goto too_bad;
 
-		/* Writable file? */
-		if (S_ISREG(inode->i_mode) && (file->f_mode & FMODE_WRITE))
-			goto too_bad;
+			/* Writable file? */
+			if (S_ISREG(inode->i_mode) && (file->f_mode & FMODE_WRITE))
+				goto too_bad;
+		}
+		sb_file_list_unlock(cpu);
 	}
-	file_list_unlock();
 	return 1; /* Tis' cool bro. */
 too_bad:
-	file_list_unlock();
+	sb_file_list_unlock(cpu);
 	return 0;
 }
+
+void __init files_init(void)
+{
+	int i;
+
+	for (i = 0; i < NR_CPUS; i++) {
+		spin_lock_init(&files_cpu[i].lock);
+		INIT_LIST_HEAD(&files_cpu[i].free);
+		files_cpu[i].nr_free = 0;
+	}
+}
@@ -40,27 +40,39 @@ static unsigned int i_hash_mask;
 static unsigned int i_hash_shift;
 
 /*
- * Each inode can be on two separate lists. One is
+ * Each inode can be on three separate lists. One is
  * the hash list of the inode, used for lookups. The
- * other linked list is the "type" list:
+ * second is the "type" list:
  *  "in_use" - valid inode, i_count > 0, i_nlink > 0
  *  "dirty"  - as "in_use" but also dirty
  *  "unused" - valid inode, i_count = 0
+ * and the third is the list of all inodes of its super
+ * block, so that umount only has to look at its own.
  *
  * A "dirty" list is maintained for each super block,
  * allowing for low-overhead inode sync() operations.
  */
 
+struct inode_hash_bucket {
+	struct list_head	chain;
+	spinlock_t		lock;
+};
+
 static LIST_HEAD(inode_in_use);
 static LIST_HEAD(inode_unused);
-static struct list_head *inode_hashtable;
-static LIST_HEAD(anon_hash_chain); /* for inodes with NULL i_sb */
+static struct inode_hash_bucket *inode_hashtable;
+static struct inode_hash_bucket anon_hash_bucket; /* for inodes with NULL i_sb */
 
 /*
  * A simple spinlock to protect the list manipulations.
  *
  * NOTE! You also have to own the lock if you change
  * the i_state of an inode while it is in use..
+ *
+ * Each hash chain has a lock of its own, nested inside
+ * inode_lock. The chain lock alone is enough to find an
+ * inode and take a reference to it if it is already in
+ * use; taking i_count up from zero needs inode_lock too.
  */
 spinlock_t inode_lock = SPIN_LOCK_UNLOCKED;
 
@@ -75,6 +87,33 @@ struct {
 
 static kmem_cache_t * inode_cachep;
 
+static inline unsigned long hash(struct super_block *sb, unsigned long i_ino)
+{
+	unsigned long tmp = i_ino | ((unsigned long) sb / L1_CACHE_BYTES);
+	tmp = tmp + (tmp >> I_HASHBITS) + (tmp >> I_HASHBITS*2);
+	return tmp & I_HASHMASK;
+}
+
+/* Yeah, I know about quadratic hash. Maybe, later. */
+
+static inline struct inode_hash_bucket * inode_bucket(struct inode * inode)
+{
+	if (!inode->i_sb)
+		return &anon_hash_bucket;
+	return inode_hashtable + hash(inode->i_sb, inode->i_ino);
+}
+
+/* Called with inode_lock held */
+static inline void unhash_inode(struct inode * inode)
+{
+	struct inode_hash_bucket * bucket = inode_bucket(inode);
+
+	spin_lock(&bucket->lock);
+	list_del(&inode->i_hash);
+	INIT_LIST_HEAD(&inode->i_hash);
+	spin_unlock(&bucket->lock);
+}
+
 #define alloc_inode() \
 	 ((struct inode *) kmem_cache_alloc(inode_cachep, SLAB_KERNEL))
 static void destroy_inode(struct inode *inode) 
@@ -100,6 +139,7 @@ static void init_once(void * foo, kmem_cache_t * cachep, unsigned long flags)
 		memset(inode, 0, sizeof(*inode));
 		init_waitqueue_head(&inode->i_wait);
 		INIT_LIST_HEAD(&inode->i_hash);
+		INIT_LIST_HEAD(&inode->i_sb_list);
 		INIT_LIST_HEAD(&inode->i_data.clean_pages);
 		INIT_LIST_HEAD(&inode->i_data.dirty_pages);
 		INIT_LIST_HEAD(&inode->i_data.locked_pages);
@@ -136,6 +176,11 @@ void __mark_inode_dirty(struct inode *inode, int flags)
 	struct super_block * sb = inode->i_sb;
 
 	if (sb) {
+		/* Let a journaling filesystem log the change while it is fresh */
+		if ((flags & (I_DIRTY_SYNC | I_DIRTY_DATASYNC)) &&
+		    sb->s_op && sb->s_op->dirty_inode)
+			sb->s_op->dirty_inode(inode);
+
 		spin_lock(&inode_lock);
 		if ((inode->i_state & flags) != flags) {
 			inode->i_state |= flags;
@@ -311,7 +356,7 @@ void write_inode_now(struct inode *inode, int sync)
 
 int generic_osync_inode(struct inode *inode, int datasync)
 {
-	int err;
+	int err, ret = 0;
 	
 	/* 
 	 * WARNING
@@ -334,11 +379,21 @@ int generic_osync_inode(struct inode *inode, int datasync)
 	 * every O_SYNC write, not just the synchronous I/Os.  --sct
 	 */
 
+	/* Delayed allocation: the data is only in dirty pages so far */
+	if (inode->i_sb && atomic_read(&inode->i_sb->s_delayed_blocks)) {
+		ret = filemap_fdatasync(inode->i_mapping);
+		err = filemap_fdatawait(inode->i_mapping);
+		if (err && !ret)
+			ret = err;
+	}
+
 #ifdef WRITERS_QUEUE_IO
 	err = osync_inode_buffers(inode);
 #else
 	err = fsync_inode_buffers(inode);
 #endif
+	if (ret && !err)
+		err = ret;
 
 	spin_lock(&inode_lock);
 	if (!(inode->i_state & I_DIRTY))
@@ -411,7 +466,7 @@ static void dispose_list(struct list_head * head)
 /*
  * Invalidate all inodes for a device.
  */
-static int invalidate_list(struct list_head *head, struct super_block * sb, struct list_head * dispose)
+static int invalidate_list(struct list_head *head, struct list_head * dispose)
 {
 	struct list_head *next;
 	int busy = 0, count = 0;
@@ -424,13 +479,11 @@ static int invalidate_list(struct list_head *head, struct super_block * sb, stru
 		next = next->next;
 		if (tmp == head)
 			break;
-		inode = list_entry(tmp, struct inode, i_list);
-		if (inode->i_sb != sb)
-			continue;
+		inode = list_entry(tmp, struct inode, i_sb_list);
 		invalidate_inode_buffers(inode);
 		if (!atomic_read(&inode->i_count)) {
-			list_del(&inode->i_hash);
-			INIT_LIST_HEAD(&inode->i_hash);
+			unhash_inode(inode);
+			list_del_init(&inode->i_sb_list);
 			list_del(&inode->i_list);
 			list_add(&inode->i_list, dispose);
 			inode->i_state |= I_FREEING;
@@ -467,9 +520,7 @@ int invalidate_inodes(struct super_block * sb)
 	LIST_HEAD(throw_away);
 
 	spin_lock(&inode_lock);
-	busy = invalidate_list(&inode_in_use, sb, &throw_away);
-	busy |= invalidate_list(&inode_unused, sb, &throw_away);
-	busy |= invalidate_list(&sb->s_dirty, sb, &throw_away);
+	busy = invalidate_list(&sb->s_inodes, &throw_away);
 	spin_unlock(&inode_lock);
 
 	dispose_list(&throw_away);
@@ -518,8 +569,8 @@ void prune_icache(int goal)
 		if (atomic_read(&inode->i_count))
 			BUG();
 		list_del(tmp);
-		list_del(&inode->i_hash);
-		INIT_LIST_HEAD(&inode->i_hash);
+		unhash_inode(inode);
+		list_del_init(&inode->i_sb_list);
 		list_add(tmp, freeable);
 		inode->i_state |= I_FREEING;
 		count++;
@@ -554,7 +605,7 @@ void shrink_icache_memory(int priority, int gfp_mask)
 }
 
 /*
- * Called with the inode lock held.
+ * Called with the hash chain's lock held.
  * NOTE: we are not increasing the inode-refcount, you must call __iget()
  * by hand after calling find_inode now! This simplifies iunique and won't
  * add any additional branch in the common code.
@@ -600,6 +651,7 @@ static void clean_inode(struct inode *inode)
 	inode->i_fop = &empty_fops;
 	inode->i_nlink = 1;
 	atomic_set(&inode->i_writecount, 0);
+	atomic_set(&inode->i_dio_count, 0);
 	inode->i_size = 0;
 	inode->i_generation = 0;
 	memset(&inode->i_dquot, 0, sizeof(inode->i_dquot));
@@ -623,7 +675,7 @@ static void clean_inode(struct inode *inode)
  * lists.
  */
  
-struct inode * get_empty_inode(void)
+static struct inode * __get_empty_inode(struct super_block *sb)
 {
 	static unsigned long last_ino;
 	struct inode * inode;
@@ -634,8 +686,10 @@ struct inode * get_empty_inode(void)
 		spin_lock(&inode_lock);
 		inodes_stat.nr_inodes++;
 		list_add(&inode->i_list, &inode_in_use);
-		inode->i_sb = NULL;
-		inode->i_dev = 0;
+		if (sb)
+			list_add(&inode->i_sb_list, &sb->s_inodes);
+		inode->i_sb = sb;
+		inode->i_dev = sb ? sb->s_dev : 0;
 		inode->i_ino = ++last_ino;
 		inode->i_flags = 0;
 		atomic_set(&inode->i_count, 1);
@@ -646,13 +700,31 @@ struct inode * get_empty_inode(void)
 	return inode;
 }
 
+struct inode * get_empty_inode(void)
+{
+	return __get_empty_inode(NULL);
+}
+
+/**
+ * new_inode 	- obtain an inode for a superblock
+ * @sb: superblock
+ *
+ * Like get_empty_inode(), but the inode belongs to @sb and is
+ * on its inode list, so that invalidate_inodes() finds it.
+ */
+ 
+struct inode * new_inode(struct super_block *sb)
+{
+	return __get_empty_inode(sb);
+}
+
 /*
  * This is called without the inode lock held.. Be careful.
  *
  * We no longer cache the sb_flags in i_flags - see fs.h
  *	-- rmk@arm.uk.linux.org
  */
-static struct inode * get_new_inode(struct super_block *sb, unsigned long ino, struct list_head *head, find_inode_t find_actor, void *opaque)
+static struct inode * get_new_inode(struct super_block *sb, unsigned long ino, struct inode_hash_bucket *bucket, find_inode_t find_actor, void *opaque)
 {
 	struct inode * inode;
 
@@ -661,18 +733,21 @@ static struct inode * get_new_inode(struct super_block *sb, unsigned long ino, s
 		struct inode * old;
 
 		spin_lock(&inode_lock);
+		spin_lock(&bucket->lock);
 		/* We released the lock, so.. */
-		old = find_inode(sb, ino, head, find_actor, opaque);
+		old = find_inode(sb, ino, &bucket->chain, find_actor, opaque);
 		if (!old) {
 			inodes_stat.nr_inodes++;
 			list_add(&inode->i_list, &inode_in_use);
-			list_add(&inode->i_hash, head);
+			list_add(&inode->i_sb_list, &sb->s_inodes);
+			list_add(&inode->i_hash, &bucket->chain);
 			inode->i_sb = sb;
 			inode->i_dev = sb->s_dev;
 			inode->i_ino = ino;
 			inode->i_flags = 0;
 			atomic_set(&inode->i_count, 1);
 			inode->i_state = I_LOCK;
+			spin_unlock(&bucket->lock);
 			spin_unlock(&inode_lock);
 
 			clean_inode(inode);
@@ -698,6 +773,7 @@ static struct inode * get_new_inode(struct super_block *sb, unsigned long ino, s
 		 * allocated.
 		 */
 		__iget(old);
+		spin_unlock(&bucket->lock);
 		spin_unlock(&inode_lock);
 		destroy_inode(inode);
 		inode = old;
@@ -706,15 +782,6 @@ static struct inode * get_new_inode(struct super_block *sb, unsigned long ino, s
 	return inode;
 }
 
-static inline unsigned long hash(struct super_block *sb, unsigned long i_ino)
-{
-	unsigned long tmp = i_ino | ((unsigned long) sb / L1_CACHE_BYTES);
-	tmp = tmp + (tmp >> I_HASHBITS) + (tmp >> I_HASHBITS*2);
-	return tmp & I_HASHMASK;
-}
-
-/* Yeah, I know about quadratic hash. Maybe, later. */
-
 /**
  *	iunique - get a unique inode number
  *	@sb: superblock
@@ -734,13 +801,15 @@ ino_t iunique(struct super_block *sb, ino_t max_reserved)
 {
 	static ino_t counter = 0;
 	struct inode *inode;
-	struct list_head * head;
+	struct inode_hash_bucket * bucket;
 	ino_t res;
 	spin_lock(&inode_lock);
 retry:
 	if (counter > max_reserved) {
-		head = inode_hashtable + hash(sb,counter);
-		inode = find_inode(sb, res = counter++, head, NULL, NULL);
+		bucket = inode_hashtable + hash(sb,counter);
+		spin_lock(&bucket->lock);
+		inode = find_inode(sb, res = counter++, &bucket->chain, NULL, NULL);
+		spin_unlock(&bucket->lock);
 		if (!inode) {
 			spin_unlock(&inode_lock);
 			return res;
@@ -773,24 +842,43 @@ struct inode *igrab(struct inode *inode)
 
 struct inode *iget4(struct super_block *sb, unsigned long ino, find_inode_t find_actor, void *opaque)
 {
-	struct list_head * head = inode_hashtable + hash(sb,ino);
+	struct inode_hash_bucket * bucket = inode_hashtable + hash(sb,ino);
 	struct inode * inode;
 
+	/*
+	 * An inode that is in use only needs its count raised, and
+	 * the chain lock is enough for that. iput() checks the count
+	 * again under the chain lock before it lets go of an inode.
+	 */
+	spin_lock(&bucket->lock);
+	inode = find_inode(sb, ino, &bucket->chain, find_actor, opaque);
+	if (inode && atomic_read(&inode->i_count)) {
+		atomic_inc(&inode->i_count);
+		spin_unlock(&bucket->lock);
+		wait_on_inode(inode);
+		return inode;
+	}
+	spin_unlock(&bucket->lock);
+
+	/* Unused or not there: it moves between the type lists */
 	spin_lock(&inode_lock);
-	inode = find_inode(sb, ino, head, find_actor, opaque);
+	spin_lock(&bucket->lock);
+	inode = find_inode(sb, ino, &bucket->chain, find_actor, opaque);
 	if (inode) {
 		__iget(inode);
+		spin_unlock(&bucket->lock);
 		spin_unlock(&inode_lock);
 		wait_on_inode(inode);
 		return inode;
 	}
+	spin_unlock(&bucket->lock);
 	spin_unlock(&inode_lock);
 
 	/*
 	 * get_new_inode() will do the right thing, re-trying the search
 	 * in case it had to block at any point.
 	 */
-	return get_new_inode(sb, ino, head, find_actor, opaque);
+	return get_new_inode(sb, ino, bucket, find_actor, opaque);
 }
 
 /**
@@ -803,11 +891,11 @@ struct inode *iget4(struct super_block *sb, unsigned long ino, find_inode_t find
  
 void insert_inode_hash(struct inode *inode)
 {
-	struct list_head *head = &anon_hash_chain;
-	if (inode->i_sb)
-		head = inode_hashtable + hash(inode->i_sb, inode->i_ino);
+	struct inode_hash_bucket *bucket = inode_bucket(inode);
 	spin_lock(&inode_lock);
-	list_add(&inode->i_hash, head);
+	spin_lock(&bucket->lock);
+	list_add(&inode->i_hash, &bucket->chain);
+	spin_unlock(&bucket->lock);
 	spin_unlock(&inode_lock);
 }
 
@@ -821,8 +909,7 @@ void insert_inode_hash(struct inode *inode)
 void remove_inode_hash(struct inode *inode)
 {
 	spin_lock(&inode_lock);
-	list_del(&inode->i_hash);
-	INIT_LIST_HEAD(&inode->i_hash);
+	unhash_inode(inode);
 	spin_unlock(&inode_lock);
 }
 
@@ -838,6 +925,7 @@ void iput(struct inode *inode)
 {
 	if (inode) {
 		struct super_operations *op = NULL;
+		struct inode_hash_bucket *bucket;
 
 		if (inode->i_sb && inode->i_sb->s_op)
 			op = inode->i_sb->s_op;
@@ -847,11 +935,22 @@ void iput(struct inode *inode)
 		if (!atomic_dec_and_lock(&inode->i_count, &inode_lock))
 			return;
 
+		/* Picked up again by iget4() under the chain lock? */
+		bucket = inode_bucket(inode);
+		spin_lock(&bucket->lock);
+		if (atomic_read(&inode->i_count)) {
+			spin_unlock(&bucket->lock);
+			spin_unlock(&inode_lock);
+			return;
+		}
+
 		if (!inode->i_nlink) {
 			list_del(&inode->i_hash);
 			INIT_LIST_HEAD(&inode->i_hash);
+			spin_unlock(&bucket->lock);
 			list_del(&inode->i_list);
 			INIT_LIST_HEAD(&inode->i_list);
+			list_del_init(&inode->i_sb_list);
 			inode->i_state|=I_FREEING;
 			inodes_stat.nr_inodes--;
 			spin_unlock(&inode_lock);
@@ -869,6 +968,7 @@ void iput(struct inode *inode)
 				BUG();
 		} else {
 			if (!list_empty(&inode->i_hash)) {
+				spin_unlock(&bucket->lock);
 				if (!(inode->i_state & I_DIRTY)) {
 					list_del(&inode->i_list);
 					list_add(&inode->i_list,
@@ -879,8 +979,10 @@ void iput(struct inode *inode)
 				return;
 			} else {
 				/* magic nfs path */
+				spin_unlock(&bucket->lock);
 				list_del(&inode->i_list);
 				INIT_LIST_HEAD(&inode->i_list);
+				list_del_init(&inode->i_sb_list);
 				inode->i_state|=I_FREEING;
 				inodes_stat.nr_inodes--;
 				spin_unlock(&inode_lock);
@@ -926,13 +1028,13 @@ int bmap(struct inode * inode, int block)
  */
 void __init inode_init(unsigned long mempages)
 {
-	struct list_head *head;
+	struct inode_hash_bucket *bucket;
 	unsigned long order;
 	unsigned int nr_hash;
 	int i;
 
 	mempages >>= (14 - PAGE_SHIFT);
-	mempages *= sizeof(struct list_head);
+	mempages *= sizeof(struct inode_hash_bucket);
 	for (order = 0; ((1UL << order) << PAGE_SHIFT) < mempages; order++)
 		;
 
@@ -940,7 +1042,7 @@ void __init inode_init(unsigned long mempages)
 		unsigned long tmp;
 
 		nr_hash = (1UL << order) * PAGE_SIZE /
-			sizeof(struct list_head);
+			sizeof(struct inode_hash_bucket);
 		i_hash_mask = (nr_hash - 1);
 
 		tmp = nr_hash;
@@ -948,7 +1050,7 @@ void __init inode_init(unsigned long mempages)
 		while ((tmp >>= 1UL) != 0UL)
 			i_hash_shift++;
 
-		inode_hashtable = (struct list_head *)
+		inode_hashtable = (struct inode_hash_bucket *)
 			__get_free_pages(GFP_ATOMIC, order);
 	} while (inode_hashtable == NULL && --order >= 0);
 
@@ -958,13 +1060,16 @@ void __init inode_init(unsigned long mempages)
 	if (!inode_hashtable)
 		panic("Failed to allocate inode hash table\n");
 
-	head = inode_hashtable;
+	bucket = inode_hashtable;
 	i = nr_hash;
 	do {
-		INIT_LIST_HEAD(head);
-		head++;
+		INIT_LIST_HEAD(&bucket->chain);
+		spin_lock_init(&bucket->lock);
+		bucket++;
 		i--;
 	} while (i);
+	INIT_LIST_HEAD(&anon_hash_bucket.chain);
+	spin_lock_init(&anon_hash_bucket.lock);
 
 	/* inode slab cache */
 	inode_cachep = kmem_cache_create("inode_cache", sizeof(struct inode),
@@ -1015,23 +1120,11 @@ void remove_dquot_ref(kdev_t dev, short type)
 	/* We have to be protected against other CPUs */
 	spin_lock(&inode_lock);
  
-	for (act_head = inode_in_use.next; act_head != &inode_in_use; act_head = act_head->next) {
-		inode = list_entry(act_head, struct inode, i_list);
-		if (inode->i_sb != sb || !IS_QUOTAINIT(inode))
-			continue;
-		remove_inode_dquot_ref(inode, type, &tofree_head);
-	}
-	for (act_head = inode_unused.next; act_head != &inode_unused; act_head = act_head->next) {
-		inode = list_entry(act_head, struct inode, i_list);
-		if (inode->i_sb != sb || !IS_QUOTAINIT(inode))
-			continue;
-		remove_inode_dquot_ref(inode, type, &tofree_head);
-	}
-	for (act_head = sb->s_dirty.next; act_head != &sb->s_dirty; act_head = act_head->next) {
-		inode = list_entry(act_head, struct inode, i_list);
+	for (act_head = sb->s_inodes.next; act_head != &sb->s_inodes; act_head = act_head->next) {
+		inode = list_entry(act_head, struct inode, i_sb_list);
 		if (!IS_QUOTAINIT(inode))
 			continue;
-  		remove_inode_dquot_ref(inode, type, &tofree_head);
+		remove_inode_dquot_ref(inode, type, &tofree_head);
 	}
 	spin_unlock(&inode_lock);
 
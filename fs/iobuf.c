@@ -19,9 +19,11 @@ void end_kio_request(struct kiobuf *kiobuf, int uptodate)
 		kiobuf->errno = -EIO;
 
 	if (atomic_dec_and_test(&kiobuf->io_count)) {
+		/* end_io may free the kiobuf: nothing waits on those */
 		if (kiobuf->end_io)
 			kiobuf->end_io(kiobuf);
-		wake_up(&kiobuf->wait_queue);
+		else
+			wake_up(&kiobuf->wait_queue);
 	}
 }
 
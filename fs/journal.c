@@ -0,0 +1,1573 @@
+/*
+ *  linux/fs/journal.c
+ *
+ *  Write-ahead journal for metadata in the buffer cache.
+ *
+ *  A transaction collects the buffers modified by its handles.  When it
+ *  is committed, new handles are held off until the open ones finish,
+ *  the buffers are copied into log blocks, and then handles may run
+ *  again while the copies, a descriptor of where they belong and a
+ *  commit block are written out.  Data buffers registered with
+ *  journal_dirty_data() are written before the commit block, so a
+ *  committed block pointer never exposes stale data.
+ *
+ *  Only once a transaction has committed are its buffers marked dirty
+ *  for bdflush.  A transaction's log space is reused when all of its
+ *  buffers have reached their home locations or been logged again by a
+ *  later transaction (checkpointing).
+ *
+ *  Recovery reads the log three times: to find the last complete
+ *  transaction, to collect revoke records, and to write the logged
+ *  blocks home, skipping those revoked by the same or a later
+ *  transaction.
+ */
+
+#include <linux/sched.h>
+#include <linux/fs.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/locks.h>
+#include <linux/journal.h>
+#include <linux/init.h>
+
+#include <asm/byteorder.h>
+
+static kmem_cache_t *journal_head_cachep;
+
+#define tid_gt(x, y)	((int)((x) - (y)) > 0)
+#define tid_geq(x, y)	((int)((x) - (y)) >= 0)
+
+static inline void lock_journal(journal_t *journal)
+{
+	down(&journal->j_sem);
+}
+
+static inline void unlock_journal(journal_t *journal)
+{
+	up(&journal->j_sem);
+}
+
+/*
+ * Allocations below may not fail: the metadata change they record has
+ * already been made, or is about to be.  GFP_BUFFER keeps us from
+ * recursing into the filesystem.
+ */
+static void *journal_kmalloc(size_t size)
+{
+	void *p;
+
+	while (!(p = kmalloc(size, GFP_BUFFER))) {
+		current->policy |= SCHED_YIELD;
+		schedule();
+	}
+	return p;
+}
+
+static struct journal_head *journal_add_journal_head(struct buffer_head *bh)
+{
+	struct journal_head *jh = bh->b_journal_head;
+
+	if (jh)
+		return jh;
+	while (!(jh = kmem_cache_alloc(journal_head_cachep, SLAB_BUFFER))) {
+		current->policy |= SCHED_YIELD;
+		schedule();
+	}
+	memset(jh, 0, sizeof(*jh));
+	jh->jh_bh = bh;
+	INIT_LIST_HEAD(&jh->jh_list);
+	INIT_LIST_HEAD(&jh->jh_log_list);
+	INIT_LIST_HEAD(&jh->jh_cp_list);
+	atomic_inc(&bh->b_count);
+	bh->b_journal_head = jh;
+	return jh;
+}
+
+/* Drop the journal_head once no transaction cares about the buffer */
+static void journal_put_journal_head(struct journal_head *jh)
+{
+	struct buffer_head *bh = jh->jh_bh;
+
+	if (jh->jh_transaction || jh->jh_committing || jh->jh_cp_transaction)
+		return;
+	bh->b_journal_head = NULL;
+	if (jh->jh_committed_data)
+		kfree(jh->jh_committed_data);
+	if (jh->jh_frozen_data)
+		kfree(jh->jh_frozen_data);
+	kmem_cache_free(journal_head_cachep, jh);
+	brelse(bh);
+}
+
+static void journal_remove_checkpoint(struct journal_head *jh)
+{
+	if (!jh->jh_cp_transaction)
+		return;
+	list_del(&jh->jh_cp_list);
+	INIT_LIST_HEAD(&jh->jh_cp_list);
+	jh->jh_cp_transaction = NULL;
+}
+
+/*
+ * Log space.  j_free keeps one block in reserve so that a full log can
+ * not be mistaken for an empty one.
+ */
+static void log_update_free(journal_t *journal)
+{
+	unsigned long free;
+
+	if (journal->j_tail > journal->j_head)
+		free = journal->j_tail - journal->j_head;
+	else
+		free = (journal->j_last - journal->j_first) -
+			(journal->j_head - journal->j_tail);
+	journal->j_free = free - 1;
+}
+
+static unsigned long log_next_block(journal_t *journal)
+{
+	unsigned long blocknr = journal->j_head;
+
+	if (++journal->j_head == journal->j_last)
+		journal->j_head = journal->j_first;
+	journal->j_free--;
+	return blocknr;
+}
+
+/*
+ * A zeroed, uptodate buffer for the next log block.  It is only marked
+ * dirty right before we write it, so that bdflush can not send a commit
+ * block out ahead of the blocks it covers.
+ */
+static struct buffer_head *log_get_block(journal_t *journal)
+{
+	unsigned long blocknr = log_next_block(journal);
+	struct buffer_head *bh;
+
+	bh = getblk(journal->j_dev, journal->j_blockmap[blocknr],
+		    journal->j_blocksize);
+	lock_buffer(bh);
+	memset(bh->b_data, 0, journal->j_blocksize);
+	mark_buffer_uptodate(bh, 1);
+	unlock_buffer(bh);
+	return bh;
+}
+
+static void log_header(struct buffer_head *bh, int type, tid_t tid)
+{
+	journal_header_t *header = (journal_header_t *) bh->b_data;
+
+	header->h_magic = cpu_to_be32(JFS_MAGIC_NUMBER);
+	header->h_blocktype = cpu_to_be32(type);
+	header->h_sequence = cpu_to_be32(tid);
+}
+
+/* Log blocks a transaction will take, descriptors and commit included */
+static int log_space_needed(journal_t *journal, transaction_t *transaction)
+{
+	int bs = journal->j_blocksize;
+	int per_desc = (bs - sizeof(journal_header_t) - 40) /
+			sizeof(journal_block_tag_t);
+	int per_revoke = (bs - sizeof(journal_revoke_header_t)) / 4;
+
+	return transaction->t_nr_buffers +
+		(transaction->t_nr_buffers + per_desc - 1) / per_desc +
+		(transaction->t_nr_revokes + per_revoke - 1) / per_revoke + 1;
+}
+
+/*
+ * Write out the dirty ones among a batch of buffers and wait for all
+ * of them, dropping our references; returns -EIO on any failure.
+ */
+static int journal_write_buffers(struct buffer_head **bhs, int nr)
+{
+	int i, err = 0;
+
+	ll_rw_block(WRITE, nr, bhs);
+	for (i = 0; i < nr; i++) {
+		wait_on_buffer(bhs[i]);
+		if (!buffer_uptodate(bhs[i]))
+			err = -EIO;
+		brelse(bhs[i]);
+	}
+	return err;
+}
+
+/*
+ * Write the log superblock.  j_tail == 0 marks the log as empty, which
+ * is only done at unmount.
+ */
+static void journal_update_superblock(journal_t *journal)
+{
+	journal_superblock_t *sb = journal->j_superblock;
+	struct buffer_head *bh = journal->j_sb_buffer;
+
+	sb->s_sequence = cpu_to_be32(journal->j_tail_sequence);
+	sb->s_start = cpu_to_be32(journal->j_tail);
+	mark_buffer_dirty(bh);
+	ll_rw_block(WRITE, 1, &bh);
+	wait_on_buffer(bh);
+	if (!buffer_uptodate(bh))
+		printk(KERN_ERR "journal: I/O error writing superblock\n");
+}
+
+void journal_abort(journal_t *journal)
+{
+	if (journal->j_flags & JFS_ABORT)
+		return;
+	printk(KERN_ERR "journal: aborting journal on device %s\n",
+	       kdevname(journal->j_dev));
+	journal->j_flags |= JFS_ABORT;
+	wake_up(&journal->j_wait_transaction_locked);
+	wake_up(&journal->j_wait_done_commit);
+	wake_up(&journal->j_wait_commit);
+}
+
+/*
+ * Checkpointing.  Called with j_sem held.
+ *
+ * __log_cleanup() drops checkpoint buffers which bdflush has already
+ * written and releases transactions with nothing left to write,
+ * moving the log tail past them.  It returns non-zero if the tail
+ * moved.
+ */
+static int __log_cleanup(journal_t *journal)
+{
+	struct list_head *tlist, *entry, *next;
+	transaction_t *transaction;
+	int moved = 0;
+
+	list_for_each(tlist, &journal->j_checkpoint) {
+		transaction = list_entry(tlist, transaction_t, t_cplist);
+		for (entry = transaction->t_checkpoint.next;
+		     entry != &transaction->t_checkpoint; entry = next) {
+			struct journal_head *jh;
+			struct buffer_head *bh;
+
+			next = entry->next;
+			jh = list_entry(entry, struct journal_head, jh_cp_list);
+			bh = jh->jh_bh;
+			if (jh->jh_transaction || jh->jh_committing ||
+			    buffer_dirty(bh) || buffer_locked(bh))
+				continue;
+			journal_remove_checkpoint(jh);
+			journal_put_journal_head(jh);
+		}
+	}
+
+	while (!list_empty(&journal->j_checkpoint)) {
+		transaction = list_entry(journal->j_checkpoint.next,
+					 transaction_t, t_cplist);
+		if (!list_empty(&transaction->t_checkpoint))
+			break;
+		list_del(&transaction->t_cplist);
+		kfree(transaction);
+		moved = 1;
+	}
+	if (!moved)
+		return 0;
+
+	if (!list_empty(&journal->j_checkpoint)) {
+		transaction = list_entry(journal->j_checkpoint.next,
+					 transaction_t, t_cplist);
+		journal->j_tail = transaction->t_log_start;
+		journal->j_tail_sequence = transaction->t_tid;
+	} else if (journal->j_committing) {
+		journal->j_tail = journal->j_committing->t_log_start;
+		journal->j_tail_sequence = journal->j_committing->t_tid;
+	} else {
+		journal->j_tail = journal->j_head;
+		journal->j_tail_sequence = journal->j_running ?
+			journal->j_running->t_tid :
+			journal->j_transaction_sequence;
+	}
+	/* The space may be reused only once the log says so on disk */
+	journal_update_superblock(journal);
+	log_update_free(journal);
+	return 1;
+}
+
+static void log_start_commit(journal_t *, tid_t);
+static int log_wait_commit(journal_t *, tid_t);
+
+/*
+ * Free some log space by writing home the buffers of the oldest
+ * committed transaction.  May drop j_sem; callers recheck their
+ * condition afterwards.
+ */
+#define CP_BATCH	64
+
+static void log_do_checkpoint(journal_t *journal)
+{
+	struct buffer_head *bhs[CP_BATCH];
+	transaction_t *transaction;
+	struct list_head *entry;
+	int nr = 0;
+	tid_t tid;
+
+	if (__log_cleanup(journal))
+		return;
+
+	if (list_empty(&journal->j_checkpoint)) {
+		/* All used log space belongs to the commit in progress */
+		if (!journal->j_committing)
+			return;
+		tid = journal->j_committing->t_tid;
+		goto wait_commit;
+	}
+
+	transaction = list_entry(journal->j_checkpoint.next,
+				 transaction_t, t_cplist);
+	list_for_each(entry, &transaction->t_checkpoint) {
+		struct journal_head *jh;
+		struct buffer_head *bh;
+
+		jh = list_entry(entry, struct journal_head, jh_cp_list);
+		bh = jh->jh_bh;
+		if (jh->jh_transaction || jh->jh_committing) {
+			/* A newer copy must be committed before we can go */
+			tid = jh->jh_transaction ? jh->jh_transaction->t_tid :
+				jh->jh_committing->t_tid;
+			goto wait_commit;
+		}
+		if (!buffer_dirty(bh) && !buffer_locked(bh))
+			continue;
+		atomic_inc(&bh->b_count);
+		bhs[nr++] = bh;
+		if (nr == CP_BATCH)
+			break;
+	}
+	if (nr && journal_write_buffers(bhs, nr))
+		journal_abort(journal);
+	__log_cleanup(journal);
+	return;
+
+wait_commit:
+	unlock_journal(journal);
+	log_start_commit(journal, tid);
+	log_wait_commit(journal, tid);
+	lock_journal(journal);
+}
+
+/*
+ * Handles.
+ */
+handle_t *journal_start(journal_t *journal, int nblocks)
+{
+	handle_t *handle = journal_current_handle();
+	transaction_t *transaction;
+
+	if (handle) {
+		handle->h_ref++;
+		return handle;
+	}
+	handle = journal_kmalloc(sizeof(*handle));
+	memset(handle, 0, sizeof(*handle));
+	handle->h_ref = 1;
+	handle->h_buffer_credits = nblocks;
+
+	lock_journal(journal);
+repeat:
+	if (is_journal_aborted(journal)) {
+		unlock_journal(journal);
+		kfree(handle);
+		return ERR_PTR(-EROFS);
+	}
+
+	transaction = journal->j_running;
+	if (transaction && transaction->t_state == T_LOCKED) {
+		unlock_journal(journal);
+		wait_event(journal->j_wait_transaction_locked,
+			   journal->j_running != transaction ||
+			   transaction->t_state != T_LOCKED ||
+			   is_journal_aborted(journal));
+		lock_journal(journal);
+		goto repeat;
+	}
+
+	if (!transaction) {
+		if (journal->j_free < 2 * journal->j_max_transaction_buffers) {
+			log_do_checkpoint(journal);
+			goto repeat;
+		}
+		transaction = journal_kmalloc(sizeof(*transaction));
+		memset(transaction, 0, sizeof(*transaction));
+		transaction->t_journal = journal;
+		transaction->t_tid = journal->j_transaction_sequence++;
+		transaction->t_state = T_RUNNING;
+		transaction->t_expires = jiffies + journal->j_commit_interval;
+		INIT_LIST_HEAD(&transaction->t_buffers);
+		INIT_LIST_HEAD(&transaction->t_forget);
+		INIT_LIST_HEAD(&transaction->t_log);
+		INIT_LIST_HEAD(&transaction->t_data);
+		INIT_LIST_HEAD(&transaction->t_revoke);
+		INIT_LIST_HEAD(&transaction->t_checkpoint);
+		INIT_LIST_HEAD(&transaction->t_cplist);
+		journal->j_running = transaction;
+		/* so that kjournald notices the new commit deadline */
+		wake_up(&journal->j_wait_commit);
+	}
+
+	if (transaction->t_outstanding_credits &&
+	    transaction->t_outstanding_credits + nblocks >
+	    journal->j_max_transaction_buffers) {
+		tid_t tid = transaction->t_tid;
+
+		unlock_journal(journal);
+		log_start_commit(journal, tid);
+		wait_event(journal->j_wait_transaction_locked,
+			   journal->j_running != transaction ||
+			   is_journal_aborted(journal));
+		lock_journal(journal);
+		goto repeat;
+	}
+
+	transaction->t_updates++;
+	transaction->t_outstanding_credits += nblocks;
+	handle->h_transaction = transaction;
+	unlock_journal(journal);
+
+	current->journal_info = handle;
+	return handle;
+}
+
+int journal_stop(handle_t *handle)
+{
+	transaction_t *transaction = handle->h_transaction;
+	journal_t *journal = transaction->t_journal;
+	int err = 0;
+	tid_t tid;
+
+	if (--handle->h_ref > 0)
+		return 0;
+	current->journal_info = NULL;
+
+	lock_journal(journal);
+	transaction->t_outstanding_credits -= handle->h_buffer_credits;
+	if (!--transaction->t_updates)
+		wake_up(&journal->j_wait_updates);
+	tid = transaction->t_tid;
+	unlock_journal(journal);
+
+	if (handle->h_sync) {
+		log_start_commit(journal, tid);
+		err = log_wait_commit(journal, tid);
+	}
+	kfree(handle);
+	return err;
+}
+
+/*
+ * Split an update too big for one transaction: what the handle did so
+ * far commits with its transaction, and the handle, nesting and all,
+ * carries on in a new one.  On failure there is no handle any more.
+ */
+int journal_restart(handle_t *handle, int nblocks)
+{
+	journal_t *journal = handle->h_transaction->t_journal;
+	int ref = handle->h_ref;
+	int sync = handle->h_sync;
+
+	handle->h_ref = 1;
+	handle->h_sync = 0;
+	journal_stop(handle);
+	handle = journal_start(journal, nblocks);
+	if (IS_ERR(handle))
+		return PTR_ERR(handle);
+	handle->h_ref = ref;
+	handle->h_sync = sync;
+	return 0;
+}
+
+/* Revoke records of the running transaction, hashed by block */
+static inline struct list_head *revoke_hash(journal_t *journal,
+					    unsigned long blocknr)
+{
+	return &journal->j_revoke_hash[blocknr & (JOURNAL_REVOKE_HASH - 1)];
+}
+
+static struct journal_revoke *find_revoke(journal_t *journal,
+					  unsigned long blocknr)
+{
+	struct list_head *head = revoke_hash(journal, blocknr);
+	struct list_head *entry;
+
+	list_for_each(entry, head) {
+		struct journal_revoke *r;
+
+		r = list_entry(entry, struct journal_revoke, r_hash);
+		if (r->r_blocknr == blocknr)
+			return r;
+	}
+	return NULL;
+}
+
+/*
+ * Declare that we are about to modify a metadata buffer.  It joins the
+ * running transaction and stays clean until that commits, so bdflush
+ * can not write half a transaction home.
+ */
+int journal_get_write_access(handle_t *handle, struct buffer_head *bh)
+{
+	transaction_t *transaction = handle->h_transaction;
+	journal_t *journal = transaction->t_journal;
+	struct journal_head *jh;
+	struct journal_revoke *r;
+
+	lock_journal(journal);
+	if (is_journal_aborted(journal)) {
+		unlock_journal(journal);
+		return -EROFS;
+	}
+	jh = journal_add_journal_head(bh);
+	if (jh->jh_transaction == transaction) {
+		if (!jh->jh_forget)
+			goto out;
+		/* freed and reused within the same transaction */
+		list_del(&jh->jh_list);
+		jh->jh_forget = 0;
+		goto add;
+	}
+
+	lock_buffer(bh);
+	mark_buffer_clean(bh);
+	unlock_buffer(bh);
+	jh->jh_transaction = transaction;
+	handle->h_buffer_credits--;
+add:
+	list_add_tail(&jh->jh_list, &transaction->t_buffers);
+	transaction->t_nr_buffers++;
+out:
+	/* A block freed earlier in this transaction is metadata again */
+	r = find_revoke(journal, bh->b_blocknr);
+	if (r) {
+		list_del(&r->r_hash);
+		list_del(&r->r_list);
+		kfree(r);
+		transaction->t_nr_revokes--;
+	}
+	unlock_journal(journal);
+	return 0;
+}
+
+/*
+ * Write access to an allocation bitmap which things are about to be
+ * freed from.  Until the transaction commits, a crash brings the freed
+ * bits back, so they may not be handed out again: keep a copy of the
+ * bitmap as the last committed transaction left it, for
+ * journal_merge_committed().  Bits set since then only make the copy
+ * more careful.
+ */
+int journal_get_undo_access(handle_t *handle, struct buffer_head *bh)
+{
+	journal_t *journal = handle->h_transaction->t_journal;
+	struct journal_head *jh;
+	int err;
+
+	err = journal_get_write_access(handle, bh);
+	if (err)
+		return err;
+	lock_journal(journal);
+	jh = bh->b_journal_head;
+	if (jh && !jh->jh_committed_data) {
+		jh->jh_committed_data = journal_kmalloc(bh->b_size);
+		memcpy(jh->jh_committed_data, bh->b_data, bh->b_size);
+	}
+	unlock_journal(journal);
+	return 0;
+}
+
+/*
+ * Fill @map with the bits set in @bh or in its committed copy: a bit
+ * clear in @map is free both now and after a crash.  Returns 0, with
+ * @map untouched, if nothing has been freed from @bh since its last
+ * commit.
+ */
+int journal_merge_committed(journal_t *journal, struct buffer_head *bh,
+			    char *map)
+{
+	struct journal_head *jh;
+	unsigned long *dst = (unsigned long *) map;
+	unsigned long *cur = (unsigned long *) bh->b_data;
+	unsigned long *old;
+	int i, ret = 0;
+
+	lock_journal(journal);
+	jh = bh->b_journal_head;
+	if (jh && jh->jh_committed_data) {
+		old = (unsigned long *) jh->jh_committed_data;
+		for (i = 0; i < bh->b_size / sizeof(long); i++)
+			dst[i] = cur[i] | old[i];
+		ret = 1;
+	}
+	unlock_journal(journal);
+	return ret;
+}
+
+/*
+ * The buffer was modified.  Everything was arranged by
+ * journal_get_write_access(), but catch callers who forgot it.
+ */
+int journal_dirty_metadata(handle_t *handle, struct buffer_head *bh)
+{
+	struct journal_head *jh = bh->b_journal_head;
+
+	if (jh && jh->jh_transaction == handle->h_transaction &&
+	    !jh->jh_forget)
+		return 0;
+	printk(KERN_WARNING "journal: block %lu dirtied without write access\n",
+	       bh->b_blocknr);
+	return journal_get_write_access(handle, bh);
+}
+
+/* A data block which must be on disk before the transaction commits */
+int journal_dirty_data(handle_t *handle, struct buffer_head *bh)
+{
+	transaction_t *transaction = handle->h_transaction;
+	journal_t *journal = transaction->t_journal;
+	struct journal_data *jd;
+
+	jd = journal_kmalloc(sizeof(*jd));
+	atomic_inc(&bh->b_count);
+	jd->jd_bh = bh;
+	lock_journal(journal);
+	list_add_tail(&jd->jd_list, &transaction->t_data);
+	unlock_journal(journal);
+	return 0;
+}
+
+/*
+ * A metadata buffer is being freed: like bforget(), but an older
+ * committed copy must stay in the log until this transaction commits.
+ * Consumes the caller's reference.
+ */
+void journal_forget(handle_t *handle, struct buffer_head *bh)
+{
+	transaction_t *transaction = handle->h_transaction;
+	journal_t *journal = transaction->t_journal;
+	struct journal_head *jh;
+
+	lock_journal(journal);
+	jh = bh->b_journal_head;
+	if (!jh) {
+		unlock_journal(journal);
+		bforget(bh);
+		return;
+	}
+
+	lock_buffer(bh);
+	mark_buffer_clean(bh);
+	unlock_buffer(bh);
+	if (jh->jh_transaction == transaction && !jh->jh_forget) {
+		list_del(&jh->jh_list);
+		transaction->t_nr_buffers--;
+		jh->jh_transaction = NULL;
+	}
+	if (!jh->jh_transaction) {
+		if (!jh->jh_committing && !jh->jh_cp_transaction) {
+			/* never reached the log */
+			journal_put_journal_head(jh);
+			unlock_journal(journal);
+			bforget(bh);
+			return;
+		}
+		jh->jh_transaction = transaction;
+		jh->jh_forget = 1;
+		list_add_tail(&jh->jh_list, &transaction->t_forget);
+	}
+	unlock_journal(journal);
+	brelse(bh);
+}
+
+/*
+ * A metadata block was freed: older copies of it in the log must not
+ * be replayed over whatever the block is used for next.
+ */
+int journal_revoke(handle_t *handle, unsigned long blocknr)
+{
+	transaction_t *transaction = handle->h_transaction;
+	journal_t *journal = transaction->t_journal;
+	struct journal_revoke *r;
+
+	lock_journal(journal);
+	if (!find_revoke(journal, blocknr)) {
+		r = journal_kmalloc(sizeof(*r));
+		r->r_blocknr = blocknr;
+		r->r_tid = transaction->t_tid;
+		list_add(&r->r_hash, revoke_hash(journal, blocknr));
+		list_add_tail(&r->r_list, &transaction->t_revoke);
+		transaction->t_nr_revokes++;
+	}
+	unlock_journal(journal);
+	return 0;
+}
+
+/*
+ * Commit.  Only kjournald runs this, so commits never overlap.
+ */
+static void journal_write_revoke_records(journal_t *journal,
+		transaction_t *transaction, struct buffer_head **wbuf, int *nr)
+{
+	journal_revoke_header_t *header = NULL;
+	struct buffer_head *bh = NULL;
+	int offset = 0;
+
+	while (!list_empty(&transaction->t_revoke)) {
+		struct journal_revoke *r;
+
+		r = list_entry(transaction->t_revoke.next,
+			       struct journal_revoke, r_list);
+		if (!bh || offset + 4 > journal->j_blocksize) {
+			bh = log_get_block(journal);
+			log_header(bh, JFS_REVOKE_BLOCK, transaction->t_tid);
+			header = (journal_revoke_header_t *) bh->b_data;
+			offset = sizeof(journal_revoke_header_t);
+			wbuf[(*nr)++] = bh;
+		}
+		*((__u32 *) (bh->b_data + offset)) = cpu_to_be32(r->r_blocknr);
+		offset += 4;
+		header->r_count = cpu_to_be32(offset);
+		list_del(&r->r_hash);
+		list_del(&r->r_list);
+		kfree(r);
+	}
+	transaction->t_nr_revokes = 0;
+}
+
+/* Copy the transaction's buffers into the log behind descriptors */
+static void journal_write_metadata(journal_t *journal,
+		transaction_t *transaction, struct buffer_head **wbuf, int *nr)
+{
+	journal_block_tag_t *tag = NULL;
+	struct buffer_head *dbh = NULL;
+	int space_left = 0;
+	char *tagp = NULL;
+
+	while (!list_empty(&transaction->t_buffers)) {
+		struct journal_head *jh;
+		struct buffer_head *bh, *lbh;
+		int flags = 0;
+
+		jh = list_entry(transaction->t_buffers.next,
+				struct journal_head, jh_list);
+		bh = jh->jh_bh;
+		if (!dbh) {
+			dbh = log_get_block(journal);
+			log_header(dbh, JFS_DESCRIPTOR_BLOCK, transaction->t_tid);
+			wbuf[(*nr)++] = dbh;
+			tagp = dbh->b_data + sizeof(journal_header_t);
+			space_left = journal->j_blocksize -
+					sizeof(journal_header_t);
+		} else
+			flags |= JFS_FLAG_SAME_UUID;
+
+		lbh = log_get_block(journal);
+		memcpy(lbh->b_data, bh->b_data, journal->j_blocksize);
+		if (*((__u32 *) lbh->b_data) == cpu_to_be32(JFS_MAGIC_NUMBER)) {
+			*((__u32 *) lbh->b_data) = 0;
+			flags |= JFS_FLAG_ESCAPE;
+		}
+		wbuf[(*nr)++] = lbh;
+		/* what the bitmap will look like once this commits */
+		if (jh->jh_committed_data) {
+			jh->jh_frozen_data = journal_kmalloc(bh->b_size);
+			memcpy(jh->jh_frozen_data, bh->b_data, bh->b_size);
+		}
+
+		tag = (journal_block_tag_t *) tagp;
+		tag->t_blocknr = cpu_to_be32(bh->b_blocknr);
+		tagp += sizeof(journal_block_tag_t);
+		space_left -= sizeof(journal_block_tag_t);
+		if (!(flags & JFS_FLAG_SAME_UUID)) {
+			memcpy(tagp, journal->j_superblock->s_uuid, 16);
+			tagp += 16;
+			space_left -= 16;
+		}
+
+		list_del(&jh->jh_list);
+		jh->jh_transaction = NULL;
+		jh->jh_committing = transaction;
+		list_add_tail(&jh->jh_log_list, &transaction->t_log);
+
+		if (list_empty(&transaction->t_buffers) ||
+		    space_left < sizeof(journal_block_tag_t) + 16) {
+			flags |= JFS_FLAG_LAST_TAG;
+			dbh = NULL;
+		}
+		tag->t_flags = cpu_to_be32(flags);
+	}
+	transaction->t_nr_buffers = 0;
+
+	/* Freed buffers are not logged, their revoke records cover them */
+	while (!list_empty(&transaction->t_forget)) {
+		struct journal_head *jh;
+
+		jh = list_entry(transaction->t_forget.next,
+				struct journal_head, jh_list);
+		list_del(&jh->jh_list);
+		INIT_LIST_HEAD(&jh->jh_list);
+		jh->jh_transaction = NULL;
+		jh->jh_forget = 0;
+		jh->jh_freed = 1;
+		jh->jh_committing = transaction;
+		list_add_tail(&jh->jh_log_list, &transaction->t_log);
+	}
+}
+
+/* Write ordered data, then wait for it */
+static int journal_write_data(transaction_t *transaction)
+{
+	struct list_head *entry;
+	int err = 0;
+
+	list_for_each(entry, &transaction->t_data) {
+		struct journal_data *jd;
+
+		jd = list_entry(entry, struct journal_data, jd_list);
+		ll_rw_block(WRITE, 1, &jd->jd_bh);
+	}
+	while (!list_empty(&transaction->t_data)) {
+		struct journal_data *jd;
+
+		jd = list_entry(transaction->t_data.next,
+				struct journal_data, jd_list);
+		list_del(&jd->jd_list);
+		wait_on_buffer(jd->jd_bh);
+		if (!buffer_uptodate(jd->jd_bh))
+			err = -EIO;
+		brelse(jd->jd_bh);
+		kfree(jd);
+	}
+	return err;
+}
+
+/* After the commit block is on disk: hand the buffers to checkpointing */
+static void journal_finish_commit(journal_t *journal,
+				  transaction_t *transaction)
+{
+	while (!list_empty(&transaction->t_log)) {
+		struct journal_head *jh;
+
+		jh = list_entry(transaction->t_log.next,
+				struct journal_head, jh_log_list);
+		list_del(&jh->jh_log_list);
+		INIT_LIST_HEAD(&jh->jh_log_list);
+		jh->jh_committing = NULL;
+		if (jh->jh_frozen_data) {
+			/* the frees of this transaction are final now */
+			kfree(jh->jh_committed_data);
+			jh->jh_committed_data = NULL;
+			if (jh->jh_transaction)
+				jh->jh_committed_data = jh->jh_frozen_data;
+			else
+				kfree(jh->jh_frozen_data);
+			jh->jh_frozen_data = NULL;
+		}
+		if (jh->jh_freed || is_journal_aborted(journal)) {
+			jh->jh_freed = 0;
+			if (!is_journal_aborted(journal))
+				journal_remove_checkpoint(jh);
+		} else {
+			journal_remove_checkpoint(jh);
+			jh->jh_cp_transaction = transaction;
+			list_add_tail(&jh->jh_cp_list, &transaction->t_checkpoint);
+			/* a newer transaction writes it home in its turn */
+			if (!jh->jh_transaction)
+				mark_buffer_dirty(jh->jh_bh);
+		}
+		journal_put_journal_head(jh);
+	}
+}
+
+/* Throw away a transaction that can no longer be committed */
+static void journal_discard_transaction(transaction_t *transaction)
+{
+	struct list_head *lists[2];
+	int i;
+
+	lists[0] = &transaction->t_buffers;
+	lists[1] = &transaction->t_forget;
+	for (i = 0; i < 2; i++)
+		while (!list_empty(lists[i])) {
+			struct journal_head *jh;
+
+			jh = list_entry(lists[i]->next, struct journal_head,
+					jh_list);
+			list_del(&jh->jh_list);
+			INIT_LIST_HEAD(&jh->jh_list);
+			jh->jh_transaction = NULL;
+			jh->jh_forget = 0;
+			journal_put_journal_head(jh);
+		}
+	while (!list_empty(&transaction->t_revoke)) {
+		struct journal_revoke *r;
+
+		r = list_entry(transaction->t_revoke.next,
+			       struct journal_revoke, r_list);
+		list_del(&r->r_hash);
+		list_del(&r->r_list);
+		kfree(r);
+	}
+	while (!list_empty(&transaction->t_data)) {
+		struct journal_data *jd;
+
+		jd = list_entry(transaction->t_data.next,
+				struct journal_data, jd_list);
+		list_del(&jd->jd_list);
+		brelse(jd->jd_bh);
+		kfree(jd);
+	}
+}
+
+static void journal_commit_transaction(journal_t *journal)
+{
+	transaction_t *transaction;
+	struct buffer_head **wbuf, *cbh;
+	int nr = 0, needed, i, err;
+
+	lock_journal(journal);
+	transaction = journal->j_running;
+	if (!transaction) {
+		unlock_journal(journal);
+		return;
+	}
+
+	/* Hold off new handles and let the open ones finish */
+	transaction->t_state = T_LOCKED;
+	while (transaction->t_updates) {
+		unlock_journal(journal);
+		wait_event(journal->j_wait_updates, !transaction->t_updates);
+		lock_journal(journal);
+	}
+
+	needed = log_space_needed(journal, transaction);
+	if (!is_journal_aborted(journal) && needed > journal->j_free) {
+		printk(KERN_ERR "journal: transaction %u needs %d log blocks, "
+		       "only %lu free\n", transaction->t_tid, needed,
+		       journal->j_free);
+		journal_abort(journal);
+	}
+	if (is_journal_aborted(journal)) {
+		journal_discard_transaction(transaction);
+		journal->j_running = NULL;
+		unlock_journal(journal);
+		kfree(transaction);
+		wake_up(&journal->j_wait_transaction_locked);
+		wake_up(&journal->j_wait_done_commit);
+		return;
+	}
+
+	wbuf = journal_kmalloc(needed * sizeof(*wbuf));
+	transaction->t_log_start = journal->j_head;
+	journal_write_revoke_records(journal, transaction, wbuf, &nr);
+	journal_write_metadata(journal, transaction, wbuf, &nr);
+	cbh = log_get_block(journal);
+	log_header(cbh, JFS_COMMIT_BLOCK, transaction->t_tid);
+
+	/* Everything is copied: handles may modify the buffers again */
+	journal->j_committing = transaction;
+	journal->j_running = NULL;
+	transaction->t_state = T_COMMIT;
+	unlock_journal(journal);
+	wake_up(&journal->j_wait_transaction_locked);
+
+	err = journal_write_data(transaction);
+	for (i = 0; i < nr; i++)
+		mark_buffer_dirty(wbuf[i]);
+	for (i = 0; i < nr; i += CP_BATCH) {
+		int n = nr - i < CP_BATCH ? nr - i : CP_BATCH;
+
+		if (journal_write_buffers(wbuf + i, n))
+			err = -EIO;
+	}
+	kfree(wbuf);
+	if (!err) {
+		mark_buffer_dirty(cbh);
+		err = journal_write_buffers(&cbh, 1);
+	} else
+		brelse(cbh);
+
+	lock_journal(journal);
+	if (err)
+		journal_abort(journal);
+	journal_finish_commit(journal, transaction);
+	if (is_journal_aborted(journal)) {
+		kfree(transaction);
+	} else {
+		transaction->t_state = T_FINISHED;
+		list_add_tail(&transaction->t_cplist, &journal->j_checkpoint);
+		journal->j_commit_sequence = transaction->t_tid;
+	}
+	journal->j_committing = NULL;
+	if (journal->j_free < (journal->j_last - journal->j_first) / 2)
+		__log_cleanup(journal);
+	unlock_journal(journal);
+	wake_up(&journal->j_wait_done_commit);
+}
+
+static void log_start_commit(journal_t *journal, tid_t tid)
+{
+	lock_journal(journal);
+	if (tid_gt(tid, journal->j_commit_request))
+		journal->j_commit_request = tid;
+	unlock_journal(journal);
+	wake_up(&journal->j_wait_commit);
+}
+
+static int log_wait_commit(journal_t *journal, tid_t tid)
+{
+	wait_event(journal->j_wait_done_commit,
+		   tid_geq(journal->j_commit_sequence, tid) ||
+		   is_journal_aborted(journal));
+	return is_journal_aborted(journal) ? -EIO : 0;
+}
+
+static inline int commit_due(journal_t *journal)
+{
+	transaction_t *transaction = journal->j_running;
+
+	return transaction &&
+		(tid_geq(journal->j_commit_request, transaction->t_tid) ||
+		 time_after_eq(jiffies, transaction->t_expires));
+}
+
+static int kjournald(void *arg)
+{
+	journal_t *journal = arg;
+	struct task_struct *tsk = current;
+	DECLARE_WAITQUEUE(wait, tsk);
+
+	daemonize();
+	strcpy(tsk->comm, "kjournald");
+	spin_lock_irq(&tsk->sigmask_lock);
+	sigfillset(&tsk->blocked);
+	recalc_sigpending(tsk);
+	spin_unlock_irq(&tsk->sigmask_lock);
+
+	journal->j_task = tsk;
+	up(&journal->j_exit_sem);
+
+	for (;;) {
+		long timeout = MAX_SCHEDULE_TIMEOUT;
+
+		lock_journal(journal);
+		if (commit_due(journal)) {
+			unlock_journal(journal);
+			journal_commit_transaction(journal);
+			continue;
+		}
+		if (journal->j_flags & JFS_UNMOUNT) {
+			unlock_journal(journal);
+			break;
+		}
+		if (journal->j_running)
+			timeout = journal->j_running->t_expires - jiffies;
+		unlock_journal(journal);
+
+		add_wait_queue(&journal->j_wait_commit, &wait);
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!commit_due(journal) && !(journal->j_flags & JFS_UNMOUNT))
+			schedule_timeout(timeout);
+		set_current_state(TASK_RUNNING);
+		remove_wait_queue(&journal->j_wait_commit, &wait);
+	}
+
+	journal->j_task = NULL;
+	up(&journal->j_exit_sem);
+	return 0;
+}
+
+/* Commit everything done so far and wait for it.  Not from a handle. */
+int journal_force_commit(journal_t *journal)
+{
+	transaction_t *transaction;
+	tid_t tid;
+
+	lock_journal(journal);
+	transaction = journal->j_running;
+	if (!transaction)
+		transaction = journal->j_committing;
+	if (!transaction) {
+		unlock_journal(journal);
+		return 0;
+	}
+	tid = transaction->t_tid;
+	unlock_journal(journal);
+
+	log_start_commit(journal, tid);
+	return log_wait_commit(journal, tid);
+}
+
+/* Ask kjournald to commit the running transaction, without waiting */
+void journal_start_commit(journal_t *journal)
+{
+	transaction_t *transaction;
+	tid_t tid = 0;
+
+	lock_journal(journal);
+	transaction = journal->j_running;
+	if (transaction)
+		tid = transaction->t_tid;
+	unlock_journal(journal);
+	if (transaction)
+		log_start_commit(journal, tid);
+}
+
+/* Commit and checkpoint everything, leaving the log empty */
+int journal_flush(journal_t *journal)
+{
+	int err = journal_force_commit(journal);
+
+	lock_journal(journal);
+	while (!is_journal_aborted(journal) &&
+	       (!list_empty(&journal->j_checkpoint) || journal->j_committing))
+		log_do_checkpoint(journal);
+	if (!is_journal_aborted(journal)) {
+		journal->j_tail = journal->j_head;
+		journal->j_tail_sequence = journal->j_transaction_sequence;
+		journal_update_superblock(journal);
+		log_update_free(journal);
+	} else
+		err = -EIO;
+	unlock_journal(journal);
+	return err;
+}
+
+/*
+ * Recovery.
+ */
+#define PASS_SCAN	0
+#define PASS_REVOKE	1
+#define PASS_REPLAY	2
+
+struct recovery_info {
+	tid_t	start_transaction;
+	tid_t	end_transaction;
+	int	nr_replays;
+	int	nr_revokes;
+};
+
+static int jread(struct buffer_head **bhp, journal_t *journal,
+		 unsigned long offset)
+{
+	struct buffer_head *bh;
+
+	*bhp = NULL;
+	if (offset >= journal->j_last) {
+		printk(KERN_ERR "journal: log block %lu out of range\n", offset);
+		return -EIO;
+	}
+	bh = bread(journal->j_dev, journal->j_blockmap[offset],
+		   journal->j_blocksize);
+	if (!bh) {
+		printk(KERN_ERR "journal: I/O error reading log block %lu\n",
+		       offset);
+		return -EIO;
+	}
+	*bhp = bh;
+	return 0;
+}
+
+static inline unsigned long log_wrap(journal_t *journal, unsigned long block)
+{
+	if (block >= journal->j_last)
+		block -= journal->j_last - journal->j_first;
+	return block;
+}
+
+static int count_tags(struct buffer_head *bh, int size)
+{
+	char *tagp = bh->b_data + sizeof(journal_header_t);
+	int nr = 0;
+
+	while (tagp - bh->b_data + sizeof(journal_block_tag_t) <= size) {
+		journal_block_tag_t *tag = (journal_block_tag_t *) tagp;
+
+		nr++;
+		tagp += sizeof(journal_block_tag_t);
+		if (!(tag->t_flags & cpu_to_be32(JFS_FLAG_SAME_UUID)))
+			tagp += 16;
+		if (tag->t_flags & cpu_to_be32(JFS_FLAG_LAST_TAG))
+			break;
+	}
+	return nr;
+}
+
+/* Remember the newest transaction which revoked each block */
+static int set_revoke(journal_t *journal, unsigned long blocknr, tid_t tid)
+{
+	struct journal_revoke *r = find_revoke(journal, blocknr);
+
+	if (r) {
+		if (tid_gt(tid, r->r_tid))
+			r->r_tid = tid;
+		return 0;
+	}
+	r = kmalloc(sizeof(*r), GFP_KERNEL);
+	if (!r)
+		return -ENOMEM;
+	r->r_blocknr = blocknr;
+	r->r_tid = tid;
+	list_add(&r->r_hash, revoke_hash(journal, blocknr));
+	INIT_LIST_HEAD(&r->r_list);
+	return 0;
+}
+
+static void clear_revokes(journal_t *journal)
+{
+	int i;
+
+	for (i = 0; i < JOURNAL_REVOKE_HASH; i++)
+		while (!list_empty(&journal->j_revoke_hash[i])) {
+			struct journal_revoke *r;
+
+			r = list_entry(journal->j_revoke_hash[i].next,
+				       struct journal_revoke, r_hash);
+			list_del(&r->r_hash);
+			kfree(r);
+		}
+}
+
+static int scan_revoke_records(journal_t *journal, struct buffer_head *bh,
+			       tid_t tid, struct recovery_info *info)
+{
+	journal_revoke_header_t *header = (journal_revoke_header_t *) bh->b_data;
+	int offset = sizeof(journal_revoke_header_t);
+	int max = be32_to_cpu(header->r_count);
+	int err;
+
+	if (max > journal->j_blocksize)
+		return -EINVAL;
+	while (offset + 4 <= max) {
+		err = set_revoke(journal,
+				 be32_to_cpu(*((__u32 *) (bh->b_data + offset))),
+				 tid);
+		if (err)
+			return err;
+		offset += 4;
+		info->nr_revokes++;
+	}
+	return 0;
+}
+
+static int replay_block(journal_t *journal, unsigned long io_block,
+			unsigned long blocknr, int flags,
+			struct buffer_head **wbuf, int *nr)
+{
+	struct buffer_head *obh, *nbh;
+	int err;
+
+	err = jread(&obh, journal, io_block);
+	if (err)
+		return err;
+	nbh = getblk(journal->j_dev, blocknr, journal->j_blocksize);
+	lock_buffer(nbh);
+	memcpy(nbh->b_data, obh->b_data, journal->j_blocksize);
+	if (flags & JFS_FLAG_ESCAPE)
+		*((__u32 *) nbh->b_data) = cpu_to_be32(JFS_MAGIC_NUMBER);
+	mark_buffer_uptodate(nbh, 1);
+	unlock_buffer(nbh);
+	mark_buffer_dirty(nbh);
+	brelse(obh);
+
+	wbuf[(*nr)++] = nbh;
+	if (*nr == CP_BATCH) {
+		err = journal_write_buffers(wbuf, *nr);
+		*nr = 0;
+	}
+	return err;
+}
+
+static int do_one_pass(journal_t *journal, struct recovery_info *info,
+		       int pass)
+{
+	journal_superblock_t *sb = journal->j_superblock;
+	unsigned long next_log_block = be32_to_cpu(sb->s_start);
+	tid_t next_commit_ID = be32_to_cpu(sb->s_sequence);
+	struct buffer_head *wbuf[CP_BATCH];
+	int nr = 0, err = 0;
+
+	info->start_transaction = next_commit_ID;
+	for (;;) {
+		journal_header_t *header;
+		struct buffer_head *bh;
+		char *tagp;
+
+		if (pass != PASS_SCAN &&
+		    tid_geq(next_commit_ID, info->end_transaction))
+			break;
+		err = jread(&bh, journal, next_log_block);
+		if (err)
+			goto out;
+		next_log_block = log_wrap(journal, next_log_block + 1);
+
+		header = (journal_header_t *) bh->b_data;
+		if (header->h_magic != cpu_to_be32(JFS_MAGIC_NUMBER) ||
+		    be32_to_cpu(header->h_sequence) != next_commit_ID) {
+			brelse(bh);
+			break;
+		}
+
+		switch (be32_to_cpu(header->h_blocktype)) {
+		case JFS_DESCRIPTOR_BLOCK:
+			if (pass != PASS_REPLAY) {
+				next_log_block = log_wrap(journal, next_log_block +
+					count_tags(bh, journal->j_blocksize));
+				break;
+			}
+			tagp = bh->b_data + sizeof(journal_header_t);
+			while (tagp - bh->b_data + sizeof(journal_block_tag_t) <=
+			       journal->j_blocksize) {
+				journal_block_tag_t *tag = (journal_block_tag_t *) tagp;
+				unsigned long io_block = next_log_block;
+				unsigned long blocknr = be32_to_cpu(tag->t_blocknr);
+				int flags = be32_to_cpu(tag->t_flags);
+				struct journal_revoke *r;
+
+				next_log_block = log_wrap(journal, next_log_block + 1);
+				r = find_revoke(journal, blocknr);
+				if (!r || tid_gt(next_commit_ID, r->r_tid)) {
+					err = replay_block(journal, io_block, blocknr,
+							   flags, wbuf, &nr);
+					if (err) {
+						brelse(bh);
+						goto out;
+					}
+					info->nr_replays++;
+				}
+				tagp += sizeof(journal_block_tag_t);
+				if (!(flags & JFS_FLAG_SAME_UUID))
+					tagp += 16;
+				if (flags & JFS_FLAG_LAST_TAG)
+					break;
+			}
+			break;
+
+		case JFS_COMMIT_BLOCK:
+			next_commit_ID++;
+			break;
+
+		case JFS_REVOKE_BLOCK:
+			if (pass == PASS_REVOKE) {
+				err = scan_revoke_records(journal, bh,
+							  next_commit_ID, info);
+				if (err) {
+					brelse(bh);
+					goto out;
+				}
+			}
+			break;
+
+		default:
+			brelse(bh);
+			goto done;
+		}
+		brelse(bh);
+	}
+done:
+	if (pass == PASS_SCAN)
+		info->end_transaction = next_commit_ID;
+	else if (info->end_transaction != next_commit_ID) {
+		printk(KERN_ERR "journal: recovery pass %d ended at transaction "
+		       "%u, expected %u\n", pass, next_commit_ID,
+		       info->end_transaction);
+		err = -EIO;
+	}
+out:
+	if (nr && journal_write_buffers(wbuf, nr))
+		err = -EIO;
+	return err;
+}
+
+static int journal_recover(journal_t *journal)
+{
+	journal_superblock_t *sb = journal->j_superblock;
+	struct recovery_info info;
+	int err;
+
+	if (!sb->s_start) {
+		journal->j_transaction_sequence = be32_to_cpu(sb->s_sequence) + 1;
+		return 0;
+	}
+
+	memset(&info, 0, sizeof(info));
+	err = do_one_pass(journal, &info, PASS_SCAN);
+	if (!err)
+		err = do_one_pass(journal, &info, PASS_REVOKE);
+	if (!err)
+		err = do_one_pass(journal, &info, PASS_REPLAY);
+	clear_revokes(journal);
+
+	printk(KERN_INFO "journal: recovered transactions %u-%u on %s: "
+	       "%d blocks replayed, %d revoke records\n",
+	       info.start_transaction, info.end_transaction - 1,
+	       kdevname(journal->j_dev), info.nr_replays, info.nr_revokes);
+	journal->j_transaction_sequence = info.end_transaction + 1;
+	return err;
+}
+
+/*
+ * Setup and teardown.
+ */
+journal_t *journal_init_inode(struct inode *inode)
+{
+	int blocksize = inode->i_sb->s_blocksize;
+	unsigned long blocks, i;
+	journal_t *journal;
+
+	journal = kmalloc(sizeof(*journal), GFP_KERNEL);
+	if (!journal)
+		return NULL;
+	memset(journal, 0, sizeof(*journal));
+	journal->j_dev = inode->i_dev;
+	journal->j_blocksize = blocksize;
+	journal->j_inode = inode;
+	journal->j_commit_interval = 5 * HZ;
+	init_MUTEX(&journal->j_sem);
+	init_MUTEX_LOCKED(&journal->j_exit_sem);
+	INIT_LIST_HEAD(&journal->j_checkpoint);
+	for (i = 0; i < JOURNAL_REVOKE_HASH; i++)
+		INIT_LIST_HEAD(&journal->j_revoke_hash[i]);
+	init_waitqueue_head(&journal->j_wait_transaction_locked);
+	init_waitqueue_head(&journal->j_wait_updates);
+	init_waitqueue_head(&journal->j_wait_commit);
+	init_waitqueue_head(&journal->j_wait_done_commit);
+
+	blocks = inode->i_size >> inode->i_sb->s_blocksize_bits;
+	if (blocks < JFS_MIN_JOURNAL_BLOCKS) {
+		printk(KERN_ERR "journal: inode %lu too small for a journal\n",
+		       inode->i_ino);
+		goto out;
+	}
+	journal->j_last = blocks;
+	journal->j_blockmap = vmalloc(blocks * sizeof(unsigned long));
+	if (!journal->j_blockmap)
+		goto out;
+	for (i = 0; i < blocks; i++) {
+		journal->j_blockmap[i] = bmap(inode, i);
+		if (!journal->j_blockmap[i]) {
+			printk(KERN_ERR "journal: hole at block %lu of inode %lu\n",
+			       i, inode->i_ino);
+			goto out_map;
+		}
+	}
+
+	journal->j_sb_buffer = bread(journal->j_dev, journal->j_blockmap[0],
+				     blocksize);
+	if (!journal->j_sb_buffer)
+		goto out_map;
+	journal->j_superblock = (journal_superblock_t *)
+					journal->j_sb_buffer->b_data;
+	return journal;
+
+out_map:
+	vfree(journal->j_blockmap);
+out:
+	kfree(journal);
+	return NULL;
+}
+
+/* Check the log superblock, replay the log and start kjournald */
+int journal_load(journal_t *journal)
+{
+	journal_superblock_t *sb = journal->j_superblock;
+	unsigned long maxlen;
+	int err;
+
+	if (sb->s_header.h_magic != cpu_to_be32(JFS_MAGIC_NUMBER) ||
+	    (sb->s_header.h_blocktype != cpu_to_be32(JFS_SUPERBLOCK_V1) &&
+	     sb->s_header.h_blocktype != cpu_to_be32(JFS_SUPERBLOCK_V2))) {
+		printk(KERN_ERR "journal: no valid journal superblock found\n");
+		return -EINVAL;
+	}
+	if (sb->s_header.h_blocktype == cpu_to_be32(JFS_SUPERBLOCK_V2) &&
+	    (sb->s_feature_incompat &
+	     ~cpu_to_be32(JFS_KNOWN_INCOMPAT_FEATURES))) {
+		printk(KERN_ERR "journal: unknown incompatible features\n");
+		return -EINVAL;
+	}
+	maxlen = be32_to_cpu(sb->s_maxlen);
+	if (be32_to_cpu(sb->s_blocksize) != journal->j_blocksize ||
+	    maxlen > journal->j_last || maxlen < JFS_MIN_JOURNAL_BLOCKS ||
+	    !sb->s_first || be32_to_cpu(sb->s_first) >= maxlen) {
+		printk(KERN_ERR "journal: journal superblock is inconsistent\n");
+		return -EINVAL;
+	}
+	journal->j_first = be32_to_cpu(sb->s_first);
+	journal->j_last = maxlen;
+
+	err = journal_recover(journal);
+	if (err)
+		return err;
+
+	journal->j_head = journal->j_tail = journal->j_first;
+	log_update_free(journal);
+	journal->j_max_transaction_buffers =
+		(journal->j_last - journal->j_first) / 4;
+	journal->j_tail_sequence = journal->j_transaction_sequence;
+	journal->j_commit_sequence = journal->j_transaction_sequence - 1;
+	journal->j_commit_request = journal->j_commit_sequence;
+	journal_update_superblock(journal);
+
+	kernel_thread(kjournald, journal, CLONE_FS | CLONE_FILES | CLONE_SIGNAL);
+	down(&journal->j_exit_sem);
+	return 0;
+}
+
+void journal_destroy(journal_t *journal)
+{
+	if (journal->j_task) {
+		journal_flush(journal);
+
+		lock_journal(journal);
+		journal->j_flags |= JFS_UNMOUNT;
+		unlock_journal(journal);
+		wake_up(&journal->j_wait_commit);
+		down(&journal->j_exit_sem);
+
+		if (!is_journal_aborted(journal)) {
+			journal->j_tail = 0;
+			journal->j_tail_sequence =
+				journal->j_transaction_sequence;
+			journal_update_superblock(journal);
+		}
+	}
+
+	/* After an abort buffers may still wait for a checkpoint */
+	while (!list_empty(&journal->j_checkpoint)) {
+		transaction_t *transaction;
+
+		transaction = list_entry(journal->j_checkpoint.next,
+					 transaction_t, t_cplist);
+		while (!list_empty(&transaction->t_checkpoint)) {
+			struct journal_head *jh;
+
+			jh = list_entry(transaction->t_checkpoint.next,
+					struct journal_head, jh_cp_list);
+			journal_remove_checkpoint(jh);
+			journal_put_journal_head(jh);
+		}
+		list_del(&transaction->t_cplist);
+		kfree(transaction);
+	}
+	if (journal->j_running) {
+		journal_discard_transaction(journal->j_running);
+		kfree(journal->j_running);
+	}
+
+	brelse(journal->j_sb_buffer);
+	vfree(journal->j_blockmap);
+	kfree(journal);
+}
+
+static int __init journal_setup(void)
+{
+	journal_head_cachep = kmem_cache_create("journal_head",
+					sizeof(struct journal_head),
+					0, SLAB_HWCACHE_ALIGN, NULL, NULL);
+	if (!journal_head_cachep)
+		panic("Cannot create journal_head SLAB cache");
+	return 0;
+}
+
+module_init(journal_setup)
@@ -254,6 +254,8 @@ static struct dentry * cached_lookup(struct dentry * parent, struct qstr * name,
 			dentry = NULL;
 		}
 	}
+	if (dentry && !dentry->d_inode)
+		dentry_stat.nr_negative_hits++;
 	return dentry;
 }
 
@@ -282,7 +284,15 @@ static struct dentry * real_lookup(struct dentry * parent, struct qstr * name, i
 	if (!result) {
 		struct dentry * dentry = d_alloc(parent, name);
 		result = ERR_PTR(-ENOMEM);
-		if (dentry) {
+		if (dentry && (parent->d_flags & DCACHE_COMPLETE)) {
+			/*
+			 * Every name in the directory is in the dcache
+			 * and we hold i_sem, so it isn't there.
+			 */
+			dentry_stat.nr_complete_hits++;
+			d_add(dentry, NULL);
+			result = dentry;
+		} else if (dentry) {
 			lock_kernel();
 			result = dir->i_op->lookup(dir, dentry);
 			unlock_kernel();
@@ -1073,6 +1083,15 @@ ok:
 			goto exit;
 	}
 
+	/*
+	 * O_DIRECT on regular files needs support from the filesystem.
+	 * Refuse it before the file is truncated.
+	 */
+	error = -EINVAL;
+	if ((flag & O_DIRECT) && S_ISREG(inode->i_mode) &&
+	    !inode->i_mapping->a_ops->direct_IO)
+		goto exit;
+
 	/*
 	 * Ensure there are no outstanding leases on the file.
 	 */
@@ -1260,9 +1279,24 @@ int vfs_mkdir(struct inode *dir, struct dentry *dentry, int mode)
 
 	DQUOT_INIT(dir);
 	mode &= (S_IRWXUGO|S_ISVTX) & ~current->fs->umask;
+	/*
+	 * The new directory starts out empty, so all of its names will
+	 * go through the dcache. Mark it before anything can be created
+	 * in it, and drop the mark again if mkdir fails.
+	 */
+	if (dir->i_sb->s_type->fs_flags & FS_COMPLETE_DIRS) {
+		spin_lock(&dcache_lock);
+		dentry->d_flags |= DCACHE_COMPLETE;
+		spin_unlock(&dcache_lock);
+	}
 	lock_kernel();
 	error = dir->i_op->mkdir(dir, dentry, mode);
 	unlock_kernel();
+	if (error) {
+		spin_lock(&dcache_lock);
+		dentry->d_flags &= ~DCACHE_COMPLETE;
+		spin_unlock(&dcache_lock);
+	}
 
 exit_lock:
 	up(&dir->i_zombie);
@@ -642,6 +642,11 @@ struct file *dentry_open(struct dentry *dentry, struct vfsmount *mnt, int flags)
 	f->f_flags = flags;
 	f->f_mode = (flags+1) & O_ACCMODE;
 	inode = dentry->d_inode;
+	/* O_DIRECT on regular files needs support from the filesystem */
+	error = -EINVAL;
+	if ((flags & O_DIRECT) && S_ISREG(inode->i_mode) &&
+	    !inode->i_mapping->a_ops->direct_IO)
+		goto cleanup_file;
 	if (f->f_mode & FMODE_WRITE) {
 		error = get_write_access(inode);
 		if (error)
@@ -654,7 +659,7 @@ struct file *dentry_open(struct dentry *dentry, struct vfsmount *mnt, int flags)
 	f->f_reada = 0;
 	f->f_op = fops_get(inode->i_fop);
 	if (inode->i_sb)
-		file_move(f, &inode->i_sb->s_files);
+		file_move_sb(f, inode->i_sb);
 	if (f->f_op && f->f_op->open) {
 		error = f->f_op->open(inode,f);
 		if (error)
@@ -690,9 +695,7 @@ int get_unused_fd(void)
 	write_lock(&files->file_lock);
 
 repeat:
- 	fd = find_next_zero_bit(files->open_fds, 
-				files->max_fdset, 
-				files->next_fd);
+ 	fd = find_next_fd(files, files->next_fd);
 
 	/*
 	 * N.B. For clone tasks sharing a files structure, this test
@@ -723,7 +726,7 @@ repeat:
 		goto out;
 	}
 
-	FD_SET(fd, files->open_fds);
+	__set_open_fd(files, fd);
 	FD_CLR(fd, files->close_on_exec);
 	files->next_fd = fd + 1;
 #if 1
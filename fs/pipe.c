@@ -6,6 +6,8 @@
 
 #include <linux/mm.h>
 #include <linux/file.h>
+#include <linux/pagemap.h>
+#include <linux/highmem.h>
 #include <linux/poll.h>
 #include <linux/malloc.h>
 #include <linux/module.h>
@@ -14,9 +16,11 @@
 #include <asm/uaccess.h>
 
 /*
- * We use a start+len construction, which provides full use of the 
- * allocated memory.
- * -- Florian Coosmann (FGC)
+ * A pipe is a ring of up to PIPE_BUFFERS page references.  write()
+ * appends to the last page while there is room in it and otherwise
+ * starts a new one; read() consumes pages from the head and hands
+ * emptied ones back.  splice() links page cache pages straight into
+ * the ring, so file data can go through a pipe without being copied.
  * 
  * Reads with count = 0 should always return 0.
  * -- Julian Bradfield 1999-06-07.
@@ -35,11 +39,56 @@ void pipe_wait(struct inode * inode)
 	down(PIPE_SEM(*inode));
 }
 
+/* Bytes a writer can add without waiting */
+static inline size_t pipe_free(struct inode *inode)
+{
+	size_t free = (PIPE_BUFFERS - PIPE_NRBUFS(*inode)) * PAGE_SIZE;
+
+	if (!PIPE_EMPTY(*inode)) {
+		struct pipe_buffer *pbuf = PIPE_TAIL(*inode);
+		if (pbuf->flags & PIPE_BUF_PRIVATE)
+			free += PAGE_SIZE - pbuf->offset - pbuf->len;
+	}
+	return free;
+}
+
+static struct page *pipe_get_page(struct inode *inode)
+{
+	struct page *page = inode->i_pipe->tmp_page;
+
+	if (page) {
+		inode->i_pipe->tmp_page = NULL;
+		return page;
+	}
+	return alloc_page(GFP_HIGHUSER);
+}
+
+static void pipe_put_page(struct inode *inode, struct page *page, int private)
+{
+	/* Keep one of our own pages around for the next write */
+	if (private && !inode->i_pipe->tmp_page && page_count(page) == 1) {
+		inode->i_pipe->tmp_page = page;
+		return;
+	}
+	page_cache_release(page);
+}
+
+/* Drop the buffer at the head of the ring once it is used up */
+static void pipe_consume(struct inode *inode, struct pipe_buffer *pbuf)
+{
+	if (pbuf->len)
+		return;
+	pipe_put_page(inode, pbuf->page, pbuf->flags & PIPE_BUF_PRIVATE);
+	pbuf->page = NULL;
+	PIPE_CURBUF(*inode) = (PIPE_CURBUF(*inode) + 1) & (PIPE_BUFFERS-1);
+	PIPE_NRBUFS(*inode)--;
+}
+
 static ssize_t
 pipe_read(struct file *filp, char *buf, size_t count, loff_t *ppos)
 {
 	struct inode *inode = filp->f_dentry->d_inode;
-	ssize_t size, read, ret;
+	ssize_t read, ret;
 
 	/* Seeks are not allowed on pipes.  */
 	ret = -ESPIPE;
@@ -84,30 +133,30 @@ do_more_read:
 
 	/* Read what data is available.  */
 	ret = -EFAULT;
-	while (count > 0 && (size = PIPE_LEN(*inode))) {
-		char *pipebuf = PIPE_BASE(*inode) + PIPE_START(*inode);
-		ssize_t chars = PIPE_MAX_RCHUNK(*inode);
+	while (count > 0 && !PIPE_EMPTY(*inode)) {
+		struct pipe_buffer *pbuf = PIPE_HEAD(*inode);
+		ssize_t chars = pbuf->len;
+		char *kaddr;
+		int error;
 
 		if (chars > count)
 			chars = count;
-		if (chars > size)
-			chars = size;
 
-		if (copy_to_user(buf, pipebuf, chars))
+		kaddr = kmap(pbuf->page);
+		error = copy_to_user(buf, kaddr + pbuf->offset, chars);
+		kunmap(pbuf->page);
+		if (error)
 			goto out;
 
 		read += chars;
-		PIPE_START(*inode) += chars;
-		PIPE_START(*inode) &= (PIPE_SIZE - 1);
+		pbuf->offset += chars;
+		pbuf->len -= chars;
 		PIPE_LEN(*inode) -= chars;
 		count -= chars;
 		buf += chars;
+		pipe_consume(inode, pbuf);
 	}
 
-	/* Cache behaviour optimization */
-	if (!PIPE_LEN(*inode))
-		PIPE_START(*inode) = 0;
-
 	if (count && PIPE_WAITING_WRITERS(*inode) && !(filp->f_flags & O_NONBLOCK)) {
 		/*
 		 * We know that we are going to sleep: signal
@@ -162,10 +211,10 @@ pipe_write(struct file *filp, const char *buf, size_t count, loff_t *ppos)
 	/* Wait, or check for, available space.  */
 	if (filp->f_flags & O_NONBLOCK) {
 		ret = -EAGAIN;
-		if (PIPE_FREE(*inode) < free)
+		if (pipe_free(inode) < free)
 			goto out;
 	} else {
-		while (PIPE_FREE(*inode) < free) {
+		while (pipe_free(inode) < free) {
 			PIPE_WAITING_WRITERS(*inode)++;
 			pipe_wait(inode);
 			PIPE_WAITING_WRITERS(*inode)--;
@@ -181,47 +230,82 @@ pipe_write(struct file *filp, const char *buf, size_t count, loff_t *ppos)
 	/* Copy into available space.  */
 	ret = -EFAULT;
 	while (count > 0) {
-		int space;
-		char *pipebuf = PIPE_BASE(*inode) + PIPE_END(*inode);
-		ssize_t chars = PIPE_MAX_WCHUNK(*inode);
-
-		if ((space = PIPE_FREE(*inode)) != 0) {
-			if (chars > count)
-				chars = count;
-			if (chars > space)
-				chars = space;
-
-			if (copy_from_user(pipebuf, buf, chars))
+		struct pipe_buffer *pbuf = NULL;
+		struct page *page;
+		unsigned int offset;
+		ssize_t chars;
+		char *kaddr;
+		int error;
+
+		/* Append to the last page if it is ours and has room.. */
+		if (!PIPE_EMPTY(*inode)) {
+			pbuf = PIPE_TAIL(*inode);
+			if (!(pbuf->flags & PIPE_BUF_PRIVATE) ||
+			    pbuf->offset + pbuf->len == PAGE_SIZE)
+				pbuf = NULL;
+		}
+		if (pbuf) {
+			page = pbuf->page;
+			offset = pbuf->offset + pbuf->len;
+		} else if (!PIPE_FULL(*inode)) {
+			/* .. or start a new one */
+			ret = -ENOMEM;
+			page = pipe_get_page(inode);
+			if (!page)
 				goto out;
+			ret = -EFAULT;
+			offset = 0;
+		} else {
+			ret = written;
+			if (filp->f_flags & O_NONBLOCK)
+				break;
 
-			written += chars;
-			PIPE_LEN(*inode) += chars;
-			count -= chars;
-			buf += chars;
-			space = PIPE_FREE(*inode);
+			do {
+				/*
+				 * Synchronous wake-up: it knows that this process
+				 * is going to give up this CPU, so it doesnt have
+				 * to do idle reschedules.
+				 */
+				wake_up_interruptible_sync(PIPE_WAIT(*inode));
+				PIPE_WAITING_WRITERS(*inode)++;
+				pipe_wait(inode);
+				PIPE_WAITING_WRITERS(*inode)--;
+				if (signal_pending(current))
+					goto out;
+				if (!PIPE_READERS(*inode))
+					goto sigpipe;
+			} while (PIPE_FULL(*inode));
+			ret = -EFAULT;
 			continue;
 		}
 
-		ret = written;
-		if (filp->f_flags & O_NONBLOCK)
-			break;
+		chars = PAGE_SIZE - offset;
+		if (chars > count)
+			chars = count;
 
-		do {
-			/*
-			 * Synchronous wake-up: it knows that this process
-			 * is going to give up this CPU, so it doesnt have
-			 * to do idle reschedules.
-			 */
-			wake_up_interruptible_sync(PIPE_WAIT(*inode));
-			PIPE_WAITING_WRITERS(*inode)++;
-			pipe_wait(inode);
-			PIPE_WAITING_WRITERS(*inode)--;
-			if (signal_pending(current))
-				goto out;
-			if (!PIPE_READERS(*inode))
-				goto sigpipe;
-		} while (!PIPE_FREE(*inode));
-		ret = -EFAULT;
+		kaddr = kmap(page);
+		error = copy_from_user(kaddr + offset, buf, chars);
+		kunmap(page);
+		if (error) {
+			if (!pbuf)
+				pipe_put_page(inode, page, 1);
+			goto out;
+		}
+
+		if (pbuf) {
+			pbuf->len += chars;
+		} else {
+			PIPE_NRBUFS(*inode)++;
+			pbuf = PIPE_TAIL(*inode);
+			pbuf->page = page;
+			pbuf->offset = 0;
+			pbuf->len = chars;
+			pbuf->flags = PIPE_BUF_PRIVATE;
+		}
+		written += chars;
+		PIPE_LEN(*inode) += chars;
+		count -= chars;
+		buf += chars;
 	}
 
 	/* Signal readers asynchronously that there is more data.  */
@@ -285,9 +369,11 @@ pipe_poll(struct file *filp, poll_table *wait)
 	poll_wait(filp, PIPE_WAIT(*inode), wait);
 
 	/* Reading only -- no need for acquiring the semaphore.  */
-	mask = POLLIN | POLLRDNORM;
-	if (PIPE_EMPTY(*inode))
-		mask = POLLOUT | POLLWRNORM;
+	mask = 0;
+	if (!PIPE_EMPTY(*inode))
+		mask |= POLLIN | POLLRDNORM;
+	if (!PIPE_FULL(*inode))
+		mask |= POLLOUT | POLLWRNORM;
 	if (!PIPE_WRITERS(*inode) && filp->f_version != PIPE_WCOUNTER(*inode))
 		mask |= POLLHUP;
 	if (!PIPE_READERS(*inode))
@@ -306,10 +392,7 @@ pipe_release(struct inode *inode, int decr, int decw)
 	PIPE_READERS(*inode) -= decr;
 	PIPE_WRITERS(*inode) -= decw;
 	if (!PIPE_READERS(*inode) && !PIPE_WRITERS(*inode)) {
-		struct pipe_inode_info *info = inode->i_pipe;
-		inode->i_pipe = NULL;
-		free_page((unsigned long) info->base);
-		kfree(info);
+		free_pipe_info(inode);
 	} else {
 		wake_up_interruptible(PIPE_WAIT(*inode));
 	}
@@ -441,27 +524,34 @@ struct file_operations rdwr_pipe_fops = {
 
 struct inode* pipe_new(struct inode* inode)
 {
-	unsigned long page;
-
-	page = __get_free_page(GFP_USER);
-	if (!page)
-		return NULL;
-
 	inode->i_pipe = kmalloc(sizeof(struct pipe_inode_info), GFP_KERNEL);
 	if (!inode->i_pipe)
-		goto fail_page;
+		return NULL;
 
+	memset(inode->i_pipe, 0, sizeof(struct pipe_inode_info));
 	init_waitqueue_head(PIPE_WAIT(*inode));
-	PIPE_BASE(*inode) = (char*) page;
-	PIPE_START(*inode) = PIPE_LEN(*inode) = 0;
+	PIPE_LEN(*inode) = 0;
 	PIPE_READERS(*inode) = PIPE_WRITERS(*inode) = 0;
 	PIPE_WAITING_READERS(*inode) = PIPE_WAITING_WRITERS(*inode) = 0;
 	PIPE_RCOUNTER(*inode) = PIPE_WCOUNTER(*inode) = 1;
 
 	return inode;
-fail_page:
-	free_page(page);
-	return NULL;
+}
+
+/* Drop whatever is still in the pipe, and the pipe itself */
+void free_pipe_info(struct inode* inode)
+{
+	struct pipe_inode_info *info = inode->i_pipe;
+	int i;
+
+	inode->i_pipe = NULL;
+	for (i = 0; i < PIPE_BUFFERS; i++) {
+		if (info->bufs[i].page)
+			page_cache_release(info->bufs[i].page);
+	}
+	if (info->tmp_page)
+		page_cache_release(info->tmp_page);
+	kfree(info);
 }
 
 static struct vfsmount *pipe_mnt;
@@ -576,9 +666,7 @@ close_f12_inode_i_j:
 close_f12_inode_i:
 	put_unused_fd(i);
 close_f12_inode:
-	free_page((unsigned long) PIPE_BASE(*inode));
-	kfree(inode->i_pipe);
-	inode->i_pipe = NULL;
+	free_pipe_info(inode);
 	iput(inode);
 close_f12:
 	put_filp(f2);
@@ -588,6 +676,232 @@ no_files:
 	return error;	
 }
 
+/*
+ * splice() moves data between a pipe and a file or socket through page
+ * references.  Pages from the page cache are linked into the pipe
+ * without copying, and pages leave the pipe through the same actor
+ * sendfile() uses, so sockets get them via ->sendpage().  Spliced pages
+ * are shared with the page cache: later writes to the file show through.
+ */
+static inline struct inode *file_pipe_inode(struct file *file)
+{
+	struct inode *inode = file->f_dentry->d_inode;
+
+	if (S_ISFIFO(inode->i_mode) && inode->i_pipe)
+		return inode;
+	return NULL;
+}
+
+/* read_actor_t that links file pages into the pipe in desc->buf */
+static int pipe_splice_actor(read_descriptor_t * desc, struct page *page, unsigned long offset, unsigned long size)
+{
+	struct file *filp = (struct file *) desc->buf;
+	struct inode *inode = filp->f_dentry->d_inode;
+	struct pipe_buffer *pbuf;
+
+	if (size > desc->count)
+		size = desc->count;
+
+	while (PIPE_FULL(*inode)) {
+		if (filp->f_flags & O_NONBLOCK) {
+			if (!desc->written)
+				desc->error = -EAGAIN;
+			return 0;
+		}
+		wake_up_interruptible_sync(PIPE_WAIT(*inode));
+		PIPE_WAITING_WRITERS(*inode)++;
+		pipe_wait(inode);
+		PIPE_WAITING_WRITERS(*inode)--;
+		if (signal_pending(current)) {
+			desc->error = -ERESTARTSYS;
+			return 0;
+		}
+		if (!PIPE_READERS(*inode)) {
+			desc->error = -EPIPE;
+			return 0;
+		}
+	}
+
+	page_cache_get(page);
+	PIPE_NRBUFS(*inode)++;
+	pbuf = PIPE_TAIL(*inode);
+	pbuf->page = page;
+	pbuf->offset = offset;
+	pbuf->len = size;
+	pbuf->flags = 0;
+	PIPE_LEN(*inode) += size;
+
+	desc->count -= size;
+	desc->written += size;
+	return size;
+}
+
+static ssize_t splice_to_pipe(struct file *in, loff_t *ppos, struct file *out, size_t len)
+{
+	struct inode *inode = out->f_dentry->d_inode;
+	read_descriptor_t desc;
+
+	if (down_interruptible(PIPE_SEM(*inode)))
+		return -ERESTARTSYS;
+
+	desc.written = 0;
+	desc.count = len;
+	desc.buf = (char *) out;
+	desc.error = 0;
+	if (PIPE_READERS(*inode))
+		do_generic_file_read(in, ppos, &desc, pipe_splice_actor);
+	else
+		desc.error = -EPIPE;
+
+	if (desc.written) {
+		wake_up_interruptible(PIPE_WAIT(*inode));
+		inode->i_ctime = inode->i_mtime = CURRENT_TIME;
+		mark_inode_dirty(inode);
+	}
+	up(PIPE_SEM(*inode));
+
+	if (desc.written)
+		return desc.written;
+	if (desc.error == -EPIPE)
+		send_sig(SIGPIPE, current, 0);
+	return desc.error;
+}
+
+static ssize_t splice_from_pipe(struct file *in, struct file *out, size_t len)
+{
+	struct inode *inode = in->f_dentry->d_inode;
+	read_descriptor_t desc;
+	ssize_t ret;
+
+	if (down_interruptible(PIPE_SEM(*inode)))
+		return -ERESTARTSYS;
+
+	while (PIPE_EMPTY(*inode)) {
+		ret = 0;
+		if (!PIPE_WRITERS(*inode))
+			goto out;
+		ret = -EAGAIN;
+		if (in->f_flags & O_NONBLOCK)
+			goto out;
+		PIPE_WAITING_READERS(*inode)++;
+		pipe_wait(inode);
+		PIPE_WAITING_READERS(*inode)--;
+		ret = -ERESTARTSYS;
+		if (signal_pending(current))
+			goto out;
+	}
+
+	/*
+	 * Only ask for what is in the pipe, so that the actor does not
+	 * tell a socket more is coming after the last page.
+	 */
+	desc.written = 0;
+	desc.count = len;
+	if (desc.count > PIPE_LEN(*inode))
+		desc.count = PIPE_LEN(*inode);
+	desc.buf = (char *) out;
+	desc.error = 0;
+	while (desc.count && !PIPE_EMPTY(*inode)) {
+		struct pipe_buffer *pbuf = PIPE_HEAD(*inode);
+		size_t chars = pbuf->len;
+		int written;
+
+		if (chars > desc.count)
+			chars = desc.count;
+		written = file_send_actor(&desc, pbuf->page, pbuf->offset, chars);
+		pbuf->offset += written;
+		pbuf->len -= written;
+		PIPE_LEN(*inode) -= written;
+		pipe_consume(inode, pbuf);
+		if (written != chars)
+			break;
+	}
+	ret = desc.written;
+	if (!ret)
+		ret = desc.error;
+	if (desc.written)
+		wake_up_interruptible(PIPE_WAIT(*inode));
+out:
+	up(PIPE_SEM(*inode));
+	return ret;
+}
+
+/*
+ * Like sendfile(), only a regular file on the input side can be given
+ * an offset; otherwise the file positions are used and updated.
+ */
+asmlinkage ssize_t sys_splice(int fd_in, loff_t *off_in, int fd_out, size_t len, unsigned int flags)
+{
+	struct file *in, *out;
+	struct inode *in_inode, *out_inode;
+	loff_t pos, *ppos;
+	ssize_t ret;
+
+	ret = -EINVAL;
+	if (flags)
+		goto out;
+
+	ret = -EBADF;
+	in = fget(fd_in);
+	if (!in)
+		goto out;
+	if (!(in->f_mode & FMODE_READ))
+		goto fput_in;
+	out = fget(fd_out);
+	if (!out)
+		goto fput_in;
+	if (!(out->f_mode & FMODE_WRITE))
+		goto fput_out;
+
+	ret = 0;
+	if (!len)
+		goto fput_out;
+
+	in_inode = file_pipe_inode(in);
+	out_inode = file_pipe_inode(out);
+	ret = -EINVAL;
+	if (in_inode && out_inode)
+		goto fput_out;
+
+	if (in_inode) {
+		ret = -ESPIPE;
+		if (off_in)
+			goto fput_out;
+		ret = -EINVAL;
+		if (!out->f_op || !out->f_op->write)
+			goto fput_out;
+		out_inode = out->f_dentry->d_inode;
+		ret = locks_verify_area(FLOCK_VERIFY_WRITE, out_inode, out, out->f_pos, len);
+		if (ret)
+			goto fput_out;
+		ret = splice_from_pipe(in, out, len);
+	} else if (out_inode) {
+		in_inode = in->f_dentry->d_inode;
+		if (!in_inode->i_mapping->a_ops->readpage)
+			goto fput_out;
+		ppos = &in->f_pos;
+		if (off_in) {
+			ret = -EFAULT;
+			if (copy_from_user(&pos, off_in, sizeof(loff_t)))
+				goto fput_out;
+			ppos = &pos;
+		}
+		ret = locks_verify_area(FLOCK_VERIFY_READ, in_inode, in, *ppos, len);
+		if (ret)
+			goto fput_out;
+		ret = splice_to_pipe(in, ppos, out, len);
+		if (off_in && copy_to_user(off_in, &pos, sizeof(loff_t)))
+			ret = -EFAULT;
+	}
+
+fput_out:
+	fput(out);
+fput_in:
+	fput(in);
+out:
+	return ret;
+}
+
 /*
  * pipefs should _never_ be mounted by userland - too much of security hassle,
  * no real gain from having the whole whorehouse mounted. So we don't need
@@ -381,28 +381,31 @@ static void proc_kill_inodes(struct proc_dir_entry *de)
 {
 	struct list_head *p;
 	struct super_block *sb = proc_mnt->mnt_sb;
+	int cpu;
 
 	/*
 	 * Actually it's a partial revoke().
 	 */
-	file_list_lock();
-	for (p = sb->s_files.next; p != &sb->s_files; p = p->next) {
-		struct file * filp = list_entry(p, struct file, f_list);
-		struct dentry * dentry;
-		struct inode * inode;
-
-		dentry = filp->f_dentry;
-		if (!dentry)
-			continue;
-		if (dentry->d_op != &proc_dentry_operations)
-			continue;
-		inode = dentry->d_inode;
-		if (inode->u.generic_ip != de)
-			continue;
-		fops_put(filp->f_op);
-		filp->f_op = NULL;
+	for (cpu = 0; cpu < NR_CPUS; cpu++) {
+		sb_file_list_lock(cpu);
+		for (p = sb->s_files[cpu].next; p != &sb->s_files[cpu]; p = p->next) {
+			struct file * filp = list_entry(p, struct file, f_list);
+			struct dentry * dentry;
+			struct inode * inode;
+
+			dentry = filp->f_dentry;
+			if (!dentry)
+				continue;
+			if (dentry->d_op != &proc_dentry_operations)
+				continue;
+			inode = dentry->d_inode;
+			if (inode->u.generic_ip != de)
+				continue;
+			fops_put(filp->f_op);
+			filp->f_op = NULL;
+		}
+		sb_file_list_unlock(cpu);
 	}
-	file_list_unlock();
 }
 
 struct proc_dir_entry *proc_symlink(const char *name,
@@ -68,6 +68,9 @@ extern int get_irq_list(char *);
 extern int get_dma_list(char *);
 extern int get_locks_status (char *, char **, off_t, int);
 extern int get_swaparea_info (char *);
+extern int get_buffer_lock_stats(char *);
+extern int get_writeback_stats(char *);
+extern int get_request_sizes(char *);
 #ifdef CONFIG_SGI_DS1286
 extern int get_ds1286_status(char *);
 #endif
@@ -430,6 +433,27 @@ static int swaps_read_proc(char *page, char **start, off_t off,
 	return proc_calc_metrics(page, start, off, count, eof, len);
 }
 
+static int buffer_locks_read_proc(char *page, char **start, off_t off,
+				 int count, int *eof, void *data)
+{
+	int len = get_buffer_lock_stats(page);
+	return proc_calc_metrics(page, start, off, count, eof, len);
+}
+
+static int writeback_read_proc(char *page, char **start, off_t off,
+				 int count, int *eof, void *data)
+{
+	int len = get_writeback_stats(page);
+	return proc_calc_metrics(page, start, off, count, eof, len);
+}
+
+static int request_sizes_read_proc(char *page, char **start, off_t off,
+				 int count, int *eof, void *data)
+{
+	int len = get_request_sizes(page);
+	return proc_calc_metrics(page, start, off, count, eof, len);
+}
+
 static int memory_read_proc(char *page, char **start, off_t off,
 				 int count, int *eof, void *data)
 {
@@ -543,6 +567,9 @@ void __init proc_misc_init(void)
 		{"locks",	locks_read_proc},
 		{"mounts",	mounts_read_proc},
 		{"swaps",	swaps_read_proc},
+		{"buffer_locks",	buffer_locks_read_proc},
+		{"writeback",	writeback_read_proc},
+		{"request_sizes",	request_sizes_read_proc},
 		{"iomem",	memory_read_proc},
 		{"execdomains",	execdomains_read_proc},
 		{NULL,}
@@ -692,6 +692,7 @@ out:
 struct super_block *get_empty_super(void)
 {
 	struct super_block *s;
+	int i;
 
 	for (s  = sb_entry(super_blocks.next);
 	     s != sb_entry(&super_blocks); 
@@ -710,9 +711,11 @@ struct super_block *get_empty_super(void)
 		nr_super_blocks++;
 		memset(s, 0, sizeof(struct super_block));
 		INIT_LIST_HEAD(&s->s_dirty);
+		INIT_LIST_HEAD(&s->s_inodes);
 		list_add (&s->s_list, super_blocks.prev);
 		init_waitqueue_head(&s->s_wait);
-		INIT_LIST_HEAD(&s->s_files);
+		for (i = 0; i < NR_CPUS; i++)
+			INIT_LIST_HEAD(&s->s_files[i]);
 		INIT_LIST_HEAD(&s->s_mounts);
 	}
 	return s;
@@ -227,6 +227,15 @@
 #define __NR_madvise1		219	/* delete when C lib stub is removed */
 #define __NR_getdents64		220
 #define __NR_fcntl64		221
+#define __NR_io_setup		223
+#define __NR_io_destroy		224
+#define __NR_io_submit		225
+#define __NR_io_getevents	226
+#define __NR_io_cancel		227
+#define __NR_splice		228
+#define __NR_epoll_create	229
+#define __NR_epoll_ctl		230
+#define __NR_epoll_wait		231
 
 /* user-visible error numbers are in the range -1 - -124: see <asm-i386/errno.h> */
 
@@ -21,7 +21,7 @@
 #define O_RSYNC		02000000 /* HPUX only */
 
 #define FASYNC		00020000 /* fcntl, for BSD compatibility */
-#define O_DIRECT	00040000 /* direct disk access hint - currently ignored */
+#define O_DIRECT	00040000 /* direct disk access */
 #define O_DIRECTORY	00010000 /* must be a directory */
 #define O_NOFOLLOW	00000200 /* don't follow links */
 
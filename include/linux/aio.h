@@ -0,0 +1,92 @@
+#ifndef __LINUX_AIO_H
+#define __LINUX_AIO_H
+
+/*
+ * Asynchronous block I/O on raw devices and O_DIRECT files.
+ *
+ * A process sets up a context with io_setup(), queues requests on it
+ * with io_submit() and collects their completions with io_getevents().
+ */
+
+#include <linux/types.h>
+
+typedef unsigned long	aio_context_t;
+
+#define IOCB_CMD_PREAD		0
+#define IOCB_CMD_PWRITE		1
+
+/* A request, as passed to io_submit() */
+struct iocb {
+	__u64	aio_data;		/* returned in io_event.data */
+	__u32	aio_fildes;
+	__u16	aio_lio_opcode;		/* IOCB_CMD_* */
+	__s16	aio_reqprio;		/* not used yet */
+	__u64	aio_buf;
+	__u64	aio_nbytes;
+	__s64	aio_offset;
+	__u64	aio_reserved[2];
+};
+
+/* A completion, as returned by io_getevents() and io_cancel() */
+struct io_event {
+	__u64	data;			/* the request's aio_data */
+	__u64	obj;			/* the struct iocb it came from */
+	__s64	res;			/* bytes transferred or -errno */
+	__s64	res2;
+};
+
+#ifdef __KERNEL__
+
+#include <linux/list.h>
+#include <linux/iobuf.h>
+#include <linux/wait.h>
+#include <linux/spinlock.h>
+
+#define AIO_MAX_REQS	4096	/* per context */
+
+/*
+ * Where a request on a file goes on disk, as worked out by the
+ * f_op->aio_map method. blocks[] entries of -1UL are holes.
+ */
+struct kio_map {
+	kdev_t		dev;
+	int		blocksize;
+	int		nr_blocks;
+	size_t		valid;		/* bytes of the I/O that are inside the file */
+	struct inode	*inode;		/* kept from truncate until the I/O is done */
+	unsigned long	blocks[KIO_MAX_SECTORS];
+};
+
+struct kioctx {
+	struct kioctx		*next;		/* on mm->ioctx_list */
+	aio_context_t		id;		/* what user space knows it by */
+	atomic_t		users;
+	int			dead;
+	spinlock_t		lock;		/* taken from interrupts */
+	wait_queue_head_t	wait;		/* for completions */
+	struct list_head	active_reqs;	/* in flight */
+	struct list_head	done_reqs;	/* completed, not yet reaped */
+	int			nr_reqs;	/* active + done */
+	int			max_reqs;
+};
+
+struct kiocb {
+	struct kiobuf		iobuf;		/* must be first */
+	struct list_head	list;
+	struct kioctx		*ctx;
+	struct file		*filp;
+	struct iocb		*user_iocb;
+	__u64			data;
+	int			nr_bh;
+	struct kio_map		map;
+	struct buffer_head	*bh[KIO_MAX_SECTORS];
+};
+
+struct mm_struct;
+
+/* fs/aio.c */
+extern void exit_aio(struct mm_struct *);
+
+#endif /* __KERNEL__ */
+
+#endif /* __LINUX_AIO_H */
@@ -4,7 +4,10 @@
 #ifdef __KERNEL__
 
 #include <asm/atomic.h>
+#include <asm/system.h>
+#include <linux/spinlock.h>
 #include <linux/mount.h>
+#include <linux/rcupdate.h>
 
 /*
  * linux/include/linux/dcache.h
@@ -59,6 +62,7 @@ static __inline__ unsigned int full_name_hash(const unsigned char * name, unsign
 struct dentry {
 	atomic_t d_count;
 	unsigned int d_flags;
+	spinlock_t d_lock;		/* d_count vs. lockless lookup, d_name, d_parent, d_hash */
 	struct inode  * d_inode;	/* Where the name belongs to - NULL is negative */
 	struct dentry * d_parent;	/* parent directory */
 	struct list_head d_vfsmnt;
@@ -73,6 +77,7 @@ struct dentry {
 	struct super_block * d_sb;	/* The root of the dentry tree */
 	unsigned long d_reftime;	/* last time referenced */
 	void * d_fsdata;		/* fs-specific data */
+	struct rcu_head d_rcu;		/* deferred freeing */
 	unsigned char d_iname[DNAME_INLINE_LEN]; /* small names */
 };
 
@@ -94,13 +99,13 @@ struct dentry_operations {
 
 /*
 locking rules:
-		big lock	dcache_lock	may block
-d_revalidate:	no		no		yes
-d_hash		no		no		yes
-d_compare:	no		yes		no
-d_delete:	no		yes		no
-d_release:	no		no		yes
-d_iput:		no		no		yes
+		big lock	dcache_lock	d_lock	may block
+d_revalidate:	no		no		no	yes
+d_hash		no		no		no	yes
+d_compare:	no		maybe		yes	no
+d_delete:	no		yes		yes	no
+d_release:	no		no		no	yes
+d_iput:		no		no		no	yes
  */
 
 /* d_flags entries */
@@ -115,9 +120,66 @@ d_iput:		no		no		yes
 					 * If this dentry points to a directory, then
 					 * s_nfsd_free_path semaphore will be down
 					 */
+#define DCACHE_COMPLETE	0x0008	/* directory: every name in it has a hashed
+					 * dentry, so a miss needs no ->lookup().
+					 * Changed under dcache_lock.
+					 */
 
 extern spinlock_t dcache_lock;
 
+/* /proc/sys/fs/dentry-state */
+struct dentry_stat_t {
+	int nr_dentry;
+	int nr_unused;
+	int age_limit;		/* seconds a negative dentry is kept in preference */
+	int want_pages;		/* pages requested by system */
+	int nr_negative_hits;	/* lookups answered by a negative dentry */
+	int nr_complete_hits;	/* misses answered by DCACHE_COMPLETE */
+};
+extern struct dentry_stat_t dentry_stat;
+
+/*
+ * d_lookup() walks the hash chains without dcache_lock. d_hash_seq is
+ * odd while a chain is being changed (under dcache_lock), and a walk
+ * that sees it change falls back to taking the lock.
+ */
+extern unsigned int d_hash_seq;
+
+static __inline__ void d_hash_write_begin(void)
+{
+	d_hash_seq++;
+	wmb();
+}
+
+static __inline__ void d_hash_write_end(void)
+{
+	wmb();
+	d_hash_seq++;
+}
+
+/*
+ * Called with dcache_lock and dentry->d_lock held. A name that still
+ * exists may be going out of the cache, so the parent directory is
+ * no longer known to be complete.
+ */
+static __inline__ void __d_unhash(struct dentry * dentry)
+{
+	if (dentry->d_inode)
+		dentry->d_parent->d_flags &= ~DCACHE_COMPLETE;
+	d_hash_write_begin();
+	list_del(&dentry->d_hash);
+	INIT_LIST_HEAD(&dentry->d_hash);
+	d_hash_write_end();
+}
+
+/* Called with dcache_lock held */
+static __inline__ void __d_drop(struct dentry * dentry)
+{
+	spin_lock(&dentry->d_lock);
+	__d_unhash(dentry);
+	spin_unlock(&dentry->d_lock);
+}
+
 /**
  * d_drop - drop a dentry
  * @dentry: dentry to drop
@@ -138,8 +200,7 @@ extern spinlock_t dcache_lock;
 static __inline__ void d_drop(struct dentry * dentry)
 {
 	spin_lock(&dcache_lock);
-	list_del(&dentry->d_hash);
-	INIT_LIST_HEAD(&dentry->d_hash);
+	__d_drop(dentry);
 	spin_unlock(&dcache_lock);
 }
 
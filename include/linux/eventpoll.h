@@ -0,0 +1,35 @@
+#ifndef _LINUX_EVENTPOLL_H
+#define _LINUX_EVENTPOLL_H
+
+/*
+ * Persistent interest sets for poll events.
+ *
+ * Files are registered once with epoll_ctl(); epoll_wait() then
+ * returns only the ones that are ready, however many are watched.
+ */
+
+#include <linux/types.h>
+#include <asm/poll.h>
+
+#define EPOLL_CTL_ADD	1
+#define EPOLL_CTL_DEL	2
+#define EPOLL_CTL_MOD	3
+
+/* Report a file once per wakeup rather than for as long as it is ready */
+#define EPOLLET		(1U << 31)
+
+struct epoll_event {
+	__u32	events;		/* POLL* bits, plus EPOLLET */
+	__u64	data;		/* returned as is */
+};
+
+#ifdef __KERNEL__
+
+struct file;
+
+/* fs/eventpoll.c */
+extern void eventpoll_release(struct file *file);
+
+#endif /* __KERNEL__ */
+
+#endif /* _LINUX_EVENTPOLL_H */
@@ -28,10 +28,13 @@
 #undef EXT2FS_DEBUG
 
 /*
- * Define EXT2_PREALLOCATE to preallocate data blocks for expanding files
+ * Define EXT2_PREALLOCATE to preallocate data blocks for expanding files.
+ * The window doubles, up to EXT2_MAX_PREALLOC_BLOCKS, each time a file
+ * writing sequentially uses it up.
  */
 #define EXT2_PREALLOCATE
 #define EXT2_DEFAULT_PREALLOC_BLOCKS	8
+#define EXT2_MAX_PREALLOC_BLOCKS	256
 
 /*
  * The second extended file system version
@@ -61,6 +64,7 @@
 #define EXT2_ACL_DATA_INO	 4	/* ACL inode */
 #define EXT2_BOOT_LOADER_INO	 5	/* Boot loader inode */
 #define EXT2_UNDEL_DIR_INO	 6	/* Undelete directory inode */
+#define EXT2_JOURNAL_INO	 8	/* Journal inode */
 
 /* First non-reserved inode for old ext2 filesystems */
 #define EXT2_GOOD_OLD_FIRST_INO	11
@@ -197,12 +201,21 @@ struct ext2_group_desc
 #define EXT2_NOCOMP_FL			0x00000400 /* Don't compress */
 #define EXT2_ECOMPR_FL			0x00000800 /* Compression error */
 /* End compression flags --- maybe not all used */	
-#define EXT2_BTREE_FL			0x00001000 /* btree format dir */
+#define EXT2_INDEX_FL			0x00001000 /* hash-indexed directory */
+#define EXT2_BTREE_FL			EXT2_INDEX_FL /* its old name */
+#define EXT2_INLINE_DATA_FL		0x10000000 /* data kept in the inode */
 #define EXT2_RESERVED_FL		0x80000000 /* reserved for ext2 lib */
 
 #define EXT2_FL_USER_VISIBLE		0x00001FFF /* User visible flags */
 #define EXT2_FL_USER_MODIFIABLE		0x000000FF /* User modifiable flags */
 
+/*
+ * An inline file keeps its data in i_block, and on filesystems with
+ * inodes larger than 128 bytes, in the rest of the inode after that.
+ */
+#define EXT2_INLINE_DATA_SIZE(s)	(EXT2_N_BLOCKS * 4 + EXT2_INODE_SIZE(s) - \
+					 EXT2_GOOD_OLD_INODE_SIZE)
+
 /*
  * ioctl commands
  */
@@ -314,6 +327,11 @@ struct ext2_inode {
 #define EXT2_MOUNT_ERRORS_PANIC		0x0040	/* Panic on errors */
 #define EXT2_MOUNT_MINIX_DF		0x0080	/* Mimics the Minix statfs */
 #define EXT2_MOUNT_NO_UID32		0x0200  /* Disable 32-bit UIDs */
+#define EXT2_MOUNT_DELALLOC		0x0400	/* Allocate data blocks at writeback */
+#define EXT2_MOUNT_INDEX		0x0800	/* Turn on hashed directory indexes */
+#define EXT2_MOUNT_OLDALLOC		0x1000	/* Spread out every directory */
+#define EXT2_MOUNT_NOJOURNAL		0x2000	/* Ignore the journal */
+#define EXT2_MOUNT_INLINE		0x4000	/* Keep small files in their inodes */
 
 #define clear_opt(o, opt)		o &= ~EXT2_MOUNT_##opt
 #define set_opt(o, opt)			o |= EXT2_MOUNT_##opt
@@ -392,7 +410,14 @@ struct ext2_super_block {
 	__u8	s_prealloc_blocks;	/* Nr of blocks to try to preallocate*/
 	__u8	s_prealloc_dir_blocks;	/* Nr to preallocate for dirs */
 	__u16	s_padding1;
-	__u32	s_reserved[204];	/* Padding to the end of the block */
+	/*
+	 * Journaling support, valid if EXT2_FEATURE_COMPAT_HAS_JOURNAL.
+	 */
+	__u8	s_journal_uuid[16];	/* uuid of journal superblock */
+	__u32	s_journal_inum;		/* inode number of journal file */
+	__u32	s_journal_dev;		/* device number of journal file */
+	__u32	s_last_orphan;		/* start of list of inodes to delete */
+	__u32	s_reserved[197];	/* Padding to the end of the block */
 };
 
 #ifdef __KERNEL__
@@ -448,6 +473,8 @@ struct ext2_super_block {
 	EXT2_SB(sb)->s_es->s_feature_incompat &= ~cpu_to_le32(mask)
 
 #define EXT2_FEATURE_COMPAT_DIR_PREALLOC	0x0001
+#define EXT2_FEATURE_COMPAT_HAS_JOURNAL		0x0004
+#define EXT2_FEATURE_COMPAT_DIR_INDEX		0x0020
 
 #define EXT2_FEATURE_RO_COMPAT_SPARSE_SUPER	0x0001
 #define EXT2_FEATURE_RO_COMPAT_LARGE_FILE	0x0002
@@ -455,9 +482,14 @@ struct ext2_super_block {
 
 #define EXT2_FEATURE_INCOMPAT_COMPRESSION	0x0001
 #define EXT2_FEATURE_INCOMPAT_FILETYPE		0x0002
-
-#define EXT2_FEATURE_COMPAT_SUPP	0
-#define EXT2_FEATURE_INCOMPAT_SUPP	EXT2_FEATURE_INCOMPAT_FILETYPE
+#define EXT2_FEATURE_INCOMPAT_RECOVER		0x0004	/* journal needs replay */
+#define EXT2_FEATURE_INCOMPAT_INLINE_DATA	0x0020	/* EXT2_INLINE_DATA_FL */
+
+#define EXT2_FEATURE_COMPAT_SUPP	(EXT2_FEATURE_COMPAT_DIR_INDEX| \
+					 EXT2_FEATURE_COMPAT_HAS_JOURNAL)
+#define EXT2_FEATURE_INCOMPAT_SUPP	(EXT2_FEATURE_INCOMPAT_FILETYPE| \
+					 EXT2_FEATURE_INCOMPAT_RECOVER| \
+					 EXT2_FEATURE_INCOMPAT_INLINE_DATA)
 #define EXT2_FEATURE_RO_COMPAT_SUPP	(EXT2_FEATURE_RO_COMPAT_SPARSE_SUPER| \
 					 EXT2_FEATURE_RO_COMPAT_LARGE_FILE| \
 					 EXT2_FEATURE_RO_COMPAT_BTREE_DIR)
@@ -519,6 +551,16 @@ struct ext2_dir_entry_2 {
 #define EXT2_DIR_REC_LEN(name_len)	(((name_len) + 8 + EXT2_DIR_ROUND) & \
 					 ~EXT2_DIR_ROUND)
 
+/*
+ * Journal credits: how many metadata blocks a handle may dirty
+ */
+#define EXT2_INODE_TRANS_BLOCKS		1	/* the inode table block */
+#define EXT2_ALLOC_TRANS_BLOCKS		8	/* bitmap, group, indirects, inode */
+#define EXT2_WRITE_TRANS_BLOCKS		32	/* a page worth of allocations */
+#define EXT2_DIROP_TRANS_BLOCKS		32	/* new inode, entry, index split */
+#define EXT2_RENAME_TRANS_BLOCKS	48
+#define EXT2_TRUNCATE_TRANS_BLOCKS	64	/* per step of a truncate */
+
 #ifdef __KERNEL__
 /*
  * Function prototypes
@@ -538,11 +580,12 @@ extern int ext2_permission (struct inode *, int);
 /* balloc.c */
 extern int ext2_bg_has_super(struct super_block *sb, int group);
 extern unsigned long ext2_bg_num_gdb(struct super_block *sb, int group);
-extern int ext2_new_block (const struct inode *, unsigned long,
-			   __u32 *, __u32 *, int *);
+extern int ext2_new_blocks (const struct inode *, unsigned long,
+			    unsigned long *, int, int *);
 extern void ext2_free_blocks (const struct inode *, unsigned long,
 			      unsigned long);
 extern unsigned long ext2_count_free_blocks (struct super_block *);
+extern int ext2_reserve_blocks (struct inode *, int);
 extern void ext2_check_blocks_bitmap (struct super_block *);
 extern struct ext2_group_desc * ext2_get_group_desc(struct super_block * sb,
 						    unsigned int block_group,
@@ -569,6 +612,7 @@ extern struct inode * ext2_new_inode (const struct inode *, int);
 extern void ext2_free_inode (struct inode *);
 extern unsigned long ext2_count_free_inodes (struct super_block *);
 extern void ext2_check_inodes_bitmap (struct super_block *);
+extern unsigned long ext2_count_dirs (struct super_block *);
 
 /* inode.c */
 
@@ -577,15 +621,37 @@ extern struct buffer_head * ext2_bread (struct inode *, int, int, int *);
 
 extern void ext2_read_inode (struct inode *);
 extern void ext2_write_inode (struct inode *, int);
+extern void ext2_dirty_inode (struct inode *);
 extern void ext2_put_inode (struct inode *);
 extern void ext2_delete_inode (struct inode *);
 extern int ext2_sync_inode (struct inode *);
 extern void ext2_discard_prealloc (struct inode *);
+extern void ext2_init_inline (struct inode *);
+extern int ext2_map_read_proc (char *, char **, off_t, int, int *, void *);
 
 /* ioctl.c */
 extern int ext2_ioctl (struct inode *, struct file *, unsigned int,
 		       unsigned long);
 
+/* journal.c */
+extern int ext2_journal_start (struct super_block *, int);
+extern int ext2_journal_stop (struct super_block *);
+extern void ext2_journal_restart (struct inode *, struct buffer_head *);
+extern int ext2_journal_access (struct super_block *, struct buffer_head *);
+extern int ext2_journal_undo_access (struct super_block *, struct buffer_head *);
+extern char * ext2_journal_bitmap (struct super_block *, struct buffer_head *);
+extern void ext2_journal_dirty (struct super_block *, struct buffer_head *);
+extern void ext2_journal_dirty_inode (struct buffer_head *, struct inode *);
+extern int ext2_journal_sync (struct super_block *, struct buffer_head *);
+extern void ext2_journal_forget (struct super_block *, struct buffer_head *);
+extern void ext2_journal_free_data (struct inode *, unsigned long,
+				    unsigned long);
+extern void ext2_journal_data (struct inode *, struct buffer_head *);
+extern int ext2_force_commit (struct super_block *);
+extern void ext2_start_commit (struct super_block *);
+extern int ext2_load_journal (struct super_block *);
+extern void ext2_destroy_journal (struct super_block *);
+
 /* namei.c */
 extern struct inode_operations ext2_dir_inode_operations;
 
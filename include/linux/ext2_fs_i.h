@@ -16,6 +16,18 @@
 #ifndef _LINUX_EXT2_FS_I
 #define _LINUX_EXT2_FS_I
 
+/*
+ * A run of logical blocks mapped onto contiguous disk blocks,
+ * cached by ext2_get_block(). len == 0 means the slot is unused.
+ */
+struct ext2_map_extent {
+	__u32	lblock;
+	__u32	pblock;
+	__u32	len;
+};
+
+#define EXT2_MAP_EXTENTS	4
+
 /*
  * second extended file system inode data in memory
  */
@@ -35,8 +47,12 @@ struct ext2_inode_info {
 	__u32	i_next_alloc_goal;
 	__u32	i_prealloc_block;
 	__u32	i_prealloc_count;
+	__u32	i_prealloc_window;	/* size of the next window */
 	__u32	i_high_size;
 	int	i_new_inode:1;	/* Is a freshly allocated inode */
+	struct ext2_map_extent i_map[EXT2_MAP_EXTENTS];
+	__u32	i_map_next;	/* slot to replace next */
+	__u32	i_map_gen;	/* bumped by truncate */
 };
 
 #endif	/* _LINUX_EXT2_FS_I */
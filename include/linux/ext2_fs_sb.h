@@ -22,7 +22,13 @@
  */
 /* #define EXT2_MAX_GROUP_DESC	8 */
 
-#define EXT2_MAX_GROUP_LOADED	8
+/*
+ * Free space summary for a block group, kept in memory only
+ */
+struct ext2_group_info {
+	unsigned long gi_max_run;	/* no free run in the group is longer */
+	unsigned char gi_debt;		/* directories made here lately */
+};
 
 /*
  * second extended-fs super-block data in memory
@@ -41,12 +47,8 @@ struct ext2_sb_info {
 	struct buffer_head * s_sbh;	/* Buffer containing the super block */
 	struct ext2_super_block * s_es;	/* Pointer to the super block in the buffer */
 	struct buffer_head ** s_group_desc;
-	unsigned short s_loaded_inode_bitmaps;
-	unsigned short s_loaded_block_bitmaps;
-	unsigned long s_inode_bitmap_number[EXT2_MAX_GROUP_LOADED];
-	struct buffer_head * s_inode_bitmap[EXT2_MAX_GROUP_LOADED];
-	unsigned long s_block_bitmap_number[EXT2_MAX_GROUP_LOADED];
-	struct buffer_head * s_block_bitmap[EXT2_MAX_GROUP_LOADED];
+	struct ext2_group_info * s_group_info;
+	unsigned long s_dir_count;	/* directories in the fs */
 	unsigned long  s_mount_opt;
 	uid_t s_resuid;
 	gid_t s_resgid;
@@ -56,6 +58,8 @@ struct ext2_sb_info {
 	int s_desc_per_block_bits;
 	int s_inode_size;
 	int s_first_ino;
+	struct journal_s * s_journal;	/* NULL unless journaled */
+	char * s_alloc_map;		/* ext2_journal_bitmap() scratch */
 };
 
 #endif	/* _LINUX_EXT2_FS_SB */
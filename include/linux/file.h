@@ -29,12 +29,19 @@ static inline void set_close_on_exec(unsigned int fd, int flag)
 	write_unlock(&files->file_lock);
 }
 
+/*
+ * May be called without file_lock: expand_fd_array() installs a new
+ * array before raising max_fds, and frees the old one only once
+ * nobody can be looking at it any more.
+ */
 static inline struct file * fcheck_files(struct files_struct *files, unsigned int fd)
 {
 	struct file * file = NULL;
 
-	if (fd < files->max_fds)
+	if (fd < files->max_fds) {
+		smp_rmb();
 		file = files->fd[fd];
+	}
 	return file;
 }
 
@@ -43,21 +50,31 @@ static inline struct file * fcheck_files(struct files_struct *files, unsigned in
  */
 static inline struct file * fcheck(unsigned int fd)
 {
-	struct file * file = NULL;
-	struct files_struct *files = current->files;
-
-	if (fd < files->max_fds)
-		file = files->fd[fd];
-	return file;
+	return fcheck_files(current->files, fd);
 }
 
 extern void put_filp(struct file *);
 
 extern int get_unused_fd(void);
+extern int find_next_fd(struct files_struct *, int);
 
-static inline void __put_unused_fd(struct files_struct *files, unsigned int fd)
+/* The open_fds updates, keeping full_fds_bits in step. file_lock held for write */
+static inline void __set_open_fd(struct files_struct *files, unsigned int fd)
+{
+	FD_SET(fd, files->open_fds);
+	if (!~files->open_fds->fds_bits[fd / __NFDBITS])
+		set_bit(fd / __NFDBITS, files->full_fds_bits);
+}
+
+static inline void __clear_open_fd(struct files_struct *files, unsigned int fd)
 {
 	FD_CLR(fd, files->open_fds);
+	clear_bit(fd / __NFDBITS, files->full_fds_bits);
+}
+
+static inline void __put_unused_fd(struct files_struct *files, unsigned int fd)
+{
+	__clear_open_fd(files, fd);
 	if (fd < files->next_fd)
 		files->next_fd = fd;
 }
@@ -91,6 +108,8 @@ static inline void fd_install(unsigned int fd, struct file * file)
 	write_lock(&files->file_lock);
 	if (files->fd[fd])
 		BUG();
+	/* fget() may pick it up without the lock */
+	wmb();
 	files->fd[fd] = file;
 	write_unlock(&files->file_lock);
 }
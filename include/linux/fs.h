@@ -16,6 +16,7 @@
 #include <linux/kdev_t.h>
 #include <linux/ioctl.h>
 #include <linux/list.h>
+#include <linux/threads.h>
 #include <linux/dcache.h>
 #include <linux/stat.h>
 #include <linux/cache.h>
@@ -55,6 +56,7 @@ struct files_stat_struct {
 extern struct files_stat_struct files_stat;
 extern int max_super_blocks, nr_super_blocks;
 extern int leases_enable, dir_notify_enable, lease_break_time;
+extern int aio_nr, aio_max_nr;
 
 #define NR_FILE  8192	/* this can well be larger on a larger system */
 #define NR_RESERVED_FILES 10 /* reserved for root */
@@ -90,6 +92,11 @@ extern int leases_enable, dir_notify_enable, lease_break_time;
 			   */
 #define FS_NOMOUNT	16 /* Never mount from userland */
 #define FS_LITTER	32 /* Keeps the tree in dcache */
+#define FS_COMPLETE_DIRS 64 /*
+			     * Directories only change through the VFS, so
+			     * ones made by mkdir() can answer lookup misses
+			     * from the dcache (DCACHE_COMPLETE).
+			     */
 #define FS_ODD_RENAME	32768	/* Temporary stuff; will go away as soon
 				  * as nfs_rename() will be cleaned up
 				  */
@@ -205,6 +212,7 @@ extern void inode_init(unsigned long);
 #define BH_Mapped	4	/* 1 if the buffer has a disk mapping */
 #define BH_New		5	/* 1 if the buffer is new and not yet written out */
 #define BH_Protected	6	/* 1 if the buffer is protected */
+#define BH_Delay	7	/* 1 if the buffer has a block reserved but not allocated */
 
 /*
  * Try to keep the most commonly used fields in single cache lines (16
@@ -246,6 +254,7 @@ struct buffer_head {
 
 	struct inode *	     b_inode;
 	struct list_head     b_inode_buffers;	/* doubly linked list of inode dirty buffers */
+	struct journal_head *b_journal_head;	/* see <linux/journal.h> */
 };
 
 typedef void (bh_end_io_t)(struct buffer_head *bh, int uptodate);
@@ -260,6 +269,7 @@ void init_buffer(struct buffer_head *, bh_end_io_t *, void *);
 #define buffer_mapped(bh)	__buffer_state(bh,Mapped)
 #define buffer_new(bh)		__buffer_state(bh,New)
 #define buffer_protected(bh)	__buffer_state(bh,Protected)
+#define buffer_delay(bh)	__buffer_state(bh,Delay)
 
 #define bh_offset(bh)		((unsigned long)(bh)->b_data & ~PAGE_MASK)
 
@@ -351,15 +361,21 @@ struct iattr {
  */
 struct page;
 struct address_space;
+struct kiobuf;
+struct kio_map;
 
 struct address_space_operations {
 	int (*writepage)(struct page *);
+	/* Write out all dirty pages, several at a time */
+	int (*writepages)(struct address_space *);
 	int (*readpage)(struct file *, struct page *);
 	int (*sync_page)(struct page *);
 	int (*prepare_write)(struct file *, struct page *, unsigned, unsigned);
 	int (*commit_write)(struct file *, struct page *, unsigned, unsigned);
 	/* Unfortunately this kludge is needed for FIBMAP. Don't use it */
 	int (*bmap)(struct address_space *, long);
+	/* Unbuffered I/O for O_DIRECT files: rw, inode, iobuf, first block, blocksize */
+	int (*direct_IO)(int, struct inode *, struct kiobuf *, unsigned long, int);
 };
 
 struct address_space {
@@ -387,6 +403,7 @@ struct block_device {
 struct inode {
 	struct list_head	i_hash;
 	struct list_head	i_list;
+	struct list_head	i_sb_list;	/* on i_sb->s_inodes */
 	struct list_head	i_dentry;
 	
 	struct list_head	i_dirty_buffers;
@@ -428,6 +445,7 @@ struct inode {
 	unsigned char		i_sock;
 
 	atomic_t		i_writecount;
+	atomic_t		i_dio_count;	/* O_DIRECT reads of its blocks */
 	unsigned int		i_attr_flags;
 	__u32			i_generation;
 	union {
@@ -497,6 +515,7 @@ struct fown_struct {
 
 struct file {
 	struct list_head	f_list;
+	int			f_list_cpu;	/* whose lock guards f_list, -1: files_lock */
 	struct dentry		*f_dentry;
 	struct vfsmount         *f_vfsmnt;
 	struct file_operations	*f_op;
@@ -513,11 +532,33 @@ struct file {
 
 	/* needed for tty driver, and maybe others */
 	void			*private_data;
+
+	/* epoll interest sets watching this file */
+	struct list_head	f_ep_links;
+
+	struct rcu_head		f_rcu;		/* deferred freeing, for fget() */
 };
+/*
+ * files_lock guards the global pool of free file structures, and lists
+ * like tty_files that file_move() puts files on. Each CPU keeps a few
+ * free ones of its own, and a super block's open files are kept on one
+ * list per CPU, s_files[cpu], under that CPU's lock: open() and close()
+ * on different CPUs do not share a lock.
+ */
 extern spinlock_t files_lock;
 #define file_list_lock() spin_lock(&files_lock);
 #define file_list_unlock() spin_unlock(&files_lock);
 
+struct files_cpu {
+	spinlock_t		lock;		/* s_files[this cpu] of every sb */
+	struct list_head	free;		/* free structures, own CPU only */
+	int			nr_free;
+} ____cacheline_aligned;
+
+extern struct files_cpu files_cpu[NR_CPUS];
+#define sb_file_list_lock(cpu) spin_lock(&files_cpu[cpu].lock);
+#define sb_file_list_unlock(cpu) spin_unlock(&files_cpu[cpu].lock);
+
 #define get_file(x)	atomic_inc(&(x)->f_count)
 #define file_count(x)	atomic_read(&(x)->f_count)
 
@@ -678,7 +719,9 @@ struct super_block {
 	wait_queue_head_t	s_wait;
 
 	struct list_head	s_dirty;	/* dirty inodes */
-	struct list_head	s_files;
+	struct list_head	s_inodes;	/* all inodes, under inode_lock */
+	struct list_head	s_files[NR_CPUS];	/* open files, by CPU that opened them */
+	atomic_t		s_delayed_blocks;	/* reserved for delayed allocation */
 
 	struct block_device	*s_bdev;
 	struct list_head	s_mounts;	/* vfsmount(s) of this one */
@@ -787,6 +830,8 @@ struct file_operations {
 	int (*lock) (struct file *, int, struct file_lock *);
 	ssize_t (*readv) (struct file *, const struct iovec *, unsigned long, loff_t *);
 	ssize_t (*writev) (struct file *, const struct iovec *, unsigned long, loff_t *);
+	int (*aio_map) (struct file *, int, loff_t, size_t, struct kio_map *);
+	ssize_t (*sendpage) (struct file *, struct page *, int, size_t, loff_t *, int);
 };
 
 struct inode_operations {
@@ -816,6 +861,7 @@ struct inode_operations {
 struct super_operations {
 	void (*read_inode) (struct inode *);
 	void (*write_inode) (struct inode *, int);
+	void (*dirty_inode) (struct inode *);
 	void (*put_inode) (struct inode *);
 	void (*delete_inode) (struct inode *);
 	void (*put_super) (struct super_block *);
@@ -1073,8 +1119,8 @@ extern int fsync_dev(kdev_t);
 extern int fsync_inode_buffers(struct inode *);
 extern int osync_inode_buffers(struct inode *);
 extern int inode_has_buffers(struct inode *);
-extern void filemap_fdatasync(struct address_space *);
-extern void filemap_fdatawait(struct address_space *);
+extern int filemap_fdatasync(struct address_space *);
+extern int filemap_fdatawait(struct address_space *);
 extern void sync_supers(kdev_t);
 extern int bmap(struct inode *, int);
 extern int notify_change(struct dentry *, struct iattr *);
@@ -1189,20 +1235,14 @@ static inline struct inode *iget(struct super_block *sb, unsigned long ino)
 
 extern void clear_inode(struct inode *);
 extern struct inode * get_empty_inode(void);
-static inline struct inode * new_inode(struct super_block *sb)
-{
-	struct inode *inode = get_empty_inode();
-	if (inode) {
-		inode->i_sb = sb;
-		inode->i_dev = sb->s_dev;
-	}
-	return inode;
-}
+extern struct inode * new_inode(struct super_block *);
 
 extern void insert_inode_hash(struct inode *);
 extern void remove_inode_hash(struct inode *);
+extern void files_init(void);
 extern struct file * get_empty_filp(void);
 extern void file_move(struct file *f, struct list_head *list);
+extern void file_move_sb(struct file *f, struct super_block *sb);
 extern void file_moveto(struct file *new, struct file *old);
 extern struct buffer_head * get_hash_table(kdev_t, int, int);
 extern struct buffer_head * getblk(kdev_t, int, int);
@@ -1229,6 +1269,7 @@ extern void wakeup_bdflush(int wait);
 extern int brw_page(int, struct page *, kdev_t, int [], int);
 
 typedef int (get_block_t)(struct inode*,long,struct buffer_head*,int);
+typedef int (reserve_blocks_t)(struct inode*, int);
 
 /* Generic buffer handling for block filesystems.. */
 extern int block_flushpage(struct page *, unsigned long);
@@ -1238,9 +1279,14 @@ extern int block_read_full_page(struct page*, get_block_t*);
 extern int block_prepare_write(struct page*, unsigned, unsigned, get_block_t*);
 extern int cont_prepare_write(struct page*, unsigned, unsigned, get_block_t*,
 				unsigned long *);
+extern int delay_prepare_write(struct page*, unsigned, unsigned, get_block_t*,
+				reserve_blocks_t*);
+extern void block_write_fault(struct page *, unsigned, unsigned);
 extern int block_sync_page(struct page *);
+extern int block_writepages(struct address_space *, get_block_t *);
 
 int generic_block_bmap(struct address_space *, long, get_block_t *);
+int generic_direct_IO(int, struct inode *, struct kiobuf *, unsigned long, int, get_block_t *);
 int generic_commit_write(struct file *, struct page *, unsigned, unsigned);
 int block_truncate_page(struct address_space *, loff_t, get_block_t *);
 
@@ -1248,6 +1294,8 @@ extern int generic_file_mmap(struct file *, struct vm_area_struct *);
 extern ssize_t generic_file_read(struct file *, char *, size_t, loff_t *);
 extern ssize_t generic_file_write(struct file *, const char *, size_t, loff_t *);
 extern void do_generic_file_read(struct file *, loff_t *, read_descriptor_t *, read_actor_t);
+extern int file_send_actor(read_descriptor_t *, struct page *, unsigned long, unsigned long);
+extern int generic_file_aio_map(struct file *, int, loff_t, size_t, struct kio_map *);
 
 extern ssize_t generic_read_dir(struct file *, char *, size_t, loff_t *);
 
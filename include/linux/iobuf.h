@@ -13,6 +13,8 @@
 #include <linux/wait.h>
 #include <asm/atomic.h>
 
+struct buffer_head;
+
 /*
  * The kiobuf structure describes a physical set of pages reserved
  * locked for IO.  The reference counts on each page will have been
@@ -80,5 +82,9 @@ void	kiobuf_wait_for_io(struct kiobuf *);
 
 int	brw_kiovec(int rw, int nr, struct kiobuf *iovec[], 
 		   kdev_t dev, unsigned long b[], int size);
+int	brw_kiovec_async(int rw, struct kiobuf *iobuf, kdev_t dev,
+			 unsigned long b[], int nr_blocks, int size,
+			 struct buffer_head *bh[]);
+int	brw_kiovec_collect(int nr, struct buffer_head *bh[], int size);
 
 #endif /* __LINUX_IOBUF_H */
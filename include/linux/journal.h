@@ -0,0 +1,240 @@
+#ifndef _LINUX_JOURNAL_H
+#define _LINUX_JOURNAL_H
+
+/*
+ * Write-ahead journal for filesystem metadata kept in the buffer cache.
+ *
+ * A filesystem brackets each metadata update in a handle:
+ *
+ *	handle = journal_start(journal, nblocks);
+ *	journal_get_write_access(handle, bh);
+ *	... modify bh->b_data ...
+ *	journal_dirty_metadata(handle, bh);
+ *	journal_stop(handle);
+ *
+ * Handles are grouped into transactions which kjournald writes to the
+ * log, followed by a commit block.  Only after that are the buffers
+ * released to bdflush for writing to their home locations
+ * (checkpointing).  After a crash, journal_load() replays every
+ * committed transaction still in the log.
+ *
+ * The on-disk format is the one used by e2fsprogs, so "tune2fs -j"
+ * journals can be mounted and e2fsck can replay our logs.
+ */
+
+#include <linux/types.h>
+
+#define JFS_MAGIC_NUMBER	0xc03b3998U
+
+/* Block types */
+#define JFS_DESCRIPTOR_BLOCK	1
+#define JFS_COMMIT_BLOCK	2
+#define JFS_SUPERBLOCK_V1	3
+#define JFS_SUPERBLOCK_V2	4
+#define JFS_REVOKE_BLOCK	5
+
+/* All on-disk fields are big-endian */
+typedef struct journal_header_s {
+	__u32	h_magic;
+	__u32	h_blocktype;
+	__u32	h_sequence;
+} journal_header_t;
+
+/* Descriptor blocks are a header followed by an array of tags */
+typedef struct journal_block_tag_s {
+	__u32	t_blocknr;		/* home block of the logged copy */
+	__u32	t_flags;
+} journal_block_tag_t;
+
+#define JFS_FLAG_ESCAPE		1	/* copy had its magic number zeroed */
+#define JFS_FLAG_SAME_UUID	2	/* no 16-byte uuid follows the tag */
+#define JFS_FLAG_DELETED	4
+#define JFS_FLAG_LAST_TAG	8	/* last tag in this descriptor */
+
+/* Blocks freed by a transaction must not be replayed from older ones */
+typedef struct journal_revoke_header_s {
+	journal_header_t r_header;
+	__u32	r_count;		/* bytes used in the block */
+} journal_revoke_header_t;
+
+typedef struct journal_superblock_s {
+	journal_header_t s_header;
+
+	/* Static description of the log */
+	__u32	s_blocksize;
+	__u32	s_maxlen;		/* total blocks in the log */
+	__u32	s_first;		/* first block of log data */
+
+	/* Dynamic state */
+	__u32	s_sequence;		/* first commit ID expected in log */
+	__u32	s_start;		/* start of log, 0 if clean */
+	__s32	s_errno;
+
+	/* Version 2 only */
+	__u32	s_feature_compat;
+	__u32	s_feature_incompat;
+	__u32	s_feature_ro_compat;
+	__u8	s_uuid[16];
+	__u32	s_nr_users;
+	__u32	s_dynsuper;
+	__u32	s_max_transaction;
+	__u32	s_max_trans_data;
+	__u32	s_padding[44];
+	__u8	s_users[16*48];
+} journal_superblock_t;
+
+#define JFS_FEATURE_INCOMPAT_REVOKE	0x00000001
+#define JFS_KNOWN_INCOMPAT_FEATURES	JFS_FEATURE_INCOMPAT_REVOKE
+
+#define JFS_MIN_JOURNAL_BLOCKS	1024
+
+#ifdef __KERNEL__
+
+#include <linux/list.h>
+#include <linux/wait.h>
+#include <linux/sched.h>
+#include <asm/semaphore.h>
+
+typedef unsigned int tid_t;
+
+typedef struct journal_s journal_t;
+typedef struct transaction_s transaction_t;
+typedef struct handle_s handle_t;
+
+/*
+ * Journal state attached to a buffer through bh->b_journal_head.  A
+ * buffer belongs to at most one open transaction (the running one),
+ * may be in the middle of being committed by the previous one, and
+ * sits on the checkpoint list of the newest committed transaction
+ * which logged it.
+ */
+struct journal_head {
+	struct buffer_head	*jh_bh;
+	transaction_t		*jh_transaction;	/* running owner */
+	transaction_t		*jh_committing;		/* being logged by */
+	transaction_t		*jh_cp_transaction;	/* to be checkpointed by */
+	int			jh_forget;		/* freed by jh_transaction */
+	int			jh_freed;		/* freed by jh_committing */
+	char			*jh_committed_data;	/* bitmap before frees */
+	char			*jh_frozen_data;	/* as jh_committing logs it */
+	struct list_head	jh_list;		/* t_buffers or t_forget */
+	struct list_head	jh_log_list;		/* t_log */
+	struct list_head	jh_cp_list;		/* t_checkpoint */
+};
+
+/* Data buffer which must reach the disk before its transaction commits */
+struct journal_data {
+	struct buffer_head	*jd_bh;
+	struct list_head	jd_list;
+};
+
+struct journal_revoke {
+	unsigned long		r_blocknr;
+	tid_t			r_tid;
+	struct list_head	r_hash;
+	struct list_head	r_list;
+};
+
+#define T_RUNNING	0
+#define T_LOCKED	1	/* no new handles, waiting for updates */
+#define T_COMMIT	2	/* being written to the log */
+#define T_FINISHED	3	/* committed, waiting for checkpoint */
+
+struct transaction_s {
+	journal_t		*t_journal;
+	tid_t			t_tid;
+	int			t_state;
+	unsigned long		t_log_start;	/* first log block we used */
+	unsigned long		t_expires;	/* commit by then */
+	int			t_updates;	/* open handles */
+	int			t_outstanding_credits;
+	int			t_nr_buffers;
+	int			t_nr_revokes;
+	struct list_head	t_buffers;	/* to be logged */
+	struct list_head	t_forget;	/* freed while in this transaction */
+	struct list_head	t_log;		/* logged, waiting for commit */
+	struct list_head	t_data;		/* journal_data to flush first */
+	struct list_head	t_revoke;	/* journal_revoke records */
+	struct list_head	t_checkpoint;	/* journal_heads to write home */
+	struct list_head	t_cplist;	/* on j_checkpoint */
+};
+
+struct handle_s {
+	transaction_t		*h_transaction;
+	int			h_buffer_credits;
+	int			h_ref;		/* nested journal_start()s */
+	int			h_sync;		/* wait for commit on stop */
+};
+
+#define JFS_UNMOUNT	1
+#define JFS_ABORT	2
+
+#define JOURNAL_REVOKE_HASH	256
+
+struct journal_s {
+	int			j_flags;
+	kdev_t			j_dev;
+	int			j_blocksize;
+	struct inode		*j_inode;
+	unsigned long		*j_blockmap;	/* log block -> device block */
+	struct buffer_head	*j_sb_buffer;
+	journal_superblock_t	*j_superblock;
+
+	/* Log blocks [j_first, j_last) wrap around */
+	unsigned long		j_first, j_last;
+	unsigned long		j_head;		/* next block to write */
+	unsigned long		j_tail;		/* oldest block still needed */
+	unsigned long		j_free;
+	tid_t			j_tail_sequence;
+	tid_t			j_transaction_sequence;	/* next tid */
+	tid_t			j_commit_sequence;	/* last committed */
+	tid_t			j_commit_request;
+	int			j_max_transaction_buffers;
+	unsigned long		j_commit_interval;
+
+	struct semaphore	j_sem;		/* protects everything below */
+	transaction_t		*j_running;
+	transaction_t		*j_committing;
+	struct list_head	j_checkpoint;	/* finished, oldest first */
+	struct list_head	j_revoke_hash[JOURNAL_REVOKE_HASH];
+
+	wait_queue_head_t	j_wait_transaction_locked;
+	wait_queue_head_t	j_wait_updates;
+	wait_queue_head_t	j_wait_commit;
+	wait_queue_head_t	j_wait_done_commit;
+	struct task_struct	*j_task;
+	struct semaphore	j_exit_sem;
+};
+
+extern handle_t *journal_start(journal_t *, int);
+extern int journal_stop(handle_t *);
+extern int journal_restart(handle_t *, int);
+extern int journal_get_write_access(handle_t *, struct buffer_head *);
+extern int journal_get_undo_access(handle_t *, struct buffer_head *);
+extern int journal_merge_committed(journal_t *, struct buffer_head *, char *);
+extern int journal_dirty_metadata(handle_t *, struct buffer_head *);
+extern int journal_dirty_data(handle_t *, struct buffer_head *);
+extern void journal_forget(handle_t *, struct buffer_head *);
+extern int journal_revoke(handle_t *, unsigned long);
+
+extern journal_t *journal_init_inode(struct inode *);
+extern int journal_load(journal_t *);
+extern int journal_force_commit(journal_t *);
+extern void journal_start_commit(journal_t *);
+extern int journal_flush(journal_t *);
+extern void journal_destroy(journal_t *);
+extern void journal_abort(journal_t *);
+
+static inline handle_t *journal_current_handle(void)
+{
+	return current->journal_info;
+}
+
+static inline int is_journal_aborted(journal_t *journal)
+{
+	return journal->j_flags & JFS_ABORT;
+}
+
+#endif /* __KERNEL__ */
+
+#endif /* _LINUX_JOURNAL_H */
@@ -82,6 +82,7 @@ struct socket
 
 struct scm_cookie;
 struct vm_area_struct;
+struct page;
 
 struct proto_ops {
   int	family;
@@ -108,6 +109,7 @@ struct proto_ops {
   int   (*sendmsg)	(struct socket *sock, struct msghdr *m, int total_len, struct scm_cookie *scm);
   int   (*recvmsg)	(struct socket *sock, struct msghdr *m, int total_len, int flags, struct scm_cookie *scm);
   int	(*mmap)		(struct file *file, struct socket *sock, struct vm_area_struct * vma);
+  ssize_t (*sendpage)	(struct socket *sock, struct page *page, int offset, size_t size, int flags);
 };
 
 struct net_proto_family 
@@ -33,6 +33,12 @@
 #define page_cache_free(x)	__free_page(x)
 #define page_cache_release(x)	__free_page(x)
 
+/*
+ * Max number of pages handled in one go by the batched page
+ * cache lookups (find_get_pages, grab_cache_pages).
+ */
+#define PAGE_CACHE_BATCH	16
+
 /*
  * From a kernel address, get the "struct page *"
  */
@@ -89,6 +95,11 @@ extern inline void wait_on_page(struct page * page)
 }
 
 extern struct page * grab_cache_page (struct address_space *, unsigned long);
+extern unsigned int find_get_pages(struct address_space *, unsigned long,
+				unsigned int, struct page **);
+extern unsigned int grab_cache_pages(struct address_space *, unsigned long,
+				unsigned int, struct page **);
+extern void page_cache_release_vec(struct page **, unsigned int);
 
 typedef int filler_t(void *, struct page*);
 
@@ -2,10 +2,29 @@
 #define _LINUX_PIPE_FS_I_H
 
 #define PIPEFS_MAGIC 0x50495045
+
+#define PIPE_BUFFERS	(16)	/* must be a power of 2 */
+
+/*
+ * A pipe is a ring of page references. Pages filled by write() belong
+ * to the pipe and later writes may append to them; pages spliced in
+ * from the page cache are shared and only ever read.
+ */
+struct pipe_buffer {
+	struct page *page;
+	unsigned int offset;
+	unsigned int len;
+	unsigned int flags;
+};
+
+#define PIPE_BUF_PRIVATE	1	/* page is ours, writers may append */
+
 struct pipe_inode_info {
 	wait_queue_head_t wait;
-	char *base;
-	unsigned int start;
+	unsigned int curbuf;
+	unsigned int nrbufs;
+	struct pipe_buffer bufs[PIPE_BUFFERS];
+	struct page *tmp_page;		/* spare page kept for the next write */
 	unsigned int readers;
 	unsigned int writers;
 	unsigned int waiting_readers;
@@ -14,14 +33,15 @@ struct pipe_inode_info {
 	unsigned int w_counter;
 };
 
-/* Differs from PIPE_BUF in that PIPE_SIZE is the length of the actual
-   memory allocation, whereas PIPE_BUF makes atomicity guarantees.  */
-#define PIPE_SIZE		PAGE_SIZE
+/* Differs from PIPE_BUF in that PIPE_SIZE is the most a pipe can hold,
+   whereas PIPE_BUF makes atomicity guarantees.  */
+#define PIPE_SIZE		(PIPE_BUFFERS * PAGE_SIZE)
 
 #define PIPE_SEM(inode)		(&(inode).i_sem)
 #define PIPE_WAIT(inode)	(&(inode).i_pipe->wait)
-#define PIPE_BASE(inode)	((inode).i_pipe->base)
-#define PIPE_START(inode)	((inode).i_pipe->start)
+#define PIPE_BUFS(inode)	((inode).i_pipe->bufs)
+#define PIPE_CURBUF(inode)	((inode).i_pipe->curbuf)
+#define PIPE_NRBUFS(inode)	((inode).i_pipe->nrbufs)
 #define PIPE_LEN(inode)		((inode).i_size)
 #define PIPE_READERS(inode)	((inode).i_pipe->readers)
 #define PIPE_WRITERS(inode)	((inode).i_pipe->writers)
@@ -30,16 +50,16 @@ struct pipe_inode_info {
 #define PIPE_RCOUNTER(inode)	((inode).i_pipe->r_counter)
 #define PIPE_WCOUNTER(inode)	((inode).i_pipe->w_counter)
 
-#define PIPE_EMPTY(inode)	(PIPE_LEN(inode) == 0)
-#define PIPE_FULL(inode)	(PIPE_LEN(inode) == PIPE_SIZE)
-#define PIPE_FREE(inode)	(PIPE_SIZE - PIPE_LEN(inode))
-#define PIPE_END(inode)	((PIPE_START(inode) + PIPE_LEN(inode)) & (PIPE_SIZE-1))
-#define PIPE_MAX_RCHUNK(inode)	(PIPE_SIZE - PIPE_START(inode))
-#define PIPE_MAX_WCHUNK(inode)	(PIPE_SIZE - PIPE_END(inode))
+#define PIPE_EMPTY(inode)	(PIPE_NRBUFS(inode) == 0)
+#define PIPE_FULL(inode)	(PIPE_NRBUFS(inode) == PIPE_BUFFERS)
+#define PIPE_HEAD(inode)	(PIPE_BUFS(inode) + PIPE_CURBUF(inode))
+#define PIPE_TAIL(inode)	(PIPE_BUFS(inode) + \
+	((PIPE_CURBUF(inode) + PIPE_NRBUFS(inode) - 1) & (PIPE_BUFFERS-1)))
 
 /* Drop the inode semaphore and wait for a pipe event, atomically */
 void pipe_wait(struct inode * inode);
 
 struct inode* pipe_new(struct inode* inode);
+void free_pipe_info(struct inode* inode);
 
 #endif
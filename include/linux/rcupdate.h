@@ -0,0 +1,26 @@
+#ifndef _LINUX_RCUPDATE_H
+#define _LINUX_RCUPDATE_H
+
+/*
+ * Deferred freeing for structures that are read without locks.
+ *
+ * Lockless readers must not sleep while they look at such a structure.
+ * Writers unlink it under their usual lock and pass it to call_rcu(),
+ * which runs func(arg) once every CPU has been through schedule() and
+ * so no reader can still hold a pointer to it.
+ */
+
+struct rcu_head {
+	struct rcu_head *next;
+	void (*func)(void *arg);
+	void *arg;
+};
+
+#ifdef __KERNEL__
+
+extern void call_rcu(struct rcu_head *head, void (*func)(void *arg), void *arg);
+extern void synchronize_kernel(void);
+
+#endif /* __KERNEL__ */
+
+#endif /* _LINUX_RCUPDATE_H */
@@ -161,8 +161,19 @@ extern int current_is_keventd(void);
  */
 #define NR_OPEN_DEFAULT BITS_PER_LONG
 
+/*
+ * Longs needed for a full_fds_bits map covering nr descriptors:
+ * one bit per long of open_fds.
+ */
+#define FULL_FDS_LONGS(nr) \
+	(((nr) / __NFDBITS + __NFDBITS - 1) / __NFDBITS)
+
 /*
  * Open file table structure
+ *
+ * fget() reads max_fds and fd without file_lock; see fs/file.c.
+ * Bit n of full_fds_bits is set when long n of open_fds is all ones,
+ * so that the search for a free descriptor skips full stretches.
  */
 struct files_struct {
 	atomic_t count;
@@ -173,8 +184,10 @@ struct files_struct {
 	struct file ** fd;	/* current fd array */
 	fd_set *close_on_exec;
 	fd_set *open_fds;
+	unsigned long *full_fds_bits;
 	fd_set close_on_exec_init;
 	fd_set open_fds_init;
+	unsigned long full_fds_bits_init[FULL_FDS_LONGS(__FD_SETSIZE)];
 	struct file * fd_array[NR_OPEN_DEFAULT];
 };
 
@@ -188,8 +201,10 @@ struct files_struct {
 	fd:		&init_files.fd_array[0], 	\
 	close_on_exec:	&init_files.close_on_exec_init, \
 	open_fds:	&init_files.open_fds_init, 	\
+	full_fds_bits:	&init_files.full_fds_bits_init[0], \
 	close_on_exec_init: { { 0, } }, 		\
 	open_fds_init:	{ { 0, } }, 			\
+	full_fds_bits_init: { 0, }, 			\
 	fd_array:	{ NULL, } 			\
 }
 
@@ -220,6 +235,10 @@ struct mm_struct {
 
 	/* Architecture-specific MM context */
 	mm_context_t context;
+
+	/* Asynchronous I/O contexts, see fs/aio.c */
+	rwlock_t ioctx_list_lock;
+	struct kioctx *ioctx_list;
 };
 
 #define INIT_MM(name) \
@@ -233,6 +252,7 @@ struct mm_struct {
 	map_count:	1, 				\
 	mmap_sem:	__MUTEX_INITIALIZER(name.mmap_sem), \
 	page_table_lock: SPIN_LOCK_UNLOCKED, 		\
+	ioctx_list_lock: RW_LOCK_UNLOCKED,		\
 }
 
 struct signal_struct {
@@ -389,6 +409,9 @@ struct task_struct {
    	u32 self_exec_id;
 /* Protection of (de-)allocation: mm, files, fs, tty */
 	spinlock_t alloc_lock;
+
+/* journal handle of the filesystem update in progress, if any */
+	void *journal_info;
 };
 
 /*
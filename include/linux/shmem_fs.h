@@ -26,12 +26,15 @@ struct shmem_inode_info {
 	struct list_head	list;
 };
 
+struct shmem_sb_cpu;
+
 struct shmem_sb_info {
 	unsigned long max_blocks;   /* How many blocks are allowed */
-	unsigned long free_blocks;  /* How many are left for allocation */
+	unsigned long free_blocks;  /* How many are left in the pool */
 	unsigned long max_inodes;   /* How many inodes are allowed */
-	unsigned long free_inodes;  /* How many are left for allocation */
+	unsigned long free_inodes;  /* How many are left in the pool */
 	spinlock_t    stat_lock;
+	struct shmem_sb_cpu *cpu;   /* per-CPU reserves taken from the pool */
 };
 
 #endif
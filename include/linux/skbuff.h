@@ -27,9 +27,18 @@
 #define HAVE_ALIGNABLE_SKB	/* Ditto 8)		   */
 #define SLAB_SKB 		/* Slabified skbuffs 	   */
 
+/*
+ * ip_summed. On receive, CHECKSUM_HW says the device summed the data
+ * into skb->csum and CHECKSUM_UNNECESSARY that it verified the checksum.
+ * On transmit, CHECKSUM_PARTIAL says the protocol left the checksum for
+ * the device to fill in: the sum runs from skb->h.raw to the end and is
+ * stored skb->csum bytes further than h.raw. The two sides never share
+ * a value, so a forwarded buffer is not mistaken for an outgoing one.
+ */
 #define CHECKSUM_NONE 0
 #define CHECKSUM_HW 1
 #define CHECKSUM_UNNECESSARY 2
+#define CHECKSUM_PARTIAL 3
 
 #ifdef __i386__
 #define NET_CALLER(arg) (*(((void**)&arg)-1))
@@ -57,6 +66,31 @@ struct sk_buff_head {
 	spinlock_t	lock;
 };
 
+/*
+ *	Paged data. An skb may carry part of its data in whole pages
+ *	after the linear area: skb->len counts all of it, skb->data_len
+ *	the part in pages. Only the transmit side builds such buffers,
+ *	and only from low memory pages, so that page_address() reaches
+ *	them from any context. Devices that cannot gather them get them
+ *	linearised by dev_queue_xmit().
+ */
+#define MAX_SKB_FRAGS (65536/PAGE_SIZE + 2)
+
+typedef struct skb_frag_struct skb_frag_t;
+
+struct skb_frag_struct {
+	struct page	*page;
+	__u16		page_offset;
+	__u16		size;
+};
+
+/* This lives at the end of the data area, shared by all the clones */
+struct skb_shared_info {
+	atomic_t	dataref;
+	unsigned int	nr_frags;
+	skb_frag_t	frags[MAX_SKB_FRAGS];
+};
+
 struct sk_buff {
 	/* These two members must be first. */
 	struct sk_buff	* next;			/* Next buffer in list 				*/
@@ -107,6 +141,7 @@ struct sk_buff {
 	char		cb[48];	 
 
 	unsigned int 	len;			/* Length of actual data			*/
+	unsigned int	data_len;		/* Of that, the part in page fragments		*/
 	unsigned int	csum;			/* Checksum 					*/
 	volatile char 	used;			/* Data moved to user and not MSG_PEEK		*/
 	unsigned char	cloned, 		/* head may be cloned (check refcnt to be sure). */
@@ -167,6 +202,11 @@ extern struct sk_buff *		skb_copy_expand(const struct sk_buff *skb,
 						int newheadroom,
 						int newtailroom,
 						int priority);
+extern int			skb_linearize(struct sk_buff *skb, int priority);
+extern int			skb_copy_bits(const struct sk_buff *skb, int offset,
+					      void *to, int len);
+extern unsigned int		skb_checksum(const struct sk_buff *skb, int offset,
+					     int len, unsigned int csum);
 #define dev_kfree_skb(a)	kfree_skb(a)
 extern void	skb_over_panic(struct sk_buff *skb, int len, void *here);
 extern void	skb_under_panic(struct sk_buff *skb, int len, void *here);
@@ -175,11 +215,26 @@ extern void	skb_under_panic(struct sk_buff *skb, int len, void *here);
 #define skb_realloc_headroom(skb, nhr) skb_copy_expand(skb, nhr, skb_tailroom(skb), GFP_ATOMIC)
 
 /* Internal */
+#define skb_shinfo(SKB)		((struct skb_shared_info *)((SKB)->end))
+
 static inline atomic_t *skb_datarefp(struct sk_buff *skb)
 {
-	return (atomic_t *)(skb->end);
+	return &skb_shinfo(skb)->dataref;
+}
+
+static inline int skb_is_nonlinear(const struct sk_buff *skb)
+{
+	return skb->data_len;
 }
 
+/* Bytes in the linear area */
+static inline unsigned int skb_headlen(const struct sk_buff *skb)
+{
+	return skb->len - skb->data_len;
+}
+
+#define SKB_LINEAR_ASSERT(skb) do { if (skb_is_nonlinear(skb)) BUG(); } while (0)
+
 /**
  *	skb_queue_empty - check if a queue is empty
  *	@list: queue head
@@ -686,6 +741,7 @@ static inline struct sk_buff *skb_dequeue_tail(struct sk_buff_head *list)
 static inline unsigned char *__skb_put(struct sk_buff *skb, unsigned int len)
 {
 	unsigned char *tmp=skb->tail;
+	SKB_LINEAR_ASSERT(skb);
 	skb->tail+=len;
 	skb->len+=len;
 	return tmp;
@@ -704,6 +760,7 @@ static inline unsigned char *__skb_put(struct sk_buff *skb, unsigned int len)
 static inline unsigned char *skb_put(struct sk_buff *skb, unsigned int len)
 {
 	unsigned char *tmp=skb->tail;
+	SKB_LINEAR_ASSERT(skb);
 	skb->tail+=len;
 	skb->len+=len;
 	if(skb->tail>skb->end) {
@@ -742,6 +799,8 @@ static inline unsigned char *skb_push(struct sk_buff *skb, unsigned int len)
 static inline char *__skb_pull(struct sk_buff *skb, unsigned int len)
 {
 	skb->len-=len;
+	if (skb->len < skb->data_len)
+		BUG();
 	return 	skb->data+=len;
 }
 
@@ -779,12 +838,13 @@ static inline int skb_headroom(const struct sk_buff *skb)
  *	skb_tailroom - bytes at buffer end
  *	@skb: buffer to check
  *
- *	Return the number of bytes of free space at the tail of an sk_buff
+ *	Return the number of bytes of free space at the tail of an sk_buff.
+ *	A buffer with paged data has none: what is added must go after it.
  */
 
 static inline int skb_tailroom(const struct sk_buff *skb)
 {
-	return skb->end-skb->tail;
+	return skb_is_nonlinear(skb) ? 0 : skb->end-skb->tail;
 }
 
 /**
@@ -805,6 +865,7 @@ static inline void skb_reserve(struct sk_buff *skb, unsigned int len)
 
 static inline void __skb_trim(struct sk_buff *skb, unsigned int len)
 {
+	SKB_LINEAR_ASSERT(skb);
 	skb->len = len;
 	skb->tail = skb->data+len;
 }
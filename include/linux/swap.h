@@ -95,6 +95,7 @@ extern void deactivate_page_nolock(struct page *);
 extern void activate_page(struct page *);
 extern void activate_page_nolock(struct page *);
 extern void lru_cache_add(struct page *);
+extern void __lru_cache_add(struct page *);
 extern void __lru_cache_del(struct page *);
 extern void lru_cache_del(struct page *);
 extern void recalculate_vm_stats(void);
@@ -526,6 +526,8 @@ enum
 	FS_LEASES=13,	/* int: leases enabled */
 	FS_DIR_NOTIFY=14,	/* int: directory notification enabled */
 	FS_LEASE_TIME=15,	/* int: maximum time to wait for a lease break */
+	FS_AIO_NR=16,	/* int: current number of aio requests */
+	FS_AIO_MAX_NR=17,	/* int: maximum number of aio requests */
 };
 
 /* CTL_DEBUG names: */
@@ -508,6 +508,7 @@ struct sock {
 	wait_queue_head_t	*sleep;		/* Sock wait queue			*/
 	struct dst_entry	*dst_cache;	/* Destination cache			*/
 	rwlock_t		dst_lock;
+	int			route_caps;	/* Features of the route's device	*/
 	atomic_t		rmem_alloc;	/* Receive queue bytes committed	*/
 	struct sk_buff_head	receive_queue;	/* Incoming packets			*/
 	atomic_t		wmem_alloc;	/* Transmit queue bytes committed	*/
@@ -874,6 +875,10 @@ extern int                      sock_no_sendmsg(struct socket *,
 extern int                      sock_no_recvmsg(struct socket *,
 						struct msghdr *, int, int,
 						struct scm_cookie *);
+extern ssize_t			sock_no_sendpage(struct socket *sock,
+						 struct page *page,
+						 int offset, size_t size,
+						 int flags);
 extern int			sock_no_mmap(struct file *file,
 					     struct socket *sock,
 					     struct vm_area_struct *vma);
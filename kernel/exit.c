@@ -208,6 +208,7 @@ void put_files_struct(struct files_struct *files)
 		if (files->max_fdset > __FD_SETSIZE) {
 			free_fdset(files->open_fds, files->max_fdset);
 			free_fdset(files->close_on_exec, files->max_fdset);
+			kfree(files->full_fds_bits);
 		}
 		kmem_cache_free(files_cachep, files);
 	}
@@ -18,6 +18,7 @@
 #include <linux/smp_lock.h>
 #include <linux/module.h>
 #include <linux/vmalloc.h>
+#include <linux/aio.h>
 
 #include <asm/pgtable.h>
 #include <asm/pgalloc.h>
@@ -201,6 +202,8 @@ static struct mm_struct * mm_init(struct mm_struct * mm)
 	atomic_set(&mm->mm_count, 1);
 	init_MUTEX(&mm->mmap_sem);
 	mm->page_table_lock = SPIN_LOCK_UNLOCKED;
+	mm->ioctx_list_lock = RW_LOCK_UNLOCKED;
+	mm->ioctx_list = NULL;
 	mm->pgd = pgd_alloc();
 	if (mm->pgd)
 		return mm;
@@ -243,6 +246,7 @@ inline void __mmdrop(struct mm_struct *mm)
 void mmput(struct mm_struct *mm)
 {
 	if (atomic_dec_and_test(&mm->mm_users)) {
+		exit_aio(mm);
 		exit_mmap(mm);
 		mmdrop(mm);
 	}
@@ -423,6 +427,7 @@ static int copy_files(unsigned long clone_flags, struct task_struct * tsk)
 	newf->max_fdset	    = __FD_SETSIZE;
 	newf->close_on_exec = &newf->close_on_exec_init;
 	newf->open_fds	    = &newf->open_fds_init;
+	newf->full_fds_bits = &newf->full_fds_bits_init[0];
 	newf->fd	    = &newf->fd_array[0];
 
 	/* We don't yet have the oldf readlock, but even if the old
@@ -486,6 +491,12 @@ static int copy_files(unsigned long clone_flags, struct task_struct * tsk)
 		memset(&newf->close_on_exec->fds_bits[start], 0, left);
 	}
 
+	memset(newf->full_fds_bits, 0,
+	       FULL_FDS_LONGS(newf->max_fdset) * sizeof(unsigned long));
+	for (i = 0; i < open_files / __NFDBITS; i++)
+		if (!~newf->open_fds->fds_bits[i])
+			set_bit(i, newf->full_fds_bits);
+
 	tsk->files = newf;
 	error = 0;
 out:
@@ -494,6 +505,8 @@ out:
 out_release:
 	free_fdset (newf->close_on_exec, newf->max_fdset);
 	free_fdset (newf->open_fds, newf->max_fdset);
+	if (newf->max_fdset > __FD_SETSIZE)
+		kfree(newf->full_fds_bits);
 	kmem_cache_free(files_cachep, newf);
 	goto out;
 }
@@ -580,6 +593,7 @@ int do_fork(unsigned long clone_flags, unsigned long stack_start,
 
 	p->did_exec = 0;
 	p->swappable = 0;
+	p->journal_info = NULL;
 	p->state = TASK_UNINTERRUPTIBLE;
 
 	copy_flags(clone_flags, p);
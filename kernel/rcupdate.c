@@ -0,0 +1,109 @@
+/*
+ *  linux/kernel/rcupdate.c
+ *
+ *  Deferred freeing for data that is read without locks.
+ *
+ *  The kernel is not preemptible, so a reader that does not sleep is
+ *  done with whatever it found by the time its CPU next schedules.
+ *  call_rcu() queues a callback; krcud takes the queued batch, runs
+ *  itself on every CPU in turn so that each of them has scheduled,
+ *  and then calls the batch.
+ */
+
+#include <linux/sched.h>
+#include <linux/init.h>
+#include <linux/smp_lock.h>
+#include <linux/rcupdate.h>
+
+static spinlock_t rcu_lock = SPIN_LOCK_UNLOCKED;
+static struct rcu_head *rcu_pending;
+static DECLARE_WAIT_QUEUE_HEAD(rcu_wait);
+
+/**
+ * call_rcu - run a function once lockless readers are done
+ * @head: structure to queue the call with, usually in the object
+ * @func: function to call
+ * @arg: its argument
+ *
+ * May be called from any context. func runs in process context.
+ */
+void call_rcu(struct rcu_head *head, void (*func)(void *arg), void *arg)
+{
+	unsigned long flags;
+
+	head->func = func;
+	head->arg = arg;
+	spin_lock_irqsave(&rcu_lock, flags);
+	head->next = rcu_pending;
+	rcu_pending = head;
+	spin_unlock_irqrestore(&rcu_lock, flags);
+
+	wake_up(&rcu_wait);
+}
+
+/**
+ * synchronize_kernel - wait for every CPU to schedule
+ *
+ * Returns once each CPU has been through schedule() since the call.
+ * Process context only.
+ */
+void synchronize_kernel(void)
+{
+#ifdef CONFIG_SMP
+	unsigned long cpus_allowed = current->cpus_allowed;
+	int i;
+
+	for (i = 0; i < smp_num_cpus; i++) {
+		int cpu = cpu_logical_map(i);
+
+		current->cpus_allowed = 1UL << cpu;
+		while (current->processor != cpu)
+			schedule();
+	}
+	current->cpus_allowed = cpus_allowed;
+#endif
+}
+
+static int krcud(void *unused)
+{
+	struct task_struct *tsk = current;
+	struct rcu_head *list, *next;
+	DECLARE_WAITQUEUE(wait, tsk);
+
+	tsk->session = 1;
+	tsk->pgrp = 1;
+	strcpy(tsk->comm, "krcud");
+	sigfillset(&tsk->blocked);
+
+	for (;;) {
+		add_wait_queue(&rcu_wait, &wait);
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!rcu_pending)
+			schedule();
+		set_current_state(TASK_RUNNING);
+		remove_wait_queue(&rcu_wait, &wait);
+
+		spin_lock_irq(&rcu_lock);
+		list = rcu_pending;
+		rcu_pending = NULL;
+		spin_unlock_irq(&rcu_lock);
+		if (!list)
+			continue;
+
+		synchronize_kernel();
+		while (list) {
+			next = list->next;
+			list->func(list->arg);
+			list = next;
+		}
+	}
+	return 0;
+}
+
+static int __init rcu_init(void)
+{
+	kernel_thread(krcud, NULL, CLONE_FS | CLONE_FILES | CLONE_SIGNAL);
+	return 0;
+}
+
+module_init(rcu_init)
@@ -668,6 +668,8 @@ recalculate:
 	goto repeat_schedule;
 
 still_running:
+	if (!(prev->cpus_allowed & (1UL << this_cpu)))
+		goto still_running_back;
 	c = goodness(prev, this_cpu, prev->active_mm);
 	next = prev;
 	goto still_running_back;
@@ -724,6 +726,10 @@ static inline void __wake_up_common (wait_queue_head_t *q, unsigned int mode,
 #if WAITQUEUE_DEBUG
 		CHECK_MAGIC(curr->__magic);
 #endif
+		if (curr->func) {
+			curr->func(curr);
+			continue;
+		}
 		p = curr->task;
 		state = p->state;
 		if (state & mode) {
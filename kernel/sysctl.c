@@ -131,7 +131,6 @@ static void unregister_proc_table(ctl_table *, struct proc_dir_entry *);
 #endif
 
 extern int inodes_stat[];
-extern int dentry_stat[];
 
 /* The default sysctl tables: */
 
@@ -281,7 +280,7 @@ static ctl_table fs_table[] = {
 	 0444, NULL, &proc_dointvec},
 	{FS_MAXDQUOT, "dquot-max", &max_dquots, sizeof(int),
 	 0644, NULL, &proc_dointvec},
-	{FS_DENTRY, "dentry-state", &dentry_stat, 6*sizeof(int),
+	{FS_DENTRY, "dentry-state", &dentry_stat, sizeof(dentry_stat),
 	 0444, NULL, &proc_dointvec},
 	{FS_OVERFLOWUID, "overflowuid", &fs_overflowuid, sizeof(int), 0644, NULL,
 	 &proc_dointvec_minmax, &sysctl_intvec, NULL,
@@ -295,6 +294,10 @@ static ctl_table fs_table[] = {
 	 sizeof(int), 0644, NULL, &proc_dointvec},
 	{FS_LEASE_TIME, "lease-break-time", &lease_break_time, sizeof(int),
 	 0644, NULL, &proc_dointvec},
+	{FS_AIO_NR, "aio-nr", &aio_nr, sizeof(int),
+	 0444, NULL, &proc_dointvec},
+	{FS_AIO_MAX_NR, "aio-max-nr", &aio_max_nr, sizeof(int),
+	 0644, NULL, &proc_dointvec},
 	{0}
 };
 
@@ -3,14 +3,12 @@
  * For conditions of distribution and use, see copyright notice in zlib.h 
  */
 
-#include "zutil.h"
+#include <linux/zutil.h>
 #include "infblock.h"
 #include "inftrees.h"
 #include "infcodes.h"
 #include "infutil.h"
 
-struct inflate_codes_state {int dummy;}; /* for buggy compilers */
-
 /* simplify the use of the inflate_huft type with some defines */
 #define exop word.what.Exop
 #define bits word.what.Bits
@@ -65,7 +63,7 @@ local const uInt border[] = { /* Order of the bit length code lengths */
  */
 
 
-void cramfs_inflate_blocks_reset(s, z, c)
+void zlib_inflate_blocks_reset(s, z, c)
 inflate_blocks_statef *s;
 z_streamp z;
 uLongf *c;
@@ -73,7 +71,7 @@ uLongf *c;
   if (c != Z_NULL)
     *c = s->check;
   if (s->mode == CODES)
-    cramfs_inflate_codes_free(s->sub.decode.codes, z);
+    zlib_inflate_codes_free(s->sub.decode.codes, z);
   s->mode = TYPE;
   s->bitk = 0;
   s->bitb = 0;
@@ -83,28 +81,25 @@ uLongf *c;
 }
 
 
-inflate_blocks_statef *cramfs_inflate_blocks_new(z, c, w)
+inflate_blocks_statef *zlib_inflate_blocks_new(z, c, w)
 z_streamp z;
 check_func c;
 uInt w;
 {
   inflate_blocks_statef *s;
-  static struct inflate_blocks_state working_blocks_state;
-  static inflate_huft working_hufts[MANY];
-  static unsigned char working_window[1 << MAX_WBITS];
 
-  s = &working_blocks_state;
-  s->hufts = working_hufts;
-  s->window = working_window;
+  s = &WS(z)->working_blocks_state;
+  s->hufts = WS(z)->working_hufts;
+  s->window = WS(z)->working_window;
   s->end = s->window + w;
   s->checkfn = c;
   s->mode = TYPE;
-  cramfs_inflate_blocks_reset(s, z, Z_NULL);
+  zlib_inflate_blocks_reset(s, z, Z_NULL);
   return s;
 }
 
 
-int cramfs_inflate_blocks(s, z, r)
+int zlib_inflate_blocks(s, z, r)
 inflate_blocks_statef *s;
 z_streamp z;
 int r;
@@ -140,8 +135,8 @@ int r;
             uInt bl, bd;
             inflate_huft *tl, *td;
 
-            cramfs_inflate_trees_fixed(&bl, &bd, &tl, &td, z);
-            s->sub.decode.codes = cramfs_inflate_codes_new(bl, bd, tl, td, z);
+            zlib_inflate_trees_fixed(&bl, &bd, &tl, &td, z);
+            s->sub.decode.codes = zlib_inflate_codes_new(bl, bd, tl, td, z);
             if (s->sub.decode.codes == Z_NULL)
             {
               r = Z_MEM_ERROR;
@@ -202,10 +197,7 @@ int r;
         LEAVE
       }
 #endif
-      {
-      	static unsigned int working_blens [258 + 0x1f + 0x1f];
-      	s->sub.trees.blens = working_blens;
-      }
+      s->sub.trees.blens = WS(z)->working_blens;
       DUMPBITS(14)
       s->sub.trees.index = 0;
       s->mode = BTREE;
@@ -219,7 +211,7 @@ int r;
       while (s->sub.trees.index < 19)
         s->sub.trees.blens[border[s->sub.trees.index++]] = 0;
       s->sub.trees.bb = 7;
-      t = cramfs_inflate_trees_bits(s->sub.trees.blens, &s->sub.trees.bb,
+      t = zlib_inflate_trees_bits(s->sub.trees.blens, &s->sub.trees.bb,
                              &s->sub.trees.tb, s->hufts, z);
       if (t != Z_OK)
       {
@@ -239,7 +231,7 @@ int r;
 
         t = s->sub.trees.bb;
         NEEDBITS(t)
-        h = s->sub.trees.tb + ((uInt)b & cramfs_inflate_mask[t]);
+        h = s->sub.trees.tb + ((uInt)b & zlib_inflate_mask[t]);
         t = h->bits;
         c = h->base;
         if (c < 16)
@@ -253,7 +245,7 @@ int r;
           j = c == 18 ? 11 : 3;
           NEEDBITS(t + i)
           DUMPBITS(t)
-          j += (uInt)b & cramfs_inflate_mask[i];
+          j += (uInt)b & zlib_inflate_mask[i];
           DUMPBITS(i)
           i = s->sub.trees.index;
           t = s->sub.trees.table;
@@ -281,7 +273,7 @@ int r;
         bl = 9;         /* must be <= 9 for lookahead assumptions */
         bd = 6;         /* must be <= 9 for lookahead assumptions */
         t = s->sub.trees.table;
-        t = cramfs_inflate_trees_dynamic(257 + (t & 0x1f), 1 + ((t >> 5) & 0x1f),
+        t = zlib_inflate_trees_dynamic(257 + (t & 0x1f), 1 + ((t >> 5) & 0x1f),
                                   s->sub.trees.blens, &bl, &bd, &tl, &td,
                                   s->hufts, z);
         if (t != Z_OK)
@@ -291,7 +283,7 @@ int r;
           r = t;
           LEAVE
         }
-        if ((c = cramfs_inflate_codes_new(bl, bd, tl, td, z)) == Z_NULL)
+        if ((c = zlib_inflate_codes_new(bl, bd, tl, td, z)) == Z_NULL)
         {
           r = Z_MEM_ERROR;
           LEAVE
@@ -301,10 +293,10 @@ int r;
       s->mode = CODES;
     case CODES:
       UPDATE
-      if ((r = cramfs_inflate_codes(s, z, r)) != Z_STREAM_END)
-        return cramfs_inflate_flush(s, z, r);
+      if ((r = zlib_inflate_codes(s, z, r)) != Z_STREAM_END)
+        return zlib_inflate_flush(s, z, r);
       r = Z_OK;
-      cramfs_inflate_codes_free(s->sub.decode.codes, z);
+      zlib_inflate_codes_free(s->sub.decode.codes, z);
       LOAD
       if (!s->last)
       {
@@ -330,16 +322,16 @@ int r;
 }
 
 
-int cramfs_inflate_blocks_free(s, z)
+int zlib_inflate_blocks_free(s, z)
 inflate_blocks_statef *s;
 z_streamp z;
 {
-  cramfs_inflate_blocks_reset(s, z, Z_NULL);
+  zlib_inflate_blocks_reset(s, z, Z_NULL);
   return Z_OK;
 }
 
 
-void cramfs_inflate_set_dictionary(s, d, n)
+void zlib_inflate_set_dictionary(s, d, n)
 inflate_blocks_statef *s;
 const Bytef *d;
 uInt  n;
@@ -353,8 +345,76 @@ uInt  n;
  * by Z_SYNC_FLUSH or Z_FULL_FLUSH. 
  * IN assertion: s != Z_NULL
  */
-int inflate_blocks_sync_point(s)
+int zlib_inflate_blocks_sync_point(s)
 inflate_blocks_statef *s;
 {
   return s->mode == LENS;
 }
+
+
+/*
+ * This subroutine adds the data at next_in/avail_in to the output history
+ * without performing any output.  The output buffer must be "caught up";
+ * i.e. no pending output (hence s->read equals s->write), and the state must
+ * be BLOCKS (i.e. we should be willing to see the start of a series of
+ * BLOCKS).  On exit, the output will also be caught up, and the checksum
+ * will have been updated if need be.
+ */
+int zlib_inflate_addhistory(s, z)
+inflate_blocks_statef *s;
+z_streamp z;
+{
+  uLong b;              /* bit buffer */  /* NOT USED HERE */
+  uInt k;               /* bits in bit buffer */ /* NOT USED HERE */
+  uInt t;               /* temporary storage */
+  Bytef *p;             /* input data pointer */
+  uInt n;               /* bytes available there */
+  Bytef *q;             /* output window write pointer */
+  uInt m;               /* bytes to end of window or read pointer */
+
+  if (s->read != s->write)
+    return Z_STREAM_ERROR;
+  if (s->mode != TYPE)
+    return Z_DATA_ERROR;
+
+  /* we're ready to rock */
+  LOAD
+  /* while there is input ready, copy to output buffer, moving
+   * pointers as needed.
+   */
+  while (n) {
+    t = n;  /* how many to do */
+    /* is there room until end of buffer? */
+    if (t > m) t = m;
+    /* update check information */
+    if (s->checkfn != Z_NULL)
+      z->adler = s->check = (*s->checkfn)(s->check, q, t);
+    memcpy(q, p, t);
+    q += t;
+    p += t;
+    n -= t;
+    z->total_out += t;
+    s->read = q;    /* drag read pointer forward */
+    /* WRAP, by hand to handle s->read */
+    if (q == s->end) {
+      s->read = q = s->window;
+      m = WAVAIL;
+    }
+  }
+  UPDATE
+  return Z_OK;
+}
+
+
+/*
+ * At the end of a Deflate-compressed PPP packet, we expect to have seen
+ * a `stored' block type value but not the (zero) length bytes.
+ */
+int zlib_inflate_packet_flush(s)
+inflate_blocks_statef *s;
+{
+  if (s->mode != LENS)
+    return Z_DATA_ERROR;
+  s->mode = TYPE;
+  return Z_OK;
+}
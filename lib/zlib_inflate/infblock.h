@@ -11,29 +11,36 @@
 struct inflate_blocks_state;
 typedef struct inflate_blocks_state FAR inflate_blocks_statef;
 
-extern inflate_blocks_statef * cramfs_inflate_blocks_new OF((
+extern inflate_blocks_statef * zlib_inflate_blocks_new OF((
     z_streamp z,
     check_func c,               /* check function */
     uInt w));                   /* window size */
 
-extern int cramfs_inflate_blocks OF((
+extern int zlib_inflate_blocks OF((
     inflate_blocks_statef *,
     z_streamp ,
     int));                      /* initial return code */
 
-extern void cramfs_inflate_blocks_reset OF((
+extern void zlib_inflate_blocks_reset OF((
     inflate_blocks_statef *,
     z_streamp ,
     uLongf *));                  /* check value on output */
 
-extern int cramfs_inflate_blocks_free OF((
+extern int zlib_inflate_blocks_free OF((
     inflate_blocks_statef *,
     z_streamp));
 
-extern void cramfs_inflate_set_dictionary OF((
+extern void zlib_inflate_set_dictionary OF((
     inflate_blocks_statef *s,
     const Bytef *d,  /* dictionary */
     uInt  n));       /* dictionary length */
 
-extern int inflate_blocks_sync_point OF((
+extern int zlib_inflate_blocks_sync_point OF((
     inflate_blocks_statef *s));
+
+extern int zlib_inflate_addhistory OF((
+    inflate_blocks_statef *,
+    z_streamp));
+
+extern int zlib_inflate_packet_flush OF((
+    inflate_blocks_statef *));
@@ -3,14 +3,15 @@
  * For conditions of distribution and use, see copyright notice in zlib.h 
  */
 
-#include "zutil.h"
+#include <linux/zutil.h>
 #include "inftrees.h"
 #include "infblock.h"
 #include "infcodes.h"
 #include "infutil.h"
 #include "inffast.h"
 
-struct inflate_codes_state {int dummy;}; /* for buggy compilers */
+#include <asm/byteorder.h>
+#include <asm/unaligned.h>
 
 /* simplify the use of the inflate_huft type with some defines */
 #define exop word.what.Exop
@@ -18,14 +19,24 @@ struct inflate_codes_state {int dummy;}; /* for buggy compilers */
 
 /* macros for bit input with no checking and for returning unused bytes */
 #define GRABBITS(j) {while(k<(j)){b|=((uLong)NEXTBYTE)<<k;k+=8;}}
-#define UNGRAB {c=z->avail_in-n;c=(k>>3)<c?k>>3:c;n+=c;p-=c;k-=c<<3;}
+#define UNGRAB {c=z->avail_in-n;c=(k>>3)<c?k>>3:c;n+=c;p-=c;k-=c<<3;\
+                b&=((uLong)1<<k)-1;}
+
+/* Top the bit buffer up to at least 24 bits with a single unaligned load,
+   taking as many whole bytes as fit in 31 bits instead of looping a byte
+   at a time.  The bits of the loaded bytes which are not taken still end
+   up above k: they are the bytes the next refill ORs in at the very same
+   place, so they do no harm, and UNGRAB clears them on the way out.
+   Needs four readable input bytes. */
+#define REFILL {if(k<20){b|=(uLong)le32_to_cpu(get_unaligned((u32 *)p))<<k;\
+                c=(31-k)>>3;p+=c;n-=c;k+=c<<3;}}
 
 /* Called with number of bytes left to write in window at least 258
    (the maximum string length) and number of input bytes available
    at least ten.  The ten bytes are six bytes for the longest length/
    distance pair plus four bytes for overloading the bit buffer. */
 
-int cramfs_inflate_fast(bl, bd, tl, td, s, z)
+int zlib_inflate_fast(bl, bd, tl, td, s, z)
 uInt bl, bd;
 inflate_huft *tl;
 inflate_huft *td; /* need separate declaration for Borland C++ */
@@ -50,13 +61,13 @@ z_streamp z;
   LOAD
 
   /* initialize masks */
-  ml = cramfs_inflate_mask[bl];
-  md = cramfs_inflate_mask[bd];
+  ml = zlib_inflate_mask[bl];
+  md = zlib_inflate_mask[bd];
 
   /* do until not enough input or output space for fast loop */
   do {                          /* assume called with m >= 258 && n >= 10 */
     /* get literal/length code */
-    GRABBITS(20)                /* max bits for literal/length code */
+    REFILL                      /* max bits for literal/length code */
     if ((e = (t = tl + ((uInt)b & ml))->exop) == 0)
     {
       DUMPBITS(t->bits)
@@ -70,7 +81,7 @@ z_streamp z;
       {
         /* get extra bits for length */
         e &= 15;
-        c = t->base + ((uInt)b & cramfs_inflate_mask[e]);
+        c = t->base + ((uInt)b & zlib_inflate_mask[e]);
         DUMPBITS(e)
 
         /* decode distance base of block to copy */
@@ -83,17 +94,13 @@ z_streamp z;
             /* get extra bits to add to distance base */
             e &= 15;
             GRABBITS(e)         /* get extra bits (up to 13) */
-            d = t->base + ((uInt)b & cramfs_inflate_mask[e]);
+            d = t->base + ((uInt)b & zlib_inflate_mask[e]);
             DUMPBITS(e)
 
             /* do the copy */
             m -= c;
             if ((uInt)(q - s->window) >= d)     /* offset before dest */
-            {                                   /*  just copy */
-              r = q - d;
-              *q++ = *r++;  c--;        /* minimum count is three, */
-              *q++ = *r++;  c--;        /*  so unroll loop a little */
-            }
+              r = q - d;                        /*  just copy */
             else                        /* else offset after destination */
             {
               e = d - (uInt)(q - s->window); /* bytes from offset to end */
@@ -107,15 +114,31 @@ z_streamp z;
                 r = s->window;          /* copy rest from start of window */
               }
             }
-            do {                        /* copy all or what's left */
-              *q++ = *r++;
-            } while (--c);
+            /* copy all or what's left: a match shorter than its length
+               repeats the last d bytes, so it overlaps its own output.
+               r == q when d is the whole window: the bytes are in place */
+            if (r >= q || (uInt)(q - r) >= c)   /* no overlap with output */
+              memmove(q, r, c);
+            else if (q - r == 1)        /* a run of one byte */
+              memset(q, *r, c);
+            else
+            {
+              while ((uInt)(q - r) < c) /* copy the period, doubling */
+              {
+                e = q - r;
+                memcpy(q, r, e);
+                q += e;
+                c -= e;
+              }
+              memcpy(q, r, c);          /* no overlap left */
+            }
+            q += c;
             break;
           }
           else if ((e & 64) == 0)
           {
             t += t->base;
-            e = (t += ((uInt)b & cramfs_inflate_mask[e]))->exop;
+            e = (t += ((uInt)b & zlib_inflate_mask[e]))->exop;
           }
           else
           {
@@ -130,7 +153,7 @@ z_streamp z;
       if ((e & 64) == 0)
       {
         t += t->base;
-        if ((e = (t += ((uInt)b & cramfs_inflate_mask[e]))->exop) == 0)
+        if ((e = (t += ((uInt)b & zlib_inflate_mask[e]))->exop) == 0)
         {
           DUMPBITS(t->bits)
           *q++ = (Byte)t->base;
@@ -3,54 +3,15 @@
  * For conditions of distribution and use, see copyright notice in zlib.h 
  */
 
-#include "zutil.h"
+#include <linux/zutil.h>
 #include "infblock.h"
+#include "inftrees.h"
+#include "infcodes.h"
+#include "infutil.h"
 
-struct inflate_blocks_state {int dummy;}; /* for buggy compilers */
-
-typedef enum {
-      METHOD,   /* waiting for method byte */
-      FLAG,     /* waiting for flag byte */
-      DICT4,    /* four dictionary check bytes to go */
-      DICT3,    /* three dictionary check bytes to go */
-      DICT2,    /* two dictionary check bytes to go */
-      DICT1,    /* one dictionary check byte to go */
-      DICT0,    /* waiting for inflateSetDictionary */
-      BLOCKS,   /* decompressing blocks */
-      CHECK4,   /* four check bytes to go */
-      CHECK3,   /* three check bytes to go */
-      CHECK2,   /* two check bytes to go */
-      CHECK1,   /* one check byte to go */
-      DONE,     /* finished check, done */
-      BAD}      /* got an error--stay here */
-inflate_mode;
-
-/* inflate private state */
-struct internal_state {
-
-  /* mode */
-  inflate_mode  mode;   /* current inflate mode */
-
-  /* mode dependent information */
-  union {
-    uInt method;        /* if FLAGS, method byte */
-    struct {
-      uLong was;                /* computed check value */
-      uLong need;               /* stream check value */
-    } check;            /* if CHECK, check values to compare */
-    uInt marker;        /* if BAD, inflateSync's marker bytes count */
-  } sub;        /* submode */
-
-  /* mode independent information */
-  int  nowrap;          /* flag for no wrapper */
-  uInt wbits;           /* log2(window size)  (8..15, defaults to 15) */
-  inflate_blocks_statef 
-    *blocks;            /* current inflate_blocks state */
-
-};
-
-
-int ZEXPORT cramfs_inflateReset(z)
+
+
+int ZEXPORT zlib_inflateReset(z)
 z_streamp z;
 {
   if (z == Z_NULL || z->state == Z_NULL)
@@ -58,31 +19,29 @@ z_streamp z;
   z->total_in = z->total_out = 0;
   z->msg = Z_NULL;
   z->state->mode = z->state->nowrap ? BLOCKS : METHOD;
-  cramfs_inflate_blocks_reset(z->state->blocks, z, Z_NULL);
+  zlib_inflate_blocks_reset(z->state->blocks, z, Z_NULL);
   return Z_OK;
 }
 
 
-int ZEXPORT cramfs_inflateEnd(z)
+int ZEXPORT zlib_inflateEnd(z)
 z_streamp z;
 {
   if (z == Z_NULL || z->state == Z_NULL)
     return Z_STREAM_ERROR;
   if (z->state->blocks != Z_NULL)
-    cramfs_inflate_blocks_free(z->state->blocks, z);
+    zlib_inflate_blocks_free(z->state->blocks, z);
   z->state = Z_NULL;
   return Z_OK;
 }
 
 
-int ZEXPORT cramfs_inflateInit2_(z, w, version, stream_size)
+int ZEXPORT zlib_inflateInit2_(z, w, version, stream_size)
 z_streamp z;
 int w;
 const char *version;
 int stream_size;
 {
-  static struct internal_state internal_state;
-
   if (version == Z_NULL || version[0] != ZLIB_VERSION[0] ||
       stream_size != sizeof(z_stream))
       return Z_VERSION_ERROR;
@@ -90,8 +49,10 @@ int stream_size;
   /* initialize state */
   if (z == Z_NULL)
     return Z_STREAM_ERROR;
+  if (z->workspace == Z_NULL)
+    return Z_MEM_ERROR;
   z->msg = Z_NULL;
-  z->state = &internal_state;
+  z->state = &WS(z)->internal_state;
   z->state->blocks = Z_NULL;
 
   /* handle undocumented nowrap option (no zlib header or check) */
@@ -105,48 +66,56 @@ int stream_size;
   /* set window size */
   if (w < 8 || w > 15)
   {
-    cramfs_inflateEnd(z);
+    zlib_inflateEnd(z);
     return Z_STREAM_ERROR;
   }
   z->state->wbits = (uInt)w;
 
   /* create inflate_blocks state */
   if ((z->state->blocks =
-      cramfs_inflate_blocks_new(z, z->state->nowrap ? Z_NULL : cramfs_adler32, (uInt)1 << w))
+      zlib_inflate_blocks_new(z, z->state->nowrap ? Z_NULL : zlib_adler32, (uInt)1 << w))
       == Z_NULL)
   {
-    cramfs_inflateEnd(z);
+    zlib_inflateEnd(z);
     return Z_MEM_ERROR;
   }
 
   /* reset state */
-  cramfs_inflateReset(z);
+  zlib_inflateReset(z);
   return Z_OK;
 }
 
 
-int ZEXPORT cramfs_inflateInit_(z, version, stream_size)
+int ZEXPORT zlib_inflate_workspacesize()
+{
+  return sizeof(struct inflate_workspace);
+}
+
+
+int ZEXPORT zlib_inflateInit_(z, version, stream_size)
 z_streamp z;
 const char *version;
 int stream_size;
 {
-  return cramfs_inflateInit2_(z, DEF_WBITS, version, stream_size);
+  return zlib_inflateInit2_(z, DEF_WBITS, version, stream_size);
 }
 
 
-#define NEEDBYTE {if(z->avail_in==0)return r;r=f;}
+#undef NEEDBYTE
+#undef NEXTBYTE
+#define NEEDBYTE {if(z->avail_in==0)return r;r=trv;}
 #define NEXTBYTE (z->avail_in--,z->total_in++,*z->next_in++)
 
-int ZEXPORT cramfs_inflate(z, f)
+int ZEXPORT zlib_inflate(z, f)
 z_streamp z;
 int f;
 {
-  int r;
+  int r, trv;
   uInt b;
 
   if (z == Z_NULL || z->state == Z_NULL || z->next_in == Z_NULL)
     return Z_STREAM_ERROR;
-  f = f == Z_FINISH ? Z_BUF_ERROR : Z_OK;
+  trv = f == Z_FINISH ? Z_BUF_ERROR : Z_OK;
   r = Z_BUF_ERROR;
   while (1) switch (z->state->mode)
   {
@@ -154,14 +123,14 @@ int f;
       NEEDBYTE
       if (((z->state->sub.method = NEXTBYTE) & 0xf) != Z_DEFLATED)
       {
-        z->state->mode = BAD;
+        z->state->mode = I_BAD;
         z->msg = (char*)"unknown compression method";
         z->state->sub.marker = 5;       /* can't try inflateSync */
         break;
       }
       if ((z->state->sub.method >> 4) + 8 > z->state->wbits)
       {
-        z->state->mode = BAD;
+        z->state->mode = I_BAD;
         z->msg = (char*)"invalid window size";
         z->state->sub.marker = 5;       /* can't try inflateSync */
         break;
@@ -172,7 +141,7 @@ int f;
       b = NEXTBYTE;
       if (((z->state->sub.method << 8) + b) % 31)
       {
-        z->state->mode = BAD;
+        z->state->mode = I_BAD;
         z->msg = (char*)"incorrect header check";
         z->state->sub.marker = 5;       /* can't try inflateSync */
         break;
@@ -202,27 +171,29 @@ int f;
       z->state->mode = DICT0;
       return Z_NEED_DICT;
     case DICT0:
-      z->state->mode = BAD;
+      z->state->mode = I_BAD;
       z->msg = (char*)"need dictionary";
       z->state->sub.marker = 0;       /* can try inflateSync */
       return Z_STREAM_ERROR;
     case BLOCKS:
-      r = cramfs_inflate_blocks(z->state->blocks, z, r);
+      r = zlib_inflate_blocks(z->state->blocks, z, r);
+      if (f == Z_PACKET_FLUSH && z->avail_in == 0 && z->avail_out != 0)
+        r = zlib_inflate_packet_flush(z->state->blocks);
       if (r == Z_DATA_ERROR)
       {
-        z->state->mode = BAD;
+        z->state->mode = I_BAD;
         z->state->sub.marker = 0;       /* can try inflateSync */
         break;
       }
       if (r == Z_OK)
-        r = f;
+        r = trv;
       if (r != Z_STREAM_END)
         return r;
-      r = f;
-      cramfs_inflate_blocks_reset(z->state->blocks, z, &z->state->sub.check.was);
+      r = trv;
+      zlib_inflate_blocks_reset(z->state->blocks, z, &z->state->sub.check.was);
       if (z->state->nowrap)
       {
-        z->state->mode = DONE;
+        z->state->mode = I_DONE;
         break;
       }
       z->state->mode = CHECK4;
@@ -244,15 +215,15 @@ int f;
 
       if (z->state->sub.check.was != z->state->sub.check.need)
       {
-        z->state->mode = BAD;
+        z->state->mode = I_BAD;
         z->msg = (char*)"incorrect data check";
         z->state->sub.marker = 5;       /* can't try inflateSync */
         break;
       }
-      z->state->mode = DONE;
-    case DONE:
+      z->state->mode = I_DONE;
+    case I_DONE:
       return Z_STREAM_END;
-    case BAD:
+    case I_BAD:
       return Z_DATA_ERROR;
     default:
       return Z_STREAM_ERROR;
@@ -263,7 +234,22 @@ int f;
 }
 
 
-int ZEXPORT cramfs_inflateSync(z)
+/*
+ * Add the data at next_in to the history of a PPP stream, as if it had
+ * arrived in a stored block, without producing any output.
+ */
+int ZEXPORT zlib_inflateIncomp(z)
+z_streamp z;
+{
+  if (z == Z_NULL || z->state == Z_NULL)
+    return Z_STREAM_ERROR;
+  if (z->state->mode != BLOCKS)
+    return Z_DATA_ERROR;
+  return zlib_inflate_addhistory(z->state->blocks, z);
+}
+
+
+int ZEXPORT zlib_inflateSync(z)
 z_streamp z;
 {
   uInt n;       /* number of bytes to look at */
@@ -274,9 +260,9 @@ z_streamp z;
   /* set up */
   if (z == Z_NULL || z->state == Z_NULL)
     return Z_STREAM_ERROR;
-  if (z->state->mode != BAD)
+  if (z->state->mode != I_BAD)
   {
-    z->state->mode = BAD;
+    z->state->mode = I_BAD;
     z->state->sub.marker = 0;
   }
   if ((n = z->avail_in) == 0)
@@ -307,7 +293,7 @@ z_streamp z;
   if (m != 4)
     return Z_DATA_ERROR;
   r = z->total_in;  w = z->total_out;
-  cramfs_inflateReset(z);
+  zlib_inflateReset(z);
   z->total_in = r;  z->total_out = w;
   z->state->mode = BLOCKS;
   return Z_OK;
@@ -321,10 +307,10 @@ z_streamp z;
  * decompressing, PPP checks that at the end of input packet, inflate is
  * waiting for these length bytes.
  */
-int ZEXPORT cramfs_inflateSyncPoint(z)
+int ZEXPORT zlib_inflateSyncPoint(z)
 z_streamp z;
 {
   if (z == Z_NULL || z->state == Z_NULL || z->state->blocks == Z_NULL)
     return Z_STREAM_ERROR;
-  return inflate_blocks_sync_point(z->state->blocks);
+  return zlib_inflate_blocks_sync_point(z->state->blocks);
 }
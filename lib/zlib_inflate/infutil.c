@@ -3,16 +3,14 @@
  * For conditions of distribution and use, see copyright notice in zlib.h 
  */
 
-#include "zutil.h"
+#include <linux/zutil.h>
 #include "infblock.h"
 #include "inftrees.h"
 #include "infcodes.h"
 #include "infutil.h"
 
-struct inflate_codes_state {int dummy;}; /* for buggy compilers */
-
 /* And'ing with mask[n] masks the lower n bits */
-uInt cramfs_inflate_mask[17] = {
+uInt zlib_inflate_mask[17] = {
     0x0000,
     0x0001, 0x0003, 0x0007, 0x000f, 0x001f, 0x003f, 0x007f, 0x00ff,
     0x01ff, 0x03ff, 0x07ff, 0x0fff, 0x1fff, 0x3fff, 0x7fff, 0xffff
@@ -20,7 +18,7 @@ uInt cramfs_inflate_mask[17] = {
 
 
 /* copy as much as possible from the sliding window to the output area */
-int cramfs_inflate_flush(s, z, r)
+int zlib_inflate_flush(s, z, r)
 inflate_blocks_statef *s;
 z_streamp z;
 int r;
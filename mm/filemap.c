@@ -22,6 +22,8 @@
 #include <linux/slab.h>
 #include <linux/init.h>
 #include <linux/mm.h>
+#include <linux/iobuf.h>
+#include <linux/aio.h>
 
 #include <asm/pgalloc.h>
 #include <asm/uaccess.h>
@@ -288,7 +290,7 @@ void truncate_inode_pages(struct address_space * mapping, loff_t lstart)
 	truncate_list_pages(&mapping->locked_pages, start, partial);
 }
 
-static inline struct page * __find_page_nolock(struct address_space *mapping, unsigned long offset, struct page *page)
+static inline struct page * __find_page_simple(struct address_space *mapping, unsigned long offset, struct page *page)
 {
 	goto inside;
 
@@ -302,18 +304,26 @@ inside:
 		if (page->index == offset)
 			break;
 	}
-	/*
-	 * Touching the page may move it to the active list.
-	 * If we end up with too few inactive pages, we wake
-	 * up kswapd.
-	 */
-	age_page_up(page);
-	if (inactive_shortage() > inactive_target / 2 && free_shortage())
-			wakeup_kswapd(0);
 not_found:
 	return page;
 }
 
+static inline struct page * __find_page_nolock(struct address_space *mapping, unsigned long offset, struct page *page)
+{
+	page = __find_page_simple(mapping, offset, page);
+	if (page) {
+		/*
+		 * Touching the page may move it to the active list.
+		 * If we end up with too few inactive pages, we wake
+		 * up kswapd.
+		 */
+		age_page_up(page);
+		if (inactive_shortage() > inactive_target / 2 && free_shortage())
+				wakeup_kswapd(0);
+	}
+	return page;
+}
+
 /*
  * By the time this is called, the page is locked and
  * we don't have to worry about any races any more.
@@ -412,11 +422,16 @@ int generic_buffer_fdatasync(struct inode *inode, unsigned long start_idx, unsig
  * 
  *      @mapping: address space structure to write
  *
+ *	Returns the first error writepage() reported.
  */
-void filemap_fdatasync(struct address_space * mapping)
+int filemap_fdatasync(struct address_space * mapping)
 {
+	int ret = 0;
 	int (*writepage)(struct page *) = mapping->a_ops->writepage;
 
+	if (mapping->a_ops->writepages)
+		return mapping->a_ops->writepages(mapping);
+
 	spin_lock(&pagecache_lock);
 
         while (!list_empty(&mapping->dirty_pages)) {
@@ -434,8 +449,11 @@ void filemap_fdatasync(struct address_space * mapping)
 		lock_page(page);
 
 		if (PageDirty(page)) {
+			int err;
 			ClearPageDirty(page);
-			writepage(page);
+			err = writepage(page);
+			if (err && !ret)
+				ret = err;
 		} else
 			UnlockPage(page);
 
@@ -443,6 +461,7 @@ void filemap_fdatasync(struct address_space * mapping)
 		spin_lock(&pagecache_lock);
 	}
 	spin_unlock(&pagecache_lock);
+	return ret;
 }
 
 /**
@@ -451,9 +470,13 @@ void filemap_fdatasync(struct address_space * mapping)
  * 
  *      @mapping: address space structure to wait for
  *
+ *	Returns -EIO if the write of any of the pages failed, whether
+ *	it did so before we got here or while we waited.
  */
-void filemap_fdatawait(struct address_space * mapping)
+int filemap_fdatawait(struct address_space * mapping)
 {
+	int ret = 0;
+
 	spin_lock(&pagecache_lock);
 
         while (!list_empty(&mapping->locked_pages)) {
@@ -462,18 +485,28 @@ void filemap_fdatawait(struct address_space * mapping)
 		list_del(&page->list);
 		list_add(&page->list, &mapping->clean_pages);
 
-		if (!PageLocked(page))
+		if (!PageLocked(page)) {
+			if (PageError(page)) {
+				ClearPageError(page);
+				ret = -EIO;
+			}
 			continue;
+		}
 
 		page_cache_get(page);
 		spin_unlock(&pagecache_lock);
 
 		___wait_on_page(page);
+		if (PageError(page)) {
+			ClearPageError(page);
+			ret = -EIO;
+		}
 
 		page_cache_release(page);
 		spin_lock(&pagecache_lock);
 	}
 	spin_unlock(&pagecache_lock);
+	return ret;
 }
 
 /*
@@ -499,8 +532,9 @@ void add_to_page_cache_locked(struct page * page, struct address_space *mapping,
 /*
  * This adds a page to the page cache, starting out as locked,
  * owned by us, but unreferenced, not uptodate and with no errors.
+ * The caller has to put it on the LRU lists.
  */
-static inline void __add_to_page_cache(struct page * page,
+static inline void ___add_to_page_cache(struct page * page,
 	struct address_space *mapping, unsigned long offset,
 	struct page **hash)
 {
@@ -515,6 +549,13 @@ static inline void __add_to_page_cache(struct page * page,
 	page->index = offset;
 	add_page_to_inode_queue(mapping, page);
 	add_page_to_hash_queue(page, hash);
+}
+
+static inline void __add_to_page_cache(struct page * page,
+	struct address_space *mapping, unsigned long offset,
+	struct page **hash)
+{
+	___add_to_page_cache(page, mapping, offset, hash);
 	lru_cache_add(page);
 }
 
@@ -715,6 +756,51 @@ repeat:
 	return NULL;
 }
 
+/*
+ * Gang lookup: find up to @nr_pages pages of @mapping that are
+ * contiguous in the file starting at @start, and get a reference
+ * to each of them, with a single hold of the pagecache_lock.
+ *
+ * The lookup stops at the first page that is not cached, so on
+ * return pages[i] is the page at index @start + i. Returns the
+ * number of pages found.
+ */
+unsigned int find_get_pages(struct address_space *mapping, unsigned long start,
+			    unsigned int nr_pages, struct page **pages)
+{
+	unsigned int ret = 0;
+
+	spin_lock(&pagecache_lock);
+	spin_lock(&pagemap_lru_lock);
+	while (ret < nr_pages) {
+		unsigned long index = start + ret;
+		struct page *page;
+
+		page = __find_page_simple(mapping, index, *page_hash(mapping, index));
+		if (!page)
+			break;
+		age_page_up_nolock(page);
+		page_cache_get(page);
+		pages[ret++] = page;
+	}
+	spin_unlock(&pagemap_lru_lock);
+	spin_unlock(&pagecache_lock);
+
+	if (ret && inactive_shortage() > inactive_target / 2 && free_shortage())
+		wakeup_kswapd(0);
+	return ret;
+}
+
+/*
+ * Drop the references to a vector of pages, eg. the leftovers of
+ * a find_get_pages() batch.
+ */
+void page_cache_release_vec(struct page **pages, unsigned int nr_pages)
+{
+	while (nr_pages--)
+		page_cache_release(*pages++);
+}
+
 #if 0
 #define PROFILE_READAHEAD
 #define DEBUG_READAHEAD
@@ -1019,11 +1105,14 @@ void do_generic_file_read(struct file * filp, loff_t *ppos, read_descriptor_t *
 	struct address_space *mapping = inode->i_mapping;
 	unsigned long index, offset;
 	struct page *cached_page;
+	struct page *batch[PAGE_CACHE_BATCH];
+	unsigned int batch_nr, batch_next;
 	int reada_ok;
 	int error;
 	int max_readahead = get_max_readahead(inode);
 
 	cached_page = NULL;
+	batch_nr = batch_next = 0;
 	index = *ppos >> PAGE_CACHE_SHIFT;
 	offset = *ppos & ~PAGE_CACHE_MASK;
 
@@ -1068,7 +1157,7 @@ void do_generic_file_read(struct file * filp, loff_t *ppos, read_descriptor_t *
 
 	for (;;) {
 		struct page *page, **hash;
-		unsigned long end_index, nr;
+		unsigned long end_index, nr, want;
 
 		end_index = inode->i_size >> PAGE_CACHE_SHIFT;
 		if (index > end_index)
@@ -1083,8 +1172,33 @@ void do_generic_file_read(struct file * filp, loff_t *ppos, read_descriptor_t *
 		nr = nr - offset;
 
 		/*
-		 * Try to find the data in the page cache..
+		 * Try to find the data in the page cache.. For a multi-page
+		 * read we look up as many of the following pages as we can
+		 * in one go, and use them up before looking again.
 		 */
+		if (batch_next < batch_nr) {
+			page = batch[batch_next];
+			/* a short actor leaves us on the same index */
+			if (page->index == index) {
+				batch_next++;
+				goto have_page;
+			}
+			page_cache_release_vec(batch + batch_next, batch_nr - batch_next);
+		}
+		batch_nr = batch_next = 0;
+		want = (offset + desc->count + PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT;
+		if (want > end_index - index + 1)
+			want = end_index - index + 1;
+		if (want > 1) {
+			if (want > PAGE_CACHE_BATCH)
+				want = PAGE_CACHE_BATCH;
+			batch_nr = find_get_pages(mapping, index, want, batch);
+			if (batch_nr) {
+				page = batch[batch_next++];
+				goto have_page;
+			}
+		}
+
 		hash = page_hash(mapping, index);
 
 		spin_lock(&pagecache_lock);
@@ -1094,7 +1208,7 @@ void do_generic_file_read(struct file * filp, loff_t *ppos, read_descriptor_t *
 found_page:
 		page_cache_get(page);
 		spin_unlock(&pagecache_lock);
-
+have_page:
 		if (!Page_Uptodate(page))
 			goto page_not_up_to_date;
 		generic_file_readahead(reada_ok, filp, inode, page);
@@ -1142,6 +1256,9 @@ page_not_up_to_date:
 		if (!page->mapping) {
 			UnlockPage(page);
 			page_cache_release(page);
+			/* We'll retry this index, so the rest of the batch is out of step */
+			page_cache_release_vec(batch + batch_next, batch_nr - batch_next);
+			batch_nr = batch_next = 0;
 			continue;
 		}
 
@@ -1210,6 +1327,7 @@ no_cached_page:
 
 	*ppos = ((loff_t) index << PAGE_CACHE_SHIFT) + offset;
 	filp->f_reada = 1;
+	page_cache_release_vec(batch + batch_next, batch_nr - batch_next);
 	if (cached_page)
 		page_cache_free(cached_page);
 	UPDATE_ATIME(inode);
@@ -1237,6 +1355,175 @@ static int file_read_actor(read_descriptor_t * desc, struct page *page, unsigned
 	return size;
 }
 
+/*
+ * Unbuffered I/O for O_DIRECT files: map the user buffer into a
+ * kiobuf and have the filesystem's direct_IO method do the block
+ * I/O straight to or from it. The file offset, the length and the
+ * user buffer all have to be aligned to the filesystem block size.
+ *
+ * Writes are done with i_sem held by the caller. Reads pin the
+ * blocks against truncate as generic_file_aio_map() does.
+ */
+static ssize_t generic_file_direct_IO(int rw, struct file * filp, char * buf, size_t count, loff_t offset)
+{
+	struct inode * inode = filp->f_dentry->d_inode;
+	struct address_space * mapping = inode->i_mapping;
+	struct kiobuf * iobuf;
+	unsigned long blocknr;
+	ssize_t retval, progress, eof;
+	int blocksize, blocksize_bits, iosize;
+
+	blocksize = inode->i_sb->s_blocksize;
+	blocksize_bits = inode->i_sb->s_blocksize_bits;
+
+	retval = -EINVAL;
+	if (!mapping->a_ops->direct_IO)
+		goto out;
+	if ((offset & (blocksize - 1)) || (count & (blocksize - 1)) ||
+	    ((unsigned long) buf & (blocksize - 1)))
+		goto out;
+
+	/*
+	 * Reads stop at EOF. The last block is read in full, but
+	 * we only report the bytes that are inside the file.
+	 */
+	eof = count;
+	if (rw == READ) {
+		retval = 0;
+		down(&inode->i_sem);
+		if (offset >= inode->i_size) {
+			up(&inode->i_sem);
+			goto out;
+		}
+		if (count > inode->i_size - offset) {
+			eof = inode->i_size - offset;
+			count = (eof + blocksize - 1) & ~(blocksize - 1);
+		}
+		atomic_inc(&inode->i_dio_count);
+		up(&inode->i_sem);
+	}
+
+	retval = alloc_kiovec(1, &iobuf);
+	if (retval)
+		goto out_unpin;
+
+	/*
+	 * Get any dirty cached data over the range onto the disk first,
+	 * so that we neither read stale blocks nor have a later writeback
+	 * overwrite what we are about to write.
+	 */
+	filemap_fdatasync(mapping);
+	retval = generic_buffer_fdatasync(inode, offset >> PAGE_CACHE_SHIFT,
+			(offset + count + PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT);
+	filemap_fdatawait(mapping);
+	if (retval)
+		goto out_free;
+
+	progress = 0;
+	blocknr = offset >> blocksize_bits;
+	while (count > 0) {
+		iosize = count;
+		if (iosize > KIO_MAX_ATOMIC_BYTES)
+			iosize = KIO_MAX_ATOMIC_BYTES;
+
+		retval = map_user_kiobuf(rw, iobuf, (unsigned long) buf, iosize);
+		if (retval)
+			break;
+
+		retval = mapping->a_ops->direct_IO(rw, inode, iobuf, blocknr, blocksize);
+		unmap_kiobuf(iobuf);
+
+		if (retval >= 0) {
+			progress += retval;
+			count -= retval;
+			buf += retval;
+			blocknr += retval >> blocksize_bits;
+		}
+		if (retval != iosize)
+			break;
+	}
+	if (progress)
+		retval = progress;
+	if (retval > eof)
+		retval = eof;
+
+	/*
+	 * The page cache may still hold the old contents of what we just
+	 * wrote; throw away the unused pages so that it gets reread.
+	 */
+	if (rw == WRITE && progress)
+		invalidate_inode_pages(inode);
+
+out_free:
+	free_kiovec(1, &iobuf);
+out_unpin:
+	if (rw == READ && atomic_dec_and_test(&inode->i_dio_count))
+		wake_up(&inode->i_wait);
+out:
+	return retval;
+}
+
+/*
+ * The aio_map method for O_DIRECT files on block-based filesystems:
+ * find the blocks behind an asynchronous read with bmap. Writes may
+ * have to allocate blocks, which needs i_sem, so they aren't done
+ * asynchronously.
+ */
+int generic_file_aio_map(struct file * filp, int rw, loff_t pos, size_t count, struct kio_map * map)
+{
+	struct inode * inode = filp->f_dentry->d_inode;
+	struct address_space * mapping = inode->i_mapping;
+	int blocksize = inode->i_sb->s_blocksize;
+	int blocksize_bits = inode->i_sb->s_blocksize_bits;
+	unsigned long block;
+	int i;
+
+	if (rw != READ || !(filp->f_flags & O_DIRECT) || !mapping->a_ops->bmap)
+		return -EINVAL;
+	if ((pos & (blocksize - 1)) || (count & (blocksize - 1)))
+		return -EINVAL;
+	if ((count >> blocksize_bits) > KIO_MAX_SECTORS)
+		return -EINVAL;
+
+	map->dev = inode->i_dev;
+	map->blocksize = blocksize;
+	map->nr_blocks = 0;
+	map->valid = 0;
+
+	/*
+	 * The blocks must not be freed and reused before the read is
+	 * done: truncate takes i_sem and then waits for i_dio_count.
+	 */
+	down(&inode->i_sem);
+	if (pos >= inode->i_size)
+		goto out;
+	map->valid = count;
+	if (count > inode->i_size - pos) {
+		map->valid = inode->i_size - pos;
+		count = (map->valid + blocksize - 1) & ~(blocksize - 1);
+	}
+
+	/* Don't read stale blocks from under dirty cached data */
+	if (mapping->nrpages) {
+		filemap_fdatasync(mapping);
+		generic_buffer_fdatasync(inode, pos >> PAGE_CACHE_SHIFT,
+			(pos + count + PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT);
+		filemap_fdatawait(mapping);
+	}
+
+	map->nr_blocks = count >> blocksize_bits;
+	block = pos >> blocksize_bits;
+	for (i = 0; i < map->nr_blocks; i++) {
+		int phys = mapping->a_ops->bmap(mapping, block + i);
+		map->blocks[i] = phys ? phys : -1UL;
+	}
+	atomic_inc(&inode->i_dio_count);
+	map->inode = inode;
+out:
+	up(&inode->i_sem);
+	return 0;
+}
+
 /*
  * This is the "read()" routine for all filesystems
  * that can use the page cache directly.
@@ -1249,7 +1536,12 @@ ssize_t generic_file_read(struct file * filp, char * buf, size_t count, loff_t *
 	if (access_ok(VERIFY_WRITE, buf, count)) {
 		retval = 0;
 
-		if (count) {
+		if (count && (filp->f_flags & O_DIRECT)) {
+			retval = generic_file_direct_IO(READ, filp, buf, count, *ppos);
+			if (retval > 0)
+				*ppos += retval;
+			UPDATE_ATIME(filp->f_dentry->d_inode);
+		} else if (count) {
 			read_descriptor_t desc;
 
 			desc.written = 0;
@@ -1266,7 +1558,7 @@ ssize_t generic_file_read(struct file * filp, char * buf, size_t count, loff_t *
 	return retval;
 }
 
-static int file_send_actor(read_descriptor_t * desc, struct page *page, unsigned long offset , unsigned long size)
+int file_send_actor(read_descriptor_t * desc, struct page *page, unsigned long offset , unsigned long size)
 {
 	char *kaddr;
 	ssize_t written;
@@ -1276,13 +1568,23 @@ static int file_send_actor(read_descriptor_t * desc, struct page *page, unsigned
 
 	if (size > count)
 		size = count;
-	old_fs = get_fs();
-	set_fs(KERNEL_DS);
 
-	kaddr = kmap(page);
-	written = file->f_op->write(file, kaddr + offset, size, &file->f_pos);
-	kunmap(page);
-	set_fs(old_fs);
+	/*
+	 * Hand the page itself to files that know what to do with
+	 * it (sockets), telling them whether more is to follow.
+	 */
+	if (file->f_op->sendpage) {
+		written = file->f_op->sendpage(file, page, offset, size,
+					       &file->f_pos, size < count);
+	} else {
+		old_fs = get_fs();
+		set_fs(KERNEL_DS);
+
+		kaddr = kmap(page);
+		written = file->f_op->write(file, kaddr + offset, size, &file->f_pos);
+		kunmap(page);
+		set_fs(old_fs);
+	}
 	if (written < 0) {
 		desc->error = written;
 		written = 0;
@@ -1741,11 +2043,17 @@ static int msync_interval(struct vm_area_struct * vma,
 
 		if (!error && (flags & MS_SYNC)) {
 			struct inode * inode = file->f_dentry->d_inode;
+			int err;
 			down(&inode->i_sem);
-			filemap_fdatasync(inode->i_mapping);
-			if (file->f_op && file->f_op->fsync)
-				error = file->f_op->fsync(file, file->f_dentry, 1);
-			filemap_fdatawait(inode->i_mapping);
+			error = filemap_fdatasync(inode->i_mapping);
+			if (file->f_op && file->f_op->fsync) {
+				err = file->f_op->fsync(file, file->f_dentry, 1);
+				if (err && !error)
+					error = err;
+			}
+			err = filemap_fdatawait(inode->i_mapping);
+			if (err && !error)
+				error = err;
 			up(&inode->i_sem);
 		}
 		return error;
@@ -2411,6 +2719,84 @@ struct page *grab_cache_page(struct address_space *mapping, unsigned long index)
 	return page;
 }
 
+/*
+ * Batched grab_cache_page(): returns up to @nr_pages locked pages
+ * for the contiguous range starting at @start, creating the ones
+ * that aren't cached yet. The lookups and insertions are done in
+ * one go under the pagecache_lock; new pages are allocated outside
+ * of it whenever we run into a hole.
+ *
+ * We never sleep on a page lock with pages of the batch held, so
+ * the batch is cut short at the first page somebody else has
+ * locked. Only if that is the very first page do we wait for it.
+ * Returns the number of pages in @pages, 0 if out of memory.
+ */
+unsigned int grab_cache_pages(struct address_space *mapping, unsigned long start,
+			      unsigned int nr_pages, struct page **pages)
+{
+	struct page *spare[PAGE_CACHE_BATCH];
+	unsigned int ret = 0, nr_spare = 0;
+
+	if (nr_pages > PAGE_CACHE_BATCH)
+		nr_pages = PAGE_CACHE_BATCH;
+
+	for (;;) {
+		spin_lock(&pagecache_lock);
+		spin_lock(&pagemap_lru_lock);
+		while (ret < nr_pages) {
+			unsigned long index = start + ret;
+			struct page **hash = page_hash(mapping, index);
+			struct page *page;
+
+			page = __find_page_simple(mapping, index, *hash);
+			if (page) {
+				if (TryLockPage(page)) {
+					nr_pages = ret;
+					break;
+				}
+				age_page_up_nolock(page);
+				page_cache_get(page);
+			} else {
+				if (!nr_spare)
+					break;
+				page = spare[--nr_spare];
+				___add_to_page_cache(page, mapping, index, hash);
+				__lru_cache_add(page);
+			}
+			pages[ret++] = page;
+		}
+		spin_unlock(&pagemap_lru_lock);
+		spin_unlock(&pagecache_lock);
+
+		if (ret == nr_pages)
+			break;
+
+		/* We hit a hole: allocate enough pages to fill the rest */
+		while (nr_spare < nr_pages - ret) {
+			struct page *page = page_cache_alloc();
+			if (!page)
+				break;
+			spare[nr_spare++] = page;
+		}
+		if (!nr_spare)
+			break;
+	}
+
+	while (nr_spare)
+		page_cache_free(spare[--nr_spare]);
+
+	if (!ret) {
+		struct page *cached_page = NULL;
+
+		pages[0] = __grab_cache_page(mapping, start, &cached_page);
+		if (cached_page)
+			page_cache_free(cached_page);
+		if (pages[0])
+			ret = 1;
+	}
+	return ret;
+}
+
 static inline void remove_suid(struct inode *inode)
 {
 	unsigned int mode;
@@ -2448,12 +2834,14 @@ generic_file_write(struct file *file,const char *buf,size_t count,loff_t *ppos)
 	struct address_space *mapping = inode->i_mapping;
 	unsigned long	limit = current->rlim[RLIMIT_FSIZE].rlim_cur;
 	loff_t		pos;
-	struct page	*page, *cached_page;
+	struct page	*page;
+	struct page	*batch[PAGE_CACHE_BATCH];
+	unsigned int	batch_nr, batch_next;
 	unsigned long	written;
 	long		status;
 	int		err;
 
-	cached_page = NULL;
+	batch_nr = batch_next = 0;
 
 	down(&inode->i_sem);
 
@@ -2495,8 +2883,11 @@ generic_file_write(struct file *file,const char *buf,size_t count,loff_t *ppos)
 		mark_inode_dirty_sync(inode);
 	}
 
+	if (file->f_flags & O_DIRECT)
+		goto o_direct;
+
 	while (count) {
-		unsigned long bytes, index, offset;
+		unsigned long bytes, copied, index, offset;
 		char *kaddr;
 
 		/*
@@ -2510,20 +2901,41 @@ generic_file_write(struct file *file,const char *buf,size_t count,loff_t *ppos)
 			bytes = count;
 
 		/*
-		 * Bring in the user page that we will copy from _first_.
-		 * Otherwise there's a nasty deadlock on copying from the
-		 * same page as we're writing to, without it being marked
-		 * up-to-date.
+		 * Grab the pages for the next part of the write in one
+		 * batch, unless we still have some left from the last one.
 		 */
-		{ volatile unsigned char dummy;
-			__get_user(dummy, buf);
-			__get_user(dummy, buf+bytes-1);
-		}
+		if (batch_next == batch_nr) {
+			unsigned long want, span;
 
-		status = -ENOMEM;	/* we'll assign it later anyway */
-		page = __grab_cache_page(mapping, index, &cached_page);
-		if (!page)
-			break;
+			want = (offset + count + PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT;
+			if (want > PAGE_CACHE_BATCH)
+				want = PAGE_CACHE_BATCH;
+			span = (want << PAGE_CACHE_SHIFT) - offset;
+			if (span > count)
+				span = count;
+
+			/*
+			 * Bring in the user pages that we will copy from _first_.
+			 * Otherwise there's a nasty deadlock on copying from the
+			 * same page as we're writing to, without it being marked
+			 * up-to-date. This covers the whole batch, as we hold
+			 * all of its pages locked while copying into the first.
+			 */
+			{ volatile unsigned char dummy;
+				unsigned long done;
+
+				for (done = 0; done < span; done += PAGE_SIZE)
+					__get_user(dummy, buf+done);
+				__get_user(dummy, buf+span-1);
+			}
+
+			status = -ENOMEM;	/* we'll assign it later anyway */
+			batch_nr = grab_cache_pages(mapping, index, want, batch);
+			batch_next = 0;
+			if (!batch_nr)
+				break;
+		}
+		page = batch[batch_next++];
 
 		/* We have exclusive IO access to the page.. */
 		if (!PageLocked(page)) {
@@ -2534,19 +2946,35 @@ generic_file_write(struct file *file,const char *buf,size_t count,loff_t *ppos)
 		if (status)
 			goto unlock;
 		kaddr = page_address(page);
-		status = copy_from_user(kaddr+offset, buf, bytes);
+		copied = bytes - copy_from_user(kaddr+offset, buf, bytes);
 		flush_dcache_page(page);
-		if (status)
-			goto fail_write;
-		status = mapping->a_ops->commit_write(file, page, offset, offset+bytes);
+		/*
+		 * A fault zero-fills the rest of the range. Committing the
+		 * block that holds the first zero would write them over the
+		 * file's data, so stop at its start.
+		 */
+		if (copied < bytes && page->buffers) {
+			unsigned long end = (offset + copied) & ~(page->buffers->b_size - 1);
+			copied = end > offset ? end - offset : 0;
+		}
+		/*
+		 * Commit even after a fault, but only what was copied: the
+		 * filesystem may hold state from prepare_write, such as a
+		 * journal handle, that only commit_write releases.
+		 */
+		status = mapping->a_ops->commit_write(file, page, offset, offset+copied);
 		if (!status)
-			status = bytes;
+			status = copied;
+		if (copied < bytes)
+			block_write_fault(page, offset+copied, offset+bytes);
 
 		if (status >= 0) {
 			written += status;
 			count -= status;
 			pos += status;
 			buf += status;
+			if (copied < bytes)
+				goto fail_write;
 		}
 unlock:
 		/* Mark it unlocked again and drop the page.. */
@@ -2559,8 +2987,12 @@ unlock:
 	}
 	*ppos = pos;
 
-	if (cached_page)
-		page_cache_free(cached_page);
+	/* Unlock and drop whatever is left over from the last batch */
+	while (batch_next < batch_nr) {
+		page = batch[batch_next++];
+		UnlockPage(page);
+		page_cache_release(page);
+	}
 
 	/* For now, when the user asks for O_SYNC, we'll actually
 	 * provide O_DSYNC. */
@@ -2572,10 +3004,30 @@ out:
 
 	up(&inode->i_sem);
 	return err;
+
+o_direct:
+	err = 0;
+	if (!count)
+		goto out;
+	err = generic_file_direct_IO(WRITE, file, (char *) buf, count, pos);
+	if (err > 0) {
+		pos += err;
+		if (pos > inode->i_size) {
+			inode->i_size = pos;
+			mark_inode_dirty(inode);
+		}
+		*ppos = pos;
+		/* The data is on disk, but the block mappings may not be */
+		if (file->f_flags & O_SYNC) {
+			status = generic_osync_inode(inode, 1);
+			if (status)
+				err = status;
+		}
+	}
+	goto out;
+
 fail_write:
 	status = -EFAULT;
-	ClearPageUptodate(page);
-	kunmap(page);
 	goto unlock;
 }
 
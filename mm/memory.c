@@ -955,6 +955,8 @@ out_unlock:
 	spin_unlock(&mapping->i_shared_lock);
 	/* this should go into ->truncate */
 	inode->i_size = offset;
+	/* O_DIRECT reads may still be going to the blocks we free */
+	wait_event(inode->i_wait, !atomic_read(&inode->i_dio_count));
 	if (inode->i_op && inode->i_op->truncate)
 		inode->i_op->truncate(inode);
 	return;
@@ -27,6 +27,7 @@
 #include <linux/pagemap.h>
 #include <linux/string.h>
 #include <linux/locks.h>
+#include <linux/slab.h>
 #include <asm/smplock.h>
 
 #include <asm/uaccess.h>
@@ -48,27 +49,133 @@ static struct vm_operations_struct shmem_private_vm_ops;
 LIST_HEAD (shmem_inodes);
 static spinlock_t shmem_ilock = SPIN_LOCK_UNLOCKED;
 
-static swp_entry_t * shmem_swp_entry (struct shmem_inode_info *info, unsigned long index) 
+/*
+ * Block and inode accounting.  Each CPU keeps a small reserve of free
+ * blocks and inodes taken from the superblock's pool, so that faults
+ * and creates on different CPUs do not all meet on stat_lock.  The pool
+ * and the reserves together hold everything that is free; statfs and
+ * remount drain the reserves back into the pool first.
+ *
+ * stat_lock may be taken before a CPU's lock, never the other way.
+ */
+#define SHMEM_BLOCKS	0
+#define SHMEM_INODES	1
+#define SHMEM_RESERVE	16
+
+struct shmem_sb_cpu {
+	spinlock_t	lock;
+	unsigned long	free[2];	/* SHMEM_BLOCKS, SHMEM_INODES */
+} ____cacheline_aligned;
+
+static inline unsigned long * shmem_pool (struct shmem_sb_info *sbinfo, int what)
+{
+	return what == SHMEM_BLOCKS ? &sbinfo->free_blocks : &sbinfo->free_inodes;
+}
+
+/* Called with stat_lock held */
+static void shmem_drain (struct shmem_sb_info *sbinfo)
+{
+	struct shmem_sb_cpu *sc;
+	int cpu;
+
+	for (cpu = 0; cpu < NR_CPUS; cpu++) {
+		sc = &sbinfo->cpu[cpu];
+		spin_lock (&sc->lock);
+		sbinfo->free_blocks += sc->free[SHMEM_BLOCKS];
+		sbinfo->free_inodes += sc->free[SHMEM_INODES];
+		sc->free[SHMEM_BLOCKS] = sc->free[SHMEM_INODES] = 0;
+		spin_unlock (&sc->lock);
+	}
+}
+
+static int shmem_charge (struct super_block *sb, int what)
+{
+	struct shmem_sb_info *sbinfo = &sb->u.shmem_sb;
+	struct shmem_sb_cpu *sc = &sbinfo->cpu[smp_processor_id()];
+	unsigned long *pool = shmem_pool(sbinfo, what);
+	unsigned long n;
+
+	spin_lock (&sc->lock);
+	if (sc->free[what]) {
+		sc->free[what]--;
+		spin_unlock (&sc->lock);
+		return 0;
+	}
+	spin_unlock (&sc->lock);
+
+	spin_lock (&sbinfo->stat_lock);
+	/* what is left may be sitting in other CPUs' reserves */
+	if (!*pool)
+		shmem_drain (sbinfo);
+	n = *pool;
+	if (!n) {
+		spin_unlock (&sbinfo->stat_lock);
+		return -ENOSPC;
+	}
+	if (n > SHMEM_RESERVE)
+		n = SHMEM_RESERVE;
+	*pool -= n;
+	spin_unlock (&sbinfo->stat_lock);
+
+	spin_lock (&sc->lock);
+	sc->free[what] += n - 1;
+	spin_unlock (&sc->lock);
+	return 0;
+}
+
+static void shmem_uncharge (struct super_block *sb, int what, unsigned long n)
 {
+	struct shmem_sb_info *sbinfo = &sb->u.shmem_sb;
+	struct shmem_sb_cpu *sc = &sbinfo->cpu[smp_processor_id()];
+
+	spin_lock (&sc->lock);
+	sc->free[what] += n;
+	n = 0;
+	if (sc->free[what] > 2 * SHMEM_RESERVE) {
+		n = sc->free[what] - SHMEM_RESERVE;
+		sc->free[what] = SHMEM_RESERVE;
+	}
+	spin_unlock (&sc->lock);
+
+	if (n) {
+		spin_lock (&sbinfo->stat_lock);
+		*shmem_pool(sbinfo, what) += n;
+		spin_unlock (&sbinfo->stat_lock);
+	}
+}
+
+/*
+ * Find the swap entry of page @index.  The vector pages holding the
+ * entries are only allocated when a page is first swapped out: if one
+ * is missing, the zeroed page *@vpage is put in its place, or if there
+ * is none, ERR_PTR(-ENOMEM) tells that the page has no entry yet.
+ * Called with info->lock held.
+ */
+static swp_entry_t * shmem_swp_entry (struct shmem_inode_info *info, unsigned long index, unsigned long *vpage)
+{
+	swp_entry_t **dir;
+
 	if (index < SHMEM_NR_DIRECT)
 		return info->i_direct+index;
 
 	index -= SHMEM_NR_DIRECT;
 	if (index >= ENTRIES_PER_PAGE*ENTRIES_PER_PAGE)
-		return NULL;
+		return ERR_PTR(-EFBIG);
 
 	if (!info->i_indirect) {
-		info->i_indirect = (swp_entry_t **) get_zeroed_page(GFP_USER);
-		if (!info->i_indirect)
-			return NULL;
+		if (!vpage || !*vpage)
+			return ERR_PTR(-ENOMEM);
+		info->i_indirect = (swp_entry_t **) *vpage;
+		*vpage = 0;
 	}
-	if(!(info->i_indirect[index/ENTRIES_PER_PAGE])) {
-		info->i_indirect[index/ENTRIES_PER_PAGE] = (swp_entry_t *) get_zeroed_page(GFP_USER);
-		if (!info->i_indirect[index/ENTRIES_PER_PAGE])
-			return NULL;
+	dir = info->i_indirect + index/ENTRIES_PER_PAGE;
+	if (!*dir) {
+		if (!vpage || !*vpage)
+			return ERR_PTR(-ENOMEM);
+		*dir = (swp_entry_t *) *vpage;
+		*vpage = 0;
 	}
-	
-	return info->i_indirect[index/ENTRIES_PER_PAGE]+index%ENTRIES_PER_PAGE;
+	return *dir + index%ENTRIES_PER_PAGE;
 }
 
 static int shmem_free_swp(swp_entry_t *dir, unsigned int count)
@@ -171,23 +278,18 @@ out:
 	inode->i_blocks -= freed + mmfreed;
 	spin_unlock (&info->lock);
 
-	spin_lock (&inode->i_sb->u.shmem_sb.stat_lock);
-	inode->i_sb->u.shmem_sb.free_blocks += freed + mmfreed;
-	spin_unlock (&inode->i_sb->u.shmem_sb.stat_lock);
+	if (freed + mmfreed)
+		shmem_uncharge (inode->i_sb, SHMEM_BLOCKS, freed + mmfreed);
 }
 
 static void shmem_delete_inode(struct inode * inode)
 {
-	struct shmem_sb_info *info = &inode->i_sb->u.shmem_sb;
-
 	spin_lock (&shmem_ilock);
 	list_del (&inode->u.shmem_i.list);
 	spin_unlock (&shmem_ilock);
 	inode->i_size = 0;
 	shmem_truncate (inode);
-	spin_lock (&info->stat_lock);
-	info->free_inodes++;
-	spin_unlock (&info->stat_lock);
+	shmem_uncharge (inode->i_sb, SHMEM_INODES, 1);
 	clear_inode(inode);
 }
 
@@ -199,18 +301,35 @@ static int shmem_writepage(struct page * page)
 	int error;
 	struct shmem_inode_info *info;
 	swp_entry_t *entry, swap;
+	unsigned long vpage = 0;
 
 	info = &page->mapping->host->u.shmem_i;
 	if (info->locked)
 		return 1;
+	/* Mapped by shmem_nopage() since page_launder() looked at it? */
+	if (page_count(page) > 2)
+		return 1;
 	swap = __get_swap_page(2);
 	if (!swap.val)
 		return 1;
 
 	spin_lock(&info->lock);
-	entry = shmem_swp_entry (info, page->index);
-	if (!entry)	/* this had been allocted on page allocation */
-		BUG();
+	while (IS_ERR(entry = shmem_swp_entry (info, page->index, &vpage))) {
+		spin_unlock(&info->lock);
+		/*
+		 * A vector page lets up to ENTRIES_PER_PAGE pages go to
+		 * swap: worth dipping into the reserves for.
+		 */
+		if (PTR_ERR(entry) == -ENOMEM)
+			vpage = get_zeroed_page(GFP_ATOMIC);
+		if (!vpage) {
+			__swap_free(swap, 2);
+			return 1;
+		}
+		spin_lock(&info->lock);
+	}
+	if (vpage)
+		free_page(vpage);
 	error = -EAGAIN;
 	if (entry->val) {
                 __swap_free(swap, 2);
@@ -234,6 +353,15 @@ out:
 	return error;
 }
 
+/*
+ * Pages only go to swap from page_launder(): there is nothing for
+ * msync() or the flush thread to write.
+ */
+static int shmem_writepages(struct address_space *mapping)
+{
+	return 0;
+}
+
 /*
  * shmem_nopage - either get the page from swap or allocate a new one
  *
@@ -249,11 +377,33 @@ struct page * shmem_nopage(struct vm_area_struct * vma, unsigned long address, i
 	swp_entry_t *entry;
 	struct inode * inode = vma->vm_file->f_dentry->d_inode;
 	struct address_space * mapping = inode->i_mapping;
-	struct shmem_inode_info *info;
+	struct shmem_inode_info *info = &inode->u.shmem_i;
 
 	idx = (address - vma->vm_start) >> PAGE_SHIFT;
 	idx += vma->vm_pgoff;
 
+	size = (inode->i_size + PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT;
+	if ((idx >= size) && (vma->vm_mm == current->mm))
+		return NOPAGE_SIGBUS;
+
+	/*
+	 * Pages in the cache are mapped without taking i_sem.  Getting
+	 * the page lock for a moment makes sure that shmem_writepage()
+	 * is not moving it to the swap cache under us: once we hold a
+	 * reference it leaves the page alone.
+	 */
+	page = __find_get_page(mapping, idx, page_hash (mapping, idx));
+	if (page) {
+		if (!TryLockPage(page)) {
+			if (page->mapping == mapping && Page_Uptodate(page)) {
+				UnlockPage(page);
+				goto got_page;
+			}
+			UnlockPage(page);
+		}
+		page_cache_release(page);
+	}
+
 	down (&inode->i_sem);
 	size = (inode->i_size + PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT;
 	page = NOPAGE_SIGBUS;
@@ -265,11 +415,11 @@ struct page * shmem_nopage(struct vm_area_struct * vma, unsigned long address, i
 	if (page)
 		goto cached_page;
 
-	info = &inode->u.shmem_i;
-	entry = shmem_swp_entry (info, idx);
-	if (!entry)
-		goto oom;
-	if (entry->val) {
+	/* No swap vector page yet: the page was never swapped out */
+	spin_lock (&info->lock);
+	entry = shmem_swp_entry (info, idx, NULL);
+	spin_unlock (&info->lock);
+	if (!IS_ERR(entry) && entry->val) {
 		unsigned long flags;
 
 		/* Look it up and read it in.. */
@@ -295,15 +445,14 @@ struct page * shmem_nopage(struct vm_area_struct * vma, unsigned long address, i
 		info->swapped--;
 		spin_unlock (&info->lock);
 	} else {
-		spin_lock (&inode->i_sb->u.shmem_sb.stat_lock);
-		if (inode->i_sb->u.shmem_sb.free_blocks == 0)
-			goto no_space;
-		inode->i_sb->u.shmem_sb.free_blocks--;
-		spin_unlock (&inode->i_sb->u.shmem_sb.stat_lock);
+		if (shmem_charge (inode->i_sb, SHMEM_BLOCKS))
+			goto oom;
 		/* Ok, get a new page */
 		page = page_cache_alloc();
-		if (!page)
+		if (!page) {
+			shmem_uncharge (inode->i_sb, SHMEM_BLOCKS, 1);
 			goto oom;
+		}
 		clear_user_highpage(page, address);
 		inode->i_blocks++;
 		add_to_page_cache (page, mapping, idx);
@@ -315,6 +464,7 @@ cached_page:
 	UnlockPage (page);
 	up(&inode->i_sem);
 
+got_page:
 	if (no_share) {
 		struct page *new_page = page_cache_alloc();
 
@@ -329,8 +479,6 @@ cached_page:
 
 	flush_page_to_ram (page);
 	return(page);
-no_space:
-	spin_unlock (&inode->i_sb->u.shmem_sb.stat_lock);
 oom:
 	page = NOPAGE_OOM;
 out:
@@ -342,13 +490,8 @@ struct inode *shmem_get_inode(struct super_block *sb, int mode, int dev)
 {
 	struct inode * inode;
 
-	spin_lock (&sb->u.shmem_sb.stat_lock);
-	if (!sb->u.shmem_sb.free_inodes) {
-		spin_unlock (&sb->u.shmem_sb.stat_lock);
+	if (shmem_charge (sb, SHMEM_INODES))
 		return NULL;
-	}
-	sb->u.shmem_sb.free_inodes--;
-	spin_unlock (&sb->u.shmem_sb.stat_lock);
 
 	inode = new_inode(sb);
 	if (inode) {
@@ -380,7 +523,8 @@ struct inode *shmem_get_inode(struct super_block *sb, int mode, int dev)
 		spin_lock (&shmem_ilock);
 		list_add (&inode->u.shmem_i.list, &shmem_inodes);
 		spin_unlock (&shmem_ilock);
-	}
+	} else
+		shmem_uncharge (sb, SHMEM_INODES, 1);
 	return inode;
 }
 
@@ -391,6 +535,7 @@ static int shmem_statfs(struct super_block *sb, struct statfs *buf)
 	spin_lock (&sb->u.shmem_sb.stat_lock);
 	if (sb->u.shmem_sb.max_blocks != ULONG_MAX || 
 	    sb->u.shmem_sb.max_inodes != ULONG_MAX) {
+		shmem_drain (&sb->u.shmem_sb);
 		buf->f_blocks = sb->u.shmem_sb.max_blocks;
 		buf->f_bavail = buf->f_bfree = sb->u.shmem_sb.free_blocks;
 		buf->f_files = sb->u.shmem_sb.max_inodes;
@@ -599,12 +744,21 @@ static struct super_block *shmem_read_super(struct super_block * sb, void * data
 	unsigned long blocks = ULONG_MAX;	/* unlimited */
 	unsigned long inodes = ULONG_MAX;	/* unlimited */
 	int mode   = S_IRWXUGO | S_ISVTX;
+	int i;
 
 	if (shmem_parse_options (data, &mode, &blocks, &inodes)) {
 		printk(KERN_ERR "shmem fs invalid option\n");
 		return NULL;
 	}
 
+	sb->u.shmem_sb.cpu = kmalloc(NR_CPUS * sizeof(struct shmem_sb_cpu), GFP_KERNEL);
+	if (!sb->u.shmem_sb.cpu)
+		return NULL;
+	for (i = 0; i < NR_CPUS; i++) {
+		spin_lock_init (&sb->u.shmem_sb.cpu[i].lock);
+		sb->u.shmem_sb.cpu[i].free[SHMEM_BLOCKS] = 0;
+		sb->u.shmem_sb.cpu[i].free[SHMEM_INODES] = 0;
+	}
 	spin_lock_init (&sb->u.shmem_sb.stat_lock);
 	sb->u.shmem_sb.max_blocks = blocks;
 	sb->u.shmem_sb.free_blocks = blocks;
@@ -616,15 +770,24 @@ static struct super_block *shmem_read_super(struct super_block * sb, void * data
 	sb->s_op = &shmem_ops;
 	inode = shmem_get_inode(sb, S_IFDIR | mode, 0);
 	if (!inode)
-		return NULL;
+		goto out_free;
 
 	root = d_alloc_root(inode);
 	if (!root) {
 		iput(inode);
-		return NULL;
+		goto out_free;
 	}
 	sb->s_root = root;
 	return sb;
+
+out_free:
+	kfree(sb->u.shmem_sb.cpu);
+	return NULL;
+}
+
+static void shmem_put_super (struct super_block *sb)
+{
+	kfree(sb->u.shmem_sb.cpu);
 }
 
 static int shmem_remount_fs (struct super_block *sb, int *flags, char *data)
@@ -638,6 +801,7 @@ static int shmem_remount_fs (struct super_block *sb, int *flags, char *data)
 		return -EINVAL;
 
 	spin_lock(&info->stat_lock);
+	shmem_drain(info);
 	blocks = info->max_blocks - info->free_blocks;
 	inodes = info->max_inodes - info->free_inodes;
 	error = -EINVAL;
@@ -656,7 +820,8 @@ out:
 }
 
 static struct address_space_operations shmem_aops = {
-	writepage: shmem_writepage
+	writepage: shmem_writepage,
+	writepages: shmem_writepages,
 };
 
 static struct file_operations shmem_file_operations = {
@@ -687,6 +852,7 @@ static struct inode_operations shmem_dir_inode_operations = {
 static struct super_operations shmem_ops = {
 	statfs:		shmem_statfs,
 	remount_fs:	shmem_remount_fs,
+	put_super:	shmem_put_super,
 	delete_inode:	shmem_delete_inode,
 	put_inode:	force_delete,	
 };
@@ -230,6 +230,19 @@ void activate_page(struct page * page)
 void lru_cache_add(struct page * page)
 {
 	spin_lock(&pagemap_lru_lock);
+	__lru_cache_add(page);
+	spin_unlock(&pagemap_lru_lock);
+}
+
+/**
+ * __lru_cache_add: add a page to the page lists
+ * @page: the page to add
+ *
+ * This function is for when the caller already holds
+ * the pagemap_lru_lock.
+ */
+void __lru_cache_add(struct page * page)
+{
 	if (!PageLocked(page))
 		BUG();
 	DEBUG_ADD_PAGE
@@ -237,7 +250,6 @@ void lru_cache_add(struct page * page)
 	/* This should be relatively rare */
 	if (!page->age)
 		deactivate_page_nolock(page);
-	spin_unlock(&pagemap_lru_lock);
 }
 
 /**
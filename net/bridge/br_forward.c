@@ -32,6 +32,8 @@ static inline int should_forward(struct net_bridge_port *p, struct sk_buff *skb)
 static void __br_forward(struct net_bridge_port *to, struct sk_buff *skb)
 {
 	skb->dev = to->dev;
+	/* A checksum verified on receive means nothing on transmit */
+	skb->ip_summed = CHECKSUM_NONE;
 	dev_queue_xmit(skb);
 }
 
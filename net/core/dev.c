@@ -89,6 +89,7 @@
 #include <linux/if_bridge.h>
 #include <linux/divert.h>
 #include <net/dst.h>
+#include <net/checksum.h>
 #include <net/pkt_sched.h>
 #include <net/profile.h>
 #include <linux/init.h>
@@ -862,7 +863,14 @@ void dev_queue_xmit_nit(struct sk_buff *skb, struct net_device *dev)
 			((struct sock *)ptype->data != skb->sk))
 		{
 			struct sk_buff *skb2;
-			if ((skb2 = skb_clone(skb, GFP_ATOMIC)) == NULL)
+
+			/* Taps read the data linearly; give them a copy
+			   rather than a clone of a paged buffer. */
+			if (skb_is_nonlinear(skb))
+				skb2 = skb_copy(skb, GFP_ATOMIC);
+			else
+				skb2 = skb_clone(skb, GFP_ATOMIC);
+			if (skb2 == NULL)
 				break;
 
 			/* skb->nh should be correctly
@@ -887,6 +895,31 @@ void dev_queue_xmit_nit(struct sk_buff *skb, struct net_device *dev)
 	br_read_unlock(BR_NETPROTO_LOCK);
 }
 
+/**
+ *	skb_checksum_help - complete a checksum left to the hardware
+ *	@skb: buffer with ip_summed == CHECKSUM_PARTIAL
+ *
+ *	Computes in software the checksum of the data from skb->h.raw on,
+ *	and stores it at skb->h.raw + skb->csum. Used when the frame goes
+ *	somewhere that cannot do it: a device without checksum offload, a
+ *	netfilter hook, fragmentation. Returns 0 or -EINVAL.
+ */
+
+int skb_checksum_help(struct sk_buff *skb)
+{
+	unsigned int csum;
+	int offset = skb->h.raw - skb->data;
+
+	if (offset < 0 || offset > (int)skb->len ||
+	    skb->csum + 2 > skb_headlen(skb) - offset)
+		return -EINVAL;
+
+	csum = skb_checksum(skb, offset, skb->len-offset, 0);
+	*(u16*)(skb->h.raw + skb->csum) = csum_fold(csum);
+	skb->ip_summed = CHECKSUM_NONE;
+	return 0;
+}
+
 /**
  *	dev_queue_xmit - transmit a buffer
  *	@skb: buffer to transmit
@@ -905,6 +938,23 @@ int dev_queue_xmit(struct sk_buff *skb)
 	struct net_device *dev = skb->dev;
 	struct Qdisc  *q;
 
+	/* Paged data and offloaded checksums are only for devices
+	   which said they can take them. */
+	if (skb_is_nonlinear(skb) && !(dev->features&NETIF_F_SG) &&
+	    skb_linearize(skb, GFP_ATOMIC) != 0) {
+		kfree_skb(skb);
+		return -ENOMEM;
+	}
+
+	if (skb->ip_summed == CHECKSUM_PARTIAL &&
+	    !(dev->features&(NETIF_F_HW_CSUM|NETIF_F_NO_CSUM)) &&
+	    (!(dev->features&NETIF_F_IP_CSUM) ||
+	     skb->protocol != htons(ETH_P_IP)) &&
+	    skb_checksum_help(skb) != 0) {
+		kfree_skb(skb);
+		return -EINVAL;
+	}
+
 	/* Grab device queue */
 	spin_lock_bh(&dev->queue_lock);
 	q = dev->qdisc;
@@ -11,6 +11,7 @@
  */
 #include <linux/config.h>
 #include <linux/netfilter.h>
+#include <linux/netfilter_ipv4.h>
 #include <net/protocol.h>
 #include <linux/init.h>
 #include <linux/skbuff.h>
@@ -460,6 +461,19 @@ int nf_hook_slow(int pf, unsigned int hook, struct sk_buff *skb,
 	skb->nf_debug |= (1 << hook);
 #endif
 
+	/* Hooks look at and mangle the data in place: hand them a
+	   linear buffer with its checksum filled in. */
+	if (skb_is_nonlinear(skb) && skb_linearize(skb, GFP_ATOMIC) != 0) {
+		kfree_skb(skb);
+		return -ENOMEM;
+	}
+	if (pf == PF_INET && skb->ip_summed == CHECKSUM_PARTIAL &&
+	    (hook == NF_IP_LOCAL_OUT || hook == NF_IP_POST_ROUTING) &&
+	    skb_checksum_help(skb) != 0) {
+		kfree_skb(skb);
+		return -EINVAL;
+	}
+
 	elem = &nf_hooks[pf][hook];
 	verdict = nf_iterate(&nf_hooks[pf][hook], &skb, hook, indev,
 			     outdev, &elem, okfn);
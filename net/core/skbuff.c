@@ -187,7 +187,7 @@ struct sk_buff *alloc_skb(unsigned int size,int gfp_mask)
 
 	/* Get the DATA. Size must match skb_add_mtu(). */
 	size = ((size + 15) & ~15); 
-	data = kmalloc(size + sizeof(atomic_t), gfp_mask);
+	data = kmalloc(size + sizeof(struct skb_shared_info), gfp_mask);
 	if (data == NULL)
 		goto nodata;
 
@@ -202,10 +202,12 @@ struct sk_buff *alloc_skb(unsigned int size,int gfp_mask)
 
 	/* Set up other state */
 	skb->len = 0;
+	skb->data_len = 0;
 	skb->cloned = 0;
 
 	atomic_set(&skb->users, 1); 
 	atomic_set(skb_datarefp(skb), 1);
+	skb_shinfo(skb)->nr_frags = 0;
 	return skb;
 
 nodata:
@@ -249,14 +251,24 @@ static inline void skb_headerinit(void *p, kmem_cache_t *cache,
 #endif
 }
 
+/* Drop our reference to the data, and the pages it holds */
+static void skb_release_data(struct sk_buff *skb)
+{
+	if (!skb->cloned || atomic_dec_and_test(skb_datarefp(skb))) {
+		int i;
+
+		for (i = 0; i < skb_shinfo(skb)->nr_frags; i++)
+			put_page(skb_shinfo(skb)->frags[i].page);
+		kfree(skb->head);
+	}
+}
+
 /*
  *	Free an skbuff by memory without cleaning the state. 
  */
 void kfree_skbmem(struct sk_buff *skb)
 {
-	if (!skb->cloned || atomic_dec_and_test(skb_datarefp(skb)))  
-		kfree(skb->head);
-
+	skb_release_data(skb);
 	skb_head_to_pool(skb);
 }
 
@@ -388,22 +400,27 @@ static void copy_skb_header(struct sk_buff *new, const struct sk_buff *old)
 struct sk_buff *skb_copy(const struct sk_buff *skb, int gfp_mask)
 {
 	struct sk_buff *n;
+	int headerlen = skb->data-skb->head;
 
 	/*
 	 *	Allocate the copy buffer
 	 */
 	 
-	n=alloc_skb(skb->end - skb->head, gfp_mask);
+	n=alloc_skb(skb->end - skb->head + skb->data_len, gfp_mask);
 	if(n==NULL)
 		return NULL;
 
 	/* Set the data pointer */
-	skb_reserve(n,skb->data-skb->head);
+	skb_reserve(n,headerlen);
 	/* Set the tail pointer and length */
 	skb_put(n,skb->len);
-	/* Copy the bytes */
-	memcpy(n->head,skb->head,skb->end-skb->head);
+	/* Copy the bytes, paged ones included: the copy is linear */
+	if (skb_is_nonlinear(skb))
+		skb_copy_bits(skb, -headerlen, n->head, headerlen+skb->len);
+	else
+		memcpy(n->head,skb->head,skb->end-skb->head);
 	n->csum = skb->csum;
+	n->ip_summed = skb->ip_summed;
 	copy_skb_header(n, skb);
 
 	return n;
@@ -440,7 +457,7 @@ struct sk_buff *skb_copy_expand(const struct sk_buff *skb,
 	 *	Allocate the copy buffer
 	 */
  	 
-	n=alloc_skb(newheadroom + (skb->tail - skb->data) + newtailroom,
+	n=alloc_skb(newheadroom + skb->len + newtailroom,
 		    gfp_mask);
 	if(n==NULL)
 		return NULL;
@@ -451,12 +468,164 @@ struct sk_buff *skb_copy_expand(const struct sk_buff *skb,
 	skb_put(n,skb->len);
 
 	/* Copy the data only. */
-	memcpy(n->data, skb->data, skb->len);
+	skb_copy_bits(skb, 0, n->data, skb->len);
 
+	n->csum = skb->csum;
+	n->ip_summed = skb->ip_summed;
 	copy_skb_header(n, skb);
 	return n;
 }
 
+/**
+ *	skb_linearize - pull the paged data of a buffer into its linear area
+ *	@skb: buffer to linearize
+ *	@gfp_mask: allocation priority
+ *
+ *	Gives the buffer a private linear data area holding all of its
+ *	data, and drops its reference to the old one (a clone stops being
+ *	one). Returns 0, or -ENOMEM with the buffer left as it was.
+ */
+
+int skb_linearize(struct sk_buff *skb, int gfp_mask)
+{
+	unsigned int size;
+	u8 *data;
+	long offset;
+	int headerlen = skb->data - skb->head;
+	int expand = (skb->tail + skb->data_len) - skb->end;
+
+	if (expand <= 0)
+		expand = 0;
+
+	size = ((skb->end - skb->head + expand + 15) & ~15);
+	data = kmalloc(size + sizeof(struct skb_shared_info), gfp_mask);
+	if (data == NULL)
+		return -ENOMEM;
+
+	/* Copy the entire thing */
+	skb_copy_bits(skb, -headerlen, data, headerlen+skb->len);
+
+	/* Offset between the two in bytes */
+	offset = data - skb->head;
+
+	skb_release_data(skb);
+
+	skb->head = data;
+	skb->end = data + size;
+
+	skb->h.raw += offset;
+	skb->nh.raw += offset;
+	skb->mac.raw += offset;
+	skb->tail += offset;
+	skb->data += offset;
+
+	atomic_set(skb_datarefp(skb), 1);
+	skb_shinfo(skb)->nr_frags = 0;
+	skb->cloned = 0;
+
+	skb->tail += skb->data_len;
+	skb->data_len = 0;
+	return 0;
+}
+
+/**
+ *	skb_copy_bits - copy bits from a buffer, paged data included
+ *	@skb: source buffer
+ *	@offset: offset in the source, negative to reach into the headroom
+ *	@to: destination
+ *	@len: number of bytes to copy
+ *
+ *	Returns 0, or -EFAULT if the buffer is too short.
+ */
+
+int skb_copy_bits(const struct sk_buff *skb, int offset, void *to, int len)
+{
+	int i, copy;
+	int start = skb_headlen(skb);
+
+	if (offset > (int)skb->len-len)
+		return -EFAULT;
+
+	/* Copy the linear part */
+	if ((copy = start-offset) > 0) {
+		if (copy > len)
+			copy = len;
+		memcpy(to, skb->data + offset, copy);
+		if ((len -= copy) == 0)
+			return 0;
+		offset += copy;
+		to += copy;
+	}
+
+	for (i = 0; i < skb_shinfo(skb)->nr_frags; i++) {
+		skb_frag_t *frag = &skb_shinfo(skb)->frags[i];
+		int end = start + frag->size;
+
+		if ((copy = end-offset) > 0) {
+			if (copy > len)
+				copy = len;
+			memcpy(to, page_address(frag->page) + frag->page_offset +
+			       offset - start, copy);
+			if ((len -= copy) == 0)
+				return 0;
+			offset += copy;
+			to += copy;
+		}
+		start = end;
+	}
+	return len ? -EFAULT : 0;
+}
+
+/**
+ *	skb_checksum - checksum part of a buffer, paged data included
+ *	@skb: buffer
+ *	@offset: where to start, from skb->data
+ *	@len: number of bytes
+ *	@csum: checksum to add to
+ */
+
+unsigned int skb_checksum(const struct sk_buff *skb, int offset, int len, unsigned int csum)
+{
+	int i, copy;
+	int start = skb_headlen(skb);
+	int pos = 0;
+
+	if ((copy = start-offset) > 0) {
+		if (copy > len)
+			copy = len;
+		csum = csum_partial(skb->data + offset, copy, csum);
+		if ((len -= copy) == 0)
+			return csum;
+		offset += copy;
+		pos = copy;
+	}
+
+	for (i = 0; i < skb_shinfo(skb)->nr_frags; i++) {
+		skb_frag_t *frag = &skb_shinfo(skb)->frags[i];
+		int end = start + frag->size;
+
+		if ((copy = end-offset) > 0) {
+			unsigned int csum2;
+
+			if (copy > len)
+				copy = len;
+			csum2 = csum_partial(page_address(frag->page) +
+					     frag->page_offset + offset - start,
+					     copy, 0);
+			/* A piece that starts at an odd position is byte swapped */
+			csum = csum_block_add(csum, csum2, pos);
+			if ((len -= copy) == 0)
+				return csum;
+			offset += copy;
+			pos += copy;
+		}
+		start = end;
+	}
+	if (len)
+		BUG();
+	return csum;
+}
+
 #if 0
 /* 
  * 	Tune the memory allocator for a new MTU size.
@@ -464,7 +633,7 @@ struct sk_buff *skb_copy_expand(const struct sk_buff *skb,
 void skb_add_mtu(int mtu)
 {
 	/* Must match allocation in alloc_skb */
-	mtu = ((mtu + 15) & ~15) + sizeof(atomic_t);
+	mtu = ((mtu + 15) & ~15) + sizeof(struct skb_shared_info);
 
 	kmem_add_cache_size(mtu);
 }
@@ -934,7 +934,8 @@ struct proto_ops inet_stream_ops = {
 	getsockopt:	inet_getsockopt,
 	sendmsg:	inet_sendmsg,
 	recvmsg:	inet_recvmsg,
-	mmap:		sock_no_mmap
+	mmap:		sock_no_mmap,
+	sendpage:	tcp_sendpage,
 };
 
 struct proto_ops inet_dgram_ops = {
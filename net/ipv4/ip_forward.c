@@ -83,6 +83,9 @@ int ip_forward(struct sk_buff *skb)
 
 	if (skb->pkt_type != PACKET_HOST)
 		goto drop;
+
+	/* A checksum verified on receive means nothing on transmit */
+	skb->ip_summed = CHECKSUM_NONE;
 	
 	/*
 	 *	According to the RFC, we must first decrease the TTL field. If
@@ -358,6 +358,7 @@ int ip_queue_xmit(struct sk_buff *skb)
 				    sk->bound_dev_if))
 			goto no_route;
 		__sk_dst_set(sk, &rt->u.dst);
+		sk->route_caps = rt->u.dst.dev->features;
 	}
 	skb->dst = dst_clone(&rt->u.dst);
 
@@ -734,6 +735,13 @@ int ip_fragment(struct sk_buff *skb, int (*output)(struct sk_buff*))
 
 	dev = rt->u.dst.dev;
 
+	/* The fragments are cut out of a linear buffer, and a checksum
+	   left to the device would cover only the first of them. */
+	if (skb_is_nonlinear(skb) && (err = skb_linearize(skb, GFP_ATOMIC)) != 0)
+		goto fail;
+	if (skb->ip_summed == CHECKSUM_PARTIAL && (err = skb_checksum_help(skb)) != 0)
+		goto fail;
+
 	/*
 	 *	Point into the IP datagram header.
 	 */
@@ -1197,6 +1197,7 @@ static void ipmr_queue_xmit(struct sk_buff *skb, struct mfc_cache *c,
 	}
 
 	IPCB(skb2)->flags |= IPSKB_FORWARDED;
+	skb2->ip_summed = CHECKSUM_NONE;
 
 	/*
 	 * RFC1584 teaches, that DVMRP/PIM router must deliver packets locally
@@ -103,6 +103,7 @@ static unsigned int ipt_mirror_target(struct sk_buff **pskb,
 	if ((*pskb)->dst != NULL) {
 		if (route_mirror(*pskb)) {
 			ip_rewrite(*pskb);
+			(*pskb)->ip_summed = CHECKSUM_NONE;
 			/* Don't let conntrack code see this packet:
                            it will think we are starting a new
                            connection! --RR */
@@ -887,7 +887,7 @@ static long wait_for_tcp_memory(struct sock * sk, long timeo)
 }
 
 /* When all user supplied data has been queued set the PSH bit */
-#define PSH_NEEDED (seglen == 0 && iovlen == 0)
+#define PSH_NEEDED (seglen == 0 && iovlen == 0 && !(flags & MSG_MORE))
 
 /*
  *	This routine copies from a user buffer into a socket,
@@ -1093,7 +1093,8 @@ int tcp_sendmsg(struct sock *sk, struct msghdr *msg, int size)
 	}
 	err = copied;
 out:
-	__tcp_push_pending_frames(sk, tp, mss_now, tp->nonagle);
+	/* With more data on its way, hold back partial frames as TCP_CORK does */
+	__tcp_push_pending_frames(sk, tp, mss_now, (flags & MSG_MORE) ? 2 : tp->nonagle);
 out_unlock:
 	TCP_CHECK_TIMER(sk);
 	release_sock(sk);
@@ -1130,6 +1131,191 @@ do_fault2:
 
 #undef PSH_NEEDED
 
+static inline int tcp_can_coalesce(struct sk_buff *skb, int i, struct page *page, int off)
+{
+	if (i) {
+		skb_frag_t *frag = &skb_shinfo(skb)->frags[i-1];
+		return page == frag->page &&
+			off == frag->page_offset+frag->size;
+	}
+	return 0;
+}
+
+/*
+ *	Queue a page (of the page cache, usually) for sending without
+ *	copying it: the page is attached to the skb as a fragment. Only
+ *	done when the route's device can gather the fragments and sum the
+ *	data itself; otherwise the data has to be touched to be summed
+ *	anyway, and it is copied as in tcp_sendmsg().
+ */
+
+ssize_t tcp_sendpage(struct socket *sock, struct page *page, int offset, size_t size, int flags)
+{
+	struct sock *sk = sock->sk;
+	struct tcp_opt *tp = &(sk->tp_pinfo.af_tcp);
+	int mss_now;
+	int err, copied;
+	long timeo;
+
+	if (!(sk->route_caps & NETIF_F_SG) ||
+	    !(sk->route_caps & (NETIF_F_IP_CSUM|NETIF_F_NO_CSUM|NETIF_F_HW_CSUM)) ||
+	    PageHighMem(page))
+		return sock_no_sendpage(sock, page, offset, size, flags);
+
+	err = 0;
+
+	lock_sock(sk);
+	TCP_CHECK_TIMER(sk);
+
+	timeo = sock_sndtimeo(sk, flags&MSG_DONTWAIT);
+
+	/* Wait for a connection to finish. */
+	if ((1 << sk->state) & ~(TCPF_ESTABLISHED | TCPF_CLOSE_WAIT))
+		if((err = wait_for_tcp_connect(sk, flags, &timeo)) != 0)
+			goto out_unlock;
+
+	clear_bit(SOCK_ASYNC_NOSPACE, &sk->socket->flags);
+
+	mss_now = tcp_current_mss(sk);
+	copied = 0;
+
+	while (size > 0) {
+		struct sk_buff *skb = sk->write_queue.prev;
+		int copy, i, need, new_skb;
+
+		/* Stop on errors. */
+		if (sk->err)
+			goto do_sock_err;
+
+		/* Make sure that we are established. */
+		if (sk->shutdown & SEND_SHUTDOWN)
+			goto do_shutdown;
+
+		/* Tack the page onto a half built packet if it has room
+		 * for another fragment, else start a new one.
+		 */
+		new_skb = 0;
+		i = 0;
+		if (tp->send_head == NULL ||
+		    (copy = mss_now - skb->len) <= 0 ||
+		    ((i = skb_shinfo(skb)->nr_frags) >= MAX_SKB_FRAGS &&
+		     !tcp_can_coalesce(skb, i, page, offset))) {
+			skb = NULL;
+			if (tcp_memory_free(sk))
+				skb = tcp_alloc_skb(sk, MAX_TCP_HEADER, sk->allocation);
+			if (skb == NULL)
+				goto wait_for_memory;
+
+			skb_reserve(skb, MAX_TCP_HEADER);
+			skb->csum = 0;
+			TCP_SKB_CB(skb)->flags = TCPCB_FLAG_ACK;
+			TCP_SKB_CB(skb)->sacked = 0;
+			TCP_SKB_CB(skb)->seq = tp->write_seq;
+			TCP_SKB_CB(skb)->end_seq = tp->write_seq;
+			copy = mss_now;
+			new_skb = 1;
+			i = 0;
+		}
+
+		if (copy > size)
+			copy = size;
+
+		/* The page is charged to the socket as the bytes
+		 * tcp_sendmsg() would have copied are.
+		 */
+		need = copy + (new_skb ? skb->truesize : 0);
+		if (sk->forward_alloc < need && !tcp_mem_schedule(sk, need, 0)) {
+			if (new_skb)
+				__kfree_skb(skb);
+			goto wait_for_memory;
+		}
+
+		if (tcp_can_coalesce(skb, i, page, offset)) {
+			skb_shinfo(skb)->frags[i-1].size += copy;
+		} else {
+			get_page(page);
+			skb_shinfo(skb)->frags[i].page = page;
+			skb_shinfo(skb)->frags[i].page_offset = offset;
+			skb_shinfo(skb)->frags[i].size = copy;
+			skb_shinfo(skb)->nr_frags = i+1;
+		}
+		skb->len += copy;
+		skb->data_len += copy;
+		skb->truesize += copy;
+		skb->ip_summed = CHECKSUM_PARTIAL;
+
+		offset += copy;
+		copied += copy;
+		size -= copy;
+
+		if ((size == 0 && !(flags & MSG_MORE)) ||
+		    after(tp->write_seq+copy, tp->pushed_seq+(tp->max_window>>1))) {
+			TCP_SKB_CB(skb)->flags |= TCPCB_FLAG_PSH;
+			tp->pushed_seq = tp->write_seq + copy;
+		}
+
+		TCP_SKB_CB(skb)->end_seq += copy;
+		if (new_skb) {
+			/* This advances tp->write_seq for us. */
+			tcp_send_skb(sk, skb, skb->len < mss_now, mss_now);
+		} else {
+			sk->wmem_queued += copy;
+			sk->forward_alloc -= copy;
+			tp->write_seq += copy;
+		}
+		continue;
+
+wait_for_memory:
+		/* If we didn't get any memory, we need to sleep. */
+		set_bit(SOCK_ASYNC_NOSPACE, &sk->socket->flags);
+		set_bit(SOCK_NOSPACE, &sk->socket->flags);
+
+		__tcp_push_pending_frames(sk, tp, mss_now, 1);
+
+		if (!timeo) {
+			err = -EAGAIN;
+			goto do_interrupted;
+		}
+		if (signal_pending(current)) {
+			err = sock_intr_errno(timeo);
+			goto do_interrupted;
+		}
+		timeo = wait_for_tcp_memory(sk, timeo);
+
+		/* If SACK's were formed or PMTU events happened,
+		 * we must find out about it.
+		 */
+		mss_now = tcp_current_mss(sk);
+	}
+	err = copied;
+out:
+	__tcp_push_pending_frames(sk, tp, mss_now, (flags & MSG_MORE) ? 2 : tp->nonagle);
+out_unlock:
+	TCP_CHECK_TIMER(sk);
+	release_sock(sk);
+	return err;
+
+do_sock_err:
+	if (copied)
+		err = copied;
+	else
+		err = sock_error(sk);
+	goto out;
+do_shutdown:
+	if (copied)
+		err = copied;
+	else {
+		if (!(flags&MSG_NOSIGNAL))
+			send_sig(SIGPIPE, current, 0);
+		err = -EPIPE;
+	}
+	goto out;
+do_interrupted:
+	if (copied)
+		err = copied;
+	goto out_unlock;
+}
+
 /*
  *	Handle reading urgent data. BSD has very simple semantics for
  *	this, no blocking and very strange errors 8)
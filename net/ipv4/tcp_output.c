@@ -349,6 +349,10 @@ static int tcp_fragment(struct sock *sk, struct sk_buff *skb, u32 len)
 	int nsize = skb->len - len;
 	u16 flags;
 
+	/* Page fragments are cut in the linear area only. */
+	if (skb_is_nonlinear(skb) && skb_linearize(skb, GFP_ATOMIC) != 0)
+		return -ENOMEM;
+
 	/* Get a new skb... force flag on. */
 	buff = tcp_alloc_skb(sk, nsize + MAX_TCP_HEADER, GFP_ATOMIC);
 	if (buff == NULL)
@@ -373,16 +377,23 @@ static int tcp_fragment(struct sock *sk, struct sk_buff *skb, u32 len)
 	}
 	TCP_SKB_CB(buff)->sacked &= ~TCPCB_AT_TAIL;
 
-	/* Copy and checksum data tail into the new buffer. */
-	buff->csum = csum_partial_copy_nocheck(skb->data + len, skb_put(buff, nsize),
-					       nsize, 0);
+	if (skb->ip_summed == CHECKSUM_PARTIAL) {
+		/* The device sums both halves, just copy. */
+		memcpy(skb_put(buff, nsize), skb->data + len, nsize);
+		buff->ip_summed = CHECKSUM_PARTIAL;
+	} else {
+		/* Copy and checksum data tail into the new buffer. */
+		buff->csum = csum_partial_copy_nocheck(skb->data + len, skb_put(buff, nsize),
+						       nsize, 0);
+	}
 
 	/* This takes care of the FIN sequence number too. */
 	TCP_SKB_CB(skb)->end_seq = TCP_SKB_CB(buff)->seq;
 	skb_trim(skb, len);
 
 	/* Rechecksum original buffer. */
-	skb->csum = csum_partial(skb->data, skb->len, 0);
+	if (skb->ip_summed != CHECKSUM_PARTIAL)
+		skb->csum = csum_partial(skb->data, skb->len, 0);
 
 	/* Looks stupid, but our code really uses when of
 	 * skbs, which it never sent before. --ANK
@@ -623,6 +634,10 @@ static void tcp_retrans_try_collapse(struct sock *sk, struct sk_buff *skb, int m
 		if(TCP_SKB_CB(next_skb)->sacked & TCPCB_SACKED_ACKED)
 			return;
 
+		/* Paged data cannot be copied in with a memcpy. */
+		if (skb_is_nonlinear(next_skb))
+			return;
+
 		/* Next skb is out of window. */
 		if (after(TCP_SKB_CB(next_skb)->end_seq, tp->snd_una+tp->snd_wnd))
 			return;
@@ -769,6 +784,7 @@ int tcp_retransmit_skb(struct sock *sk, struct sk_buff *skb)
 	 * since it is cheap to do so and saves bytes on the network.
 	 */
 	if(skb->len > 0 &&
+	   !skb_is_nonlinear(skb) &&
 	   (TCP_SKB_CB(skb)->flags & TCPCB_FLAG_FIN) &&
 	   tp->snd_una == (TCP_SKB_CB(skb)->end_seq - 1)) {
 		TCP_SKB_CB(skb)->seq = TCP_SKB_CB(skb)->end_seq - 1;
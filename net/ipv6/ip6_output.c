@@ -800,6 +800,9 @@ int ip6_forward(struct sk_buff *skb)
 	if ((skb = skb_cow(skb, dst->dev->hard_header_len)) == NULL)
 		return 0;
 
+	/* A checksum verified on receive means nothing on transmit */
+	skb->ip_summed = CHECKSUM_NONE;
+
 	hdr = skb->nh.ipv6h;
 
 	/* Mangling hops number delayed to point after skb COW */
@@ -31,7 +31,6 @@
 #include <net/irda/irqueue.h>
 #include <net/irda/irlap.h>
 #include <net/irda/irlap_comp.h>
-#include "../../drivers/net/zlib.h"
 
 hashbin_t *irlap_compressors = NULL;
 
@@ -38,7 +38,6 @@
 #include <net/irda/irlap.h>
 #ifdef CONFIG_IRDA_COMPRESSION
 #include <net/irda/irlap_comp.h>
-#include "../../drivers/net/zlib.h"
 
 #define CI_BZIP2  27 /* Random pick */
 #endif